@@ -8,6 +8,7 @@ if [ "$TRAVIS_OS_NAME" = linux -o -z "$TRAVIS_OS_NAME" ]; then
     mkdir build && cd build
     cmake -DUSE_QT5=OFF .. 
     make -j4
+    ctest --output-on-failure
 elif [ "$TRAVIS_OS_NAME" = osx ]; then
     export Qt5_DIR=$(brew --prefix)/opt/qt5
     mkdir build && cd build
@@ -5,14 +5,20 @@
 #include <thread>
 
 #include "common/common.h"
+#include "common/file_util.h"
 #include "common/logging/text_formatter.h"
 #include "common/logging/backend.h"
 #include "common/logging/filter.h"
 #include "common/scope_exit.h"
+#include "common/trace.h"
 
 #include "core/settings.h"
 #include "core/system.h"
 #include "core/core.h"
+#include "core/movie.h"
+#include "core/rewind.h"
+#include "core/savestate.h"
+#include "core/arm/sampling_profiler.h"
 #include "core/loader/loader.h"
 
 #include "citra/config.h"
@@ -33,8 +39,28 @@ int __cdecl main(int argc, char **argv) {
         return -1;
     }
 
+    // Usage: citra <rom> [state] [--record <movie> | --play <movie>] [--trace <file>]
+    //              [--guest-profile <file>]
+    std::string state_filename, record_filename, play_filename, trace_filename;
+    std::string guest_profile_filename;
+    for (int i = 2; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--record" && i + 1 < argc) {
+            record_filename = argv[++i];
+        } else if (arg == "--play" && i + 1 < argc) {
+            play_filename = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace_filename = argv[++i];
+        } else if (arg == "--guest-profile" && i + 1 < argc) {
+            guest_profile_filename = argv[++i];
+        } else {
+            state_filename = arg;
+        }
+    }
+
     Config config;
     log_filter.ParseFilterString(Settings::values.log_filter);
+    Log::SetGlobalFilter(log_filter);
 
     std::string boot_filename = argv[1];
     EmuWindow_GLFW* emu_window = new EmuWindow_GLFW;
@@ -47,9 +73,50 @@ int __cdecl main(int argc, char **argv) {
         return -1;
     }
 
+    // Optionally start from a savestate, e.g. to skip the boot sequence of a test scenario
+    if (!state_filename.empty() && !SaveState::LoadFromFile(state_filename)) {
+        LOG_CRITICAL(Frontend, "Failed to load state %s", state_filename.c_str());
+        return -1;
+    }
+
+    // Movies start from here, so replaying one needs the same ROM and state as recording it
+    if (!record_filename.empty())
+        Movie::StartRecording(record_filename);
+    if (!play_filename.empty() && !Movie::StartPlayback(play_filename)) {
+        LOG_CRITICAL(Frontend, "Failed to play movie %s", play_filename.c_str());
+        return -1;
+    }
+
+    // The trace keeps the last events, F9 writes it out right after a stutter worth looking at
+    if (!trace_filename.empty())
+        Common::Trace::Start();
+    if (!guest_profile_filename.empty())
+        SamplingProfiler::Start(SamplingProfiler::DefaultConfig());
+
+    const std::string quick_save_filename = FileUtil::GetUserPath(D_STATESAVES_IDX) + "quick.cst";
     while (emu_window->IsOpen()) {
         Core::RunLoop();
+
+        if (emu_window->TakeSaveStateRequest())
+            SaveState::SaveToFile(quick_save_filename);
+        if (emu_window->TakeLoadStateRequest())
+            SaveState::LoadFromFile(quick_save_filename);
+        if (emu_window->TakeRewindRequest())
+            Rewind::StepBack();
+        if (emu_window->TakeTraceDumpRequest() && !trace_filename.empty())
+            Common::Trace::Dump(trace_filename);
+    }
+
+    Movie::Stop();
+    if (!trace_filename.empty()) {
+        Common::Trace::Stop();
+        Common::Trace::Dump(trace_filename);
+    }
+    if (!guest_profile_filename.empty()) {
+        SamplingProfiler::Stop();
+        SamplingProfiler::Dump(guest_profile_filename);
     }
+    SaveState::WaitForPendingSaves();
 
     delete emu_window;
 
@@ -59,9 +59,13 @@ void Config::ReadValues() {
     // Core
     Settings::values.cpu_core = glfw_config->GetInteger("Core", "cpu_core", Core::CPU_Interpreter);
     Settings::values.gpu_refresh_rate = glfw_config->GetInteger("Core", "gpu_refresh_rate", 60);
+    Settings::values.rewind_interval = glfw_config->GetInteger("Core", "rewind_interval", 0);
+    Settings::values.rewind_buffer_size = glfw_config->GetInteger("Core", "rewind_buffer_size", 64);
 
     // Data Storage
     Settings::values.use_virtual_sd = glfw_config->GetBoolean("Data Storage", "use_virtual_sd", true);
+    Settings::values.use_async_io = glfw_config->GetBoolean("Data Storage", "use_async_io", false);
+    Settings::values.use_code_cache = glfw_config->GetBoolean("Data Storage", "use_code_cache", false);
 
     // Miscellaneous
     Settings::values.log_filter = glfw_config->Get("Miscellaneous", "log_filter", "*:Info");
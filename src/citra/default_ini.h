@@ -29,9 +29,13 @@ pad_sright =
 [Core]
 cpu_core = ## 0: Interpreter (default), 1: FastInterpreter (experimental)
 gpu_refresh_rate = ## 60 (default)
+rewind_interval = ## 0: Rewind disabled (default), N: Capture a rewind state every N frames
+rewind_buffer_size = ## Memory budget of the rewind buffer in MB, 64 (default)
 
 [Data Storage]
 use_virtual_sd =
+use_async_io = ## 0: Synchronous file I/O (default), 1: Large reads and writes on host worker threads
+use_code_cache = ## 0: Decompress code on every boot (default), 1: Cache decompressed code in the user directory
 
 [Miscellaneous]
 log_filter = *:Info  ## Examples: *:Debug Kernel.SVC:Trace Service.*:Critical
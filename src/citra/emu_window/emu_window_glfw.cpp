@@ -5,9 +5,12 @@
 #include <GLFW/glfw3.h>
 
 #include "common/common.h"
+#include "common/scm_rev.h"
+#include "common/string_util.h"
 
 #include "video_core/video_core.h"
 
+#include "core/frame_pacing.h"
 #include "core/settings.h"
 
 #include "citra/emu_window/emu_window_glfw.h"
@@ -21,6 +24,24 @@ void EmuWindow_GLFW::OnKeyEvent(GLFWwindow* win, int key, int scancode, int acti
 
     int keyboard_id = GetEmuWindow(win)->keyboard_id;
 
+    if (action == GLFW_PRESS && key == GLFW_KEY_F5) {
+        GetEmuWindow(win)->save_state_requested = true;
+        return;
+    }
+    if (action == GLFW_PRESS && key == GLFW_KEY_F7) {
+        GetEmuWindow(win)->load_state_requested = true;
+        return;
+    }
+    // Holding the key keeps rewinding
+    if ((action == GLFW_PRESS || action == GLFW_REPEAT) && key == GLFW_KEY_BACKSPACE) {
+        GetEmuWindow(win)->rewind_requested = true;
+        return;
+    }
+    if (action == GLFW_PRESS && key == GLFW_KEY_F9) {
+        GetEmuWindow(win)->trace_dump_requested = true;
+        return;
+    }
+
     if (action == GLFW_PRESS) {
         EmuWindow::KeyPressed({key, keyboard_id});
     } else if (action == GLFW_RELEASE) {
@@ -55,6 +76,10 @@ void EmuWindow_GLFW::OnClientAreaResizeEvent(GLFWwindow* win, int width, int hei
 /// EmuWindow_GLFW constructor
 EmuWindow_GLFW::EmuWindow_GLFW() {
     keyboard_id = KeyMap::NewDeviceId();
+    save_state_requested = false;
+    load_state_requested = false;
+    rewind_requested = false;
+    trace_dump_requested = false;
 
     ReloadSetKeymaps();
 
@@ -109,6 +134,16 @@ EmuWindow_GLFW::~EmuWindow_GLFW() {
 /// Swap buffers to display the next frame
 void EmuWindow_GLFW::SwapBuffers() {
     glfwSwapBuffers(m_render_window);
+
+    // Show the frame statistics in the title, which is cheaper than drawing them on the screens
+    const auto now = std::chrono::steady_clock::now();
+    if (now - last_title_update >= std::chrono::seconds(1)) {
+        last_title_update = now;
+        const std::string title = Common::StringFromFormat("Citra | %s-%s | %s",
+            Common::g_scm_branch, Common::g_scm_desc,
+            FramePacing::FormatStats(FramePacing::GetStats()).c_str());
+        glfwSetWindowTitle(m_render_window, title.c_str());
+    }
 }
 
 /// Polls window events
@@ -156,3 +191,27 @@ void EmuWindow_GLFW::OnMinimalClientAreaChangeRequest(const std::pair<unsigned,u
     if (current_size != std::make_pair(new_width, new_height))
         glfwSetWindowSize(m_render_window, new_width, new_height);
 }
+
+bool EmuWindow_GLFW::TakeSaveStateRequest() {
+    bool requested = save_state_requested;
+    save_state_requested = false;
+    return requested;
+}
+
+bool EmuWindow_GLFW::TakeLoadStateRequest() {
+    bool requested = load_state_requested;
+    load_state_requested = false;
+    return requested;
+}
+
+bool EmuWindow_GLFW::TakeRewindRequest() {
+    bool requested = rewind_requested;
+    rewind_requested = false;
+    return requested;
+}
+
+bool EmuWindow_GLFW::TakeTraceDumpRequest() {
+    bool requested = trace_dump_requested;
+    trace_dump_requested = false;
+    return requested;
+}
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <chrono>
+
 #include "common/emu_window.h"
 
 struct GLFWwindow;
@@ -36,6 +38,18 @@ public:
 
     void ReloadSetKeymaps() override;
 
+    /// Returns true once after F5 was pressed, to save a quick savestate
+    bool TakeSaveStateRequest();
+
+    /// Returns true once after F7 was pressed, to load the quick savestate
+    bool TakeLoadStateRequest();
+
+    /// Returns true once after Backspace was pressed, to step back in the rewind buffer
+    bool TakeRewindRequest();
+
+    /// Returns true once after F9 was pressed, to write the recorded trace
+    bool TakeTraceDumpRequest();
+
 private:
     void OnMinimalClientAreaChangeRequest(const std::pair<unsigned,unsigned>& minimal_size) override;
 
@@ -45,4 +59,13 @@ private:
 
     /// Device id of keyboard for use with KeyMap
     int keyboard_id;
+
+    /// Savestate keys pressed, handled by the main loop between two runs of the core
+    bool save_state_requested;
+    bool load_state_requested;
+    bool rewind_requested;
+    bool trace_dump_requested;
+
+    /// Last time the frame statistics in the window title were updated
+    std::chrono::steady_clock::time_point last_title_update;
 };
@@ -0,0 +1,344 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "common/common.h"
+#include "common/file_util.h"
+#include "common/logging/backend.h"
+#include "common/logging/filter.h"
+#include "common/logging/text_formatter.h"
+#include "common/profiler.h"
+#include "common/scm_rev.h"
+#include "common/scope_exit.h"
+#include "common/string_util.h"
+#include "common/trace.h"
+
+#include "core/core.h"
+#include "core/frame_pacing.h"
+#include "core/movie.h"
+#include "core/savestate.h"
+#include "core/settings.h"
+#include "core/system.h"
+#include "core/arm/disassembler/load_symbol_map.h"
+#include "core/arm/dyncom/arm_dyncom_profiler.h"
+#include "core/arm/sampling_profiler.h"
+#include "core/loader/loader.h"
+
+#include "video_core/video_core.h"
+
+using Common::Profiling::Subsystem;
+
+static const char* USAGE =
+    "Usage: citra-bench <rom> [options]\n"
+    "Runs a program without a window and reports how fast it was emulated.\n"
+    "  --frames <n>       Stop after n emulated frames (default: 600, or the movie's length)\n"
+    "  --seconds <n>      Stop after n seconds\n"
+    "  --cpu <core>       CPU core, interpreter (default) or dyncom\n"
+    "  --state <file>     Start from a savestate\n"
+    "  --movie <file>     Replay a movie, so that every run emulates the same thing\n"
+    "  --json <file>      Also write the results as JSON, or only print them as JSON with -\n"
+    "  --log <filter>     Log filter (default: *:Warning)\n"
+    "  --trace <file>     Write a Chrome trace of the last frames of the run\n"
+    "  --cpu-profile <file>\n"
+    "                     Profile the dyncom core and write the report, or print it with -\n"
+    "  --guest-profile <file>\n"
+    "                     Sample the emulated program and write its collapsed stacks for\n"
+    "                     flamegraph.pl, or a report of its hottest functions if the file\n"
+    "                     name ends with .txt\n"
+    "  --symbols <file>   Symbol map naming the functions of the guest profile\n"
+    "The trace, the CPU profile and the vertex shader and rasterizer times are only\n"
+    "available in builds with ENABLE_PROFILING, without it the last two are counted in\n"
+    "the command processor time. Frame times are over the last frames of the run.\n";
+
+struct Results {
+    std::string rom;
+    u64 frames;
+    u64 emulated_ticks;
+    u64 instructions;
+    double seconds;
+    FramePacing::Stats frame_pacing;
+    std::array<Common::Profiling::SubsystemStats, (size_t)Subsystem::Count> subsystems;
+    std::string cpu_profile;    ///< Report of DyncomProfiler, if it was enabled
+};
+
+static std::string EscapeJSON(const std::string& str) {
+    std::string escaped;
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if ((unsigned char)c < 0x20) {
+            escaped += Common::StringFromFormat("\\u%04x", c);
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+/// Whether the time of a subsystem is measured in this build, see PROFILE_SUBSYSTEM_FINE
+static bool IsSubsystemTimed(Subsystem subsystem) {
+    return Common::Profiling::IS_ENABLED ||
+           (subsystem != Subsystem::VertexShader && subsystem != Subsystem::Rasterizer);
+}
+
+static std::string FormatText(const Results& results) {
+    const FramePacing::Stats& pacing = results.frame_pacing;
+    std::string text = Common::StringFromFormat(
+        "%s (%s)\n"
+        "  %llu frames in %.3f s: %.2f fps\n"
+        "  %llu instructions: %.2f MIPS\n"
+        "  frame times over the last %u frames: avg %.2f ms, p50 %.2f ms, p90 %.2f ms, "
+        "p99 %.2f ms, max %.2f ms\n",
+        results.rom.c_str(), Common::g_scm_desc, (unsigned long long)results.frames,
+        results.seconds, results.frames / results.seconds,
+        (unsigned long long)results.instructions, results.instructions / results.seconds / 1e6,
+        pacing.num_recent_frames, pacing.frame_time_avg_ms, pacing.frame_time_p50_ms,
+        pacing.frame_time_p90_ms, pacing.frame_time_p99_ms, pacing.frame_time_max_ms);
+
+    text += "  time breakdown (exclusive):\n";
+    for (size_t i = 1; i < (size_t)Subsystem::Count; ++i) {
+        if (!IsSubsystemTimed((Subsystem)i))
+            continue;
+        const auto& stats = results.subsystems[i];
+        const double seconds = Common::Profiling::TicksToNanoseconds(stats.total_ticks) / 1e9;
+        text += Common::StringFromFormat("    %-18s %9.3f s %6.1f%% %12llu calls\n",
+            Common::Profiling::GetSubsystemName((Subsystem)i), seconds,
+            seconds * 100 / results.seconds, (unsigned long long)stats.num_calls);
+    }
+    if (!Common::Profiling::IS_ENABLED)
+        text += "  (vertex shader and rasterizer counted in command processor, build with "
+                "ENABLE_PROFILING)\n";
+    return text;
+}
+
+static std::string FormatJSON(const Results& results) {
+    const FramePacing::Stats& pacing = results.frame_pacing;
+    std::string subsystems;
+    for (size_t i = 1; i < (size_t)Subsystem::Count; ++i) {
+        if (!IsSubsystemTimed((Subsystem)i))
+            continue;
+        const auto& stats = results.subsystems[i];
+        subsystems += Common::StringFromFormat(
+            "%s\n    \"%s\": {\"calls\": %llu, \"ns\": %.0f}", subsystems.empty() ? "" : ",",
+            Common::Profiling::GetSubsystemName((Subsystem)i),
+            (unsigned long long)stats.num_calls,
+            Common::Profiling::TicksToNanoseconds(stats.total_ticks));
+    }
+
+    return Common::StringFromFormat("{\n"
+        "  \"rom\": \"%s\",\n"
+        "  \"revision\": \"%s\",\n"
+        "  \"cpu_core\": %d,\n"
+        "  \"frames\": %llu,\n"
+        "  \"emulated_ticks\": %llu,\n"
+        "  \"instructions\": %llu,\n"
+        "  \"seconds\": %.6f,\n"
+        "  \"fps\": %.3f,\n"
+        "  \"instructions_per_second\": %.0f,\n"
+        "  \"frame_time_ms\": {\"frames\": %u, \"avg\": %.3f, \"p50\": %.3f, \"p90\": %.3f, "
+        "\"p99\": %.3f, \"max\": %.3f},\n"
+        "  \"subsystems\": {%s\n  }\n"
+        "}\n",
+        EscapeJSON(results.rom).c_str(), Common::g_scm_rev, Settings::values.cpu_core,
+        (unsigned long long)results.frames, (unsigned long long)results.emulated_ticks,
+        (unsigned long long)results.instructions, results.seconds,
+        results.frames / results.seconds, results.instructions / results.seconds,
+        pacing.num_recent_frames, pacing.frame_time_avg_ms, pacing.frame_time_p50_ms,
+        pacing.frame_time_p90_ms, pacing.frame_time_p99_ms, pacing.frame_time_max_ms,
+        subsystems.c_str());
+}
+
+struct Options {
+    std::string rom;
+    std::string state_filename;
+    std::string movie_filename;
+    std::string json_filename;
+    std::string cpu_profile_filename;
+    std::string guest_profile_filename;
+    std::string symbols_filename;
+    std::string trace_filename;
+    std::string log_filter = "*:Warning";
+    u64 max_frames = 0;
+    double max_seconds = 0;
+    int cpu_core = Core::CPU_Interpreter;
+};
+
+static bool ParseOptions(int argc, char** argv, Options& options) {
+    if (argc < 2 || argv[1][0] == '-')
+        return false;
+
+    options.rom = argv[1];
+    for (int i = 2; i + 1 < argc; i += 2) {
+        const std::string arg = argv[i];
+        const std::string value = argv[i + 1];
+
+        if (arg == "--frames") {
+            options.max_frames = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "--seconds") {
+            options.max_seconds = std::atof(value.c_str());
+        } else if (arg == "--cpu" && (value == "interpreter" || value == "dyncom")) {
+            options.cpu_core = (value == "dyncom") ? Core::CPU_FastInterpreter
+                                                   : Core::CPU_Interpreter;
+        } else if (arg == "--state") {
+            options.state_filename = value;
+        } else if (arg == "--movie") {
+            options.movie_filename = value;
+        } else if (arg == "--json") {
+            options.json_filename = value;
+        } else if (arg == "--log") {
+            options.log_filter = value;
+        } else if (arg == "--trace") {
+            options.trace_filename = value;
+        } else if (arg == "--cpu-profile") {
+            options.cpu_profile_filename = value;
+        } else if (arg == "--guest-profile") {
+            options.guest_profile_filename = value;
+        } else if (arg == "--symbols") {
+            options.symbols_filename = value;
+        } else {
+            return false;
+        }
+    }
+    if (argc % 2 != 0)
+        return false; // An option is missing its value
+
+    if (options.max_frames == 0 && options.max_seconds == 0 && options.movie_filename.empty())
+        options.max_frames = 600;
+    return true;
+}
+
+/**
+ * Boots the program and runs it until one of the limits of the options is reached
+ * @return True if the program was run, false if it failed to boot
+ */
+static bool RunBenchmark(const Options& options, Results& results) {
+    Loader::ResultStatus load_result = Loader::LoadFile(options.rom);
+    if (Loader::ResultStatus::Success != load_result) {
+        LOG_CRITICAL(Frontend, "Failed to load ROM (Error %i)!", (int)load_result);
+        return false;
+    }
+    if (!options.state_filename.empty() && !SaveState::LoadFromFile(options.state_filename)) {
+        LOG_CRITICAL(Frontend, "Failed to load state %s", options.state_filename.c_str());
+        return false;
+    }
+    if (!options.movie_filename.empty() && !Movie::StartPlayback(options.movie_filename)) {
+        LOG_CRITICAL(Frontend, "Failed to play movie %s", options.movie_filename.c_str());
+        return false;
+    }
+
+    Common::Profiling::ResetSubsystemStats();
+    FramePacing::Reset(Settings::values.gpu_refresh_rate);
+    if (!options.trace_filename.empty())
+        Common::Trace::Start();
+    DyncomProfiler::Reset();
+    DyncomProfiler::SetEnabled(!options.cpu_profile_filename.empty());
+    if (!options.guest_profile_filename.empty())
+        SamplingProfiler::Start(SamplingProfiler::DefaultConfig());
+    const int start_frame = VideoCore::g_renderer->current_frame();
+    const u64 start_ticks = Core::g_app_core->GetTicks();
+    const u64 start_instructions = Core::g_app_core->GetNumInstructions();
+    const auto start_time = std::chrono::steady_clock::now();
+
+    results.rom = options.rom;
+    while (true) {
+        Core::RunLoop();
+
+        results.frames = VideoCore::g_renderer->current_frame() - start_frame;
+        results.seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start_time).count();
+        if ((options.max_frames != 0 && results.frames >= options.max_frames) ||
+            (options.max_seconds != 0 && results.seconds >= options.max_seconds) ||
+            (!options.movie_filename.empty() && !Movie::IsActive())) {
+            break;
+        }
+    }
+
+    results.emulated_ticks = Core::g_app_core->GetTicks() - start_ticks;
+    results.instructions = Core::g_app_core->GetNumInstructions() - start_instructions;
+    results.frame_pacing = FramePacing::GetStats();
+    results.subsystems = Common::Profiling::g_subsystem_stats;
+    Common::Trace::Stop();
+    SamplingProfiler::Stop();
+    if (DyncomProfiler::IsEnabled()) {
+        // Formatted while the emulated memory is still mapped, for the listings of the hot blocks
+        results.cpu_profile = DyncomProfiler::FormatReport();
+        DyncomProfiler::SetEnabled(false);
+    }
+    return true;
+}
+
+/// Application entry point
+int __cdecl main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        fputs(USAGE, stderr);
+        return -1;
+    }
+
+    std::shared_ptr<Log::Logger> logger = Log::InitGlobalLogger();
+    Log::Filter log_filter(Log::Level::Debug);
+    log_filter.ParseFilterString(options.log_filter);
+    Log::SetGlobalFilter(log_filter);
+    std::thread logging_thread(Log::TextLoggingLoop, logger, &log_filter);
+    SCOPE_EXIT({
+        logger->Close();
+        logging_thread.join();
+    });
+
+    // Fixed settings rather than the user's configuration, so that results are comparable
+    Settings::values.cpu_core = options.cpu_core;
+    Settings::values.gpu_refresh_rate = 60;
+    Settings::values.rewind_interval = 0;
+    Settings::values.use_virtual_sd = true;
+    Settings::values.use_async_io = false;
+    Settings::values.use_code_cache = false;
+
+    if (!options.symbols_filename.empty())
+        LoadSymbolMap(options.symbols_filename);
+
+    System::Init(nullptr);
+    Results results;
+    const bool success = RunBenchmark(options, results);
+    System::Shutdown();
+    if (!success)
+        return -1;
+
+    if (!options.trace_filename.empty() && !Common::Trace::Dump(options.trace_filename))
+        return -1;
+
+    if (!options.guest_profile_filename.empty() &&
+        !SamplingProfiler::Dump(options.guest_profile_filename)) {
+        return -1;
+    }
+
+    const std::string& profile_filename = options.cpu_profile_filename;
+    if (profile_filename == "-") {
+        fputs(results.cpu_profile.c_str(), stdout);
+    } else if (!profile_filename.empty() && FileUtil::WriteStringToFile(true, results.cpu_profile,
+               profile_filename.c_str()) != results.cpu_profile.size()) {
+        LOG_ERROR(Frontend, "Failed to write %s", profile_filename.c_str());
+        return -1;
+    }
+
+    if (options.json_filename == "-") {
+        fputs(FormatJSON(results).c_str(), stdout);
+        return 0;
+    }
+
+    fputs(FormatText(results).c_str(), stdout);
+    if (!options.json_filename.empty()) {
+        const std::string json = FormatJSON(results);
+        if (FileUtil::WriteStringToFile(true, json, options.json_filename.c_str()) != json.size()) {
+            LOG_ERROR(Frontend, "Failed to write %s", options.json_filename.c_str());
+            return -1;
+        }
+    }
+
+    return 0;
+}
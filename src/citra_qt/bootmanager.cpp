@@ -12,6 +12,7 @@
 #include "bootmanager.hxx"
 
 #include "core/core.h"
+#include "core/rewind.h"
 #include "core/settings.h"
 
 #include "video_core/debug_utils/debug_utils.h"
@@ -27,7 +28,7 @@
 
 EmuThread::EmuThread(GRenderWindow* render_window) :
     filename(""), exec_cpu_step(false), cpu_running(false),
-    stop_run(false), render_window(render_window)
+    stop_run(false), rewind_requested(false), render_window(render_window)
 {
 }
 
@@ -44,6 +45,8 @@ void EmuThread::run()
         if (cpu_running)
         {
             Core::RunLoop();
+            if (rewind_requested.exchange(false))
+                Rewind::StepBack();
         }
         else if (exec_cpu_step)
         {
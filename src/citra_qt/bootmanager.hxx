@@ -52,6 +52,13 @@ public:
     */
     bool IsCpuRunning() { return cpu_running; }
 
+    /**
+     * Step back in the rewind buffer, between two runs of the CPU loop
+     *
+     * @note This function is thread-safe
+     */
+    void RequestRewind() { rewind_requested = true; }
+
 
 public slots:
     /**
@@ -72,6 +79,7 @@ private:
     bool exec_cpu_step;
     bool cpu_running;
     std::atomic<bool> stop_run;
+    std::atomic<bool> rewind_requested;
 
     GRenderWindow* render_window;
 
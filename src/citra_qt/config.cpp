@@ -45,10 +45,14 @@ void Config::ReadValues() {
     qt_config->beginGroup("Core");
     Settings::values.cpu_core = qt_config->value("cpu_core", Core::CPU_Interpreter).toInt();
     Settings::values.gpu_refresh_rate = qt_config->value("gpu_refresh_rate", 60).toInt();
+    Settings::values.rewind_interval = qt_config->value("rewind_interval", 0).toInt();
+    Settings::values.rewind_buffer_size = qt_config->value("rewind_buffer_size", 64).toInt();
     qt_config->endGroup();
 
     qt_config->beginGroup("Data Storage");
     Settings::values.use_virtual_sd = qt_config->value("use_virtual_sd", true).toBool();
+    Settings::values.use_async_io = qt_config->value("use_async_io", false).toBool();
+    Settings::values.use_code_cache = qt_config->value("use_code_cache", false).toBool();
     qt_config->endGroup();
 
     qt_config->beginGroup("Miscellaneous");
@@ -80,10 +84,14 @@ void Config::SaveValues() {
     qt_config->beginGroup("Core");
     qt_config->setValue("cpu_core", Settings::values.cpu_core);
     qt_config->setValue("gpu_refresh_rate", Settings::values.gpu_refresh_rate);
+    qt_config->setValue("rewind_interval", Settings::values.rewind_interval);
+    qt_config->setValue("rewind_buffer_size", Settings::values.rewind_buffer_size);
     qt_config->endGroup();
 
     qt_config->beginGroup("Data Storage");
     qt_config->setValue("use_virtual_sd", Settings::values.use_virtual_sd);
+    qt_config->setValue("use_async_io", Settings::values.use_async_io);
+    qt_config->setValue("use_code_cache", Settings::values.use_code_cache);
     qt_config->endGroup();
 
     qt_config->beginGroup("Miscellaneous");
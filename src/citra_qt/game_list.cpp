@@ -0,0 +1,325 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDirIterator>
+#include <QFile>
+#include <QHeaderView>
+#include <QIcon>
+#include <QMutexLocker>
+#include <QPixmap>
+#include <QStandardItemModel>
+#include <QThread>
+#include <QTreeView>
+#include <QVBoxLayout>
+
+#include "game_list.hxx"
+#include "game_list_p.hxx"
+
+#include "common/file_util.h"
+
+#include "core/loader/loader.h"
+#include "core/loader/ncch.h"
+#include "core/loader/smdh.h"
+
+static const quint32 GAME_LIST_INDEX_MAGIC   = 0x58444E49; // 'INDX'
+static const quint32 GAME_LIST_INDEX_VERSION = 1;
+
+static QDataStream& operator<<(QDataStream& stream, const GameListEntry& entry) {
+    return stream << entry.path << entry.modified << entry.size << (qint32)entry.file_type
+                  << entry.program_id << entry.title << entry.icon;
+}
+
+static QDataStream& operator>>(QDataStream& stream, GameListEntry& entry) {
+    qint32 file_type;
+    stream >> entry.path >> entry.modified >> entry.size >> file_type >> entry.program_id
+           >> entry.title >> entry.icon;
+    entry.file_type = file_type;
+    return stream;
+}
+
+/// Returns the path of the game list index in the user directory
+static QString GetIndexFilename() {
+    return QString::fromStdString(FileUtil::GetUserPath(D_CACHE_IDX) + "game_list.bin");
+}
+
+static QString GetFileTypeName(Loader::FileType file_type) {
+    switch (file_type) {
+    case Loader::FileType::CCI:      return "CCI";
+    case Loader::FileType::CXI:      return "CXI";
+    case Loader::FileType::ELF:      return "ELF";
+    case Loader::FileType::BIN:      return "BIN";
+    case Loader::FileType::THREEDSX: return "3DSX";
+    default:                         return "";
+    }
+}
+
+/**
+ * Reads the metadata of a file: the program ID, title and icon of NCCH based files, or just the
+ * file name for other formats
+ * @param info File to read
+ * @return Entry of the file for the game list
+ */
+static GameListEntry ReadEntry(const QFileInfo& info) {
+    GameListEntry entry;
+    entry.path = info.absoluteFilePath();
+    entry.modified = info.lastModified().toMSecsSinceEpoch();
+    entry.size = info.size();
+    entry.title = info.completeBaseName();
+
+    std::string filename = entry.path.toStdString();
+    Loader::FileType file_type = Loader::IdentifyFile(filename);
+    entry.file_type = static_cast<int>(file_type);
+    if (file_type != Loader::FileType::CCI && file_type != Loader::FileType::CXI)
+        return entry;
+
+    Loader::NCCHContainer container;
+    if (container.Open(filename) != Loader::ResultStatus::Success)
+        return entry;
+    entry.program_id = container.GetProgramId();
+
+    u64 icon_offset;
+    u32 icon_size;
+    if (!container.FindExeFSSection("icon", icon_offset, icon_size))
+        return entry;
+
+    std::vector<u8> icon_section(icon_size);
+    if (container.Read(icon_offset, icon_size, icon_section.data()) != icon_size ||
+        !Loader::SMDH::IsValid(icon_section)) {
+        return entry;
+    }
+
+    Loader::SMDH smdh;
+    memcpy(&smdh, icon_section.data(), sizeof(Loader::SMDH));
+
+    std::u16string title = smdh.GetShortTitle(Loader::SMDH::TitleLanguage::English);
+    if (!title.empty())
+        entry.title = QString::fromUtf16(reinterpret_cast<const ushort*>(title.data()), (int)title.size());
+
+    std::vector<u16> icon = smdh.GetIcon(true);
+    entry.icon = QImage(reinterpret_cast<const uchar*>(icon.data()), Loader::SMDH_LARGE_ICON_SIZE,
+                        Loader::SMDH_LARGE_ICON_SIZE, QImage::Format_RGB16).copy();
+    return entry;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GameListCache::Load(const QString& filename) {
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_8);
+
+    quint32 magic, version;
+    stream >> magic >> version;
+    if (magic != GAME_LIST_INDEX_MAGIC || version != GAME_LIST_INDEX_VERSION)
+        return;
+
+    QHash<QString, GameListEntry> entries;
+    stream >> entries;
+    if (stream.status() != QDataStream::Ok)
+        return;
+
+    QMutexLocker lock(&mutex);
+    indexed.swap(entries);
+}
+
+void GameListCache::Save(const QString& filename) const {
+    FileUtil::CreateFullPath(filename.toStdString());
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_8);
+
+    QMutexLocker lock(&mutex);
+    stream << GAME_LIST_INDEX_MAGIC << GAME_LIST_INDEX_VERSION << indexed;
+}
+
+void GameListCache::BeginScan(int new_scan_id) {
+    QMutexLocker lock(&mutex);
+    scan_id = new_scan_id;
+    found.clear();
+}
+
+void GameListCache::EndScan() {
+    QMutexLocker lock(&mutex);
+    indexed.swap(found);
+    found.clear();
+}
+
+bool GameListCache::Find(const QFileInfo& info, GameListEntry& entry) const {
+    QMutexLocker lock(&mutex);
+    auto it = indexed.find(info.absoluteFilePath());
+    if (it == indexed.end() || it->size != info.size() ||
+        it->modified != info.lastModified().toMSecsSinceEpoch()) {
+        return false;
+    }
+    entry = *it;
+    return true;
+}
+
+void GameListCache::Insert(const GameListEntry& entry, int entry_scan_id) {
+    QMutexLocker lock(&mutex);
+    // Tasks of a cancelled scan may still be running
+    if (entry_scan_id == scan_id)
+        found.insert(entry.path, entry);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GameListScan::Start(QRunnable* task) {
+    ++pending_tasks;
+    pool->start(task);
+}
+
+void GameListScan::FinishTask() {
+    if (--pending_tasks == 0 && !cancelled)
+        QMetaObject::invokeMethod(game_list, "OnScanFinished", Qt::QueuedConnection, Q_ARG(int, id));
+}
+
+void GameListDirectoryTask::run() {
+    for (const QString& directory : directories) {
+        QDirIterator it(directory, QDir::Files, QDirIterator::Subdirectories | QDirIterator::FollowSymlinks);
+        while (it.hasNext() && !scan->cancelled) {
+            it.next();
+            Loader::FileType file_type = Loader::IdentifyFile(it.filePath().toStdString());
+            if (file_type != Loader::FileType::Unknown && file_type != Loader::FileType::Error)
+                scan->Start(new GameListFileTask(scan, it.fileInfo()));
+        }
+    }
+    scan->FinishTask();
+}
+
+void GameListFileTask::run() {
+    if (!scan->cancelled) {
+        GameListEntry entry;
+        if (!scan->cache->Find(info, entry))
+            entry = ReadEntry(info);
+        scan->cache->Insert(entry, scan->id);
+
+        QMetaObject::invokeMethod(scan->game_list, "AddEntry", Qt::QueuedConnection,
+                                  Q_ARG(GameListEntry, entry), Q_ARG(int, scan->id));
+    }
+    scan->FinishTask();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+GameList::GameList(QWidget* parent) : QWidget(parent), current_scan_id(0), cache(new GameListCache)
+{
+    qRegisterMetaType<GameListEntry>("GameListEntry");
+
+    item_model = new QStandardItemModel(0, NUM_COLUMNS, this);
+    item_model->setHeaderData(COLUMN_NAME, Qt::Horizontal, tr("Name"));
+    item_model->setHeaderData(COLUMN_PROGRAM_ID, Qt::Horizontal, tr("Program ID"));
+    item_model->setHeaderData(COLUMN_FILE_TYPE, Qt::Horizontal, tr("File type"));
+    item_model->setHeaderData(COLUMN_SIZE, Qt::Horizontal, tr("Size"));
+    item_model->setHeaderData(COLUMN_PATH, Qt::Horizontal, tr("Path"));
+
+    tree_view = new QTreeView;
+    tree_view->setModel(item_model);
+    tree_view->setRootIsDecorated(false);
+    tree_view->setUniformRowHeights(true);
+    tree_view->setAlternatingRowColors(true);
+    tree_view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    tree_view->setSelectionBehavior(QAbstractItemView::SelectRows);
+    tree_view->setSortingEnabled(true);
+    tree_view->sortByColumn(COLUMN_NAME, Qt::AscendingOrder);
+    tree_view->setIconSize(QSize(Loader::SMDH_SMALL_ICON_SIZE, Loader::SMDH_SMALL_ICON_SIZE));
+
+    QVBoxLayout* layout = new QVBoxLayout;
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(tree_view);
+    setLayout(layout);
+
+    connect(tree_view, SIGNAL(activated(const QModelIndex&)), this, SLOT(OnItemActivated(const QModelIndex&)));
+
+    // Reading metadata is mostly waiting on the disk, so use more threads than there are cores
+    scan_pool.setMaxThreadCount(std::max(4, 2 * QThread::idealThreadCount()));
+
+    cache->Load(GetIndexFilename());
+}
+
+GameList::~GameList()
+{
+    CancelScan();
+    // The tasks of the cancelled scan still reference the list and its cache
+    scan_pool.waitForDone();
+}
+
+void GameList::PopulateAsync(const QStringList& directories)
+{
+    CancelScan();
+    item_model->removeRows(0, item_model->rowCount());
+
+    ++current_scan_id;
+    cache->BeginScan(current_scan_id);
+    current_scan = std::make_shared<GameListScan>(this, cache.get(), &scan_pool, current_scan_id);
+    current_scan->Start(new GameListDirectoryTask(current_scan, directories));
+}
+
+void GameList::CancelScan()
+{
+    if (current_scan == nullptr)
+        return;
+
+    // Don't wait for the tasks of the scan, the entries they still queue are ignored by AddEntry
+    // and GameListCache::Insert since they don't have the current scan ID
+    current_scan->cancelled = true;
+    current_scan.reset();
+}
+
+void GameList::AddEntry(GameListEntry entry, int scan_id)
+{
+    // Entries queued by a cancelled scan may still arrive
+    if (scan_id != current_scan_id)
+        return;
+
+    QStandardItem* name = new QStandardItem(entry.title);
+    name->setData(entry.path, Qt::UserRole);
+    if (!entry.icon.isNull())
+        name->setIcon(QIcon(QPixmap::fromImage(entry.icon)));
+
+    QString program_id;
+    if (entry.program_id != 0)
+        program_id = QString("%1").arg(entry.program_id, 16, 16, QChar('0')).toUpper();
+
+    QList<QStandardItem*> row;
+    row << name
+        << new QStandardItem(program_id)
+        << new QStandardItem(GetFileTypeName(static_cast<Loader::FileType>(entry.file_type)))
+        << new QStandardItem(QString("%1 MiB").arg(entry.size / (1024.0 * 1024.0), 0, 'f', 1))
+        << new QStandardItem(QDir::toNativeSeparators(entry.path));
+
+    // Keep the rows unsorted while the scan adds them, sorting every row would slow it down
+    item_model->appendRow(row);
+}
+
+void GameList::OnScanFinished(int scan_id)
+{
+    if (scan_id != current_scan_id)
+        return;
+
+    cache->EndScan();
+    cache->Save(GetIndexFilename());
+
+    QHeaderView* header = tree_view->header();
+    item_model->sort(header->sortIndicatorSection(), header->sortIndicatorOrder());
+    tree_view->resizeColumnToContents(COLUMN_NAME);
+}
+
+void GameList::OnItemActivated(const QModelIndex& index)
+{
+    QModelIndex name = item_model->index(index.row(), COLUMN_NAME);
+    emit GameChosen(name.data(Qt::UserRole).toString());
+}
@@ -0,0 +1,90 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <memory>
+
+#include <QImage>
+#include <QMetaType>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QWidget>
+
+#include "common/common_types.h"
+
+class QModelIndex;
+class QStandardItemModel;
+class QTreeView;
+
+class GameListCache;
+class GameListScan;
+
+/// Metadata of a file listed by the game list
+struct GameListEntry {
+    QString path;
+    qint64 modified; ///< Modification time of the file, in ms since the epoch
+    qint64 size;
+
+    int file_type;   ///< Loader::FileType of the file
+    quint64 program_id;
+    QString title;
+    QImage icon;
+
+    GameListEntry() : modified(0), size(0), file_type(0), program_id(0) {}
+};
+
+Q_DECLARE_METATYPE(GameListEntry)
+
+/**
+ * List of the games found in a set of directories. The directories are scanned in the background
+ * by a thread pool, and the list is filled in as the games are found. The metadata of the files is
+ * kept in an index on disk, so that rescans only read the files which changed since they were
+ * indexed.
+ */
+class GameList : public QWidget {
+    Q_OBJECT
+
+public:
+    enum {
+        COLUMN_NAME,
+        COLUMN_PROGRAM_ID,
+        COLUMN_FILE_TYPE,
+        COLUMN_SIZE,
+        COLUMN_PATH,
+        NUM_COLUMNS,
+    };
+
+    explicit GameList(QWidget* parent = nullptr);
+    ~GameList() override;
+
+    /**
+     * Starts scanning directories for games, replacing the current list
+     * @param directories Directories to scan, including their subdirectories
+     */
+    void PopulateAsync(const QStringList& directories);
+
+signals:
+    /// Emitted when a game of the list is activated (double-clicked)
+    void GameChosen(QString path);
+
+private slots:
+    void AddEntry(GameListEntry entry, int scan_id);
+    void OnScanFinished(int scan_id);
+    void OnItemActivated(const QModelIndex& index);
+
+private:
+    /// Stops the current scan, if any, without waiting for its tasks to finish
+    void CancelScan();
+
+    QTreeView* tree_view;
+    QStandardItemModel* item_model;
+
+    QThreadPool scan_pool;
+    std::shared_ptr<GameListScan> current_scan;
+    int current_scan_id;
+
+    std::unique_ptr<GameListCache> cache;
+};
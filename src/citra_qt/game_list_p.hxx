@@ -0,0 +1,107 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QRunnable>
+#include <QStringList>
+
+#include "game_list.hxx"
+
+/**
+ * Index of the metadata of the files found by previous scans, persisted between sessions. Entries
+ * are keyed by path, and are only valid as long as the modification time and size of their file
+ * are unchanged. Accessed concurrently by the scan tasks.
+ */
+class GameListCache {
+public:
+    /// Reads the index from disk, if it exists
+    void Load(const QString& filename);
+
+    /// Writes the index to disk
+    void Save(const QString& filename) const;
+
+    /**
+     * Prepares recording the entries found by a new scan
+     * @param scan_id ID of the scan, entries inserted by previous scans are ignored from now on
+     */
+    void BeginScan(int scan_id);
+
+    /// Replaces the index by the entries found by the scan that just completed
+    void EndScan();
+
+    /**
+     * Looks up the entry of a file
+     * @param info File to look up
+     * @param entry Receives the entry
+     * @return True if the file was indexed and hasn't changed since
+     */
+    bool Find(const QFileInfo& info, GameListEntry& entry) const;
+
+    /**
+     * Records the entry of a file found by a scan
+     * @param entry Entry of the file
+     * @param scan_id ID of the scan which found the file, ignored unless it is the current one
+     */
+    void Insert(const GameListEntry& entry, int scan_id);
+
+private:
+    mutable QMutex mutex;
+    QHash<QString, GameListEntry> indexed; ///< Entries from disk or from the last complete scan
+    QHash<QString, GameListEntry> found;   ///< Entries found by the current scan
+    int scan_id = 0;                       ///< ID of the current scan
+};
+
+/// State shared by the tasks of one scan
+class GameListScan {
+public:
+    GameListScan(GameList* game_list, GameListCache* cache, QThreadPool* pool, int id)
+        : game_list(game_list), cache(cache), pool(pool), id(id), cancelled(false), pending_tasks(0) {}
+
+    /// Queues a task of the scan on the pool
+    void Start(QRunnable* task);
+
+    /// Called by each task when it is done, reports the end of the scan after the last task
+    void FinishTask();
+
+    GameList* game_list;
+    GameListCache* cache;
+    QThreadPool* pool;
+    int id;
+
+    std::atomic<bool> cancelled;
+    std::atomic<int> pending_tasks;
+};
+
+/// Walks directories and queues a GameListFileTask for each file the loader can identify
+class GameListDirectoryTask : public QRunnable {
+public:
+    GameListDirectoryTask(std::shared_ptr<GameListScan> scan, const QStringList& directories)
+        : scan(scan), directories(directories) {}
+
+    void run() override;
+
+private:
+    std::shared_ptr<GameListScan> scan;
+    QStringList directories;
+};
+
+/// Reads the metadata of a file, from the index or from the file itself
+class GameListFileTask : public QRunnable {
+public:
+    GameListFileTask(std::shared_ptr<GameListScan> scan, const QFileInfo& info)
+        : scan(scan), info(info) {}
+
+    void run() override;
+
+private:
+    std::shared_ptr<GameListScan> scan;
+    QFileInfo info;
+};
@@ -13,12 +13,14 @@
 #include "common/logging/filter.h"
 #include "common/platform.h"
 #include "common/scope_exit.h"
+#include "common/trace.h"
 
 #if EMU_PLATFORM == PLATFORM_LINUX
 #include <unistd.h>
 #endif
 
 #include "bootmanager.hxx"
+#include "game_list.hxx"
 #include "hotkeys.hxx"
 
 //debugger
@@ -36,6 +38,8 @@
 #include "core/core.h"
 #include "core/loader/loader.h"
 #include "core/arm/disassembler/load_symbol_map.h"
+#include "core/arm/sampling_profiler.h"
+#include "core/hle/profiler.h"
 #include "citra_qt/config.h"
 
 #include "version.h"
@@ -52,6 +56,9 @@ GMainWindow::GMainWindow()
     render_window = new GRenderWindow;
     render_window->hide();
 
+    game_list = new GameList;
+    ui.horizontalLayout->addWidget(game_list);
+
     disasmWidget = new DisassemblerWidget(this, render_window->GetEmuThread());
     addDockWidget(Qt::BottomDockWidgetArea, disasmWidget);
     disasmWidget->hide();
@@ -88,6 +95,25 @@ GMainWindow::GMainWindow()
     debug_menu->addAction(graphicsCommandsWidget->toggleViewAction());
     debug_menu->addAction(graphicsBreakpointsWidget->toggleViewAction());
     debug_menu->addAction(graphicsFramebufferWidget->toggleViewAction());
+    debug_menu->addSeparator();
+    QAction* dump_hle_profile_action = debug_menu->addAction(tr("Dump HLE Profile..."));
+    connect(dump_hle_profile_action, SIGNAL(triggered()), this, SLOT(OnDumpHLEProfile()));
+    QAction* record_trace_action = debug_menu->addAction(tr("Record Trace"));
+    record_trace_action->setCheckable(true);
+    record_trace_action->setEnabled(Common::Profiling::IS_ENABLED);
+    connect(record_trace_action, SIGNAL(toggled(bool)), this, SLOT(OnRecordTrace(bool)));
+    QAction* dump_trace_action = debug_menu->addAction(tr("Dump Trace..."));
+    dump_trace_action->setEnabled(Common::Profiling::IS_ENABLED);
+    connect(dump_trace_action, SIGNAL(triggered()), this, SLOT(OnDumpTrace()));
+    QAction* sample_guest_action = debug_menu->addAction(tr("Sample Guest Code"));
+    sample_guest_action->setCheckable(true);
+    connect(sample_guest_action, SIGNAL(toggled(bool)), this, SLOT(OnSampleGuestCode(bool)));
+    QAction* dump_guest_profile_action = debug_menu->addAction(tr("Dump Guest Profile..."));
+    connect(dump_guest_profile_action, SIGNAL(triggered()), this, SLOT(OnDumpGuestProfile()));
+
+    QAction* add_game_directory_action = new QAction(tr("Add Game Directory..."), this);
+    ui.menu_File->insertAction(ui.action_Load_Symbol_Map, add_game_directory_action);
+    connect(add_game_directory_action, SIGNAL(triggered()), this, SLOT(OnMenuAddGameDirectory()));
 
     // Set default UI state
     // geometry: 55% of the window contents are in the upper screen half, 45% in the lower half
@@ -110,8 +136,11 @@ GMainWindow::GMainWindow()
     ui.action_Popout_Window_Mode->setChecked(settings.value("popoutWindowMode", true).toBool());
     ToggleWindowMode();
 
+    game_list->PopulateAsync(settings.value("gameListDirectories").toStringList());
+
     // Setup connections
     connect(ui.action_Load_File, SIGNAL(triggered()), this, SLOT(OnMenuLoadFile()));
+    connect(game_list, SIGNAL(GameChosen(QString)), this, SLOT(OnGameListLoadFile(QString)));
     connect(ui.action_Load_Symbol_Map, SIGNAL(triggered()), this, SLOT(OnMenuLoadSymbolMap()));
     connect(ui.action_Start, SIGNAL(triggered()), this, SLOT(OnStartGame()));
     connect(ui.action_Pause, SIGNAL(triggered()), this, SLOT(OnPauseGame()));
@@ -127,10 +156,12 @@ GMainWindow::GMainWindow()
     // Setup hotkeys
     RegisterHotkey("Main Window", "Load File", QKeySequence::Open);
     RegisterHotkey("Main Window", "Start Emulation");
+    RegisterHotkey("Main Window", "Rewind", QKeySequence(Qt::Key_Backspace));
     LoadHotkeys(settings);
 
     connect(GetHotkey("Main Window", "Load File", this), SIGNAL(activated()), this, SLOT(OnMenuLoadFile()));
     connect(GetHotkey("Main Window", "Start Emulation", this), SIGNAL(activated()), this, SLOT(OnStartGame()));
+    connect(GetHotkey("Main Window", "Rewind", this), SIGNAL(activated()), this, SLOT(OnRewind()));
 
     std::string window_title = Common::StringFromFormat("Citra | %s-%s", Common::g_scm_branch, Common::g_scm_desc);
     setWindowTitle(window_title.c_str());
@@ -169,6 +200,7 @@ void GMainWindow::BootGame(std::string filename)
     render_window->GetEmuThread().SetFilename(filename);
     render_window->GetEmuThread().start();
 
+    game_list->hide();
     render_window->show();
     OnStartGame();
 }
@@ -180,12 +212,64 @@ void GMainWindow::OnMenuLoadFile()
        BootGame(filename.toLatin1().data());
 }
 
+void GMainWindow::OnGameListLoadFile(QString path)
+{
+    BootGame(path.toStdString());
+}
+
+void GMainWindow::OnMenuAddGameDirectory()
+{
+    QString directory = QFileDialog::getExistingDirectory(this, tr("Add game directory"));
+    if (directory.isEmpty())
+        return;
+
+    QSettings settings(QSettings::IniFormat, QSettings::UserScope, "Citra team", "Citra");
+    QStringList directories = settings.value("gameListDirectories").toStringList();
+    if (!directories.contains(directory)) {
+        directories.append(directory);
+        settings.setValue("gameListDirectories", directories);
+    }
+    game_list->PopulateAsync(directories);
+}
+
 void GMainWindow::OnMenuLoadSymbolMap() {
     QString filename = QFileDialog::getOpenFileName(this, tr("Load symbol map"), QString(), tr("Symbol map (*)"));
     if (filename.size())
         LoadSymbolMap(filename.toLatin1().data());
 }
 
+void GMainWindow::OnDumpHLEProfile() {
+    QString filename = QFileDialog::getSaveFileName(this, tr("Dump HLE profile"), QString(), tr("JSON (*.json);;CSV (*.csv)"));
+    if (filename.size())
+        HLE::Profiler::Dump(filename.toLocal8Bit().data());
+}
+
+void GMainWindow::OnRecordTrace(bool record) {
+    if (record)
+        Common::Trace::Start();
+    else
+        Common::Trace::Stop();
+}
+
+void GMainWindow::OnDumpTrace() {
+    QString filename = QFileDialog::getSaveFileName(this, tr("Dump trace"), QString(), tr("Chrome trace (*.json)"));
+    if (filename.size())
+        Common::Trace::Dump(filename.toLocal8Bit().data());
+}
+
+void GMainWindow::OnSampleGuestCode(bool sample) {
+    if (sample)
+        SamplingProfiler::Start(SamplingProfiler::DefaultConfig());
+    else
+        SamplingProfiler::Stop();
+}
+
+void GMainWindow::OnDumpGuestProfile() {
+    QString filename = QFileDialog::getSaveFileName(this, tr("Dump guest profile"), QString(), tr("Collapsed stacks (*.folded);;Report (*.txt)"));
+    if (filename.size())
+        SamplingProfiler::Dump(filename.toLocal8Bit().data());
+}
+
 void GMainWindow::OnStartGame()
 {
     render_window->GetEmuThread().SetCpuRunning(true);
@@ -214,6 +298,12 @@ void GMainWindow::OnStopGame()
     ui.action_Stop->setEnabled(false);
 }
 
+void GMainWindow::OnRewind()
+{
+    // The emulation thread steps back once it's done with its current run of the CPU loop
+    render_window->GetEmuThread().RequestRewind();
+}
+
 void GMainWindow::OnOpenHotkeysDialog()
 {
     GHotkeysDialog dialog(this);
@@ -280,6 +370,7 @@ int __cdecl main(int argc, char* argv[])
     GMainWindow main_window;
     // After settings have been loaded by GMainWindow, apply the filter
     log_filter.ParseFilterString(Settings::values.log_filter);
+    Log::SetGlobalFilter(log_filter);
 
     main_window.show();
     return app.exec();
@@ -7,6 +7,7 @@
 
 class GImageInfo;
 class GRenderWindow;
+class GameList;
 class DisassemblerWidget;
 class RegistersWidget;
 class CallstackWidget;
@@ -36,10 +37,18 @@ private:
 
 private slots:
     void OnStartGame();
+    void OnGameListLoadFile(QString path);
+    void OnMenuAddGameDirectory();
     void OnPauseGame();
     void OnStopGame();
+    void OnRewind();
     void OnMenuLoadFile();
     void OnMenuLoadSymbolMap();
+    void OnDumpHLEProfile();
+    void OnRecordTrace(bool record);
+    void OnDumpTrace();
+    void OnSampleGuestCode(bool sample);
+    void OnDumpGuestProfile();
     void OnOpenHotkeysDialog();
     void OnConfigure();
     void ToggleWindowMode();
@@ -48,6 +57,7 @@ private:
     Ui::MainWindow ui;
 
     GRenderWindow* render_window;
+    GameList* game_list;
 
     DisassemblerWidget* disasmWidget;
     RegistersWidget* registersWidget;
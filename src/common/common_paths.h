@@ -65,6 +65,7 @@
 
 // Files in the directory returned by GetUserPath(D_LOGS_IDX)
 #define MAIN_LOG "emu.log"
+#define HLE_PROFILE "hle_profile.json"
 
 // Files in the directory returned by GetUserPath(D_SYSCONF_IDX)
 #define SYSCONF "SYSCONF"
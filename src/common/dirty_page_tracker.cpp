@@ -0,0 +1,310 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <csignal>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "common/common.h"
+#include "common/dirty_page_tracker.h"
+
+namespace Common {
+namespace DirtyPageTracker {
+
+struct Region {
+    u8* base;
+    size_t size;    ///< Size in bytes, a multiple of the page size
+    u32 first_page; ///< Number of the first page of the region
+    u32 num_pages;
+};
+
+static const size_t MAX_REGIONS = 16;
+
+// The regions are read by the fault handler, so they are only modified while tracking is disabled
+static Region regions[MAX_REGIONS];
+static size_t num_regions = 0;
+static u32 num_pages = 0;
+static size_t page_size = 0;
+static int page_shift = 0;
+
+/// One bit per page, set when the page was written to. Atomic so the fault handler can set them.
+static std::unique_ptr<std::atomic<u64>[]> dirty_bits;
+static std::atomic<bool> enabled(false);
+
+static size_t GetHostPageSize() {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+/// Changes the protection of whole pages. Async-signal-safe.
+static bool SetWritable(u8* pointer, size_t size, bool writable) {
+#ifdef _WIN32
+    DWORD old_protect;
+    return VirtualProtect(pointer, size, writable ? PAGE_READWRITE : PAGE_READONLY, &old_protect) != 0;
+#else
+    return mprotect(pointer, size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ) == 0;
+#endif
+}
+
+static const Region* FindRegion(const u8* pointer) {
+    for (size_t i = 0; i < num_regions; ++i) {
+        if (pointer >= regions[i].base && pointer < regions[i].base + regions[i].size)
+            return &regions[i];
+    }
+    return nullptr;
+}
+
+static void SetDirtyBits(u32 first_page, u32 count) {
+    for (u32 page = first_page; page < first_page + count; ++page)
+        dirty_bits[page / 64].fetch_or(1ULL << (page % 64));
+}
+
+/**
+ * Marks pages of a region dirty and makes them writable. The bits are set first, so that any write
+ * that gets through is accounted for. If the protection can't be changed (e.g. the host ran out of
+ * memory mappings because of too many split ones), the whole region is made dirty and writable
+ * instead, which merges its mappings again. Async-signal-safe.
+ */
+static void MakePagesDirty(const Region& region, u32 first, u32 count) {
+    SetDirtyBits(region.first_page + first, count);
+    if (SetWritable(region.base + ((size_t)first << page_shift), (size_t)count << page_shift, true))
+        return;
+
+    SetDirtyBits(region.first_page, region.num_pages);
+    SetWritable(region.base, region.size, true);
+}
+
+/// Handles a write to a protected page, returns false if the address isn't tracked
+static bool HandleFault(const void* address) {
+    if (!enabled)
+        return false;
+
+    const Region* region = FindRegion(static_cast<const u8*>(address));
+    if (region == nullptr)
+        return false;
+
+    MakePagesDirty(*region, (u32)((static_cast<const u8*>(address) - region->base) >> page_shift), 1);
+    return true;
+}
+
+#ifdef _WIN32
+
+static void* exception_handler = nullptr;
+
+static LONG NTAPI ExceptionHandler(PEXCEPTION_POINTERS info) {
+    const EXCEPTION_RECORD* record = info->ExceptionRecord;
+    // ExceptionInformation[0] is 1 for writes, [1] is the address
+    if (record->ExceptionCode == EXCEPTION_ACCESS_VIOLATION && record->ExceptionInformation[0] == 1 &&
+        HandleFault(reinterpret_cast<const void*>(record->ExceptionInformation[1]))) {
+        return EXCEPTION_CONTINUE_EXECUTION;
+    }
+    return EXCEPTION_CONTINUE_SEARCH;
+}
+
+static bool InstallHandler() {
+    exception_handler = AddVectoredExceptionHandler(1, ExceptionHandler);
+    return exception_handler != nullptr;
+}
+
+static void RemoveHandler() {
+    RemoveVectoredExceptionHandler(exception_handler);
+    exception_handler = nullptr;
+}
+
+#else
+
+static struct sigaction old_segv_action;
+static struct sigaction old_bus_action; ///< Protection faults raise SIGBUS on OS X
+
+static void FaultHandler(int sig, siginfo_t* info, void* context) {
+    if (HandleFault(info->si_addr))
+        return;
+
+    // Not a tracked page, pass the fault on to the previous handler
+    const struct sigaction& old_action = (sig == SIGSEGV) ? old_segv_action : old_bus_action;
+    if (old_action.sa_flags & SA_SIGINFO) {
+        old_action.sa_sigaction(sig, info, context);
+    } else if (old_action.sa_handler != SIG_DFL && old_action.sa_handler != SIG_IGN) {
+        old_action.sa_handler(sig);
+    } else {
+        // Returning retries the access, which then faults again with the default action
+        sigaction(sig, &old_action, nullptr);
+    }
+}
+
+static bool InstallHandler() {
+    struct sigaction action;
+    action.sa_sigaction = FaultHandler;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    return sigaction(SIGSEGV, &action, &old_segv_action) == 0 &&
+           sigaction(SIGBUS, &action, &old_bus_action) == 0;
+}
+
+static void RemoveHandler() {
+    sigaction(SIGSEGV, &old_segv_action, nullptr);
+    sigaction(SIGBUS, &old_bus_action, nullptr);
+}
+
+#endif
+
+void AddRegion(u8* base, size_t size) {
+    _dbg_assert_msg_(Common_Memory, !enabled, "regions can't be added while tracking");
+    _dbg_assert_msg_(Common_Memory, num_regions < MAX_REGIONS, "too many regions");
+
+    if (page_size == 0) {
+        page_size = GetHostPageSize();
+        while (((size_t)1 << page_shift) < page_size)
+            ++page_shift;
+    }
+    _dbg_assert_msg_(Common_Memory, ((size_t)base & (page_size - 1)) == 0, "region isn't page aligned");
+
+    Region& region = regions[num_regions++];
+    region.base = base;
+    region.num_pages = (u32)((size + page_size - 1) >> page_shift);
+    region.size = (size_t)region.num_pages << page_shift;
+    region.first_page = num_pages;
+    num_pages += region.num_pages;
+}
+
+void ClearRegions() {
+    Disable();
+    num_regions = 0;
+    num_pages = 0;
+}
+
+bool Enable() {
+    if (enabled)
+        return true;
+
+    const u32 num_words = (num_pages + 63) / 64;
+    dirty_bits.reset(new std::atomic<u64>[num_words]);
+    for (u32 i = 0; i < num_words; ++i)
+        dirty_bits[i] = 0;
+
+    if (!InstallHandler()) {
+        LOG_ERROR(Common_Memory, "Failed to install the write fault handler");
+        return false;
+    }
+    enabled = true;
+
+    for (size_t i = 0; i < num_regions; ++i) {
+        if (!SetWritable(regions[i].base, regions[i].size, false)) {
+            LOG_ERROR(Common_Memory, "Failed to write protect %p (size 0x%zx)",
+                      regions[i].base, regions[i].size);
+            Disable();
+            return false;
+        }
+    }
+    return true;
+}
+
+void Disable() {
+    if (!enabled)
+        return;
+
+    for (size_t i = 0; i < num_regions; ++i)
+        SetWritable(regions[i].base, regions[i].size, true);
+    enabled = false;
+    RemoveHandler();
+}
+
+bool IsEnabled() {
+    return enabled;
+}
+
+size_t GetPageSize() {
+    return page_size;
+}
+
+u32 GetNumPages() {
+    return num_pages;
+}
+
+u8* GetPagePointer(u32 page) {
+    for (size_t i = 0; i < num_regions; ++i) {
+        const Region& region = regions[i];
+        if (page >= region.first_page && page < region.first_page + region.num_pages)
+            return region.base + ((size_t)(page - region.first_page) << page_shift);
+    }
+    return nullptr;
+}
+
+void TakeDirtyPages(std::vector<u32>& pages) {
+    pages.clear();
+    if (!enabled)
+        return;
+
+    for (size_t i = 0; i < num_regions; ++i) {
+        const Region& region = regions[i];
+        const u32 end = region.first_page + region.num_pages;
+        u32 page = region.first_page;
+
+        while (page < end) {
+            // Skip clean words quickly, most of memory is untouched between two calls
+            if (page % 64 == 0 && dirty_bits[page / 64].load(std::memory_order_relaxed) == 0) {
+                page += 64;
+                continue;
+            }
+
+            const u64 bit = 1ULL << (page % 64);
+            if (!(dirty_bits[page / 64].fetch_and(~bit) & bit)) {
+                ++page;
+                continue;
+            }
+
+            // Re-protect runs of dirty pages with a single call
+            const u32 run_start = page;
+            pages.push_back(page++);
+            while (page < end) {
+                const u64 next_bit = 1ULL << (page % 64);
+                if (!(dirty_bits[page / 64].fetch_and(~next_bit) & next_bit))
+                    break;
+                pages.push_back(page++);
+            }
+
+            const u32 count = page - run_start;
+            u8* pointer = region.base + ((size_t)(run_start - region.first_page) << page_shift);
+            if (!SetWritable(pointer, (size_t)count << page_shift, false)) {
+                // Leave the pages writable and dirty, they are collected again next time
+                SetDirtyBits(run_start, count);
+            }
+        }
+    }
+}
+
+void MarkDirty(void* pointer, size_t size) {
+    if (!enabled || size == 0)
+        return;
+
+    const u8* start = static_cast<const u8*>(pointer);
+    const u8* end = start + size;
+    for (size_t i = 0; i < num_regions; ++i) {
+        const Region& region = regions[i];
+        const u8* low = std::max(start, (const u8*)region.base);
+        const u8* high = std::min(end, (const u8*)region.base + region.size);
+        if (low >= high)
+            continue;
+
+        const u32 first = (u32)((low - region.base) >> page_shift);
+        const u32 last = (u32)((high - 1 - region.base) >> page_shift);
+        MakePagesDirty(region, first, last - first + 1);
+    }
+}
+
+} // namespace
+} // namespace
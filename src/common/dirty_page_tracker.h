@@ -0,0 +1,70 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <vector>
+
+#include "common/common_types.h"
+
+/**
+ * Tracks which pages of a set of memory regions have been written to since they were last
+ * collected. Tracked pages are write-protected; the first write to one faults, the fault handler
+ * marks the page dirty and makes it writable again, so the tracking costs one fault per page per
+ * collection and nothing on other accesses.
+ *
+ * Pages are numbered consecutively across the regions, in the order the regions were added. The
+ * host OS can't write to protected pages (e.g. a file read straight into tracked memory fails), so
+ * such writes have to be announced with MarkDirty first.
+ */
+namespace Common {
+namespace DirtyPageTracker {
+
+/**
+ * Adds a region of memory to track. Regions can only be added while tracking is disabled.
+ * @param base Start of the region, must be page aligned
+ * @param size Size of the region, rounded up to whole pages
+ */
+void AddRegion(u8* base, size_t size);
+
+/// Forgets all the regions, disabling tracking first if needed
+void ClearRegions();
+
+/**
+ * Starts tracking the regions, all pages start out clean
+ * @return False if tracking isn't supported on this host
+ */
+bool Enable();
+
+/// Stops tracking, making all the regions writable again
+void Disable();
+
+/// Returns true if the regions are being tracked
+bool IsEnabled();
+
+/// Size of the tracked pages, in bytes
+size_t GetPageSize();
+
+/// Total number of pages in all the regions
+u32 GetNumPages();
+
+/// Returns a pointer to the start of a page
+u8* GetPagePointer(u32 page);
+
+/**
+ * Collects the pages written to since the last call, and starts tracking them again. Must not
+ * race with writes to the tracked memory, or those writes might be missed.
+ * @param pages Receives the numbers of the dirty pages, in increasing order
+ */
+void TakeDirtyPages(std::vector<u32>& pages);
+
+/**
+ * Marks the pages overlapping a range as dirty and makes them writable, before they are written
+ * to by something that doesn't go through the fault handler. Memory outside the tracked regions
+ * is ignored. Safe to call from any thread.
+ */
+void MarkDirty(void* pointer, size_t size);
+
+} // namespace
+} // namespace
@@ -16,7 +16,10 @@
 #include <tchar.h>
 #else
 #include <sys/param.h>
+#include <sys/mman.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 #if defined(__APPLE__)
@@ -26,6 +29,7 @@
 #endif
 
 #include <algorithm>
+#include <limits>
 #include <sys/stat.h>
 
 #ifndef S_ISDIR
@@ -244,6 +248,36 @@ bool Rename(const std::string &srcFilename, const std::string &destFilename)
     return false;
 }
 
+// renames file srcFilename to destFilename, atomically replacing destFilename if it exists,
+// returns true on success
+bool Replace(const std::string &srcFilename, const std::string &destFilename)
+{
+    LOG_TRACE(Common_Filesystem, "%s --> %s",
+            srcFilename.c_str(), destFilename.c_str());
+#ifdef _WIN32
+    // rename() fails on Windows when the destination exists
+    if (MoveFileEx(Common::UTF8ToTStr(srcFilename).c_str(), Common::UTF8ToTStr(destFilename).c_str(),
+                   MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+        return true;
+#else
+    if (rename(srcFilename.c_str(), destFilename.c_str()) == 0) {
+        // The new directory entry is only durable once the directory itself is synced
+        const size_t separator = destFilename.find_last_of('/');
+        const std::string directory = (separator == std::string::npos) ? "." :
+                                      destFilename.substr(0, separator + 1);
+        int fd = open(directory.c_str(), O_RDONLY);
+        if (fd != -1) {
+            fsync(fd);
+            close(fd);
+        }
+        return true;
+    }
+#endif
+    LOG_ERROR(Common_Filesystem, "failed %s --> %s: %s",
+              srcFilename.c_str(), destFilename.c_str(), GetLastErrorMsg());
+    return false;
+}
+
 // copies file srcFilename to destFilename, returns true on success
 bool Copy(const std::string &srcFilename, const std::string &destFilename)
 {
@@ -922,6 +956,20 @@ bool IOFile::Flush()
     return m_good;
 }
 
+bool IOFile::Sync()
+{
+    if (!Flush() || 0 !=
+#ifdef _WIN32
+        _commit(_fileno(m_file))
+#else
+        fsync(fileno(m_file))
+#endif
+    )
+        m_good = false;
+
+    return m_good;
+}
+
 bool IOFile::Resize(u64 size)
 {
     if (!IsOpen() || 0 !=
@@ -939,4 +987,108 @@ bool IOFile::Resize(u64 size)
     return m_good;
 }
 
+MappedFile::MappedFile()
+    : m_view(nullptr), m_view_size(0), m_data(nullptr), m_size(0)
+{}
+
+MappedFile::MappedFile(const std::string& filename, u64 offset, u64 size)
+    : m_view(nullptr), m_view_size(0), m_data(nullptr), m_size(0)
+{
+    Open(filename, offset, size);
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const std::string& filename, u64 offset, u64 size)
+{
+    Close();
+
+    if (size == 0)
+        return false;
+
+    // Mappings must start at a multiple of the allocation granularity
+#ifdef _WIN32
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    const u64 granularity = system_info.dwAllocationGranularity;
+#else
+    const u64 granularity = sysconf(_SC_PAGESIZE);
+#endif
+    const u64 view_offset = offset - (offset % granularity);
+    const u64 view_size = size + (offset - view_offset);
+
+    if (view_size > std::numeric_limits<size_t>::max()) {
+        LOG_ERROR(Common_Filesystem, "Region of %s is too large to be mapped", filename.c_str());
+        return false;
+    }
+
+#ifdef _WIN32
+    HANDLE file = CreateFile(Common::UTF8ToTStr(filename).c_str(), GENERIC_READ, FILE_SHARE_READ,
+                             nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        LOG_ERROR(Common_Filesystem, "Failed to open %s: %s", filename.c_str(), GetLastErrorMsg());
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping != nullptr) {
+        m_view = MapViewOfFile(mapping, FILE_MAP_READ, (DWORD)(view_offset >> 32),
+                               (DWORD)view_offset, (SIZE_T)view_size);
+        // The view keeps the mapping alive on its own
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1) {
+        LOG_ERROR(Common_Filesystem, "Failed to open %s: %s", filename.c_str(), GetLastErrorMsg());
+        return false;
+    }
+
+    // Pages past the end of the file can be mapped, but accessing them raises SIGBUS
+    struct stat file_info;
+    if (fstat(fd, &file_info) != 0 || offset > (u64)file_info.st_size ||
+        size > (u64)file_info.st_size - offset) {
+        LOG_ERROR(Common_Filesystem, "Region of %s is past the end of the file", filename.c_str());
+        close(fd);
+        return false;
+    }
+
+    m_view = mmap(nullptr, (size_t)view_size, PROT_READ, MAP_SHARED, fd, (off_t)view_offset);
+    if (m_view == MAP_FAILED)
+        m_view = nullptr;
+    // The mapping holds its own reference to the file
+    close(fd);
+#endif
+
+    if (m_view == nullptr) {
+        LOG_ERROR(Common_Filesystem, "Failed to map %s: %s", filename.c_str(), GetLastErrorMsg());
+        return false;
+    }
+
+    m_view_size = (size_t)view_size;
+    m_data = static_cast<const u8*>(m_view) + (offset - view_offset);
+    m_size = size;
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (m_view != nullptr) {
+#ifdef _WIN32
+        UnmapViewOfFile(m_view);
+#else
+        munmap(m_view, m_view_size);
+#endif
+    }
+
+    m_view = nullptr;
+    m_view_size = 0;
+    m_data = nullptr;
+    m_size = 0;
+}
+
 } // namespace
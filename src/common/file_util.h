@@ -92,6 +92,10 @@ bool DeleteDir(const std::string &filename);
 // renames file srcFilename to destFilename, returns true on success
 bool Rename(const std::string &srcFilename, const std::string &destFilename);
 
+// renames file srcFilename to destFilename, atomically replacing destFilename if it exists, and
+// waits for the rename to reach the disk, returns true on success
+bool Replace(const std::string &srcFilename, const std::string &destFilename);
+
 // copies file srcFilename to destFilename, returns true on success
 bool Copy(const std::string &srcFilename, const std::string &destFilename);
 
@@ -222,6 +226,8 @@ public:
     u64 GetSize();
     bool Resize(u64 size);
     bool Flush();
+    // flushes the file, and waits for its contents to reach the disk
+    bool Sync();
 
     // clear error state
     void Clear() { m_good = true; std::clearerr(m_file); }
@@ -233,6 +239,32 @@ private:
     IOFile& operator=(IOFile& other);
 };
 
+// Read-only memory mapping of a region of a file. Pages are only read from disk when they are first
+// accessed, and are shared with the host page cache (and with any other process mapping the file).
+class MappedFile : public NonCopyable
+{
+public:
+    MappedFile();
+    MappedFile(const std::string& filename, u64 offset, u64 size);
+
+    ~MappedFile();
+
+    bool Open(const std::string& filename, u64 offset, u64 size);
+    void Close();
+
+    bool IsOpen() const { return nullptr != m_data; }
+
+    // Pointer to the first byte of the mapped region, or nullptr if the file isn't mapped
+    const u8* GetData() const { return m_data; }
+    u64 GetSize() const { return m_size; }
+
+private:
+    void* m_view;       // Start of the mapping, aligned down to the allocation granularity
+    size_t m_view_size;
+    const u8* m_data;
+    u64 m_size;
+};
+
 }  // namespace
 
 // To deal with Windows being dumb at unicode:
@@ -3,10 +3,14 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <array>
+#include <cstring>
+#include <thread>
 
 #include "common/log.h" // For _dbg_assert_
 
 #include "common/logging/backend.h"
+#include "common/logging/filter.h"
 #include "common/logging/log.h"
 #include "common/logging/text_formatter.h"
 
@@ -14,6 +18,8 @@ namespace Log {
 
 static std::shared_ptr<Logger> global_logger;
 
+std::atomic<Level> g_class_levels[(size_t)Class::Count];
+
 /// Macro listing all log classes. Code should define CLS and SUB as desired before invoking this.
 #define ALL_LOG_CLASSES() \
         CLS(Log) \
@@ -22,6 +28,8 @@ static std::shared_ptr<Logger> global_logger;
         SUB(Common, Memory) \
         CLS(Core) \
         SUB(Core, ARM11) \
+        SUB(Core, Movie) \
+        SUB(Core, SaveState) \
         CLS(Config) \
         CLS(Debug) \
         SUB(Debug, Emulated) \
@@ -48,7 +56,14 @@ static std::shared_ptr<Logger> global_logger;
         SUB(Render, OpenGL) \
         CLS(Loader)
 
-Logger::Logger() {
+Logger::Logger()
+    : queue(new Cell[QUEUE_SIZE]), enqueue_position(0), dequeue_position(0), closed(false),
+      reader_waiting(false) {
+
+    for (size_t i = 0; i < QUEUE_SIZE; ++i) {
+        queue[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
     // Register logging classes so that they can be queried at runtime
     size_t parent_class;
     all_classes.reserve((size_t)Class::Count);
@@ -94,12 +109,82 @@ const char* Logger::GetLevelName(Level log_level) {
 #undef LVL
 }
 
-void Logger::LogMessage(Entry entry) {
-    ring_buffer.Push(std::move(entry));
+Record* Logger::AcquireRecord() {
+    size_t position = enqueue_position.load(std::memory_order_relaxed);
+    while (!closed) {
+        Cell& cell = queue[position & (QUEUE_SIZE - 1)];
+        const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        const ptrdiff_t difference = (ptrdiff_t)sequence - (ptrdiff_t)position;
+
+        if (difference == 0) {
+            // The cell is free, try to claim it
+            if (enqueue_position.compare_exchange_weak(position, position + 1,
+                                                       std::memory_order_relaxed)) {
+                cell.record.queue_position = position;
+                return &cell.record;
+            }
+        } else {
+            if (difference < 0) {
+                // The queue is full, give the logging thread a chance to drain it
+                std::this_thread::yield();
+            }
+            position = enqueue_position.load(std::memory_order_relaxed);
+        }
+    }
+    return nullptr;
+}
+
+void Logger::SubmitRecord(Record* record) {
+    const size_t position = record->queue_position;
+    queue[position & (QUEUE_SIZE - 1)].sequence.store(position + 1, std::memory_order_release);
+
+    if (reader_waiting) {
+        std::lock_guard<std::mutex> lock(reader_mutex);
+        reader.notify_one();
+    }
 }
 
 size_t Logger::GetEntries(Entry* out_buffer, size_t buffer_len) {
-    return ring_buffer.BlockingPop(out_buffer, buffer_len);
+    auto is_record_ready = [&]{
+        const Cell& cell = queue[dequeue_position & (QUEUE_SIZE - 1)];
+        return cell.sequence.load(std::memory_order_acquire) == dequeue_position + 1;
+    };
+
+    while (true) {
+        size_t num_entries = 0;
+        while (num_entries < buffer_len && is_record_ready()) {
+            Cell& cell = queue[dequeue_position & (QUEUE_SIZE - 1)];
+            out_buffer[num_entries++] = CreateEntry(cell.record);
+
+            // Hand the cell back to the writers
+            cell.sequence.store(dequeue_position + QUEUE_SIZE, std::memory_order_release);
+            ++dequeue_position;
+        }
+
+        if (num_entries != 0) {
+            return num_entries;
+        }
+        if (closed) {
+            return QUEUE_CLOSED;
+        }
+
+        std::unique_lock<std::mutex> lock(reader_mutex);
+        reader_waiting = true;
+        // Check again after announcing that we're waiting, in case a record was submitted before
+        // the writer could see the flag. The timeout is only a safety net.
+        if (!is_record_ready() && !closed) {
+            reader.wait_for(lock, std::chrono::milliseconds(10));
+        }
+        reader_waiting = false;
+    }
+}
+
+void Logger::Close() {
+    closed = true;
+
+    // Wake up the logging thread, which might be waiting for records that will never come
+    std::lock_guard<std::mutex> lock(reader_mutex);
+    reader.notify_all();
 }
 
 std::shared_ptr<Logger> InitGlobalLogger() {
@@ -107,45 +192,309 @@ std::shared_ptr<Logger> InitGlobalLogger() {
     return global_logger;
 }
 
-Entry CreateEntry(Class log_class, Level log_level,
-                        const char* filename, unsigned int line_nr, const char* function,
-                        const char* format, va_list args) {
-    using std::chrono::steady_clock;
-    using std::chrono::duration_cast;
+void SetGlobalFilter(const Filter& filter) {
+    for (size_t i = 0; i < (size_t)Class::Count; ++i) {
+        g_class_levels[i].store(filter.GetClassLevel(static_cast<Class>(i)),
+                                std::memory_order_relaxed);
+    }
+}
+
+/// Length modifier of a printf conversion specification
+enum class LengthModifier {
+    None, Char, Short, Long, LongLong, IntMax, Size, PtrDiff, LongDouble,
+};
+
+/// Reinterprets an integer argument as the type printf would read for the given length modifier
+static u64 TruncateArgument(u64 value, LengthModifier length, bool is_signed) {
+    size_t size;
+    switch (length) {
+    case LengthModifier::Char:     size = sizeof(char); break;
+    case LengthModifier::Short:    size = sizeof(short); break;
+    case LengthModifier::Long:     size = sizeof(long); break;
+    case LengthModifier::LongLong: size = sizeof(long long); break;
+    case LengthModifier::IntMax:   size = sizeof(intmax_t); break;
+    case LengthModifier::Size:     size = sizeof(size_t); break;
+    case LengthModifier::PtrDiff:  size = sizeof(ptrdiff_t); break;
+    default:                       size = sizeof(int); break;
+    }
+
+    if (size >= sizeof(u64)) {
+        return value;
+    }
+
+    const unsigned int shift = 64 - 8 * size;
+    if (is_signed) {
+        return static_cast<u64>(static_cast<s64>(value << shift) >> shift);
+    }
+    return (value << shift) >> shift;
+}
+
+void FormatRecordMessage(const Record& record, char* out_text, size_t text_len) {
+    if (text_len == 0) {
+        return;
+    }
+
+    size_t out_pos = 0;
+    size_t next_arg = 0;
+    bool truncated = false;
+
+    // Appends the output of snprintf to the message, truncating it if necessary
+    auto append_formatted = [&](int written) {
+        if (written > 0) {
+            truncated |= out_pos + written > text_len - 1;
+            out_pos = std::min(out_pos + written, text_len - 1);
+        }
+    };
+    auto append_string = [&](const char* str) {
+        append_formatted(snprintf(out_text + out_pos, text_len - out_pos, "%s", str));
+    };
+    auto next_integer = [&]() -> s64 {
+        if (next_arg >= record.num_args)
+            return 0;
+        const ArgType type = record.arg_types[next_arg];
+        const Record::ArgValue& value = record.args[next_arg++];
+        return (type == ArgType::Signed || type == ArgType::Unsigned) ? value.s : 0;
+    };
+
+    const char* format = record.format;
+    while (*format != '\0' && out_pos + 1 < text_len) {
+        if (*format != '%') {
+            out_text[out_pos++] = *format++;
+            continue;
+        }
+        if (format[1] == '%') {
+            out_text[out_pos++] = '%';
+            format += 2;
+            continue;
+        }
+
+        // Rebuild the conversion specification without its length modifier, replacing any `*`
+        // with the value of the corresponding argument.
+        std::array<char, 64> spec;
+        size_t spec_len = 0;
+        auto spec_append = [&](const char* str, size_t len) {
+            len = std::min(len, spec.size() - 8 - spec_len);
+            std::copy(str, str + len, spec.data() + spec_len);
+            spec_len += len;
+        };
 
-    static steady_clock::time_point time_origin = steady_clock::now();
+        const char* spec_begin = format++;
+        format += strspn(format, "-+ #0");
+        spec_append(spec_begin, format - spec_begin);
 
+        for (int i = 0; i < 2; ++i) {
+            if (i == 1) {
+                if (*format != '.')
+                    break;
+                spec_append(format++, 1);
+            }
+            if (*format == '*') {
+                char number[24];
+                int number_len = snprintf(number, sizeof(number), "%d", (int)next_integer());
+                spec_append(number, std::max(number_len, 0));
+                ++format;
+            } else {
+                const size_t digits = strspn(format, "0123456789");
+                spec_append(format, digits);
+                format += digits;
+            }
+        }
+
+        LengthModifier length = LengthModifier::None;
+        switch (*format) {
+        case 'h':
+            length = (format[1] == 'h') ? LengthModifier::Char : LengthModifier::Short;
+            format += (format[1] == 'h') ? 2 : 1;
+            break;
+        case 'l':
+            length = (format[1] == 'l') ? LengthModifier::LongLong : LengthModifier::Long;
+            format += (format[1] == 'l') ? 2 : 1;
+            break;
+        case 'q': length = LengthModifier::LongLong; ++format; break;
+        case 'j': length = LengthModifier::IntMax; ++format; break;
+        case 'z': length = LengthModifier::Size; ++format; break;
+        case 't': length = LengthModifier::PtrDiff; ++format; break;
+        case 'L': length = LengthModifier::LongDouble; ++format; break;
+        }
+
+        const char conversion = *format;
+        if (conversion == '\0') {
+            break;
+        }
+        ++format;
+
+        if (next_arg >= record.num_args) {
+            append_string("<missing argument>");
+            continue;
+        }
+        const ArgType type = record.arg_types[next_arg];
+        const Record::ArgValue& value = record.args[next_arg++];
+        const bool is_integer = (type == ArgType::Signed || type == ArgType::Unsigned);
+
+        switch (conversion) {
+        case 'd': case 'i':
+            if (!is_integer)
+                break;
+            spec_append("lld", 3);
+            spec[spec_len] = '\0';
+            append_formatted(snprintf(out_text + out_pos, text_len - out_pos, spec.data(),
+                (long long)TruncateArgument(value.u, length, true)));
+            continue;
+
+        case 'u': case 'o': case 'x': case 'X':
+            if (!is_integer)
+                break;
+            spec_append("ll", 2);
+            spec_append(&conversion, 1);
+            spec[spec_len] = '\0';
+            append_formatted(snprintf(out_text + out_pos, text_len - out_pos, spec.data(),
+                (unsigned long long)TruncateArgument(value.u, length, false)));
+            continue;
+
+        case 'c':
+            if (!is_integer)
+                break;
+            spec_append("c", 1);
+            spec[spec_len] = '\0';
+            append_formatted(snprintf(out_text + out_pos, text_len - out_pos, spec.data(),
+                (int)(unsigned char)value.u));
+            continue;
+
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            if (type != ArgType::Float)
+                break;
+            spec_append(&conversion, 1);
+            spec[spec_len] = '\0';
+            append_formatted(snprintf(out_text + out_pos, text_len - out_pos, spec.data(),
+                value.f));
+            continue;
+
+        case 's':
+            if (type != ArgType::String)
+                break;
+            spec_append("s", 1);
+            spec[spec_len] = '\0';
+            append_formatted(snprintf(out_text + out_pos, text_len - out_pos, spec.data(),
+                record.GetString(value.string_offset)));
+            continue;
+
+        case 'p':
+            if (type != ArgType::Pointer)
+                break;
+            spec_append("p", 1);
+            spec[spec_len] = '\0';
+            append_formatted(snprintf(out_text + out_pos, text_len - out_pos, spec.data(),
+                value.p));
+            continue;
+
+        default:
+            append_string("<unknown conversion>");
+            continue;
+        }
+
+        // The argument doesn't match the conversion; printf would have had undefined behavior
+        append_string("<bad argument>");
+    }
+
+    // Make truncated messages stand out rather than silently cutting them short
+    static const char TRUNCATION_MARKER[] = "... <truncated>";
+    if ((truncated || *format != '\0') && text_len > sizeof(TRUNCATION_MARKER)) {
+        out_pos = std::min(out_pos, text_len - sizeof(TRUNCATION_MARKER));
+        std::memcpy(out_text + out_pos, TRUNCATION_MARKER, sizeof(TRUNCATION_MARKER) - 1);
+        out_pos += sizeof(TRUNCATION_MARKER) - 1;
+    }
+
+    out_text[out_pos] = '\0';
+}
+
+Entry CreateEntry(const Record& record) {
     std::array<char, 4 * 1024> formatting_buffer;
 
     Entry entry;
-    entry.timestamp = duration_cast<std::chrono::microseconds>(steady_clock::now() - time_origin);
-    entry.log_class = log_class;
-    entry.log_level = log_level;
+    entry.timestamp = record.timestamp;
+    entry.log_class = record.log_class;
+    entry.log_level = record.log_level;
 
-    snprintf(formatting_buffer.data(), formatting_buffer.size(), "%s:%s:%u", filename, function, line_nr);
+    snprintf(formatting_buffer.data(), formatting_buffer.size(), "%s:%s:%u",
+        record.filename, record.function, record.line_nr);
     entry.location = std::string(formatting_buffer.data());
 
-    vsnprintf(formatting_buffer.data(), formatting_buffer.size(), format, args);
+    FormatRecordMessage(record, formatting_buffer.data(), formatting_buffer.size());
     entry.message = std::string(formatting_buffer.data());
 
     return std::move(entry);
 }
 
-void LogMessage(Class log_class, Level log_level,
-                const char* filename, unsigned int line_nr, const char* function,
-                const char* format, ...) {
-    va_list args;
-    va_start(args, format);
-    Entry entry = CreateEntry(log_class, log_level,
-            filename, line_nr, function, format, args);
-    va_end(args);
+namespace Detail {
 
-    if (global_logger != nullptr && !global_logger->IsClosed()) {
-        global_logger->LogMessage(std::move(entry));
+static const std::chrono::steady_clock::time_point time_origin = std::chrono::steady_clock::now();
+
+/// Record used when there is no logger to submit to, in which case messages are printed directly
+static Record fallback_record;
+static std::mutex fallback_mutex;
+
+Record* BeginRecord(Class log_class, Level log_level, const char* filename, unsigned int line_nr,
+                    const char* function, const char* format) {
+    Record* record = nullptr;
+    if (global_logger != nullptr) {
+        record = global_logger->AcquireRecord();
+    }
+    if (record == nullptr) {
+        fallback_mutex.lock();
+        record = &fallback_record;
+    }
+
+    record->timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - time_origin);
+    record->log_class = log_class;
+    record->log_level = log_level;
+    record->num_args = 0;
+    record->string_storage_used = 0;
+    record->string_overflow.clear();
+    record->line_nr = line_nr;
+    record->filename = filename;
+    record->function = function;
+    record->format = format;
+    return record;
+}
+
+void EndRecord(Record* record) {
+    if (record == &fallback_record) {
+        PrintMessage(CreateEntry(*record));
+        fallback_mutex.unlock();
     } else {
-        // Fall back to directly printing to stderr
-        PrintMessage(entry);
+        global_logger->SubmitRecord(record);
+    }
+}
+
+void CaptureString(Record& record, const char* str) {
+    Record::ArgValue* value;
+    ArgType* type = NextArg(record, &value);
+    if (type == nullptr) {
+        return;
+    }
+
+    *type = ArgType::String;
+    if (str == nullptr) {
+        value->string_offset = Record::NULL_STRING;
+        return;
     }
+
+    const size_t len = strlen(str);
+    const size_t offset = record.string_storage_used;
+    if (offset + len + 1 <= Record::STRING_STORAGE_SIZE) {
+        std::memcpy(&record.string_storage[offset], str, len + 1);
+        value->string_offset = static_cast<u32>(offset);
+        record.string_storage_used = static_cast<u16>(offset + len + 1);
+        return;
+    }
+
+    // Strings which don't fit in the remaining storage are copied to the heap
+    value->string_offset = static_cast<u32>(Record::STRING_STORAGE_SIZE +
+                                            record.string_overflow.size());
+    record.string_overflow.append(str, len + 1);
 }
 
+} // namespace Detail
+
 }
@@ -4,16 +4,18 @@
 
 #pragma once
 
-#include <cstdarg>
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <vector>
 
-#include "common/concurrent_ring_buffer.h"
-
 #include "common/logging/log.h"
 
 namespace Log {
 
+class Filter;
+
 /**
  * A log entry. Log entries are store in a structured format to permit more varied output
  * formatting on different frontends, as well as facilitating filtering and aggregation.
@@ -63,13 +65,15 @@ struct ClassInfo {
  * Logging management class. This class has the dual purpose of acting as an exchange point between
  * the logging clients and the log outputter, as well as containing reflection info about available
  * log classes.
+ *
+ * Messages are exchanged through a bounded lock-free MPSC queue of preallocated Records (based on
+ * Dmitry Vyukov's bounded MPMC queue): clients reserve a slot, fill it in place and publish it,
+ * without taking any lock or allocating memory. The logging thread formats the records when it
+ * retrieves them with `GetEntries`.
  */
 class Logger {
-private:
-    using Buffer = Common::ConcurrentRingBuffer<Entry, 16 * 1024 / sizeof(Entry)>;
-
 public:
-    static const size_t QUEUE_CLOSED = Buffer::QUEUE_CLOSED;
+    static const size_t QUEUE_CLOSED = -1;
 
     Logger();
 
@@ -92,14 +96,22 @@ public:
     static const char* GetLevelName(Level log_level);
 
     /**
-     * Appends a messages to the log buffer.
+     * Reserves a record in the message queue. If the queue is full, this method will spin until a
+     * record is freed by the logging thread.
      * @note This function is thread safe.
+     * @return The reserved record, or nullptr if the logger is closed.
      */
-    void LogMessage(Entry entry);
+    Record* AcquireRecord();
 
     /**
-     * Retrieves a batch of messages from the log buffer, blocking until they are available.
+     * Publishes a record obtained from `AcquireRecord`, making it visible to `GetEntries`.
      * @note This function is thread safe.
+     */
+    void SubmitRecord(Record* record);
+
+    /**
+     * Retrieves and formats a batch of messages from the log queue, blocking until they are
+     * available. Only one thread may call this function at a time.
      *
      * @param out_buffer Destination buffer that will receive the log entries.
      * @param buffer_len The maximum size of `out_buffer`.
@@ -112,23 +124,46 @@ public:
      * Initiates a shutdown of the logger. This will indicate to log output clients that they
      * should shutdown.
      */
-    void Close() { ring_buffer.Close(); }
+    void Close();
 
     /**
      * Returns true if Close() has already been called on the Logger.
      */
-    bool IsClosed() const { return ring_buffer.IsClosed(); }
+    bool IsClosed() const { return closed; }
 
 private:
-    Buffer ring_buffer;
+    static const size_t QUEUE_SIZE = 1024; ///< Number of records in the queue, a power of two
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        Record record;
+    };
+
+    std::unique_ptr<Cell[]> queue;
+    std::atomic<size_t> enqueue_position;
+    size_t dequeue_position; ///< Only accessed by the logging thread
+
+    std::atomic<bool> closed;
+
+    /// Used to put the logging thread to sleep while the queue is empty
+    std::mutex reader_mutex;
+    std::condition_variable reader;
+    std::atomic<bool> reader_waiting;
+
     std::vector<ClassInfo> all_classes;
 };
 
-/// Creates a log entry by formatting the given source location, and message.
-Entry CreateEntry(Class log_class, Level log_level,
-                        const char* filename, unsigned int line_nr, const char* function,
-                        const char* format, va_list args);
+/// Formats the message of a log record into the provided text buffer.
+void FormatRecordMessage(const Record& record, char* out_text, size_t text_len);
+/// Creates a log entry by formatting the given record.
+Entry CreateEntry(const Record& record);
 /// Initializes the default Logger.
 std::shared_ptr<Logger> InitGlobalLogger();
 
+/**
+ * Makes the call sites of the logging macros use the levels of `filter`, so that messages it would
+ * reject are discarded before being captured. Must be called again after the filter is modified.
+ */
+void SetGlobalFilter(const Filter& filter);
+
 }
@@ -4,9 +4,11 @@
 
 #pragma once
 
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <string>
+#include <type_traits>
 
 #include "common/common_types.h"
 
@@ -41,6 +43,8 @@ enum class Class : ClassType {
     Common_Memory,              ///< Memory mapping and management functions
     Core,                       ///< LLE emulation core
     Core_ARM11,                 ///< ARM11 CPU core
+    Core_Movie,                 ///< Input recording and replay
+    Core_SaveState,             ///< Savestates
     Config,                     ///< Emulator configuration (including commandline)
     Debug,                      ///< Debugging tools
     Debug_Emulated,             ///< Debug messages from the emulated programs
@@ -83,28 +87,195 @@ const Level MINIMUM_LEVEL =
 #endif
 
 /**
- * Logs a message to the global logger. This proxy exists to avoid exposing the details of the
- * Logger class, including the ConcurrentRingBuffer template, to all files that desire to log
- * messages, reducing unecessary recompilations.
+ * Minimum level of each log class, indexed by class. This mirrors the filter applied by the
+ * frontend (see `SetGlobalFilter`) so that filtered out messages can be rejected at the call site,
+ * before their arguments are captured. It is read without locking on every log call.
  */
+extern std::atomic<Level> g_class_levels[(size_t)Class::Count];
+
+/// Returns true if a message of the given class and level would pass the current filter.
+inline bool IsLevelEnabled(Class log_class, Level log_level) {
+    return log_level >= MINIMUM_LEVEL &&
+           log_level >= g_class_levels[(size_t)log_class].load(std::memory_order_relaxed);
+}
+
+/// Type of an argument captured in a log Record.
+enum class ArgType : u8 {
+    Signed,   ///< Any signed integer or enumeration, sign-extended to 64 bits
+    Unsigned, ///< Any unsigned integer or bool, zero-extended to 64 bits
+    Float,    ///< A float or double
+    String,   ///< A C string, copied into the record's string storage or its overflow
+    Pointer,  ///< Any other pointer, printed with %p
+};
+
+/**
+ * A log message whose formatting has been deferred. Log calls only capture the format string
+ * pointer and the raw argument values into a preallocated Record; the text is formatted later, on
+ * the logging thread. C string arguments are copied into the record since they may not outlive the
+ * call, while format strings must be string literals.
+ *
+ * Strings are copied into the fixed string_storage while they fit. Longer ones spill into
+ * string_overflow, which only allocates when it grows past the largest spill the record has held.
+ */
+struct Record {
+    static const size_t MAX_ARGS = 16;
+    static const size_t STRING_STORAGE_SIZE = 256;
+    static const u32 NULL_STRING = 0xFFFFFFFF; ///< String offset used for null C string arguments
+
+    union ArgValue {
+        s64 s;
+        u64 u;
+        double f;
+        const void* p;
+        /// Offset of the string in string_storage, or STRING_STORAGE_SIZE plus its offset in
+        /// string_overflow
+        u32 string_offset;
+    };
+
+    std::chrono::microseconds timestamp;
+    Class log_class;
+    Level log_level;
+    u8 num_args;
+    u16 string_storage_used;
+    unsigned int line_nr;
+    const char* filename;
+    const char* function;
+    const char* format;
+    size_t queue_position; ///< Used by the Logger to publish the record once it's filled in
+
+    ArgType arg_types[MAX_ARGS];
+    ArgValue args[MAX_ARGS];
+    char string_storage[STRING_STORAGE_SIZE];
+    std::string string_overflow;
+
+    /// Gets a string argument from its offset
+    const char* GetString(u32 offset) const {
+        if (offset == NULL_STRING)
+            return "(null)";
+        if (offset < STRING_STORAGE_SIZE)
+            return &string_storage[offset];
+        return &string_overflow[offset - STRING_STORAGE_SIZE];
+    }
+};
+
+namespace Detail {
+
+/**
+ * Reserves a record in the global logger's queue and fills in the message metadata. If no logger is
+ * running, returns a fallback record which will be printed directly to stderr by `EndRecord`.
+ */
+Record* BeginRecord(Class log_class, Level log_level, const char* filename, unsigned int line_nr,
+                    const char* function, const char* format);
+/// Submits a record obtained from `BeginRecord`.
+void EndRecord(Record* record);
+
+/// Copies a C string argument into the record.
+void CaptureString(Record& record, const char* str);
+
+inline ArgType* NextArg(Record& record, Record::ArgValue** value) {
+    if (record.num_args == Record::MAX_ARGS)
+        return nullptr;
+    *value = &record.args[record.num_args];
+    return &record.arg_types[record.num_args++];
+}
+
+template <typename T, bool is_enum = std::is_enum<T>::value>
+struct IntegerType {
+    typedef T type;
+};
+
+template <typename T>
+struct IntegerType<T, true> {
+    typedef typename std::underlying_type<T>::type type;
+};
+
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+CaptureArg(Record& record, T arg) {
+    typedef typename IntegerType<T>::type Integer;
+    Record::ArgValue* value;
+    if (ArgType* type = NextArg(record, &value)) {
+        if (std::is_signed<Integer>::value) {
+            *type = ArgType::Signed;
+            value->s = static_cast<s64>(static_cast<Integer>(arg));
+        } else {
+            *type = ArgType::Unsigned;
+            value->u = static_cast<u64>(static_cast<Integer>(arg));
+        }
+    }
+}
+
+inline void CaptureArg(Record& record, double arg) {
+    Record::ArgValue* value;
+    if (ArgType* type = NextArg(record, &value)) {
+        *type = ArgType::Float;
+        value->f = arg;
+    }
+}
+
+inline void CaptureArg(Record& record, const char* arg) {
+    CaptureString(record, arg);
+}
+
+template <typename T>
+void CaptureArg(Record& record, const T* arg) {
+    Record::ArgValue* value;
+    if (ArgType* type = NextArg(record, &value)) {
+        *type = ArgType::Pointer;
+        value->p = arg;
+    }
+}
+
+inline void CaptureArgs(Record& record) {
+}
+
+template <typename T, typename... Args>
+void CaptureArgs(Record& record, const T& arg, const Args&... args) {
+    CaptureArg(record, arg);
+    CaptureArgs(record, args...);
+}
+
+} // namespace Detail
+
+/**
+ * Logs a message to the global logger. Only the arguments are captured here, formatting happens
+ * on the logging thread. The Logger class and the queue implementation are kept out of this
+ * header to avoid unnecessary recompilations.
+ */
+template <typename... Args>
 void LogMessage(Class log_class, Level log_level,
-    const char* filename, unsigned int line_nr, const char* function,
+                const char* filename, unsigned int line_nr, const char* function,
+                const char* format, const Args&... args) {
+    Record* record = Detail::BeginRecord(log_class, log_level, filename, line_nr, function, format);
+    Detail::CaptureArgs(*record, args...);
+    Detail::EndRecord(record);
+}
+
+/**
+ * Never called, only used to let the compiler check log format strings against their arguments
+ * the same way it does for printf.
+ */
+inline void CheckFormat(
 #ifdef _MSC_VER
     _Printf_format_string_
 #endif
     const char* format, ...)
 #ifdef __GNUC__
-    __attribute__((format(printf, 6, 7)))
+    __attribute__((format(printf, 1, 2)))
 #endif
     ;
 
+inline void CheckFormat(const char* format, ...) {}
+
 } // namespace Log
 
 #define LOG_GENERIC(log_class, log_level, ...) \
     do { \
-        if (::Log::Level::log_level >= ::Log::MINIMUM_LEVEL) \
+        if (::Log::IsLevelEnabled(::Log::Class::log_class, ::Log::Level::log_level)) \
             ::Log::LogMessage(::Log::Class::log_class, ::Log::Level::log_level, \
                        __FILE__, __LINE__, __func__, __VA_ARGS__); \
+        if (false) \
+            ::Log::CheckFormat(__VA_ARGS__); \
     } while (0)
 
 #define LOG_TRACE(   log_class, ...) LOG_GENERIC(log_class, Trace,    __VA_ARGS__)
@@ -55,7 +55,8 @@ void FormatLogMessage(const Entry& entry, char* out_text, size_t text_len) {
 }
 
 void PrintMessage(const Entry& entry) {
-    std::array<char, 4 * 1024> format_buffer;
+    // Messages are up to 4 KB long, leave room for the prefix so that their end isn't cut off
+    std::array<char, 8 * 1024> format_buffer;
     FormatLogMessage(entry, format_buffer.data(), format_buffer.size());
     fputs(format_buffer.data(), stderr);
     fputc('\n', stderr);
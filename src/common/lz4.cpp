@@ -0,0 +1,197 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <vector>
+
+#include "common/lz4.h"
+
+namespace Common {
+namespace LZ4 {
+
+static const size_t MIN_MATCH     = 4;
+static const size_t LAST_LITERALS = 5;  ///< The last 5 bytes of a block are always literals
+static const size_t MF_LIMIT      = 12; ///< The last match must start 12 bytes before the end
+static const size_t MAX_DISTANCE  = 0xFFFF;
+static const int    HASH_BITS     = 14;
+
+static inline u32 Read32(const u8* p) {
+    u32 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline u32 Hash(u32 sequence) {
+    return (sequence * 2654435761U) >> (32 - HASH_BITS);
+}
+
+/// Writes the extra bytes of a literal or match length that didn't fit in its 4 bits of the token
+static inline u8* WriteLength(u8* op, size_t length) {
+    for (; length >= 255; length -= 255)
+        *op++ = 255;
+    *op++ = (u8)length;
+    return op;
+}
+
+/// Worst case size of a sequence header plus literals
+static inline size_t SequenceBound(size_t literals) {
+    return 1 + (literals >= 15 ? (literals - 15) / 255 + 1 : 0) + literals;
+}
+
+size_t CompressBound(size_t src_size) {
+    return src_size + src_size / 255 + 16;
+}
+
+size_t Compress(const u8* src, size_t src_size, u8* dst, size_t dst_capacity) {
+    const u8* ip = src;
+    const u8* anchor = src;
+    const u8* const iend = src + src_size;
+    u8* op = dst;
+    u8* const oend = dst + dst_capacity;
+
+    if (src_size > MF_LIMIT) {
+        // Positions of the last occurrence of each hashed 4 byte sequence, relative to src. Stale
+        // or colliding entries are harmless, every candidate is verified before use.
+        std::vector<u32> table(1 << HASH_BITS, 0);
+        const u8* const mf_limit = iend - MF_LIMIT;
+        const u8* const match_limit = iend - LAST_LITERALS;
+
+        while (ip <= mf_limit) {
+            const u32 sequence = Read32(ip);
+            const u32 hash = Hash(sequence);
+            const u8* ref = src + table[hash];
+            table[hash] = (u32)(ip - src);
+
+            if (ref >= ip || (size_t)(ip - ref) > MAX_DISTANCE || Read32(ref) != sequence) {
+                // Skip faster through data that doesn't compress
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                --ip;
+                --ref;
+            }
+
+            const u8* match_end = ip + MIN_MATCH;
+            const u8* ref_end = ref + MIN_MATCH;
+            while (match_end < match_limit && *match_end == *ref_end) {
+                ++match_end;
+                ++ref_end;
+            }
+
+            const size_t literals = ip - anchor;
+            const size_t match_length = match_end - ip - MIN_MATCH;
+            if (SequenceBound(literals) + 2 + match_length / 255 + 1 > (size_t)(oend - op))
+                return 0;
+
+            u8* token = op++;
+            if (literals >= 15) {
+                *token = 15 << 4;
+                op = WriteLength(op, literals - 15);
+            } else {
+                *token = (u8)(literals << 4);
+            }
+            memcpy(op, anchor, literals);
+            op += literals;
+
+            const size_t offset = ip - ref;
+            *op++ = (u8)offset;
+            *op++ = (u8)(offset >> 8);
+
+            if (match_length >= 15) {
+                *token |= 15;
+                op = WriteLength(op, match_length - 15);
+            } else {
+                *token |= (u8)match_length;
+            }
+
+            ip = anchor = match_end;
+            if (ip <= mf_limit)
+                table[Hash(Read32(ip - 2))] = (u32)(ip - 2 - src);
+        }
+    }
+
+    const size_t literals = iend - anchor;
+    if (SequenceBound(literals) > (size_t)(oend - op))
+        return 0;
+
+    if (literals >= 15) {
+        *op++ = 15 << 4;
+        op = WriteLength(op, literals - 15);
+    } else {
+        *op++ = (u8)(literals << 4);
+    }
+    memcpy(op, anchor, literals);
+    op += literals;
+
+    return op - dst;
+}
+
+bool Decompress(const u8* src, size_t src_size, u8* dst, size_t dst_size) {
+    const u8* ip = src;
+    const u8* const iend = src + src_size;
+    u8* op = dst;
+    u8* const oend = dst + dst_size;
+
+    while (ip < iend) {
+        const u8 token = *ip++;
+
+        size_t literals = token >> 4;
+        if (literals == 15) {
+            u8 extra;
+            do {
+                if (ip >= iend)
+                    return false;
+                extra = *ip++;
+                literals += extra;
+            } while (extra == 255);
+        }
+        if (literals > (size_t)(iend - ip) || literals > (size_t)(oend - op))
+            return false;
+        memcpy(op, ip, literals);
+        ip += literals;
+        op += literals;
+
+        // The last sequence has no match part
+        if (ip == iend)
+            return op == oend;
+
+        if (iend - ip < 2)
+            return false;
+        const size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst))
+            return false;
+
+        size_t match_length = token & 15;
+        if (match_length == 15) {
+            u8 extra;
+            do {
+                if (ip >= iend)
+                    return false;
+                extra = *ip++;
+                match_length += extra;
+            } while (extra == 255);
+        }
+        match_length += MIN_MATCH;
+        if (match_length > (size_t)(oend - op))
+            return false;
+
+        const u8* match = op - offset;
+        if (offset >= match_length) {
+            memcpy(op, match, match_length);
+            op += match_length;
+        } else {
+            // Overlapping copy, repeats the last offset bytes
+            for (size_t i = 0; i < match_length; ++i)
+                *op++ = *match++;
+        }
+    }
+
+    return false;
+}
+
+} // namespace
+} // namespace
@@ -0,0 +1,43 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "common/common_types.h"
+
+/**
+ * Codec for the LZ4 block format (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md).
+ * Blocks produced here can be decoded by the reference library and vice versa. The compressor is
+ * the simple greedy single-probe variant: it trades some ratio for speed, which is what we want for
+ * savestates.
+ */
+namespace Common {
+namespace LZ4 {
+
+/// Returns the size of the largest block Compress can produce for the given input size
+size_t CompressBound(size_t src_size);
+
+/**
+ * Compresses a buffer into a single LZ4 block
+ * @param src Data to compress
+ * @param src_size Size of the data, in bytes
+ * @param dst Buffer receiving the block
+ * @param dst_capacity Size of the buffer, at least CompressBound(src_size) to never fail
+ * @return Size of the block, or 0 if it doesn't fit in the buffer
+ */
+size_t Compress(const u8* src, size_t src_size, u8* dst, size_t dst_capacity);
+
+/**
+ * Decompresses a single LZ4 block. Malformed blocks are rejected without reading or writing out of
+ * bounds.
+ * @param src Block to decompress
+ * @param src_size Size of the block, in bytes
+ * @param dst Buffer receiving the data
+ * @param dst_size Exact size of the decompressed data
+ * @return True if the block was valid and decompressed to exactly dst_size bytes
+ */
+bool Decompress(const u8* src, size_t src_size, u8* dst, size_t dst_size);
+
+} // namespace
+} // namespace
@@ -0,0 +1,68 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+
+#include "common/common_funcs.h"
+#include "common/math_util.h"
+#include "common/profiler.h"
+
+namespace Common {
+namespace Profiling {
+
+#if defined(_MSC_VER) || defined(__i386__) || defined(__x86_64__)
+
+// The TSC frequency isn't directly queryable, so it is derived from the steady clock and TSC
+// values at program startup and at the time of the conversion.
+static const std::chrono::steady_clock::time_point origin_time = std::chrono::steady_clock::now();
+static const u64 origin_ticks = GetTicks();
+
+double TicksToNanoseconds(u64 ticks) {
+    const u64 elapsed_ticks = GetTicks() - origin_ticks;
+    const double elapsed_ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - origin_time).count();
+    if (elapsed_ticks == 0) {
+        return 0.0;
+    }
+    return ticks * (elapsed_ns / elapsed_ticks);
+}
+
+#else
+
+double TicksToNanoseconds(u64 ticks) {
+    return (double)ticks;
+}
+
+#endif
+
+std::array<SubsystemStats, (size_t)Subsystem::Count> g_subsystem_stats;
+Subsystem g_current_subsystem = Subsystem::None;
+
+const char* GetSubsystemName(Subsystem subsystem) {
+    static const char* const names[] = {
+        "none", "cpu", "svc", "service_ipc", "command_processor", "vertex_shader", "rasterizer",
+        "display_transfer",
+    };
+    static_assert(ARRAY_SIZE(names) == (size_t)Subsystem::Count, "Missing subsystem names");
+    return (subsystem < Subsystem::Count) ? names[(size_t)subsystem] : "unknown";
+}
+
+void ResetSubsystemStats() {
+    for (SubsystemStats& stats : g_subsystem_stats) {
+        stats.num_calls = 0;
+        stats.total_ticks = 0;
+    }
+}
+
+void CallStats::AddCall(u64 ticks) {
+    num_calls++;
+    total_ticks += ticks;
+    max_ticks = std::max(max_ticks, ticks);
+
+    const u64 bucket = (ticks == 0) ? 0 : Log2(ticks);
+    histogram[std::min<u64>(bucket, NUM_HISTOGRAM_BUCKETS - 1)]++;
+}
+
+} // namespace Profiling
+} // namespace Common
@@ -0,0 +1,156 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <chrono>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+#include "common/common_types.h"
+
+namespace Common {
+namespace Profiling {
+
+/**
+ * Reads a cheap, monotonically increasing host timestamp. On x86 this is the TSC, elsewhere it
+ * falls back to std::chrono::steady_clock in nanoseconds. Use TicksToNanoseconds to convert.
+ */
+inline u64 GetTicks() {
+#if defined(_MSC_VER) || defined(__i386__) || defined(__x86_64__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/// Converts a tick count returned by GetTicks (or a difference of them) to nanoseconds
+double TicksToNanoseconds(u64 ticks);
+
+/// Number of buckets in a CallStats latency histogram
+const int NUM_HISTOGRAM_BUCKETS = 32;
+
+/**
+ * Accumulated timing statistics of a single profiled call site. Latencies are collected in a
+ * logarithmic histogram: bucket i counts the calls which took [2^i, 2^(i+1)) ticks, with the last
+ * bucket also counting everything longer than that.
+ */
+struct CallStats {
+    u64 num_calls;
+    u64 total_ticks;
+    u64 max_ticks;
+    std::array<u32, NUM_HISTOGRAM_BUCKETS> histogram;
+
+    CallStats() : num_calls(0), total_ticks(0), max_ticks(0) {
+        histogram.fill(0);
+    }
+
+    void AddCall(u64 ticks);
+
+    /// Records a call without timing it, for builds without ENABLE_PROFILING
+    void CountCall() {
+        num_calls++;
+    }
+};
+
+/// Measures the time from its construction to its destruction and records it in a CallStats
+class ScopeTimer {
+public:
+    explicit ScopeTimer(CallStats& stats) : stats(stats), start(GetTicks()) {}
+    ~ScopeTimer() { stats.AddCall(GetTicks() - start); }
+
+private:
+    CallStats& stats;
+    u64 start;
+};
+
+/**
+ * Coarse parts of the emulation, whose time is broken down by benchmarks. The time of each part is
+ * exclusive: time spent in a part entered from another one (e.g. a service call made from an SVC
+ * made by the CPU) is only counted for the innermost part.
+ */
+enum class Subsystem : u32 {
+    None,               ///< Outside of any of the following
+    CPU,                ///< Running the ARM11 core
+    SVC,                ///< Handling SVCs
+    ServiceIPC,         ///< Handling service commands
+    CommandProcessor,   ///< Processing PICA200 command lists
+    VertexShader,       ///< Running vertex shaders, only timed with ENABLE_PROFILING
+    Rasterizer,         ///< Rasterizing triangles, only timed with ENABLE_PROFILING
+    DisplayTransfer,    ///< Performing display transfers
+    Count
+};
+
+struct SubsystemStats {
+    u64 num_calls;
+    s64 total_ticks;    ///< Time spent in the subsystem itself, excluding nested subsystems
+};
+
+/// Statistics of each subsystem, indexed by Subsystem
+extern std::array<SubsystemStats, (size_t)Subsystem::Count> g_subsystem_stats;
+
+/// Subsystem the emulation is currently in. Subsystems are only entered from the emulation thread.
+extern Subsystem g_current_subsystem;
+
+/// Gets the name of a subsystem, as used in reports
+const char* GetSubsystemName(Subsystem subsystem);
+
+/// Clears the statistics of all subsystems
+void ResetSubsystemStats();
+
+/// Accounts the time from its construction to its destruction to a subsystem, and removes it from
+/// the subsystem it was entered from
+class SubsystemTimer {
+public:
+    explicit SubsystemTimer(Subsystem subsystem)
+        : subsystem(subsystem), parent(g_current_subsystem), start(GetTicks()) {
+        g_current_subsystem = subsystem;
+    }
+
+    ~SubsystemTimer() {
+        const s64 elapsed = (s64)(GetTicks() - start);
+        g_subsystem_stats[(size_t)subsystem].num_calls++;
+        g_subsystem_stats[(size_t)subsystem].total_ticks += elapsed;
+        g_subsystem_stats[(size_t)parent].total_ticks -= elapsed;
+        g_current_subsystem = parent;
+    }
+
+private:
+    Subsystem subsystem;
+    Subsystem parent;
+    u64 start;
+};
+
+/**
+ * Whether support for the profiler was compiled in. When it isn't, PROFILE_SCOPE only counts
+ * calls, its timings and histograms stay empty, and the subsystems timed by PROFILE_SUBSYSTEM_FINE
+ * are counted in the subsystem they are entered from.
+ */
+#ifdef ENABLE_PROFILING
+const bool IS_ENABLED = true;
+#else
+const bool IS_ENABLED = false;
+#endif
+
+} // namespace Profiling
+} // namespace Common
+
+/// Times a subsystem entered a few times per frame at most, which is cheap enough to always do
+#define PROFILE_SUBSYSTEM(subsystem) ::Common::Profiling::SubsystemTimer \
+    _profile_subsystem_timer(::Common::Profiling::Subsystem::subsystem)
+
+#ifdef ENABLE_PROFILING
+#define PROFILE_SCOPE(stats) ::Common::Profiling::ScopeTimer _profile_scope_timer(stats)
+/// Times a subsystem entered per vertex or per triangle
+#define PROFILE_SUBSYSTEM_FINE(subsystem) PROFILE_SUBSYSTEM(subsystem)
+#else
+#define PROFILE_SCOPE(stats) (stats).CountCall()
+#define PROFILE_SUBSYSTEM_FINE(subsystem) do {} while (0)
+#endif
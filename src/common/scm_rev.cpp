@@ -0,0 +1,18 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include "common/scm_rev.h"
+
+#define GIT_REV      "c85e6e508904a5a87f44bc55861cc9de69d532c2"
+#define GIT_BRANCH   "master"
+#define GIT_DESC     "c85e6e5-dirty"
+
+namespace Common {
+
+const char g_scm_rev[]      = GIT_REV;
+const char g_scm_branch[]   = GIT_BRANCH;
+const char g_scm_desc[]     = GIT_DESC;
+
+} // namespace
+
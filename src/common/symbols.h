@@ -30,6 +30,9 @@ namespace Symbols
 
     void Add(u32 _address, const std::string& _name, u32 _size, u32 _type);
     TSymbol GetSymbol(u32 _address);
+    /// Gets the symbol whose range contains the address, or an empty symbol if there is none.
+    /// Symbols of size 0 are taken to extend up to the next one.
+    TSymbol GetContainingSymbol(u32 _address);
     const std::string GetName(u32 _address);
     void Remove(u32 _address);
     void Clear();
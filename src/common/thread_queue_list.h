@@ -5,6 +5,7 @@
 #pragma once
 
 #include "common/common.h"
+#include "common/chunk_file.h"
 
 namespace Common {
 
@@ -145,12 +146,64 @@ struct ThreadQueueList {
         return cur->first == cur->end;
     }
 
+    inline bool empty() const {
+        const Queue *cur = first;
+        while (cur != invalid())
+        {
+            if (cur->end - cur->first > 0)
+                return false;
+            cur = cur->next;
+        }
+        return true;
+    }
+
     inline void prepare(u32 priority) {
         Queue *cur = &queues[priority];
         if (cur->next == nullptr)
             link(priority, INITIAL_CAPACITY);
     }
 
+    void DoState(PointerWrap &p) {
+        auto s = p.Section("ThreadQueueList", 1);
+        if (!s)
+            return;
+
+        int num_queues = NUM_QUEUES;
+        p.Do(num_queues);
+        if (num_queues != NUM_QUEUES) {
+            LOG_ERROR(Kernel, "Savestate error: %d thread queues instead of %d", num_queues, NUM_QUEUES);
+            p.SetError(PointerWrap::ERROR_FAILURE);
+            return;
+        }
+
+        if (p.GetMode() == PointerWrap::MODE_READ)
+            clear();
+
+        for (int i = 0; i < NUM_QUEUES; ++i) {
+            Queue *cur = &queues[i];
+            int size = cur->end - cur->first;
+            int capacity = cur->capacity;
+            p.Do(size);
+            p.Do(capacity);
+            if (size < 0 || size > capacity) {
+                p.SetError(PointerWrap::ERROR_FAILURE);
+                return;
+            }
+
+            // Queues that were never prepared stay unlinked
+            if (capacity == 0)
+                continue;
+
+            if (p.GetMode() == PointerWrap::MODE_READ) {
+                link(i, capacity);
+                cur->first = (cur->capacity - size) / 2;
+                cur->end = cur->first + size;
+            }
+            if (size != 0)
+                p.DoArray(&cur->data[cur->first], size);
+        }
+    }
+
 private:
     Queue *invalid() const {
         return (Queue *) -1;
@@ -0,0 +1,148 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "common/common.h"
+#include "common/file_util.h"
+#include "common/string_util.h"
+#include "common/trace.h"
+
+namespace Common {
+namespace Trace {
+
+using Common::Profiling::TicksToNanoseconds;
+
+struct Event {
+    const char* name;
+    u64 start_ticks;
+    u64 end_ticks;
+    u64 arg;
+    Track track;
+    u32 num_calls;      ///< Number of calls merged into the event
+};
+
+/// Longest gap between two calls which are merged into one event
+static const double MERGE_GAP_NS = 20000;
+
+std::atomic<bool> g_recording(false);
+
+// Events are added from the emulation thread, but dumped from the frontend's
+static std::mutex mutex;
+static std::vector<Event> events;
+static size_t max_events = 0;
+static size_t next_event = 0;   ///< Index at which the next event is written, once events is full
+static std::array<size_t, (size_t)Track::Count> last_events; ///< Last event of each track
+static u64 merge_gap_ticks = 0;
+
+void Start(size_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex);
+    events.clear();
+    events.reserve(capacity);
+    max_events = std::max<size_t>(capacity, 1);
+    next_event = 0;
+    last_events.fill(SIZE_MAX);
+
+    static const u64 CALIBRATION_TICKS = 1 << 24;
+    merge_gap_ticks = (u64)(MERGE_GAP_NS * CALIBRATION_TICKS /
+                            std::max(TicksToNanoseconds(CALIBRATION_TICKS), 1.0));
+    g_recording = true;
+}
+
+void Stop() {
+    std::lock_guard<std::mutex> lock(mutex);
+    g_recording = false;
+}
+
+void AddEvent(Track track, const char* name, u64 start_ticks, u64 end_ticks, u64 arg,
+              bool merge) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!g_recording)
+        return;
+
+    size_t& last_event = last_events[(size_t)track];
+    if (merge && last_event < events.size()) {
+        Event& last = events[last_event];
+        // The last event of the track may have been overwritten by an event of another track
+        if (last.track == track && last.name == name && last.end_ticks <= start_ticks &&
+            start_ticks - last.end_ticks <= merge_gap_ticks) {
+            last.end_ticks = end_ticks;
+            ++last.num_calls;
+            return;
+        }
+    }
+
+    const Event event = { name, start_ticks, end_ticks, arg, track, 1 };
+    if (events.size() < max_events) {
+        last_event = events.size();
+        events.push_back(event);
+    } else {
+        last_event = next_event;
+        events[next_event] = event;
+        next_event = (next_event + 1) % max_events;
+    }
+}
+
+std::string FormatJSON() {
+    std::vector<Event> sorted_events;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        sorted_events.assign(events.begin() + next_event, events.end());
+        sorted_events.insert(sorted_events.end(), events.begin(), events.begin() + next_event);
+    }
+    // Events are added when they end, so nested events come before the ones containing them
+    std::stable_sort(sorted_events.begin(), sorted_events.end(),
+                     [](const Event& a, const Event& b) { return a.start_ticks < b.start_ticks; });
+
+    static const char* const track_names[] = { "Frames", "CPU", "GPU", "HLE" };
+    static_assert(ARRAY_SIZE(track_names) == (size_t)Track::Count, "Missing track names");
+
+    std::string json = "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    for (size_t i = 0; i < (size_t)Track::Count; ++i) {
+        json += Common::StringFromFormat("{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+            "\"tid\": %u, \"args\": {\"name\": \"%s\"}},\n", (u32)i, track_names[i]);
+    }
+
+    const u64 origin = sorted_events.empty() ? 0 : sorted_events.front().start_ticks;
+    for (size_t i = 0; i < sorted_events.size(); ++i) {
+        const Event& event = sorted_events[i];
+        std::string args;
+        if (event.track == Track::Frames)
+            args = Common::StringFromFormat("\"frame\": %llu", (unsigned long long)event.arg);
+        else if (event.num_calls > 1)
+            args = Common::StringFromFormat("\"calls\": %u", event.num_calls);
+
+        json += Common::StringFromFormat("{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, "
+            "\"tid\": %u, \"ts\": %.3f, \"dur\": %.3f, \"args\": {%s}},\n",
+            event.name, (u32)event.track, TicksToNanoseconds(event.start_ticks - origin) / 1000,
+            TicksToNanoseconds(event.end_ticks - event.start_ticks) / 1000, args.c_str());
+    }
+
+    // Drop the comma after the last event, which JSON doesn't allow
+    json.erase(json.size() - 2, 1);
+    return json + "]}\n";
+}
+
+bool Dump(const std::string& filename) {
+    if (!Common::Profiling::IS_ENABLED) {
+        LOG_WARNING(Common, "Tracing is not compiled in, nothing to dump");
+        return false;
+    }
+
+    const std::string json = FormatJSON();
+    if (FileUtil::WriteStringToFile(true, json, filename.c_str()) != json.size()) {
+        LOG_ERROR(Common, "Failed to write trace to %s", filename.c_str());
+        return false;
+    }
+
+    LOG_INFO(Common, "Wrote trace to %s", filename.c_str());
+    return true;
+}
+
+} // namespace Trace
+} // namespace Common
@@ -0,0 +1,111 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#include "common/common_types.h"
+#include "common/profiler.h"
+
+namespace Common {
+
+/**
+ * Records a timeline of what the emulator does, frame by frame, and exports it in the Chrome trace
+ * event format (chrome://tracing, Perfetto). Events are kept in a ring buffer while recording, so
+ * a dump taken after a stutter shows the frames which led to it.
+ *
+ * Events are added with TRACE_SCOPE, which like PROFILE_SCOPE is only compiled in when the
+ * emulator is built with ENABLE_PROFILING. Event names aren't copied and must be string literals
+ * or otherwise live for the rest of the program.
+ */
+namespace Trace {
+
+/// Row of the timeline an event is shown on
+enum class Track : u32 {
+    Frames,     ///< Emulated frames, from VBlank to VBlank
+    CPU,        ///< Running the ARM11 core
+    GPU,        ///< Command lists, draws, display transfers and presentation
+    HLE,        ///< SVCs and service commands
+    Count
+};
+
+/// Default capacity of the ring buffer, about a minute of a typical game
+const size_t DEFAULT_MAX_EVENTS = 1 << 20;
+
+/// Whether events are being recorded, only changed by Start and Stop but read from any thread
+extern std::atomic<bool> g_recording;
+
+/**
+ * Starts recording events, forgetting the ones recorded before
+ * @param max_events Number of events kept, the oldest ones are overwritten past it
+ */
+void Start(size_t max_events = DEFAULT_MAX_EVENTS);
+
+/// Stops recording events, the recorded ones are kept until the next Start
+void Stop();
+
+inline bool IsRecording() {
+    return g_recording;
+}
+
+/**
+ * Records an event, if recording
+ * @param track Track the event is shown on
+ * @param name Name of the event
+ * @param start_ticks Start of the event, from Common::Profiling::GetTicks
+ * @param end_ticks End of the event, from Common::Profiling::GetTicks
+ * @param arg Value shown with the event: the frame number on the Frames track
+ * @param merge Whether to extend the previous event of the track instead, if it has the same
+ *              name and ended just before. This keeps events which are split in many short calls,
+ *              like CPU slices, from filling the buffer. The number of merged calls is shown.
+ */
+void AddEvent(Track track, const char* name, u64 start_ticks, u64 end_ticks, u64 arg = 0,
+              bool merge = false);
+
+/**
+ * Formats the recorded events as a Chrome trace JSON document
+ * @return JSON document, with timestamps in microseconds since the oldest event
+ */
+std::string FormatJSON();
+
+/**
+ * Writes the recorded events to a file as Chrome trace JSON
+ * @param filename Path of the file to write
+ * @return True on success, otherwise false
+ */
+bool Dump(const std::string& filename);
+
+/// Records an event covering the time from its construction to its destruction
+class ScopedEvent {
+public:
+    ScopedEvent(Track track, const char* name, bool merge = false)
+        : track(track), name(name), merge(merge),
+          start(g_recording ? Common::Profiling::GetTicks() : 0) {}
+
+    ~ScopedEvent() {
+        if (g_recording && start != 0)
+            AddEvent(track, name, start, Common::Profiling::GetTicks(), 0, merge);
+    }
+
+private:
+    Track track;
+    const char* name;
+    bool merge;
+    u64 start;
+};
+
+} // namespace Trace
+} // namespace Common
+
+#ifdef ENABLE_PROFILING
+#define TRACE_SCOPE(track, name) ::Common::Trace::ScopedEvent \
+    _trace_scoped_event(::Common::Trace::Track::track, name)
+#define TRACE_SCOPE_MERGED(track, name) ::Common::Trace::ScopedEvent \
+    _trace_scoped_event(::Common::Trace::Track::track, name, true)
+#else
+#define TRACE_SCOPE(track, name) do {} while (0)
+#define TRACE_SCOPE_MERGED(track, name) do {} while (0)
+#endif
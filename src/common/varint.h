@@ -0,0 +1,43 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <vector>
+
+#include "common/common_types.h"
+
+namespace Common {
+
+/// Appends an unsigned integer as a varint: 7 bits per byte, low bits first, with the top bit of
+/// each byte set if more bytes follow
+inline void WriteVarint(std::vector<u8>& out, u64 value) {
+    while (value >= 0x80) {
+        out.push_back((u8)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((u8)value);
+}
+
+/**
+ * Reads a varint written by WriteVarint
+ * @param in Position to read from, advanced past the varint
+ * @param end End of the buffer
+ * @param value Receives the integer
+ * @return False if the varint is truncated or too long
+ */
+inline bool ReadVarint(const u8*& in, const u8* end, u64& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (in == end)
+            return false;
+        const u8 byte = *in++;
+        value |= (u64)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+} // namespace
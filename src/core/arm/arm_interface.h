@@ -6,6 +6,7 @@
 
 #include "common/common.h"
 #include "common/common_types.h"
+#include "common/chunk_file.h"
 
 #include "core/hle/svc.h"
 
@@ -97,6 +98,15 @@ public:
         return num_instructions;
     }
 
+    /**
+     * Saves or loads the state of the core
+     * @param p Savestate being written or read
+     */
+    void DoState(PointerWrap& p) {
+        p.Do(num_instructions);
+        DoCoreState(p);
+    }
+
 protected:
 
     /**
@@ -105,6 +115,12 @@ protected:
      */
     virtual void ExecuteInstructions(int num_instructions) = 0;
 
+    /**
+     * Saves or loads the state specific to the core implementation
+     * @param p Savestate being written or read
+     */
+    virtual void DoCoreState(PointerWrap& p) = 0;
+
 private:
 
     u64 num_instructions; ///< Number of instructions executed
@@ -164,3 +164,16 @@ void ARM_DynCom::LoadContext(const ThreadContext& ctx) {
 void ARM_DynCom::PrepareReschedule() {
     state->NumInstrsToExecute = 0;
 }
+
+/**
+ * Saves or loads the state specific to the core implementation
+ * @param p Savestate being written or read
+ */
+void ARM_DynCom::DoCoreState(PointerWrap& p) {
+    ARMul_DoState(p, state.get());
+    p.Do(ticks);
+
+    // The loaded code may differ from the code that was translated
+    if (p.GetMode() == PointerWrap::MODE_READ)
+        InterpreterClearCache();
+}
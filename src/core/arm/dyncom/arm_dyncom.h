@@ -82,6 +82,12 @@ public:
      */
     void ExecuteInstructions(int num_instructions) override;
 
+    /**
+     * Saves or loads the state specific to the core implementation
+     * @param p Savestate being written or read
+     */
+    void DoCoreState(PointerWrap& p) override;
+
 private:
 
     std::unique_ptr<ARMul_State> state;
@@ -348,6 +348,11 @@ const ISEITEM arm_exclusion_code[] = {
         {"invalid",      0,      INVALID, 0}         
 };
 
+const char* get_arm_instr_name(int idx)
+{
+	return arm_instruction[idx].name;
+}
+
 int decode_arm_instr(uint32_t instr, int32_t *idx)
 {
 	int n = 0;
@@ -102,6 +102,7 @@
 #define GET_USER_MODE() (OR(ICMP_EQ(R(MODE_REG), CONST(USER32MODE)), ICMP_EQ(R(MODE_REG), CONST(SYSTEM32MODE))))
 
 int decode_arm_instr(uint32_t instr, int32_t *idx);
+const char* get_arm_instr_name(int idx);
 
 enum DECODE_STATUS {
 	DECODE_SUCCESS,
@@ -47,6 +47,8 @@ using namespace std;
 #include "core/mem_map.h"
 #include "core/hle/hle.h"
 
+#include "arm_dyncom_profiler.h"
+
 enum {
     COND = (1 << 0),
     NON_BRANCH = (1 << 1),
@@ -1514,6 +1516,7 @@ enum DECODE_STATUS {
 };
 
 int decode_arm_instr(uint32_t instr, int32_t *idx);
+const char* get_arm_instr_name(int idx);
 
 shtop_fp_t get_shtop(unsigned int inst)
 {
@@ -3540,8 +3543,35 @@ typedef struct instruction_set_encoding_item ISEITEM;
 
 extern const ISEITEM arm_instruction[];
 
+static const int NUM_INSTRUCTION_INDICES = sizeof(arm_instruction_trans) / sizeof(transop_fp_t);
+static_assert((size_t)NUM_INSTRUCTION_INDICES <= DyncomProfiler::MAX_INSTRUCTION_INDICES,
+	"DyncomProfiler can't count all the instructions");
+
+const char* InterpreterGetInstructionName(int index)
+{
+	/* The Thumb branches at the end of the table aren't decoded by decode_arm_instr */
+	static const char* const thumb_names[] = {
+		"b_2_thumb", "b_cond_thumb", "bl_1_thumb", "bl_2_thumb", "blx_1_thumb"
+	};
+	const int num_arm = NUM_INSTRUCTION_INDICES - 5;
+	if (index < 0 || index >= NUM_INSTRUCTION_INDICES)
+		return "unknown";
+	return index < num_arm ? get_arm_instr_name(index) : thumb_names[index - num_arm];
+}
+
+int InterpreterGetNumInstructionIndices()
+{
+	return NUM_INSTRUCTION_INDICES;
+}
+
 vector<uint64_t> code_page_set;
 
+void InterpreterClearCache()
+{
+	CreamCache.clear();
+	top = 0;
+}
+
 void flush_bb(uint32_t addr)
 {
 	bb_map::iterator it;
@@ -3731,6 +3761,24 @@ translated:
 	return KEEP_GOING;
 }
 
+/* find_bb and InterpreterTranslate, timed for DyncomProfiler */
+static int ProfiledFindBlock(arm_processor *cpu, unsigned int phys_addr, int &bb_start, unsigned int num_instrs)
+{
+	const u64 start_ticks = Common::Profiling::GetTicks();
+	if (find_bb(phys_addr, bb_start) == -1) {
+		const u64 lookup_ticks = Common::Profiling::GetTicks();
+		DyncomProfiler::g_stats.lookup_ticks += lookup_ticks - start_ticks;
+		if (InterpreterTranslate(cpu, bb_start, cpu->Reg[15]) == FETCH_EXCEPTION)
+			return FETCH_EXCEPTION;
+		DyncomProfiler::g_stats.translate_ticks += Common::Profiling::GetTicks() - lookup_ticks;
+		++DyncomProfiler::g_stats.num_translations;
+	} else {
+		DyncomProfiler::g_stats.lookup_ticks += Common::Profiling::GetTicks() - start_ticks;
+	}
+	DyncomProfiler::OnBlock(cpu->Reg[15], cpu->TFlag != 0, num_instrs);
+	return KEEP_GOING;
+}
+
 #define LOG_IN_CLR	skyeye_printf_in_color
 
 int cmp(const void *x, const void *y)
@@ -3817,11 +3865,13 @@ unsigned InterpreterMainLoop(ARMul_State* state)
 #define GOTO_NEXT_INST \
     if (num_instrs >= cpu->NumInstrsToExecute) goto END; \
     num_instrs++; \
+    if (profiling) DyncomProfiler::g_stats.instruction_counts[inst_base->idx]++; \
     goto *InstLabel[inst_base->idx]
 #else
 #define GOTO_NEXT_INST \
     if (num_instrs >= cpu->NumInstrsToExecute) goto END; \
     num_instrs++; \
+    if (profiling) DyncomProfiler::g_stats.instruction_counts[inst_base->idx]++; \
     switch(inst_base->idx) { \
     case 0: goto VMLA_INST; \
     case 1: goto VMLS_INST; \
@@ -4099,6 +4149,11 @@ unsigned InterpreterMainLoop(ARMul_State* state)
 	static unsigned int last_physical_base = 0, last_logical_base = 0;
 	int ptr;
 	bool single_step = (cpu->NumInstrsToExecute == 1);
+	/* Constant false without ENABLE_PROFILING, so that the hooks are compiled out */
+	const bool profiling = DyncomProfiler::IsEnabled();
+
+	if (profiling)
+		DyncomProfiler::OnEnter();
 
 	LOAD_NZCVT;
 	DISPATCH:
@@ -4225,7 +4280,11 @@ unsigned InterpreterMainLoop(ARMul_State* state)
 		}
 #endif /* #if HYBRID_MODE */
 #endif /* #if USER_MODE_OPT */
-		if (true){//if(is_fast_interp_code(core, phys_addr)){
+		if (profiling) {
+			if (ProfiledFindBlock(cpu, phys_addr, ptr, num_instrs) == FETCH_EXCEPTION)
+				goto END;
+		}
+		else if (true){//if(is_fast_interp_code(core, phys_addr)){
 			if (find_bb(phys_addr, ptr) == -1)
 				if (InterpreterTranslate(cpu, ptr, cpu->Reg[15]) == FETCH_EXCEPTION)
 					goto END;
@@ -6398,7 +6457,7 @@ unsigned InterpreterMainLoop(ARMul_State* state)
 		if ((inst_base->cond == 0xe) || CondPassed(cpu, inst_base->cond)) {
 			if (true){ //if (core->is_user_mode) { --> Citra only emulates user mode
 				//arm_dyncom_SWI(cpu, inst_cream->num);
-				HLE::CallSVC(Memory::Read32(cpu->Reg[15]));
+				HLE::CallSVC(inst_cream->num, cpu->Reg);
 			} else {
 				cpu->syscallSig = 1;
 				goto END;
@@ -6711,12 +6770,16 @@ unsigned InterpreterMainLoop(ARMul_State* state)
 		cpu->CP15[CP15(CP15_FAULT_STATUS)] = fault & 0xff;
 		cpu->CP15[CP15(CP15_FAULT_ADDRESS)] = addr;
 		cpu->NumInstrsToExecute = 0;
+		if (profiling)
+			DyncomProfiler::OnExit(num_instrs);
 		return num_instrs;
 	}
 	END:
 	{
 		SAVE_NZCVT;
 		cpu->NumInstrsToExecute = 0;
+		if (profiling)
+			DyncomProfiler::OnExit(num_instrs);
 		return num_instrs;
 	}
 	INIT_INST_LENGTH:
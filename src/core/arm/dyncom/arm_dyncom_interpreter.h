@@ -5,3 +5,12 @@
 #pragma once
 
 unsigned InterpreterMainLoop(ARMul_State* state);
+
+/// Forgets all the translated blocks, for when guest code was replaced (e.g. a savestate was loaded)
+void InterpreterClearCache();
+
+/// Name of the instruction with the given index in the translation table (arm_inst::idx)
+const char* InterpreterGetInstructionName(int index);
+
+/// Number of instruction indices in the translation table
+int InterpreterGetNumInstructionIndices();
@@ -0,0 +1,188 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <vector>
+
+#include "common/common.h"
+#include "common/file_util.h"
+#include "common/string_util.h"
+
+#include "core/mem_map.h"
+#include "core/arm/disassembler/arm_disasm.h"
+#include "core/arm/dyncom/arm_dyncom_profiler.h"
+#include "core/arm/skyeye_common/armdefs.h"
+#include "core/arm/dyncom/arm_dyncom_interpreter.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Namespace DyncomProfiler
+
+namespace DyncomProfiler {
+
+using Common::Profiling::TicksToNanoseconds;
+
+/// Maximum number of instructions listed for each hot block
+static const u32 MAX_LISTING_LENGTH = 32;
+
+Stats g_stats;
+bool g_enabled = false;
+
+static u64 enter_ticks = 0;
+static BlockStats* current_block = nullptr;
+static u32 current_block_start = 0; ///< Value of num_instrs when the current block was entered
+
+void SetEnabled(bool enabled) {
+    if (enabled && !Common::Profiling::IS_ENABLED)
+        LOG_WARNING(Core_ARM11, "Dyncom profiler is not compiled in, build with ENABLE_PROFILING");
+    g_enabled = enabled;
+}
+
+void Reset() {
+    g_stats.instruction_counts.fill(0);
+    g_stats.num_instructions = 0;
+    g_stats.num_dispatches = 0;
+    g_stats.num_translations = 0;
+    g_stats.run_ticks = 0;
+    g_stats.lookup_ticks = 0;
+    g_stats.translate_ticks = 0;
+    g_stats.blocks.clear();
+    current_block = nullptr;
+}
+
+/// Attributes the instructions executed since the current block was entered to it
+static void FinishBlock(u32 num_instrs) {
+    if (current_block != nullptr)
+        current_block->num_instructions += num_instrs - current_block_start;
+    current_block = nullptr;
+}
+
+void OnEnter() {
+    enter_ticks = Common::Profiling::GetTicks();
+    current_block = nullptr;
+}
+
+void OnBlock(u32 address, bool thumb, u32 num_instrs) {
+    FinishBlock(num_instrs);
+
+    // Pointers to the elements of an unordered_map stay valid when it grows
+    BlockStats& block = g_stats.blocks[address];
+    block.thumb = thumb;
+    ++block.num_executions;
+    ++g_stats.num_dispatches;
+
+    current_block = &block;
+    current_block_start = num_instrs;
+}
+
+void OnExit(u32 num_instrs) {
+    FinishBlock(num_instrs);
+    g_stats.num_instructions += num_instrs;
+    g_stats.run_ticks += Common::Profiling::GetTicks() - enter_ticks;
+}
+
+static double Percent(u64 part, u64 total) {
+    return total ? part * 100.0 / total : 0.0;
+}
+
+/// Lists the instructions of a block, as many as it executes on average
+static std::string FormatListing(u32 address, const BlockStats& block) {
+    const u64 average_length = (block.num_instructions + block.num_executions - 1) /
+                               block.num_executions;
+    const u32 length = (u32)std::min<u64>(std::max<u64>(average_length, 1), MAX_LISTING_LENGTH);
+
+    std::string listing;
+    for (u32 i = 0; i < length; ++i) {
+        if (block.thumb) {
+            // ARM_Disasm only knows ARM instructions, Thumb ones are listed raw
+            const u32 pc = address + i * 2;
+            listing += Common::StringFromFormat("      %08x: %04x\n", pc, Memory::Read16(pc));
+        } else {
+            const u32 pc = address + i * 4;
+            const u32 instruction = Memory::Read32(pc);
+            listing += Common::StringFromFormat("      %08x: %08x  %s\n", pc, instruction,
+                                                ARM_Disasm::Disassemble(pc, instruction).c_str());
+        }
+    }
+    return listing;
+}
+
+std::string FormatReport(size_t num_hot_blocks) {
+    const double run_ns = TicksToNanoseconds(g_stats.run_ticks);
+    const u64 execute_ticks = g_stats.run_ticks -
+        std::min(g_stats.run_ticks, g_stats.lookup_ticks + g_stats.translate_ticks);
+
+    std::string report = Common::StringFromFormat(
+        "Dyncom profile\n"
+        "  %llu instructions in %.3f ms: %.2f MIPS\n"
+        "  %llu blocks entered, %llu translated\n"
+        "  time split:\n"
+        "    %-10s %12.3f ms %6.1f%%\n"
+        "    %-10s %12.3f ms %6.1f%%\n"
+        "    %-10s %12.3f ms %6.1f%%\n",
+        (unsigned long long)g_stats.num_instructions, run_ns / 1e6,
+        run_ns ? g_stats.num_instructions * 1e3 / run_ns : 0.0,
+        (unsigned long long)g_stats.num_dispatches, (unsigned long long)g_stats.num_translations,
+        "lookup", TicksToNanoseconds(g_stats.lookup_ticks) / 1e6,
+        Percent(g_stats.lookup_ticks, g_stats.run_ticks),
+        "translate", TicksToNanoseconds(g_stats.translate_ticks) / 1e6,
+        Percent(g_stats.translate_ticks, g_stats.run_ticks),
+        "execute", TicksToNanoseconds(execute_ticks) / 1e6,
+        Percent(execute_ticks, g_stats.run_ticks));
+
+    std::vector<int> indices;
+    for (int i = 0; i < InterpreterGetNumInstructionIndices(); ++i) {
+        if (g_stats.instruction_counts[i] != 0)
+            indices.push_back(i);
+    }
+    std::sort(indices.begin(), indices.end(), [](int a, int b) {
+        return g_stats.instruction_counts[a] > g_stats.instruction_counts[b];
+    });
+
+    report += "  instruction mix:\n";
+    for (int index : indices) {
+        const u64 count = g_stats.instruction_counts[index];
+        report += Common::StringFromFormat("    %-10s %14llu %6.2f%%\n",
+            InterpreterGetInstructionName(index), (unsigned long long)count,
+            Percent(count, g_stats.num_instructions));
+    }
+
+    std::vector<std::pair<u32, const BlockStats*>> blocks;
+    for (const auto& block : g_stats.blocks)
+        blocks.emplace_back(block.first, &block.second);
+    const size_t num_listed = std::min(num_hot_blocks, blocks.size());
+    std::partial_sort(blocks.begin(), blocks.begin() + num_listed, blocks.end(),
+        [](const std::pair<u32, const BlockStats*>& a, const std::pair<u32, const BlockStats*>& b) {
+            return a.second->num_instructions > b.second->num_instructions;
+        });
+
+    report += Common::StringFromFormat("  hot blocks (%u of %u):\n", (u32)num_listed,
+                                       (u32)blocks.size());
+    for (size_t i = 0; i < num_listed; ++i) {
+        const BlockStats& block = *blocks[i].second;
+        report += Common::StringFromFormat("    %08x %-5s %12llu executions %14llu instructions "
+            "%6.2f%%\n", blocks[i].first, block.thumb ? "thumb" : "arm",
+            (unsigned long long)block.num_executions, (unsigned long long)block.num_instructions,
+            Percent(block.num_instructions, g_stats.num_instructions));
+        report += FormatListing(blocks[i].first, block);
+    }
+    return report;
+}
+
+bool Dump(const std::string& filename, size_t num_hot_blocks) {
+    if (!Common::Profiling::IS_ENABLED) {
+        LOG_WARNING(Core_ARM11, "Dyncom profiler is not compiled in, nothing to dump");
+        return false;
+    }
+
+    const std::string report = FormatReport(num_hot_blocks);
+    if (FileUtil::WriteStringToFile(true, report, filename.c_str()) != report.size()) {
+        LOG_ERROR(Core_ARM11, "Failed to write dyncom profile to %s", filename.c_str());
+        return false;
+    }
+
+    LOG_INFO(Core_ARM11, "Wrote dyncom profile to %s", filename.c_str());
+    return true;
+}
+
+} // namespace
@@ -0,0 +1,93 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <string>
+#include <unordered_map>
+
+#include "common/common_types.h"
+#include "common/profiler.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Namespace DyncomProfiler
+
+/**
+ * Profiles the dyncom interpreter: how many times each kind of instruction was executed, how the
+ * time in InterpreterMainLoop splits between finding or translating blocks and executing them,
+ * and how often each block was executed. The hooks are only compiled in when the emulator is built
+ * with ENABLE_PROFILING, and do nothing until the profiler is enabled with SetEnabled. Like the
+ * interpreter, the statistics belong to the emulation thread.
+ */
+namespace DyncomProfiler {
+
+/// Upper bound of the instruction indices of the interpreter (arm_inst::idx)
+const size_t MAX_INSTRUCTION_INDICES = 256;
+
+struct BlockStats {
+    bool thumb;
+    u64 num_executions;     ///< Number of times the block was entered from the dispatcher
+    u64 num_instructions;   ///< Instructions executed from the block, over all executions
+};
+
+struct Stats {
+    std::array<u64, MAX_INSTRUCTION_INDICES> instruction_counts; ///< Indexed by arm_inst::idx
+    u64 num_instructions;
+    u64 num_dispatches;     ///< Blocks entered
+    u64 num_translations;   ///< Blocks which weren't in the cache and had to be translated
+    u64 run_ticks;          ///< Ticks spent in InterpreterMainLoop
+    u64 lookup_ticks;       ///< Ticks spent looking up blocks in the cache (find_bb)
+    u64 translate_ticks;    ///< Ticks spent translating blocks (InterpreterTranslate)
+    std::unordered_map<u32, BlockStats> blocks; ///< Indexed by block address
+};
+
+extern Stats g_stats;
+extern bool g_enabled;
+
+/// Returns true if the interpreter should record statistics
+inline bool IsEnabled() {
+    return Common::Profiling::IS_ENABLED && g_enabled;
+}
+
+/// Starts or stops recording statistics, the ones recorded so far are kept
+void SetEnabled(bool enabled);
+
+/// Clears all recorded statistics
+void Reset();
+
+/// Called by the interpreter when it starts running
+void OnEnter();
+
+/**
+ * Called by the interpreter when it enters a block
+ * @param address Address of the block
+ * @param thumb True if the block is Thumb code
+ * @param num_instrs Number of instructions executed since OnEnter
+ */
+void OnBlock(u32 address, bool thumb, u32 num_instrs);
+
+/**
+ * Called by the interpreter when it stops running
+ * @param num_instrs Number of instructions executed since OnEnter
+ */
+void OnExit(u32 num_instrs);
+
+/**
+ * Formats the recorded statistics as a text report: the time split, the instruction mix and a
+ * listing of the hottest blocks
+ * @param num_hot_blocks Number of blocks to list, by number of instructions executed
+ * @return Report of the statistics
+ */
+std::string FormatReport(size_t num_hot_blocks = 20);
+
+/**
+ * Writes the report of the recorded statistics to a file
+ * @param filename Path of the file to write
+ * @param num_hot_blocks Number of blocks to list
+ * @return True on success, otherwise false
+ */
+bool Dump(const std::string& filename, size_t num_hot_blocks = 20);
+
+} // namespace
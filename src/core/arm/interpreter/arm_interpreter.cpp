@@ -151,3 +151,11 @@ void ARM_Interpreter::LoadContext(const ThreadContext& ctx) {
 void ARM_Interpreter::PrepareReschedule() {
     state->NumInstrsToExecute = 0;
 }
+
+/**
+ * Saves or loads the state specific to the core implementation
+ * @param p Savestate being written or read
+ */
+void ARM_Interpreter::DoCoreState(PointerWrap& p) {
+    ARMul_DoState(p, state);
+}
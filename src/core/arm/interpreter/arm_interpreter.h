@@ -83,6 +83,12 @@ protected:
      */
     void ExecuteInstructions(int num_instructions) override;
 
+    /**
+     * Saves or loads the state specific to the core implementation
+     * @param p Savestate being written or read
+     */
+    void DoCoreState(PointerWrap& p) override;
+
 private:
 
     ARMul_State* state;
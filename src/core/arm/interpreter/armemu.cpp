@@ -3943,7 +3943,7 @@ mainswitch:
                 case 0xfe:
                 case 0xff:
                     //svc_Execute(state, BITS(0, 23));
-                    HLE::CallSVC(instr);
+                    HLE::CallSVC(BITS(0, 23), state->Reg);
                     
                     break;
                 }
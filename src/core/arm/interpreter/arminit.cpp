@@ -17,6 +17,8 @@
 
 //#include <unistd.h>
 
+#include "common/chunk_file.h"
+
 #include "core/arm/skyeye_common/armdefs.h"
 #include "core/arm/skyeye_common/armemu.h"
 
@@ -524,3 +526,86 @@ ARMul_Abort (ARMul_State * state, ARMword vector)
     } else
         ARMul_SetR15 (state, R15CCINTMODE | vector);
 }
+
+/***************************************************************************\
+*        Saves or loads the architectural and pipeline state of a core     *
+\***************************************************************************/
+
+void
+ARMul_DoState (PointerWrap& p, ARMul_State * state)
+{
+    auto s = p.Section("ARMul_State", 1);
+    if (!s)
+        return;
+
+    p.Do(state->Emulate);
+    p.DoArray(state->Reg, 16);
+    p.Do(state->Cpsr);
+    p.Do(state->Spsr_copy);
+    p.Do(state->phys_pc);
+    p.DoArray(state->Reg_usr, 2);
+    p.DoArray(state->Reg_svc, 2);
+    p.DoArray(state->Reg_abort, 2);
+    p.DoArray(state->Reg_undef, 2);
+    p.DoArray(state->Reg_irq, 2);
+    p.DoArray(state->Reg_firq, 7);
+    p.DoArray(state->Spsr, 7);
+    p.Do(state->Mode);
+    p.Do(state->Bank);
+    p.Do(state->exclusive_tag);
+    p.Do(state->exclusive_state);
+    p.Do(state->exclusive_result);
+    p.DoArray(state->CP15, VFP_BASE - CP15_BASE);
+    p.DoArray(state->VFP, 3);
+    p.DoArray(state->ExtReg, VFP_REG_NUM);
+    p.DoArray(&state->RegBank[0][0], 7 * 16);
+    p.Do(state->Accumulator);
+
+    p.Do(state->NFlag);
+    p.Do(state->ZFlag);
+    p.Do(state->CFlag);
+    p.Do(state->VFlag);
+    p.Do(state->IFFlags);
+    p.Do(state->shifter_carry_out);
+    p.Do(state->GEFlag);
+    p.Do(state->EFlag);
+    p.Do(state->AFlag);
+    p.Do(state->QFlags);
+    p.Do(state->SFlag);
+#ifdef MODET
+    p.Do(state->TFlag);
+#endif
+
+    p.Do(state->instr);
+    p.Do(state->pc);
+    p.Do(state->temp);
+    p.Do(state->loaded);
+    p.Do(state->decoded);
+    p.Do(state->loaded_addr);
+    p.Do(state->decoded_addr);
+    p.Do(state->NumScycles);
+    p.Do(state->NumNcycles);
+    p.Do(state->NumIcycles);
+    p.Do(state->NumCcycles);
+    p.Do(state->NumFcycles);
+    p.Do(state->NumInstrs);
+    p.Do(state->NextInstr);
+
+    p.Do(state->NresetSig);
+    p.Do(state->NfiqSig);
+    p.Do(state->NirqSig);
+    p.Do(state->abortSig);
+    p.Do(state->Vector);
+    p.Do(state->Aborted);
+    p.Do(state->Reseted);
+    p.Do(state->Inted);
+    p.Do(state->LastInted);
+    p.Do(state->Base);
+    p.Do(state->AbortAddr);
+
+    p.DoArray(state->exclusive_tag_array, 128);
+    p.Do(state->exclusive_access_state);
+    p.Do(state->CurrInstr);
+    p.Do(state->last_pc);
+    p.Do(state->last_instr);
+}
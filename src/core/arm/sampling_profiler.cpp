@@ -0,0 +1,251 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "common/common.h"
+#include "common/file_util.h"
+#include "common/profiler.h"
+#include "common/string_util.h"
+#include "common/symbols.h"
+
+#include "core/core.h"
+#include "core/mem_map.h"
+#include "core/arm/arm_interface.h"
+#include "core/arm/sampling_profiler.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Namespace SamplingProfiler
+
+namespace SamplingProfiler {
+
+/// Number of stack words searched for return addresses
+static const u32 MAX_STACK_SCAN_WORDS = 1024;
+
+std::atomic<bool> g_running(false);
+
+// Samples are taken on the emulation thread, but dumped from the frontend's
+static std::mutex mutex;
+static Config config;
+static u64 interval;        ///< In instructions, or in host ticks
+static u64 next_sample;     ///< 0 until the first Update, the core may not exist at Start
+static u64 num_samples;
+
+/// Number of samples of each stack, given as the functions from the sampled one outwards
+static std::map<std::vector<u32>, u64> stacks;
+
+Config DefaultConfig() {
+    Config config;
+    config.trigger = Trigger::Instructions;
+    config.interval = 10000;
+    config.max_callers = 16;
+    return config;
+}
+
+static u64 GetTime() {
+    if (config.trigger == Trigger::Instructions)
+        return Core::g_app_core->GetNumInstructions();
+    return Common::Profiling::GetTicks();
+}
+
+void Start(const Config& new_config) {
+    std::lock_guard<std::mutex> lock(mutex);
+    config = new_config;
+    interval = std::max<u64>(config.interval, 1);
+    if (config.trigger == Trigger::HostTime) {
+        static const u64 CALIBRATION_TICKS = 1 << 24;
+        const double ns_per_tick = std::max(
+            Common::Profiling::TicksToNanoseconds(CALIBRATION_TICKS) / CALIBRATION_TICKS, 1e-6);
+        interval = std::max<u64>((u64)(interval * 1000 / ns_per_tick), 1);
+    }
+
+    stacks.clear();
+    num_samples = 0;
+    next_sample = 0;
+    g_running = true;
+}
+
+void Stop() {
+    std::lock_guard<std::mutex> lock(mutex);
+    g_running = false;
+}
+
+/// Reads guest memory without logging errors when it isn't mapped
+static bool ReadGuest(VAddr address, void* value, u32 size) {
+    u32 contiguous_size;
+    const u8* pointer = Memory::GetHostRange(address, contiguous_size);
+    if (pointer == nullptr || contiguous_size < size)
+        return false;
+    std::memcpy(value, pointer, size);
+    return true;
+}
+
+/// Whether a value is the address following an ARM or Thumb call instruction
+static bool IsReturnAddress(u32 value) {
+    if (value & 1) {
+        // Thumb BL and BLX are a pair of halfwords, the return address has the Thumb bit set
+        u16 call[2];
+        if (!ReadGuest((value & ~1) - 4, call, sizeof(call)))
+            return false;
+        return (call[0] & 0xF800) == 0xF000 && (call[1] & 0xE800) == 0xE800;
+    }
+    if (value & 3)
+        return false;
+
+    u32 call;
+    if (!ReadGuest(value - 4, &call, sizeof(call)))
+        return false;
+    return (call & 0x0F000000) == 0x0B000000 ||     // BL, and BLX with the H bit set
+           (call & 0xFE000000) == 0xFA000000 ||     // BLX immediate
+           (call & 0x0FFFFFF0) == 0x012FFF30;       // BLX register
+}
+
+/// Gets the start of the function containing an address, or the address itself if it is unknown
+static u32 GetFunction(u32 address) {
+    const TSymbol symbol = Symbols::GetContainingSymbol(address & ~1);
+    return symbol.name.empty() ? (address & ~1) : symbol.address;
+}
+
+/// Adds a caller to a stack, unless it is the same function as the previous one (e.g. LR still
+/// points into the sampled function, or the stack holds a stale return address to it)
+static void AddCaller(std::vector<u32>& stack, u32 return_address) {
+    const u32 function = GetFunction(return_address - 4);
+    if (stack.back() != function)
+        stack.push_back(function);
+}
+
+static void TakeSample() {
+    const ARM_Interface& cpu = *Core::g_app_core;
+    std::vector<u32> stack(1, GetFunction(cpu.GetPC()));
+
+    if (config.max_callers >= 1) {
+        const u32 lr = cpu.GetReg(14);
+        if (IsReturnAddress(lr))
+            AddCaller(stack, lr);
+    }
+
+    const u32 sp = cpu.GetReg(13);
+    for (u32 i = 0; i < MAX_STACK_SCAN_WORDS && stack.size() <= config.max_callers; ++i) {
+        u32 value;
+        if (!ReadGuest(sp + i * 4, &value, sizeof(value)))
+            break;
+        if (IsReturnAddress(value))
+            AddCaller(stack, value);
+    }
+
+    ++stacks[stack];
+    ++num_samples;
+}
+
+void Update() {
+    if (!g_running)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    const u64 now = GetTime();
+    if (next_sample == 0)
+        next_sample = now + interval;
+    if (now < next_sample)
+        return;
+
+    TakeSample();
+    // Skip the samples which were missed rather than taking them all at once
+    next_sample = std::max(next_sample + interval, now + 1);
+}
+
+/// Gets the name of a function, for reports
+static std::string GetFunctionName(u32 function) {
+    const TSymbol symbol = Symbols::GetContainingSymbol(function);
+    if (symbol.name.empty())
+        return Common::StringFromFormat("0x%08x", function);
+    return symbol.name;
+}
+
+std::string FormatCollapsed() {
+    // Symbols may have been loaded after the samples were taken, merge the stacks by name
+    std::map<std::string, u64> collapsed;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& entry : stacks) {
+            const std::vector<u32>& stack = entry.first;
+            std::string line;
+            for (auto it = stack.rbegin(); it != stack.rend(); ++it)
+                line += (line.empty() ? "" : ";") + GetFunctionName(*it);
+            collapsed[line] += entry.second;
+        }
+    }
+
+    std::string text;
+    for (const auto& entry : collapsed)
+        text += Common::StringFromFormat("%s %llu\n", entry.first.c_str(),
+                                         (unsigned long long)entry.second);
+    return text;
+}
+
+std::string FormatReport(size_t num_functions) {
+    struct FunctionSamples {
+        u64 self;
+        u64 total;
+    };
+    std::map<std::string, FunctionSamples> functions;
+    u64 total_samples;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        total_samples = num_samples;
+        for (const auto& entry : stacks) {
+            const std::vector<u32>& stack = entry.first;
+            functions[GetFunctionName(stack.front())].self += entry.second;
+
+            // Recursive functions count once towards their total
+            std::set<std::string> seen;
+            for (u32 function : stack) {
+                const std::string name = GetFunctionName(function);
+                if (seen.insert(name).second)
+                    functions[name].total += entry.second;
+            }
+        }
+    }
+
+    std::vector<std::pair<std::string, FunctionSamples>> sorted(functions.begin(),
+                                                                functions.end());
+    const size_t num_listed = std::min(num_functions, sorted.size());
+    std::partial_sort(sorted.begin(), sorted.begin() + num_listed, sorted.end(),
+        [](const std::pair<std::string, FunctionSamples>& a,
+           const std::pair<std::string, FunctionSamples>& b) {
+            return a.second.self > b.second.self;
+        });
+
+    std::string report = Common::StringFromFormat("%llu samples, %u functions\n"
+        "      self           total         function\n",
+        (unsigned long long)total_samples, (u32)functions.size());
+    const double scale = total_samples ? 100.0 / total_samples : 0.0;
+    for (size_t i = 0; i < num_listed; ++i) {
+        const FunctionSamples& samples = sorted[i].second;
+        report += Common::StringFromFormat("%10llu %5.1f%% %8llu %5.1f%%  %s\n",
+            (unsigned long long)samples.self, samples.self * scale,
+            (unsigned long long)samples.total, samples.total * scale, sorted[i].first.c_str());
+    }
+    return report;
+}
+
+bool Dump(const std::string& filename) {
+    const bool is_report = filename.size() >= 4 &&
+        filename.compare(filename.size() - 4, 4, ".txt") == 0;
+    const std::string contents = is_report ? FormatReport() : FormatCollapsed();
+
+    if (FileUtil::WriteStringToFile(true, contents, filename.c_str()) != contents.size()) {
+        LOG_ERROR(Core_ARM11, "Failed to write guest profile to %s", filename.c_str());
+        return false;
+    }
+
+    LOG_INFO(Core_ARM11, "Wrote guest profile to %s", filename.c_str());
+    return true;
+}
+
+} // namespace
@@ -0,0 +1,83 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#include "common/common_types.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Namespace SamplingProfiler
+
+/**
+ * Finds out where the emulated program spends its time by periodically sampling the PC of the
+ * application core, and optionally its callers: LR, then the return addresses found on the stack.
+ * Samples are attributed to the functions of the loaded symbol map (see LoadSymbolMap), and can be
+ * written as collapsed stacks for flamegraph.pl or speedscope.
+ *
+ * Samples are taken by Update, between two runs of the core, so their resolution is the number of
+ * instructions the core loop runs at once. The stack walk is heuristic: it takes any word on the
+ * stack which points right after a call instruction for a return address.
+ */
+namespace SamplingProfiler {
+
+enum class Trigger {
+    Instructions,   ///< Sample every interval emulated instructions
+    HostTime,       ///< Sample every interval microseconds of host time
+};
+
+struct Config {
+    Trigger trigger;
+    u64 interval;
+    u32 max_callers;    ///< Callers recorded above the sampled function: 0 for none, 1 for LR only
+};
+
+/// Default configuration: a sample every 10000 instructions, with up to 16 callers
+Config DefaultConfig();
+
+/// Whether the profiler is running, only changed by Start and Stop but read from any thread
+extern std::atomic<bool> g_running;
+
+/**
+ * Starts sampling, forgetting the previous samples
+ * @param config How often to sample and how many callers to record
+ */
+void Start(const Config& config);
+
+/// Stops sampling, the samples are kept until the next Start
+void Stop();
+
+inline bool IsRunning() {
+    return g_running;
+}
+
+/// Takes a sample if the interval has elapsed. Called by the core loop after running the CPU.
+void Update();
+
+/**
+ * Formats the samples as collapsed stacks: one line per distinct stack, with its function names
+ * from the outermost caller to the sampled function separated by semicolons, then the number of
+ * samples
+ * @return Collapsed stacks, e.g. "main;DrawFrame;memcpy 42"
+ */
+std::string FormatCollapsed();
+
+/**
+ * Formats a summary of the functions with the most samples, by self and total samples
+ * @param num_functions Number of functions to list
+ * @return Report of the samples
+ */
+std::string FormatReport(size_t num_functions = 30);
+
+/**
+ * Writes the samples to a file, as collapsed stacks, or as the summary of FormatReport if the
+ * name ends with ".txt"
+ * @param filename Path of the file to write
+ * @return True on success, otherwise false
+ */
+bool Dump(const std::string& filename);
+
+} // namespace
@@ -33,6 +33,8 @@
 #include "core/arm/skyeye_common/armmmu.h"
 #include "core/arm/skyeye_common/skyeye_defs.h"
 
+class PointerWrap;
+
 #if EMU_PLATFORM == PLATFORM_LINUX
 #include <sys/time.h>
 #include <unistd.h>
@@ -522,6 +524,7 @@ extern void ARMul_Reset(ARMul_State* state);
 extern ARMul_State *ARMul_NewState(ARMul_State* state);
 extern ARMword ARMul_DoProg(ARMul_State* state);
 extern ARMword ARMul_DoInstr(ARMul_State* state);
+extern void ARMul_DoState(PointerWrap& p, ARMul_State* state);
 /***************************************************************************\
 *                Definitons of things for event handling                    *
 \***************************************************************************/
@@ -0,0 +1,557 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+/*
+ * Host FPU fast path for VFP arithmetic.
+ *
+ * With round-to-nearest and no trapped exceptions, the result of VFP arithmetic on normal numbers,
+ * zeros and infinities is exactly the IEEE 754 one, which SSE2 computes. The cumulative exception
+ * flags are derived from the operands and the result rather than read back from MXCSR, as
+ * switching MXCSR costs more than the operation itself: inexact is detected with exact error
+ * terms (TwoSum, Dekker's product, or a product computed exactly in double precision), overflow
+ * and division by zero from infinite results.
+ *
+ * The functions below return false, so that the caller falls back to the soft float code, when an
+ * operand or the result is a NaN or a denormal, when the result may have underflowed, and for
+ * integer conversions which would raise invalid operation. These are the cases where VFP
+ * behaviour depends on the FZ/DN bits, or where the soft float code has its own conventions.
+ *
+ * Multiply-accumulate operations round the product before the addition, as VMLA and friends do,
+ * like the soft float code.
+ */
+
+#if defined(__SSE2_MATH__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VFP_HOST_FPU 1
+#endif
+
+#ifdef VFP_HOST_FPU
+
+#include <cstring>
+
+#include <emmintrin.h>
+
+#include "core/arm/skyeye_common/vfp/vfp_helper.h"
+
+/// MXCSR bits that must be clear for the host to round like VFP: rounding control, FZ and DAZ
+#define VFP_HOST_MXCSR_CONFIG   0xE040
+
+/// Checks whether operations under an FPSCR configuration may use the host FPU
+static inline bool vfp_host_fpscr_ok(u32 fpscr)
+{
+    if (fpscr & (FPSCR_RMODE_MASK | FPSCR_IOE | FPSCR_DZE | FPSCR_OFE | FPSCR_UFE | FPSCR_IXE | FPSCR_IDE))
+        return false;
+    return (_mm_getcsr() & VFP_HOST_MXCSR_CONFIG) == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Conversions and SSE2 arithmetic. Intrinsics are used rather than C operators so that the
+// compiler can neither contract a multiplication and an addition nor use extended precision.
+
+static inline float vfp_host_single(u32 v)
+{
+    float f;
+    memcpy(&f, &v, sizeof(f));
+    return f;
+}
+
+static inline u32 vfp_host_single_bits(float f)
+{
+    u32 v;
+    memcpy(&v, &f, sizeof(v));
+    return v;
+}
+
+static inline double vfp_host_double(u64 v)
+{
+    double d;
+    memcpy(&d, &v, sizeof(d));
+    return d;
+}
+
+static inline u64 vfp_host_double_bits(double d)
+{
+    u64 v;
+    memcpy(&v, &d, sizeof(v));
+    return v;
+}
+
+static inline float vfp_host_adds(float a, float b) { return _mm_cvtss_f32(_mm_add_ss(_mm_set_ss(a), _mm_set_ss(b))); }
+static inline float vfp_host_subs(float a, float b) { return _mm_cvtss_f32(_mm_sub_ss(_mm_set_ss(a), _mm_set_ss(b))); }
+static inline float vfp_host_muls(float a, float b) { return _mm_cvtss_f32(_mm_mul_ss(_mm_set_ss(a), _mm_set_ss(b))); }
+static inline float vfp_host_divs(float a, float b) { return _mm_cvtss_f32(_mm_div_ss(_mm_set_ss(a), _mm_set_ss(b))); }
+static inline float vfp_host_sqrts(float a) { return _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(a))); }
+
+static inline double vfp_host_addd(double a, double b) { return _mm_cvtsd_f64(_mm_add_sd(_mm_set_sd(a), _mm_set_sd(b))); }
+static inline double vfp_host_subd(double a, double b) { return _mm_cvtsd_f64(_mm_sub_sd(_mm_set_sd(a), _mm_set_sd(b))); }
+static inline double vfp_host_muld(double a, double b) { return _mm_cvtsd_f64(_mm_mul_sd(_mm_set_sd(a), _mm_set_sd(b))); }
+static inline double vfp_host_divd(double a, double b) { return _mm_cvtsd_f64(_mm_div_sd(_mm_set_sd(a), _mm_set_sd(b))); }
+static inline double vfp_host_sqrtd(double a) { return _mm_cvtsd_f64(_mm_sqrt_sd(_mm_setzero_pd(), _mm_set_sd(a))); }
+
+/// Widens a single to a double, which is always exact
+static inline double vfp_host_widen(float a) { return _mm_cvtsd_f64(_mm_cvtss_sd(_mm_setzero_pd(), _mm_set_ss(a))); }
+
+/// Rounds a double to a single
+static inline float vfp_host_narrow(double a) { return _mm_cvtss_f32(_mm_cvtsd_ss(_mm_setzero_ps(), _mm_set_sd(a))); }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Operand and result classification
+
+/// Checks that a single is neither a NaN nor a denormal
+static inline bool vfp_host_single_ok(u32 v)
+{
+    u32 exponent = (v >> 23) & 0xFF;
+    u32 mantissa = v & 0x7FFFFF;
+    return mantissa == 0 || (exponent != 0 && exponent != 0xFF);
+}
+
+/// Checks that a double is neither a NaN nor a denormal
+static inline bool vfp_host_double_ok(u64 v)
+{
+    u64 exponent = (v >> 52) & 0x7FF;
+    u64 mantissa = v & 0xFFFFFFFFFFFFFULL;
+    return mantissa == 0 || (exponent != 0 && exponent != 0x7FF);
+}
+
+static inline bool vfp_host_single_is_zero(u32 v) { return (v & 0x7FFFFFFF) == 0; }
+static inline bool vfp_host_single_is_inf(u32 v) { return (v & 0x7FFFFFFF) == 0x7F800000; }
+static inline bool vfp_host_double_is_zero(u64 v) { return (v & 0x7FFFFFFFFFFFFFFFULL) == 0; }
+static inline bool vfp_host_double_is_inf(u64 v) { return (v & 0x7FFFFFFFFFFFFFFFULL) == 0x7FF0000000000000ULL; }
+
+/**
+ * Checks that a single result is a zero, an infinity, or a normal number large enough that the
+ * exact result can't have been tiny before rounding
+ */
+static inline bool vfp_host_single_result_ok(u32 v)
+{
+    u32 exponent = (v >> 23) & 0xFF;
+    return (exponent > 1 && exponent != 0xFF) || vfp_host_single_is_zero(v) || vfp_host_single_is_inf(v);
+}
+
+/// Double version of vfp_host_single_result_ok
+static inline bool vfp_host_double_result_ok(u64 v)
+{
+    u64 exponent = (v >> 52) & 0x7FF;
+    return (exponent > 1 && exponent != 0x7FF) || vfp_host_double_is_zero(v) || vfp_host_double_is_inf(v);
+}
+
+/**
+ * Checks that a double is far enough from the overflow and underflow thresholds for Dekker's
+ * product of two such numbers to be exact (|v| within 2^-250..2^250)
+ */
+static inline bool vfp_host_double_in_product_range(u64 v)
+{
+    u64 exponent = (v >> 52) & 0x7FF;
+    return exponent >= 1023 - 250 && exponent <= 1023 + 250;
+}
+
+/// Exceptions of a finite, nonzero result, depending on whether it is exact
+static inline u32 vfp_host_inexact(bool exact)
+{
+    return exact ? 0 : FPSCR_IXC;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Exactness tests
+
+/// Checks whether s = a + b (rounded) is the exact sum, with Knuth's TwoSum
+static inline bool vfp_host_single_sum_exact(float a, float b, float s)
+{
+    float b_virtual = vfp_host_subs(s, a);
+    float a_virtual = vfp_host_subs(s, b_virtual);
+    float error = vfp_host_adds(vfp_host_subs(a, a_virtual), vfp_host_subs(b, b_virtual));
+    return error == 0.0f;
+}
+
+/// Checks whether s = a + b (rounded) is the exact sum, with Knuth's TwoSum
+static inline bool vfp_host_double_sum_exact(double a, double b, double s)
+{
+    double b_virtual = vfp_host_subd(s, a);
+    double a_virtual = vfp_host_subd(s, b_virtual);
+    double error = vfp_host_addd(vfp_host_subd(a, a_virtual), vfp_host_subd(b, b_virtual));
+    return error == 0.0;
+}
+
+/// Splits a double into two halves of 26 significant bits, with Veltkamp's method
+static inline void vfp_host_split(double a, double* high, double* low)
+{
+    double c = vfp_host_muld(134217729.0, a); // 2^27 + 1
+    *high = vfp_host_subd(c, vfp_host_subd(c, a));
+    *low = vfp_host_subd(a, *high);
+}
+
+/**
+ * Checks whether p = a * b (rounded) is the exact product, with Dekker's TwoProduct. Both operands
+ * must pass vfp_host_double_in_product_range.
+ */
+static inline bool vfp_host_double_product_exact(double a, double b, double p)
+{
+    double a_high, a_low, b_high, b_low;
+    vfp_host_split(a, &a_high, &a_low);
+    vfp_host_split(b, &b_high, &b_low);
+
+    double error = vfp_host_subd(vfp_host_muld(a_high, b_high), p);
+    error = vfp_host_addd(error, vfp_host_muld(a_high, b_low));
+    error = vfp_host_addd(error, vfp_host_muld(a_low, b_high));
+    error = vfp_host_addd(error, vfp_host_muld(a_low, b_low));
+    return error == 0.0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Operations. Each one computes *result and the FPSCR cumulative exception flags it raises, or
+// returns false if it must be left to the soft float code.
+
+static inline bool vfp_host_single_add(u32 n, u32 m, u32* result, u32* exceptions)
+{
+    if (!vfp_host_single_ok(n) || !vfp_host_single_ok(m))
+        return false;
+
+    float a = vfp_host_single(n);
+    float b = vfp_host_single(m);
+    float s = vfp_host_adds(a, b);
+    u32 r = vfp_host_single_bits(s);
+    if (!vfp_host_single_result_ok(r))
+        return false;
+
+    if (vfp_host_single_is_inf(r))
+        *exceptions = (vfp_host_single_is_inf(n) || vfp_host_single_is_inf(m)) ? 0 : FPSCR_OFC | FPSCR_IXC;
+    else
+        *exceptions = vfp_host_inexact(vfp_host_single_sum_exact(a, b, s));
+    *result = r;
+    return true;
+}
+
+static inline bool vfp_host_single_mul(u32 n, u32 m, u32* result, u32* exceptions)
+{
+    if (!vfp_host_single_ok(n) || !vfp_host_single_ok(m))
+        return false;
+
+    float a = vfp_host_single(n);
+    float b = vfp_host_single(m);
+    float p = vfp_host_muls(a, b);
+    u32 r = vfp_host_single_bits(p);
+    if (!vfp_host_single_result_ok(r))
+        return false;
+
+    if (vfp_host_single_is_inf(r)) {
+        *exceptions = (vfp_host_single_is_inf(n) || vfp_host_single_is_inf(m)) ? 0 : FPSCR_OFC | FPSCR_IXC;
+    } else if (vfp_host_single_is_zero(r)) {
+        // A zero product of nonzero operands underflowed
+        if (!vfp_host_single_is_zero(n) && !vfp_host_single_is_zero(m))
+            return false;
+        *exceptions = 0;
+    } else {
+        // The product of two singles is exact in double precision
+        double exact = vfp_host_muld(vfp_host_widen(a), vfp_host_widen(b));
+        *exceptions = vfp_host_inexact(vfp_host_widen(p) == exact);
+    }
+    *result = r;
+    return true;
+}
+
+static inline bool vfp_host_single_div(u32 n, u32 m, u32* result, u32* exceptions)
+{
+    if (!vfp_host_single_ok(n) || !vfp_host_single_ok(m))
+        return false;
+
+    float a = vfp_host_single(n);
+    float b = vfp_host_single(m);
+    float q = vfp_host_divs(a, b);
+    u32 r = vfp_host_single_bits(q);
+    if (!vfp_host_single_result_ok(r))
+        return false;
+
+    if (vfp_host_single_is_inf(r)) {
+        if (vfp_host_single_is_inf(n))
+            *exceptions = 0;
+        else if (vfp_host_single_is_zero(m))
+            *exceptions = FPSCR_DZC;
+        else
+            *exceptions = FPSCR_OFC | FPSCR_IXC;
+    } else if (vfp_host_single_is_zero(r)) {
+        if (!vfp_host_single_is_zero(n) && !vfp_host_single_is_inf(m))
+            return false;
+        *exceptions = 0;
+    } else {
+        // q is exact if q * b == a, and q * b is exact in double precision
+        *exceptions = vfp_host_inexact(vfp_host_muld(vfp_host_widen(q), vfp_host_widen(b)) == vfp_host_widen(a));
+    }
+    *result = r;
+    return true;
+}
+
+static inline bool vfp_host_single_sqrt(u32 m, u32* result, u32* exceptions)
+{
+    if (!vfp_host_single_ok(m))
+        return false;
+
+    float a = vfp_host_single(m);
+    float s = vfp_host_sqrts(a);
+    u32 r = vfp_host_single_bits(s);
+    if (!vfp_host_single_result_ok(r))
+        return false;
+
+    if (vfp_host_single_is_inf(r) || vfp_host_single_is_zero(r))
+        *exceptions = 0;
+    else
+        *exceptions = vfp_host_inexact(vfp_host_muld(vfp_host_widen(s), vfp_host_widen(s)) == vfp_host_widen(a));
+    *result = r;
+    return true;
+}
+
+/// Rounds a double, which must be neither a NaN nor a denormal, to a single
+static inline bool vfp_host_double_to_single(u64 m, u32* result, u32* exceptions)
+{
+    double a = vfp_host_double(m);
+    float s = vfp_host_narrow(a);
+    u32 r = vfp_host_single_bits(s);
+    if (!vfp_host_single_result_ok(r))
+        return false;
+
+    if (vfp_host_single_is_inf(r)) {
+        *exceptions = vfp_host_double_is_inf(m) ? 0 : FPSCR_OFC | FPSCR_IXC;
+    } else if (vfp_host_single_is_zero(r)) {
+        if (!vfp_host_double_is_zero(m))
+            return false;
+        *exceptions = 0;
+    } else {
+        *exceptions = vfp_host_inexact(vfp_host_widen(s) == a);
+    }
+    *result = r;
+    return true;
+}
+
+static inline bool vfp_host_double_add(u64 n, u64 m, u64* result, u32* exceptions)
+{
+    if (!vfp_host_double_ok(n) || !vfp_host_double_ok(m))
+        return false;
+
+    double a = vfp_host_double(n);
+    double b = vfp_host_double(m);
+    double s = vfp_host_addd(a, b);
+    u64 r = vfp_host_double_bits(s);
+    if (!vfp_host_double_result_ok(r))
+        return false;
+
+    if (vfp_host_double_is_inf(r))
+        *exceptions = (vfp_host_double_is_inf(n) || vfp_host_double_is_inf(m)) ? 0 : FPSCR_OFC | FPSCR_IXC;
+    else
+        *exceptions = vfp_host_inexact(vfp_host_double_sum_exact(a, b, s));
+    *result = r;
+    return true;
+}
+
+static inline bool vfp_host_double_mul(u64 n, u64 m, u64* result, u32* exceptions)
+{
+    if (!vfp_host_double_ok(n) || !vfp_host_double_ok(m))
+        return false;
+
+    double a = vfp_host_double(n);
+    double b = vfp_host_double(m);
+    double p = vfp_host_muld(a, b);
+    u64 r = vfp_host_double_bits(p);
+    if (!vfp_host_double_result_ok(r))
+        return false;
+
+    if (vfp_host_double_is_inf(r)) {
+        *exceptions = (vfp_host_double_is_inf(n) || vfp_host_double_is_inf(m)) ? 0 : FPSCR_OFC | FPSCR_IXC;
+    } else if (vfp_host_double_is_zero(r)) {
+        if (!vfp_host_double_is_zero(n) && !vfp_host_double_is_zero(m))
+            return false;
+        *exceptions = 0;
+    } else {
+        if (!vfp_host_double_in_product_range(n) || !vfp_host_double_in_product_range(m))
+            return false;
+        *exceptions = vfp_host_inexact(vfp_host_double_product_exact(a, b, p));
+    }
+    *result = r;
+    return true;
+}
+
+static inline bool vfp_host_double_div(u64 n, u64 m, u64* result, u32* exceptions)
+{
+    if (!vfp_host_double_ok(n) || !vfp_host_double_ok(m))
+        return false;
+
+    double a = vfp_host_double(n);
+    double b = vfp_host_double(m);
+    double q = vfp_host_divd(a, b);
+    u64 r = vfp_host_double_bits(q);
+    if (!vfp_host_double_result_ok(r))
+        return false;
+
+    if (vfp_host_double_is_inf(r)) {
+        if (vfp_host_double_is_inf(n))
+            *exceptions = 0;
+        else if (vfp_host_double_is_zero(m))
+            *exceptions = FPSCR_DZC;
+        else
+            *exceptions = FPSCR_OFC | FPSCR_IXC;
+    } else if (vfp_host_double_is_zero(r)) {
+        if (!vfp_host_double_is_zero(n) && !vfp_host_double_is_inf(m))
+            return false;
+        *exceptions = 0;
+    } else {
+        // q is exact if q * b == a exactly
+        if (!vfp_host_double_in_product_range(r) || !vfp_host_double_in_product_range(m))
+            return false;
+        *exceptions = vfp_host_inexact(vfp_host_muld(q, b) == a && vfp_host_double_product_exact(q, b, a));
+    }
+    *result = r;
+    return true;
+}
+
+static inline bool vfp_host_double_sqrt(u64 m, u64* result, u32* exceptions)
+{
+    if (!vfp_host_double_ok(m))
+        return false;
+
+    double a = vfp_host_double(m);
+    double s = vfp_host_sqrtd(a);
+    u64 r = vfp_host_double_bits(s);
+    if (!vfp_host_double_result_ok(r))
+        return false;
+
+    if (vfp_host_double_is_inf(r) || vfp_host_double_is_zero(r)) {
+        *exceptions = 0;
+    } else {
+        if (!vfp_host_double_in_product_range(r))
+            return false;
+        *exceptions = vfp_host_inexact(vfp_host_muld(s, s) == a && vfp_host_double_product_exact(s, s, a));
+    }
+    *result = r;
+    return true;
+}
+
+/**
+ * Converts a value to an integer
+ * @param value Value to convert, a single or double widened to a double
+ * @param is_signed Converts to a signed integer if set, to an unsigned one otherwise
+ * @param truncate Rounds towards zero if set, to nearest otherwise
+ */
+static inline bool vfp_host_to_int(double value, bool is_signed, bool truncate, u32* result, u32* exceptions)
+{
+    // Only zero and magnitudes within 1..2^30 are converted: the soft code handles out of range
+    // values, which saturate and raise invalid operation, and doesn't round values below 1 to
+    // nearest nor shift values from 2^30 up the same way, which both paths must agree on.
+    double magnitude = (is_signed && value < 0.0) ? -value : value;
+    if (value != 0.0 && !(magnitude >= 1.0 && magnitude < 1073741824.0))
+        return false;
+
+    // The truncation doesn't depend on the MXCSR rounding mode, and the fraction is exact
+    s32 integer = _mm_cvttsd_si32(_mm_set_sd(value));
+    double fraction = vfp_host_subd(value, (double)integer);
+    if (!truncate) {
+        if (fraction > 0.5 || (fraction == 0.5 && (integer & 1)))
+            ++integer;
+        else if (fraction < -0.5 || (fraction == -0.5 && (integer & 1)))
+            --integer;
+    }
+    *result = (u32)integer;
+    *exceptions = vfp_host_inexact(fraction == 0.0);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Packed versions of the single precision operations, for short vectors. They handle four
+// elements at once, and return false if any of them must be left to the soft float code.
+
+/// Absolute values of four singles
+static inline __m128i vfp_host_single4_abs(__m128i v)
+{
+    return _mm_and_si128(v, _mm_set1_epi32(0x7FFFFFFF));
+}
+
+/// Checks that none of four singles is a NaN or a denormal
+static inline bool vfp_host_single4_ok(__m128i v)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i exponent = _mm_and_si128(v, _mm_set1_epi32(0x7F800000));
+    __m128i mantissa = _mm_and_si128(v, _mm_set1_epi32(0x007FFFFF));
+    __m128i special = _mm_or_si128(_mm_cmpeq_epi32(exponent, zero),
+                                   _mm_cmpeq_epi32(exponent, _mm_set1_epi32(0x7F800000)));
+    return _mm_movemask_epi8(_mm_andnot_si128(_mm_cmpeq_epi32(mantissa, zero), special)) == 0;
+}
+
+/// Packed version of vfp_host_single_result_ok
+static inline bool vfp_host_single4_result_ok(__m128i v)
+{
+    __m128i magnitude = vfp_host_single4_abs(v);
+    __m128i tiny = _mm_andnot_si128(_mm_cmpeq_epi32(magnitude, _mm_setzero_si128()),
+                                    _mm_cmplt_epi32(magnitude, _mm_set1_epi32(0x01000000)));
+    __m128i nan = _mm_cmpgt_epi32(magnitude, _mm_set1_epi32(0x7F800000));
+    return _mm_movemask_epi8(_mm_or_si128(tiny, nan)) == 0;
+}
+
+/// Lanes of four singles which are infinities
+static inline __m128i vfp_host_single4_is_inf(__m128i v)
+{
+    return _mm_cmpeq_epi32(vfp_host_single4_abs(v), _mm_set1_epi32(0x7F800000));
+}
+
+/// Overflow exceptions of four operations, given their operands and results
+static inline u32 vfp_host_single4_overflow(__m128i n, __m128i m, __m128i r)
+{
+    __m128i operand_inf = _mm_or_si128(vfp_host_single4_is_inf(n), vfp_host_single4_is_inf(m));
+    __m128i overflow = _mm_andnot_si128(operand_inf, vfp_host_single4_is_inf(r));
+    return _mm_movemask_epi8(overflow) ? FPSCR_OFC | FPSCR_IXC : 0;
+}
+
+static inline bool vfp_host_single4_add(__m128i n, __m128i m, __m128i* result, u32* exceptions)
+{
+    if (!vfp_host_single4_ok(n) || !vfp_host_single4_ok(m))
+        return false;
+
+    __m128 a = _mm_castsi128_ps(n);
+    __m128 b = _mm_castsi128_ps(m);
+    __m128 s = _mm_add_ps(a, b);
+    __m128i r = _mm_castps_si128(s);
+    if (!vfp_host_single4_result_ok(r))
+        return false;
+
+    // TwoSum, ignoring infinite results whose error terms are NaNs
+    __m128 b_virtual = _mm_sub_ps(s, a);
+    __m128 a_virtual = _mm_sub_ps(s, b_virtual);
+    __m128 error = _mm_add_ps(_mm_sub_ps(a, a_virtual), _mm_sub_ps(b, b_virtual));
+    __m128 inexact = _mm_andnot_ps(_mm_castsi128_ps(vfp_host_single4_is_inf(r)),
+                                   _mm_cmpneq_ps(error, _mm_setzero_ps()));
+
+    *exceptions = vfp_host_single4_overflow(n, m, r) | (_mm_movemask_ps(inexact) ? FPSCR_IXC : 0);
+    *result = r;
+    return true;
+}
+
+static inline bool vfp_host_single4_mul(__m128i n, __m128i m, __m128i* result, u32* exceptions)
+{
+    if (!vfp_host_single4_ok(n) || !vfp_host_single4_ok(m))
+        return false;
+
+    __m128 a = _mm_castsi128_ps(n);
+    __m128 b = _mm_castsi128_ps(m);
+    __m128 p = _mm_mul_ps(a, b);
+    __m128i r = _mm_castps_si128(p);
+    if (!vfp_host_single4_result_ok(r))
+        return false;
+
+    // A zero product of nonzero operands underflowed
+    __m128i zero = _mm_setzero_si128();
+    __m128i operand_zero = _mm_or_si128(_mm_cmpeq_epi32(vfp_host_single4_abs(n), zero),
+                                        _mm_cmpeq_epi32(vfp_host_single4_abs(m), zero));
+    if (_mm_movemask_epi8(_mm_andnot_si128(operand_zero, _mm_cmpeq_epi32(vfp_host_single4_abs(r), zero))))
+        return false;
+
+    // The products are exact in double precision (infinite ones included, overflowed ones
+    // differ, and are inexact anyway)
+    __m128d low = _mm_cmpneq_pd(_mm_mul_pd(_mm_cvtps_pd(a), _mm_cvtps_pd(b)), _mm_cvtps_pd(p));
+    __m128d high = _mm_cmpneq_pd(_mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(a, a)), _mm_cvtps_pd(_mm_movehl_ps(b, b))),
+                                 _mm_cvtps_pd(_mm_movehl_ps(p, p)));
+    bool inexact = (_mm_movemask_pd(low) | _mm_movemask_pd(high)) != 0;
+
+    *exceptions = vfp_host_single4_overflow(n, m, r) | (inexact ? FPSCR_IXC : 0);
+    *result = r;
+    return true;
+}
+
+#endif // VFP_HOST_FPU
@@ -54,6 +54,7 @@
 #include "core/arm/skyeye_common/vfp/vfp.h"
 #include "core/arm/skyeye_common/vfp/vfp_helper.h"
 #include "core/arm/skyeye_common/vfp/asm_vfp.h"
+#include "core/arm/skyeye_common/vfp/vfp_host.h"
 
 static struct vfp_double vfp_double_default_qnan = {
     2047,
@@ -1078,13 +1079,25 @@ vfp_double_multiply_accumulate(ARMul_State* state, int dd, int dn, int dm, u32 f
         vfp_double_normalise_denormal(&vdm);
 
     exceptions = vfp_double_multiply(&vdp, &vdn, &vdm, fpscr);
-    if (negate & NEG_MULTIPLY)
-        vdp.sign = vfp_sign_negate(vdp.sign);
 
     vfp_double_unpack(&vdn, vfp_get_double(state, dd));
+    if (vdn.exponent == 0 && vdn.significand)
+        vfp_double_normalise_denormal(&vdn);
     if (negate & NEG_SUBTRACT)
         vdn.sign = vfp_sign_negate(vdn.sign);
 
+    /*
+     * VMLA and friends aren't fused: the product is rounded as VMUL
+     * would, then added.  It goes through dd, which the sum overwrites,
+     * now that the accumulator has been read.
+     */
+    exceptions = vfp_double_normaliseround(state, dd, &vdp, fpscr, exceptions, func);
+    vfp_double_unpack(&vdp, vfp_get_double(state, dd));
+    if (vdp.exponent == 0 && vdp.significand)
+        vfp_double_normalise_denormal(&vdp);
+    if (negate & NEG_MULTIPLY)
+        vdp.sign = vfp_sign_negate(vdp.sign);
+
     exceptions |= vfp_double_add(&vdd, &vdn, &vdp, fpscr);
 
     return vfp_double_normaliseround(state, dd, &vdd, fpscr, exceptions, func);
@@ -1344,9 +1357,283 @@ static struct op fops[] = {
     { vfp_double_fdiv,  0 },
 };
 
+#ifdef VFP_HOST_FPU
+
+/*
+ * Host FPU versions of the operations above, see vfp_host.h. They return false, without
+ * touching the destination, when the operation must be left to the soft float code.
+ */
+typedef bool (*vfp_double_host_fn)(ARMul_State* state, int dd, int dn, int dm, u32* exceptions);
+
+/*
+ * dd = (negate_d ? -dd : dd) + (negate_p ? -(dn * dm) : dn * dm), with the product rounded
+ * before the addition, as VMLA and friends do (they aren't fused).
+ */
+static inline bool vfp_double_host_multiply_accumulate(ARMul_State* state, int dd, int dn, int dm, u32* exceptions, u32 negate)
+{
+    u64 n = vfp_get_double(state, dn);
+    u64 d = vfp_get_double(state, dd);
+
+    if (negate & NEG_MULTIPLY)
+        n ^= 0x8000000000000000ULL;
+    if (negate & NEG_SUBTRACT)
+        d ^= 0x8000000000000000ULL;
+
+    u64 product, result;
+    u32 product_exceptions;
+    if (!vfp_host_double_mul(n, vfp_get_double(state, dm), &product, &product_exceptions) ||
+        !vfp_host_double_add(d, product, &result, exceptions))
+        return false;
+
+    vfp_put_double(state, result, dd);
+    *exceptions |= product_exceptions;
+    return true;
+}
+
+static bool vfp_double_host_fmac(ARMul_State* state, int dd, int dn, int dm, u32* exceptions)
+{
+    return vfp_double_host_multiply_accumulate(state, dd, dn, dm, exceptions, 0);
+}
+
+static bool vfp_double_host_fnmac(ARMul_State* state, int dd, int dn, int dm, u32* exceptions)
+{
+    return vfp_double_host_multiply_accumulate(state, dd, dn, dm, exceptions, NEG_MULTIPLY);
+}
+
+static bool vfp_double_host_fmsc(ARMul_State* state, int dd, int dn, int dm, u32* exceptions)
+{
+    return vfp_double_host_multiply_accumulate(state, dd, dn, dm, exceptions, NEG_SUBTRACT);
+}
+
+static bool vfp_double_host_fnmsc(ARMul_State* state, int dd, int dn, int dm, u32* exceptions)
+{
+    return vfp_double_host_multiply_accumulate(state, dd, dn, dm, exceptions, NEG_SUBTRACT | NEG_MULTIPLY);
+}
+
+static bool vfp_double_host_fmul(ARMul_State* state, int dd, int dn, int dm, u32* exceptions)
+{
+    u64 result;
+    if (!vfp_host_double_mul(vfp_get_double(state, dn), vfp_get_double(state, dm), &result, exceptions))
+        return false;
+
+    vfp_put_double(state, result, dd);
+    return true;
+}
+
+static bool vfp_double_host_fnmul(ARMul_State* state, int dd, int dn, int dm, u32* exceptions)
+{
+    // Negating an operand rather than the result is the same in round-to-nearest
+    u64 result;
+    if (!vfp_host_double_mul(vfp_get_double(state, dn) ^ 0x8000000000000000ULL, vfp_get_double(state, dm), &result, exceptions))
+        return false;
+
+    vfp_put_double(state, result, dd);
+    return true;
+}
+
+static bool vfp_double_host_fadd(ARMul_State* state, int dd, int dn, int dm, u32* exceptions)
+{
+    u64 result;
+    if (!vfp_host_double_add(vfp_get_double(state, dn), vfp_get_double(state, dm), &result, exceptions))
+        return false;
+
+    vfp_put_double(state, result, dd);
+    return true;
+}
+
+static bool vfp_double_host_fsub(ARMul_State* state, int dd, int dn, int dm, u32* exceptions)
+{
+    u64 result;
+    if (!vfp_host_double_add(vfp_get_double(state, dn), vfp_get_double(state, dm) ^ 0x8000000000000000ULL, &result, exceptions))
+        return false;
+
+    vfp_put_double(state, result, dd);
+    return true;
+}
+
+static bool vfp_double_host_fdiv(ARMul_State* state, int dd, int dn, int dm, u32* exceptions)
+{
+    u64 result;
+    if (!vfp_host_double_div(vfp_get_double(state, dn), vfp_get_double(state, dm), &result, exceptions))
+        return false;
+
+    vfp_put_double(state, result, dd);
+    return true;
+}
+
+static bool vfp_double_host_fsqrt(ARMul_State* state, int dd, int unused, int dm, u32* exceptions)
+{
+    u64 result;
+    if (!vfp_host_double_sqrt(vfp_get_double(state, dm), &result, exceptions))
+        return false;
+
+    vfp_put_double(state, result, dd);
+    return true;
+}
+
+static bool vfp_double_host_fcvts(ARMul_State* state, int sd, int unused, int dm, u32* exceptions)
+{
+    u64 m = vfp_get_double(state, dm);
+    u32 result;
+    if (!vfp_host_double_ok(m) || !vfp_host_double_to_single(m, &result, exceptions))
+        return false;
+
+    vfp_put_float(state, result, sd);
+    return true;
+}
+
+static bool vfp_double_host_fuito(ARMul_State* state, int dd, int unused, int dm, u32* exceptions)
+{
+    // Every 32-bit integer is exact in a double
+    vfp_put_double(state, vfp_host_double_bits((double)(u32)vfp_get_float(state, dm)), dd);
+    *exceptions = 0;
+    return true;
+}
+
+static bool vfp_double_host_fsito(ARMul_State* state, int dd, int unused, int dm, u32* exceptions)
+{
+    vfp_put_double(state, vfp_host_double_bits((double)(s32)vfp_get_float(state, dm)), dd);
+    *exceptions = 0;
+    return true;
+}
+
+/*
+ * sd = (u32)dm or (s32)dm, rounded towards zero if truncate is set, to nearest otherwise
+ */
+static inline bool vfp_double_host_to_int(ARMul_State* state, int sd, int dm, u32* exceptions, bool is_signed, bool truncate)
+{
+    u64 m = vfp_get_double(state, dm);
+    if (!vfp_host_double_ok(m))
+        return false;
+
+    double value = vfp_host_double(m);
+    u32 result;
+    if (!vfp_host_to_int(value, is_signed, truncate, &result, exceptions))
+        return false;
+
+    vfp_put_float(state, result, sd);
+    return true;
+}
+
+static bool vfp_double_host_ftoui(ARMul_State* state, int sd, int unused, int dm, u32* exceptions)
+{
+    return vfp_double_host_to_int(state, sd, dm, exceptions, false, false);
+}
+
+static bool vfp_double_host_ftouiz(ARMul_State* state, int sd, int unused, int dm, u32* exceptions)
+{
+    return vfp_double_host_to_int(state, sd, dm, exceptions, false, true);
+}
+
+static bool vfp_double_host_ftosi(ARMul_State* state, int sd, int unused, int dm, u32* exceptions)
+{
+    return vfp_double_host_to_int(state, sd, dm, exceptions, true, false);
+}
+
+static bool vfp_double_host_ftosiz(ARMul_State* state, int sd, int unused, int dm, u32* exceptions)
+{
+    return vfp_double_host_to_int(state, sd, dm, exceptions, true, true);
+}
+
+/// Host versions of the operations of fops, in the same order
+static const vfp_double_host_fn host_fops[] = {
+    vfp_double_host_fmac,
+    vfp_double_host_fmsc,
+    vfp_double_host_fmul,
+    vfp_double_host_fadd,
+    vfp_double_host_fnmac,
+    vfp_double_host_fnmsc,
+    vfp_double_host_fnmul,
+    vfp_double_host_fsub,
+    vfp_double_host_fdiv,
+};
+
+/// Host versions of the operations of fops_ext, in the same order
+static const vfp_double_host_fn host_fops_ext[] = {
+    NULL,                       //0x00000000 - FEXT_FCPY
+    NULL,                       //0x00000001 - FEXT_FABS
+    NULL,                       //0x00000002 - FEXT_FNEG
+    vfp_double_host_fsqrt,      //0x00000003 - FEXT_FSQRT
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,                       //0x00000008 - FEXT_FCMP
+    NULL,                       //0x00000009 - FEXT_FCMPE
+    NULL,                       //0x0000000A - FEXT_FCMPZ
+    NULL,                       //0x0000000B - FEXT_FCMPEZ
+    NULL,
+    NULL,
+    NULL,
+    vfp_double_host_fcvts,      //0x0000000F - FEXT_FCVT
+    vfp_double_host_fuito,      //0x00000010 - FEXT_FUITO
+    vfp_double_host_fsito,      //0x00000011 - FEXT_FSITO
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    vfp_double_host_ftoui,      //0x00000018 - FEXT_FTOUI
+    vfp_double_host_ftouiz,     //0x00000019 - FEXT_FTOUIZ
+    vfp_double_host_ftosi,      //0x0000001A - FEXT_FTOSI
+    vfp_double_host_ftosiz,     //0x0000001B - FEXT_FTOSIZ
+};
+
+#endif // VFP_HOST_FPU
+
 #define FREG_BANK(x)	((x) & 0x0c)
 #define FREG_IDX(x)	((x) & 3)
 
+/*
+ * Index within its bank of the register used by each element of a short vector, for each stride
+ * and index of the first register. Looked up once per operation rather than wrapping around the
+ * bank for every element.
+ */
+static const u8 vector_sequence[2][4][8] = {
+    {   // Stride 1
+        { 0, 1, 2, 3, 0, 1, 2, 3 },
+        { 1, 2, 3, 0, 1, 2, 3, 0 },
+        { 2, 3, 0, 1, 2, 3, 0, 1 },
+        { 3, 0, 1, 2, 3, 0, 1, 2 },
+    },
+    {   // Stride 2
+        { 0, 2, 0, 2, 0, 2, 0, 2 },
+        { 1, 3, 1, 3, 1, 3, 1, 3 },
+        { 2, 0, 2, 0, 2, 0, 2, 0 },
+        { 3, 1, 3, 1, 3, 1, 3, 1 },
+    },
+};
+
+/// Registers used by each element of a short vector operation
+struct vfp_double_vector {
+    unsigned int length;
+    u8 dd[8];
+    u8 dn[8];
+    u8 dm[8];
+};
+
+static void vfp_double_vector_init(struct vfp_double_vector* vec, unsigned int length, unsigned int stride,
+                                   unsigned int dd, unsigned int dn, unsigned int dm)
+{
+    const u8* d_sequence = vector_sequence[stride - 1][FREG_IDX(dd)];
+    const u8* n_sequence = vector_sequence[stride - 1][FREG_IDX(dn)];
+    const u8* m_sequence = vector_sequence[stride - 1][FREG_IDX(dm)];
+
+    // The first element uses the registers of the instruction, which for some scalar operations
+    // aren't of the precision the banks are computed for
+    vec->length = length;
+    vec->dd[0] = dd;
+    vec->dn[0] = dn;
+    vec->dm[0] = dm;
+    for (unsigned int i = 1; i < length; i++) {
+        vec->dd[i] = FREG_BANK(dd) + d_sequence[i];
+        vec->dn[i] = FREG_BANK(dn) + n_sequence[i];
+        // dm is a scalar used by every element if it is in the first bank
+        vec->dm[i] = FREG_BANK(dm) != 0 ? FREG_BANK(dm) + m_sequence[i] : dm;
+    }
+}
+
 u32 vfp_double_cpdo(ARMul_State* state, u32 inst, u32 fpscr)
 {
     u32 op = inst & FOP_MASK;
@@ -1355,6 +1642,7 @@ u32 vfp_double_cpdo(ARMul_State* state, u32 inst, u32 fpscr)
     unsigned int dn = vfp_get_dn(inst);
     unsigned int dm;
     unsigned int vecitr, veclen, vecstride;
+    struct vfp_double_vector vec;
     struct op *fop;
 
     pr_debug("In %s\n", __FUNCTION__);
@@ -1362,6 +1650,16 @@ u32 vfp_double_cpdo(ARMul_State* state, u32 inst, u32 fpscr)
 
     fop = (op == FOP_EXT) ? &fops_ext[FEXT_TO_IDX(inst)] : &fops[FOP_TO_IDX(op)];
 
+#ifdef VFP_HOST_FPU
+    vfp_double_host_fn host_fn = NULL;
+    if (vfp_host_fpscr_ok(fpscr)) {
+        if (op != FOP_EXT)
+            host_fn = host_fops[FOP_TO_IDX(op)];
+        else if (FEXT_TO_IDX(inst) < ARRAY_SIZE(host_fops_ext))
+            host_fn = host_fops_ext[FEXT_TO_IDX(inst)];
+    }
+#endif
+
     /*
      * fcvtds takes an sN register number as destination, not dN.
      * It also always operates on scalars.
@@ -1396,23 +1694,28 @@ u32 vfp_double_cpdo(ARMul_State* state, u32 inst, u32 fpscr)
         goto invalid;
     }
 
-    for (vecitr = 0; vecitr <= veclen; vecitr += 1 << FPSCR_LENGTH_BIT) {
+    vfp_double_vector_init(&vec, (veclen >> FPSCR_LENGTH_BIT) + 1, vecstride, dest, dn, dm);
+
+    for (vecitr = 0; vecitr < vec.length; vecitr++) {
         u32 except;
         char type;
 
         type = fop->flags & OP_SD ? 's' : 'd';
         if (op == FOP_EXT)
             pr_debug("VFP: itr%d (%c%u) = op[%u] (d%u)\n",
-                     vecitr >> FPSCR_LENGTH_BIT,
-                     type, dest, dn, dm);
+                     vecitr,
+                     type, vec.dd[vecitr], vec.dn[vecitr], vec.dm[vecitr]);
         else
             pr_debug("VFP: itr%d (%c%u) = (d%u) op[%u] (d%u)\n",
-                     vecitr >> FPSCR_LENGTH_BIT,
-                     type, dest, dn, FOP_TO_IDX(op), dm);
+                     vecitr,
+                     type, vec.dd[vecitr], vec.dn[vecitr], FOP_TO_IDX(op), vec.dm[vecitr]);
 
-        except = fop->fn(state, dest, dn, dm, fpscr);
+#ifdef VFP_HOST_FPU
+        if (host_fn == NULL || !host_fn(state, vec.dd[vecitr], vec.dn[vecitr], vec.dm[vecitr], &except))
+#endif
+            except = fop->fn(state, vec.dd[vecitr], vec.dn[vecitr], vec.dm[vecitr], fpscr);
         pr_debug("VFP: itr%d: exceptions=%08x\n",
-                 vecitr >> FPSCR_LENGTH_BIT, except);
+                 vecitr, except);
 
         exceptions |= except;
 
@@ -1420,10 +1723,6 @@ u32 vfp_double_cpdo(ARMul_State* state, u32 inst, u32 fpscr)
          * CHECK: It appears to be undefined whether we stop when
          * we encounter an exception.  We continue.
          */
-        dest = FREG_BANK(dest) + ((FREG_IDX(dest) + vecstride) & 3);
-        dn = FREG_BANK(dn) + ((FREG_IDX(dn) + vecstride) & 3);
-        if (FREG_BANK(dm) != 0)
-            dm = FREG_BANK(dm) + ((FREG_IDX(dm) + vecstride) & 3);
     }
     return exceptions;
 
@@ -54,6 +54,7 @@
 #include "core/arm/skyeye_common/vfp/vfp_helper.h"
 #include "core/arm/skyeye_common/vfp/asm_vfp.h"
 #include "core/arm/skyeye_common/vfp/vfp.h"
+#include "core/arm/skyeye_common/vfp/vfp_host.h"
 
 static struct vfp_single vfp_single_default_qnan = {
     255,
@@ -979,15 +980,26 @@ vfp_single_multiply_accumulate(ARMul_State* state, int sd, int sn, s32 m, u32 fp
 
         exceptions = vfp_single_multiply(&vsp, &vsn, &vsm, fpscr);
 
-        if (negate & NEG_MULTIPLY)
-            vsp.sign = vfp_sign_negate(vsp.sign);
-
         v = vfp_get_float(state, sd);
         pr_debug("VFP: s%u = %08x\n", sd, v);
         vfp_single_unpack(&vsn, v);
+        if (vsn.exponent == 0 && vsn.significand)
+            vfp_single_normalise_denormal(&vsn);
         if (negate & NEG_SUBTRACT)
             vsn.sign = vfp_sign_negate(vsn.sign);
 
+        /*
+         * VMLA and friends aren't fused: the product is rounded as
+         * VMUL would, then added.  It goes through sd, which the sum
+         * overwrites, now that the accumulator has been read.
+         */
+        exceptions = vfp_single_normaliseround(state, sd, &vsp, fpscr, exceptions, func);
+        vfp_single_unpack(&vsp, vfp_get_float(state, sd));
+        if (vsp.exponent == 0 && vsp.significand)
+            vfp_single_normalise_denormal(&vsp);
+        if (negate & NEG_MULTIPLY)
+            vsp.sign = vfp_sign_negate(vsp.sign);
+
         exceptions |= vfp_single_add(&vsd, &vsn, &vsp, fpscr);
 
         return vfp_single_normaliseround(state, sd, &vsd, fpscr, exceptions, func);
@@ -1274,9 +1286,394 @@ static struct op fops[] = {
 	{ vfp_single_fdiv,  0 },
 };
 
+#ifdef VFP_HOST_FPU
+
+/*
+ * Host FPU versions of the operations above, see vfp_host.h. They return false, without
+ * touching the destination, when the operation must be left to the soft float code.
+ */
+typedef bool (*vfp_single_host_fn)(ARMul_State* state, int sd, int sn, s32 m, u32* exceptions);
+
+/*
+ * sd = (negate_d ? -sd : sd) + (negate_p ? -(sn * sm) : sn * sm), with the product rounded
+ * before the addition, as VMLA and friends do (they aren't fused).
+ */
+static inline bool vfp_single_host_multiply_accumulate(ARMul_State* state, int sd, int sn, s32 m, u32* exceptions, u32 negate)
+{
+    u32 n = vfp_get_float(state, sn);
+    u32 d = vfp_get_float(state, sd);
+
+    if (negate & NEG_MULTIPLY)
+        n ^= 0x80000000;
+    if (negate & NEG_SUBTRACT)
+        d ^= 0x80000000;
+
+    u32 product, product_exceptions, result;
+    if (!vfp_host_single_mul(n, m, &product, &product_exceptions) ||
+        !vfp_host_single_add(d, product, &result, exceptions))
+        return false;
+
+    vfp_put_float(state, result, sd);
+    *exceptions |= product_exceptions;
+    return true;
+}
+
+static bool vfp_single_host_fmac(ARMul_State* state, int sd, int sn, s32 m, u32* exceptions)
+{
+    return vfp_single_host_multiply_accumulate(state, sd, sn, m, exceptions, 0);
+}
+
+static bool vfp_single_host_fnmac(ARMul_State* state, int sd, int sn, s32 m, u32* exceptions)
+{
+    return vfp_single_host_multiply_accumulate(state, sd, sn, m, exceptions, NEG_MULTIPLY);
+}
+
+static bool vfp_single_host_fmsc(ARMul_State* state, int sd, int sn, s32 m, u32* exceptions)
+{
+    return vfp_single_host_multiply_accumulate(state, sd, sn, m, exceptions, NEG_SUBTRACT);
+}
+
+static bool vfp_single_host_fnmsc(ARMul_State* state, int sd, int sn, s32 m, u32* exceptions)
+{
+    return vfp_single_host_multiply_accumulate(state, sd, sn, m, exceptions, NEG_SUBTRACT | NEG_MULTIPLY);
+}
+
+static bool vfp_single_host_fmul(ARMul_State* state, int sd, int sn, s32 m, u32* exceptions)
+{
+    u32 result;
+    if (!vfp_host_single_mul(vfp_get_float(state, sn), m, &result, exceptions))
+        return false;
+
+    vfp_put_float(state, result, sd);
+    return true;
+}
+
+static bool vfp_single_host_fnmul(ARMul_State* state, int sd, int sn, s32 m, u32* exceptions)
+{
+    // Negating an operand rather than the result is the same in round-to-nearest
+    u32 result;
+    if (!vfp_host_single_mul(vfp_get_float(state, sn) ^ 0x80000000, m, &result, exceptions))
+        return false;
+
+    vfp_put_float(state, result, sd);
+    return true;
+}
+
+static bool vfp_single_host_fadd(ARMul_State* state, int sd, int sn, s32 m, u32* exceptions)
+{
+    u32 result;
+    if (!vfp_host_single_add(vfp_get_float(state, sn), m, &result, exceptions))
+        return false;
+
+    vfp_put_float(state, result, sd);
+    return true;
+}
+
+static bool vfp_single_host_fsub(ARMul_State* state, int sd, int sn, s32 m, u32* exceptions)
+{
+    u32 result;
+    if (!vfp_host_single_add(vfp_get_float(state, sn), m ^ 0x80000000, &result, exceptions))
+        return false;
+
+    vfp_put_float(state, result, sd);
+    return true;
+}
+
+static bool vfp_single_host_fdiv(ARMul_State* state, int sd, int sn, s32 m, u32* exceptions)
+{
+    u32 result;
+    if (!vfp_host_single_div(vfp_get_float(state, sn), m, &result, exceptions))
+        return false;
+
+    vfp_put_float(state, result, sd);
+    return true;
+}
+
+static bool vfp_single_host_fsqrt(ARMul_State* state, int sd, int unused, s32 m, u32* exceptions)
+{
+    u32 result;
+    if (!vfp_host_single_sqrt(m, &result, exceptions))
+        return false;
+
+    vfp_put_float(state, result, sd);
+    return true;
+}
+
+static bool vfp_single_host_fcvtd(ARMul_State* state, int dd, int unused, s32 m, u32* exceptions)
+{
+    if (!vfp_host_single_ok(m))
+        return false;
+
+    // Widening is always exact
+    vfp_put_double(state, vfp_host_double_bits(vfp_host_widen(vfp_host_single(m))), dd);
+    *exceptions = 0;
+    return true;
+}
+
+static bool vfp_single_host_fuito(ARMul_State* state, int sd, int unused, s32 m, u32* exceptions)
+{
+    // Every 32-bit integer is exact in a double, leaving a single rounding
+    u32 result;
+    if (!vfp_host_double_to_single(vfp_host_double_bits((double)(u32)m), &result, exceptions))
+        return false;
+
+    vfp_put_float(state, result, sd);
+    return true;
+}
+
+static bool vfp_single_host_fsito(ARMul_State* state, int sd, int unused, s32 m, u32* exceptions)
+{
+    u32 result;
+    if (!vfp_host_double_to_single(vfp_host_double_bits((double)m), &result, exceptions))
+        return false;
+
+    vfp_put_float(state, result, sd);
+    return true;
+}
+
+/*
+ * sd = (u32)sm or (s32)sm, rounded towards zero if truncate is set, to nearest otherwise
+ */
+static inline bool vfp_single_host_to_int(ARMul_State* state, int sd, s32 m, u32* exceptions, bool is_signed, bool truncate)
+{
+    if (!vfp_host_single_ok(m))
+        return false;
+
+    double value = vfp_host_widen(vfp_host_single(m));
+    u32 result;
+    if (!vfp_host_to_int(value, is_signed, truncate, &result, exceptions))
+        return false;
+
+    vfp_put_float(state, result, sd);
+    return true;
+}
+
+static bool vfp_single_host_ftoui(ARMul_State* state, int sd, int unused, s32 m, u32* exceptions)
+{
+    return vfp_single_host_to_int(state, sd, m, exceptions, false, false);
+}
+
+static bool vfp_single_host_ftouiz(ARMul_State* state, int sd, int unused, s32 m, u32* exceptions)
+{
+    return vfp_single_host_to_int(state, sd, m, exceptions, false, true);
+}
+
+static bool vfp_single_host_ftosi(ARMul_State* state, int sd, int unused, s32 m, u32* exceptions)
+{
+    return vfp_single_host_to_int(state, sd, m, exceptions, true, false);
+}
+
+static bool vfp_single_host_ftosiz(ARMul_State* state, int sd, int unused, s32 m, u32* exceptions)
+{
+    return vfp_single_host_to_int(state, sd, m, exceptions, true, true);
+}
+
+/// Host versions of the operations of fops, in the same order
+static const vfp_single_host_fn host_fops[] = {
+    vfp_single_host_fmac,
+    vfp_single_host_fmsc,
+    vfp_single_host_fmul,
+    vfp_single_host_fadd,
+    vfp_single_host_fnmac,
+    vfp_single_host_fnmsc,
+    vfp_single_host_fnmul,
+    vfp_single_host_fsub,
+    vfp_single_host_fdiv,
+};
+
+/// Host versions of the operations of fops_ext, in the same order
+static const vfp_single_host_fn host_fops_ext[] = {
+    NULL,                       //0x00000000 - FEXT_FCPY
+    NULL,                       //0x00000001 - FEXT_FABS
+    NULL,                       //0x00000002 - FEXT_FNEG
+    vfp_single_host_fsqrt,      //0x00000003 - FEXT_FSQRT
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,                       //0x00000008 - FEXT_FCMP
+    NULL,                       //0x00000009 - FEXT_FCMPE
+    NULL,                       //0x0000000A - FEXT_FCMPZ
+    NULL,                       //0x0000000B - FEXT_FCMPEZ
+    NULL,
+    NULL,
+    NULL,
+    vfp_single_host_fcvtd,      //0x0000000F - FEXT_FCVT
+    vfp_single_host_fuito,      //0x00000010 - FEXT_FUITO
+    vfp_single_host_fsito,      //0x00000011 - FEXT_FSITO
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    vfp_single_host_ftoui,      //0x00000018 - FEXT_FTOUI
+    vfp_single_host_ftouiz,     //0x00000019 - FEXT_FTOUIZ
+    vfp_single_host_ftosi,      //0x0000001A - FEXT_FTOSI
+    vfp_single_host_ftosiz,     //0x0000001B - FEXT_FTOSIZ
+};
+
+#endif // VFP_HOST_FPU
+
 #define FREG_BANK(x)	((x) & 0x18)
 #define FREG_IDX(x)	((x) & 7)
 
+/*
+ * Index within its bank of the register used by each element of a short vector, for each stride
+ * and index of the first register. Looked up once per operation rather than wrapping around the
+ * bank for every element.
+ */
+static const u8 vector_sequence[2][8][8] = {
+    {   // Stride 1
+        { 0, 1, 2, 3, 4, 5, 6, 7 },
+        { 1, 2, 3, 4, 5, 6, 7, 0 },
+        { 2, 3, 4, 5, 6, 7, 0, 1 },
+        { 3, 4, 5, 6, 7, 0, 1, 2 },
+        { 4, 5, 6, 7, 0, 1, 2, 3 },
+        { 5, 6, 7, 0, 1, 2, 3, 4 },
+        { 6, 7, 0, 1, 2, 3, 4, 5 },
+        { 7, 0, 1, 2, 3, 4, 5, 6 },
+    },
+    {   // Stride 2
+        { 0, 2, 4, 6, 0, 2, 4, 6 },
+        { 1, 3, 5, 7, 1, 3, 5, 7 },
+        { 2, 4, 6, 0, 2, 4, 6, 0 },
+        { 3, 5, 7, 1, 3, 5, 7, 1 },
+        { 4, 6, 0, 2, 4, 6, 0, 2 },
+        { 5, 7, 1, 3, 5, 7, 1, 3 },
+        { 6, 0, 2, 4, 6, 0, 2, 4 },
+        { 7, 1, 3, 5, 7, 1, 3, 5 },
+    },
+};
+
+/// Registers used by each element of a short vector operation
+struct vfp_single_vector {
+    unsigned int length;
+    unsigned int stride;
+    u8 sd[8];
+    u8 sn[8];
+    u8 sm[8];
+};
+
+static void vfp_single_vector_init(struct vfp_single_vector* vec, unsigned int length, unsigned int stride,
+                                   unsigned int sd, unsigned int sn, unsigned int sm)
+{
+    const u8* d_sequence = vector_sequence[stride - 1][FREG_IDX(sd)];
+    const u8* n_sequence = vector_sequence[stride - 1][FREG_IDX(sn)];
+    const u8* m_sequence = vector_sequence[stride - 1][FREG_IDX(sm)];
+
+    // The first element uses the registers of the instruction, which for some scalar operations
+    // aren't of the precision the banks are computed for
+    vec->length = length;
+    vec->stride = stride;
+    vec->sd[0] = sd;
+    vec->sn[0] = sn;
+    vec->sm[0] = sm;
+    for (unsigned int i = 1; i < length; i++) {
+        vec->sd[i] = FREG_BANK(sd) + d_sequence[i];
+        vec->sn[i] = FREG_BANK(sn) + n_sequence[i];
+        // sm is a scalar used by every element if it is in the first bank
+        vec->sm[i] = FREG_BANK(sm) != 0 ? FREG_BANK(sm) + m_sequence[i] : sm;
+    }
+}
+
+#ifdef VFP_HOST_FPU
+
+/**
+ * Checks that no element of a short vector operation reads a register written by a previous
+ * element, so that the elements may be computed in any order
+ */
+static bool vfp_single_vector_independent(const struct vfp_single_vector* vec)
+{
+    // The sequences of registers wrap around if they are longer than a bank
+    if (vec->length * vec->stride > 8)
+        return false;
+
+    // Common case: the sources are in other banks than the destination, or are the same registers
+    bool n_independent = FREG_BANK(vec->sn[0]) != FREG_BANK(vec->sd[0]) || vec->sn[0] == vec->sd[0];
+    bool m_independent = FREG_BANK(vec->sm[0]) != FREG_BANK(vec->sd[0]) || vec->sm[0] == vec->sd[0];
+    if (n_independent && m_independent)
+        return true;
+
+    for (unsigned int i = 0; i < vec->length; i++) {
+        for (unsigned int j = i + 1; j < vec->length; j++) {
+            if (vec->sd[i] == vec->sn[j] || vec->sd[i] == vec->sm[j])
+                return false;
+        }
+    }
+    return true;
+}
+
+/// Loads up to four elements of a short vector, with zeros (on which every operation is exact) past its end
+static inline __m128i vfp_single_host_gather(ARMul_State* state, const u8* regs, unsigned int count, u32 negate)
+{
+    return _mm_setr_epi32(vfp_get_float(state, regs[0]) ^ negate,
+                          count > 1 ? vfp_get_float(state, regs[1]) ^ negate : 0,
+                          count > 2 ? vfp_get_float(state, regs[2]) ^ negate : 0,
+                          count > 3 ? vfp_get_float(state, regs[3]) ^ negate : 0);
+}
+
+/*
+ * Runs a short vector multiply, add or multiply-accumulate as packed host operations, four
+ * elements at a time. Returns false, without touching the registers, when an element must be
+ * left to the soft float code, or when an element reads a register written by a previous one.
+ */
+static bool vfp_single_host_vector(ARMul_State* state, u32 op, const struct vfp_single_vector* vec, u32* exceptions)
+{
+    u32 negate_n = 0, negate_m = 0, negate_d = 0;
+    bool multiply = true, accumulate = true;
+
+    switch (op) {
+    case FOP_FMAC:                                                      break;
+    case FOP_FNMAC: negate_n = 0x80000000;                              break;
+    case FOP_FMSC:  negate_d = 0x80000000;                              break;
+    case FOP_FNMSC: negate_n = 0x80000000; negate_d = 0x80000000;       break;
+    case FOP_FMUL:  accumulate = false;                                 break;
+    case FOP_FNMUL: accumulate = false; negate_n = 0x80000000;          break;
+    case FOP_FADD:  accumulate = false; multiply = false;               break;
+    case FOP_FSUB:  accumulate = false; multiply = false; negate_m = 0x80000000; break;
+    default:
+        return false;
+    }
+
+    if (!vfp_single_vector_independent(vec))
+        return false;
+
+    // The lanes are built from the registers directly: storing them to memory and loading them
+    // back as a vector would stall on store forwarding
+    __m128i result[2];
+    u32 vector_exceptions = 0;
+    for (unsigned int i = 0; i < vec->length; i += 4) {
+        __m128i n = vfp_single_host_gather(state, &vec->sn[i], vec->length - i, negate_n);
+        __m128i m = vfp_single_host_gather(state, &vec->sm[i], vec->length - i, negate_m);
+        __m128i r;
+        u32 except;
+
+        if (multiply ? !vfp_host_single4_mul(n, m, &r, &except) : !vfp_host_single4_add(n, m, &r, &except))
+            return false;
+        vector_exceptions |= except;
+
+        if (accumulate) {
+            __m128i d = vfp_single_host_gather(state, &vec->sd[i], vec->length - i, negate_d);
+            if (!vfp_host_single4_add(d, r, &r, &except))
+                return false;
+            vector_exceptions |= except;
+        }
+        result[i / 4] = r;
+    }
+
+    u32 values[8];
+    _mm_storeu_si128((__m128i*)&values[0], result[0]);
+    if (vec->length > 4)
+        _mm_storeu_si128((__m128i*)&values[4], result[1]);
+    for (unsigned int i = 0; i < vec->length; i++)
+        vfp_put_float(state, values[i], vec->sd[i]);
+    *exceptions = vector_exceptions;
+    return true;
+}
+
+#endif // VFP_HOST_FPU
+
 u32 vfp_single_cpdo(ARMul_State* state, u32 inst, u32 fpscr)
 {
     u32 op = inst & FOP_MASK;
@@ -1285,6 +1682,7 @@ u32 vfp_single_cpdo(ARMul_State* state, u32 inst, u32 fpscr)
     unsigned int sn = vfp_get_sn(inst);
     unsigned int sm = vfp_get_sm(inst);
     unsigned int vecitr, veclen, vecstride;
+    struct vfp_single_vector vec;
     struct op *fop;
     pr_debug("In %s\n", __FUNCTION__);
 
@@ -1292,6 +1690,16 @@ u32 vfp_single_cpdo(ARMul_State* state, u32 inst, u32 fpscr)
 
     fop = (op == FOP_EXT) ? &fops_ext[FEXT_TO_IDX(inst)] : &fops[FOP_TO_IDX(op)];
 
+#ifdef VFP_HOST_FPU
+    vfp_single_host_fn host_fn = NULL;
+    if (vfp_host_fpscr_ok(fpscr)) {
+        if (op != FOP_EXT)
+            host_fn = host_fops[FOP_TO_IDX(op)];
+        else if (FEXT_TO_IDX(inst) < ARRAY_SIZE(host_fops_ext))
+            host_fn = host_fops_ext[FEXT_TO_IDX(inst)];
+    }
+#endif
+
     /*
      * fcvtsd takes a dN register number as destination, not sN.
      * Technically, if bit 0 of dd is set, this is an invalid
@@ -1321,24 +1729,34 @@ u32 vfp_single_cpdo(ARMul_State* state, u32 inst, u32 fpscr)
         goto invalid;
     }
 
-    for (vecitr = 0; vecitr <= veclen; vecitr += 1 << FPSCR_LENGTH_BIT) {
-        s32 m = vfp_get_float(state, sm);
+    vfp_single_vector_init(&vec, (veclen >> FPSCR_LENGTH_BIT) + 1, vecstride, dest, sn, sm);
+
+#ifdef VFP_HOST_FPU
+    if (vec.length > 1 && host_fn != NULL && op != FOP_EXT && vfp_single_host_vector(state, op, &vec, &exceptions))
+        return exceptions;
+#endif
+
+    for (vecitr = 0; vecitr < vec.length; vecitr++) {
+        s32 m = vfp_get_float(state, vec.sm[vecitr]);
         u32 except;
         char type;
 
         type = fop->flags & OP_DD ? 'd' : 's';
         if (op == FOP_EXT)
             pr_debug("VFP: itr%d (%c%u) = op[%u] (s%u=%08x)\n",
-                     vecitr >> FPSCR_LENGTH_BIT, type, dest, sn,
-                     sm, m);
+                     vecitr, type, vec.sd[vecitr], vec.sn[vecitr],
+                     vec.sm[vecitr], m);
         else
             pr_debug("VFP: itr%d (%c%u) = (s%u) op[%u] (s%u=%08x)\n",
-                     vecitr >> FPSCR_LENGTH_BIT, type, dest, sn,
-                     FOP_TO_IDX(op), sm, m);
+                     vecitr, type, vec.sd[vecitr], vec.sn[vecitr],
+                     FOP_TO_IDX(op), vec.sm[vecitr], m);
 
-        except = fop->fn(state, dest, sn, m, fpscr);
+#ifdef VFP_HOST_FPU
+        if (host_fn == NULL || !host_fn(state, vec.sd[vecitr], vec.sn[vecitr], m, &except))
+#endif
+            except = fop->fn(state, vec.sd[vecitr], vec.sn[vecitr], m, fpscr);
         pr_debug("VFP: itr%d: exceptions=%08x\n",
-                 vecitr >> FPSCR_LENGTH_BIT, except);
+                 vecitr, except);
 
         exceptions |= except;
 
@@ -1346,10 +1764,6 @@ u32 vfp_single_cpdo(ARMul_State* state, u32 inst, u32 fpscr)
          * CHECK: It appears to be undefined whether we stop when
          * we encounter an exception.  We continue.
          */
-        dest = FREG_BANK(dest) + ((FREG_IDX(dest) + vecstride) & 7);
-        sn = FREG_BANK(sn) + ((FREG_IDX(sn) + vecstride) & 7);
-        if (FREG_BANK(sm) != 0)
-            sm = FREG_BANK(sm) + ((FREG_IDX(sm) + vecstride) & 7);
     }
     return exceptions;
 
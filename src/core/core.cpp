@@ -3,15 +3,21 @@
 // Refer to the license.txt file included.
 
 #include "common/common_types.h"
+#include "common/chunk_file.h"
+#include "common/profiler.h"
+#include "common/trace.h"
 
 #include "core/core.h"
+#include "core/rewind.h"
 
 #include "core/settings.h"
 #include "core/arm/disassembler/arm_disasm.h"
 #include "core/arm/interpreter/arm_interpreter.h"
 #include "core/arm/dyncom/arm_dyncom.h"
+#include "core/arm/sampling_profiler.h"
 #include "core/hle/hle.h"
 #include "core/hle/kernel/thread.h"
+#include "core/hle/service/fs/async_io.h"
 #include "core/hw/hw.h"
 
 namespace Core {
@@ -23,11 +29,19 @@ ARM_Interface*     g_sys_core = nullptr;  ///< ARM11 system (OS) core
 
 /// Run the core CPU loop
 void RunLoop(int tight_loop) {
-    g_app_core->Run(tight_loop);
+    {
+        PROFILE_SUBSYSTEM(CPU);
+        TRACE_SCOPE_MERGED(CPU, "Run");
+        g_app_core->Run(tight_loop);
+    }
+    if (SamplingProfiler::IsRunning())
+        SamplingProfiler::Update();
     HW::Update();
+    Service::FS::ProcessAsyncIO();
     if (HLE::g_reschedule) {
         Kernel::Reschedule();
     }
+    Rewind::Update();
 }
 
 /// Step the CPU one instruction
@@ -75,4 +89,13 @@ void Shutdown() {
     LOG_DEBUG(Core, "shutdown OK");
 }
 
+void DoState(PointerWrap& p) {
+    auto s = p.Section("Core", 1);
+    if (!s)
+        return;
+
+    g_app_core->DoState(p);
+    p.Do(last_ticks);
+}
+
 } // namespace
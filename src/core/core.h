@@ -49,4 +49,7 @@ int Init();
 /// Shutdown the core
 void Shutdown();
 
+/// Saves or loads the state of the application core
+void DoState(PointerWrap& p);
+
 } // namespace
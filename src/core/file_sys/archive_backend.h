@@ -7,6 +7,7 @@
 #include <memory>
 
 #include "common/common_types.h"
+#include "common/chunk_file.h"
 #include "common/string_util.h"
 #include "common/bit_field.h"
 
@@ -167,6 +168,18 @@ public:
         }
     }
 
+    void DoState(PointerWrap& p) {
+        p.Do(type);
+        p.Do(binary);
+        p.Do(string);
+
+        // PointerWrap doesn't handle UTF-16 strings, go through a vector
+        std::vector<char16_t> chars(u16str.begin(), u16str.end());
+        p.Do(chars);
+        if (p.GetMode() == PointerWrap::MODE_READ)
+            u16str.assign(chars.begin(), chars.end());
+    }
+
 private:
     LowPathType type;
     std::vector<u8> binary;
@@ -2,6 +2,7 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <memory>
 
 #include "common/common_types.h"
@@ -17,10 +18,49 @@
 namespace FileSys {
 
 Archive_RomFS::Archive_RomFS(const Loader::AppLoader& app_loader) {
-    // Load the RomFS from the app
-    if (Loader::ResultStatus::Success != app_loader.ReadRomFS(raw_data)) {
+    // Map the RomFS from the app, its contents are only read from disk when accessed
+    std::string filename;
+    if (Loader::ResultStatus::Success != app_loader.ReadRomFS(filename, romfs_offset, romfs_size)) {
         LOG_ERROR(Service_FS, "Unable to read RomFS!");
+        romfs_size = 0;
+        return;
     }
+
+    if (!romfs_mapping.Open(filename, romfs_offset, romfs_size)) {
+        LOG_WARNING(Service_FS, "Unable to map RomFS, falling back to reading from the file");
+        if (!romfs_file.Open(filename, "rb")) {
+            LOG_ERROR(Service_FS, "Unable to open %s!", filename.c_str());
+            romfs_size = 0;
+            return;
+        }
+    }
+
+    // Some applications have a RomFS without a filesystem, so this isn't necessarily an error
+    File_RomFS romfs(this, Path());
+    if (!romfs.Open() || !index.Load(romfs)) {
+        LOG_WARNING(Service_FS, "Unable to index RomFS, its files can't be opened by path");
+    }
+}
+
+size_t Archive_RomFS::Read(u64 offset, u32 length, u8* buffer) const {
+    if (offset >= romfs_size) {
+        return 0;
+    }
+    size_t read_length = (size_t)std::min<u64>(length, romfs_size - offset);
+
+    if (romfs_mapping.IsOpen()) {
+        memcpy(buffer, romfs_mapping.GetData() + offset, read_length);
+        return read_length;
+    }
+
+    std::lock_guard<std::mutex> lock(romfs_file_mutex);
+    if (!romfs_file.Seek(romfs_offset + offset, SEEK_SET)) {
+        romfs_file.Clear();
+        return 0;
+    }
+    read_length = romfs_file.ReadBytes(buffer, read_length);
+    romfs_file.Clear();
+    return read_length;
 }
 
 /**
@@ -30,7 +70,11 @@ Archive_RomFS::Archive_RomFS(const Loader::AppLoader& app_loader) {
  * @return Opened file, or nullptr
  */
 std::unique_ptr<FileBackend> Archive_RomFS::OpenFile(const Path& path, const Mode mode) const {
-    return Common::make_unique<File_RomFS>(this);
+    LOG_DEBUG(Service_FS, "called path=%s mode=%01X", path.DebugStr().c_str(), mode.hex);
+    std::unique_ptr<FileBackend> file = Common::make_unique<File_RomFS>(this, path);
+    if (!file->Open())
+        return nullptr;
+    return file;
 }
 
 /**
@@ -85,7 +129,11 @@ bool Archive_RomFS::RenameDirectory(const FileSys::Path& src_path, const FileSys
  * @return Opened directory, or nullptr
  */
 std::unique_ptr<DirectoryBackend> Archive_RomFS::OpenDirectory(const Path& path) const {
-    return Common::make_unique<Directory_RomFS>();
+    LOG_DEBUG(Service_FS, "called path=%s", path.DebugStr().c_str());
+    std::unique_ptr<DirectoryBackend> directory = Common::make_unique<Directory_RomFS>(this, path);
+    if (!directory->Open())
+        return nullptr;
+    return directory;
 }
 
 } // namespace FileSys
@@ -4,11 +4,14 @@
 
 #pragma once
 
-#include <vector>
+#include <mutex>
+#include <string>
 
 #include "common/common_types.h"
+#include "common/file_util.h"
 
 #include "core/file_sys/archive_backend.h"
+#include "core/file_sys/romfs_index.h"
 #include "core/loader/loader.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -85,8 +88,28 @@ public:
 
 private:
     friend class File_RomFS;
+    friend class Directory_RomFS;
 
-    std::vector<u8> raw_data;
+    /**
+     * Read data from the RomFS
+     * @param offset Offset in bytes from the start of the RomFS
+     * @param length Length in bytes of data to read
+     * @param buffer Buffer to read data into
+     * @return Number of bytes read
+     */
+    size_t Read(u64 offset, u32 length, u8* buffer) const;
+
+    /// Mapping of the RomFS within the application file, pages are read in as they are accessed
+    FileUtil::MappedFile romfs_mapping;
+
+    /// Used instead of the mapping if the RomFS couldn't be mapped (e.g. lack of address space)
+    mutable FileUtil::IOFile romfs_file;
+    mutable std::mutex romfs_file_mutex;
+    u64 romfs_offset = 0;
+    u64 romfs_size = 0;
+
+    /// Directory and file tables of the RomFS, used to open its files and directories by path
+    RomFSIndex index;
 };
 
 } // namespace FileSys
@@ -26,6 +26,8 @@ public:
     bool Initialize();
 
     std::string GetName() const override { return "SaveData"; }
+
+    bool UseAtomicWrites() const override { return true; }
 };
 
 } // namespace FileSys
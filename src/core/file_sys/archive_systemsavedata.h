@@ -28,6 +28,8 @@ public:
     bool Initialize();
 
     std::string GetName() const override { return "SystemSaveData"; }
+
+    bool UseAtomicWrites() const override { return true; }
 };
 
 } // namespace FileSys
@@ -2,8 +2,13 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+
 #include "common/common_types.h"
+#include "common/file_util.h"
+#include "common/string_util.h"
 
+#include "core/file_sys/archive_romfs.h"
 #include "core/file_sys/directory_romfs.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -11,14 +16,42 @@
 
 namespace FileSys {
 
-Directory_RomFS::Directory_RomFS() {
+Directory_RomFS::Directory_RomFS(const Archive_RomFS* archive, const Path& path)
+    : archive(archive), path(path),
+      next_directory(RomFSIndex::INVALID_OFFSET), next_file(RomFSIndex::INVALID_OFFSET) {
 }
 
 Directory_RomFS::~Directory_RomFS() {
 }
 
 bool Directory_RomFS::Open() {
-    return false;
+    if (path.GetType() != Char && path.GetType() != Wchar && path.GetType() != Empty) {
+        LOG_ERROR(Service_FS, "Unsupported path %s for a RomFS directory", path.DebugStr().c_str());
+        return false;
+    }
+
+    RomFSDirectoryEntry directory;
+    if (!archive->index.GetDirectory(archive->index.FindDirectory(path.AsU16Str()), directory)) {
+        LOG_ERROR(Service_FS, "Directory %s not found in RomFS", path.DebugStr().c_str());
+        return false;
+    }
+
+    next_directory = directory.first_child_directory;
+    next_file = directory.first_file;
+    return true;
+}
+
+/**
+ * Fills a directory entry with the name of a RomFS directory or file
+ * @param entry Entry to fill
+ * @param name Name of the directory or file
+ */
+static void FillEntryName(Entry& entry, const std::u16string& name) {
+    size_t length = std::min(name.size(), FILENAME_LENGTH - 1);
+    std::copy(name.begin(), name.begin() + length, entry.filename);
+    entry.filename[length] = u'\0';
+
+    FileUtil::SplitFilename83(Common::UTF16ToUTF8(name), entry.short_name, entry.extension);
 }
 
 /**
@@ -28,7 +61,51 @@ bool Directory_RomFS::Open() {
  * @return Number of entries listed
  */
 u32 Directory_RomFS::Read(const u32 count, Entry* entries) {
-    return 0;
+    const RomFSIndex& index = archive->index;
+    std::u16string name;
+    u32 entries_read = 0;
+
+    while (entries_read < count && next_directory != RomFSIndex::INVALID_OFFSET) {
+        RomFSDirectoryEntry directory;
+        if (!index.GetDirectory(next_directory, directory, &name)) {
+            LOG_ERROR(Service_FS, "Invalid directory entry 0x%08X in RomFS", next_directory);
+            next_directory = RomFSIndex::INVALID_OFFSET;
+            break;
+        }
+
+        Entry& entry = entries[entries_read];
+        FillEntryName(entry, name);
+        entry.is_directory = 1;
+        entry.is_hidden = 0;
+        entry.is_archive = 0;
+        entry.is_read_only = 1;
+        entry.file_size = 0;
+
+        ++entries_read;
+        next_directory = directory.next_sibling;
+    }
+
+    while (entries_read < count && next_file != RomFSIndex::INVALID_OFFSET) {
+        RomFSFileEntry file;
+        if (!index.GetFile(next_file, file, &name)) {
+            LOG_ERROR(Service_FS, "Invalid file entry 0x%08X in RomFS", next_file);
+            next_file = RomFSIndex::INVALID_OFFSET;
+            break;
+        }
+
+        Entry& entry = entries[entries_read];
+        FillEntryName(entry, name);
+        entry.is_directory = 0;
+        entry.is_hidden = 0;
+        entry.is_archive = 1;
+        entry.is_read_only = 1;
+        entry.file_size = file.data_size;
+
+        ++entries_read;
+        next_file = file.next_sibling;
+    }
+
+    return entries_read;
 }
 
 /**
@@ -36,7 +113,7 @@ u32 Directory_RomFS::Read(const u32 count, Entry* entries) {
  * @return true if the directory closed correctly
  */
 bool Directory_RomFS::Close() const {
-    return false;
+    return true;
 }
 
 } // namespace FileSys
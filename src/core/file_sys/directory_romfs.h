@@ -6,6 +6,7 @@
 
 #include "common/common_types.h"
 
+#include "core/file_sys/archive_backend.h"
 #include "core/file_sys/directory_backend.h"
 #include "core/loader/loader.h"
 
@@ -14,9 +15,11 @@
 
 namespace FileSys {
 
+class Archive_RomFS;
+
 class Directory_RomFS final : public DirectoryBackend {
 public:
-    Directory_RomFS();
+    Directory_RomFS(const Archive_RomFS* archive, const Path& path);
     ~Directory_RomFS() override;
 
     /**
@@ -38,6 +41,15 @@ public:
      * @return true if the directory closed correctly
      */
     bool Close() const override;
+
+private:
+    const Archive_RomFS* archive;
+    Path path;
+
+    // Subdirectories are listed before files. These always refer to the next unread entry, so a
+    // subsequent call to Read will continue from it.
+    u32 next_directory;
+    u32 next_file;
 };
 
 } // namespace FileSys
@@ -2,6 +2,8 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <cstring>
 #include <sys/stat.h>
 
 #include "common/common_types.h"
@@ -15,6 +17,25 @@
 
 namespace FileSys {
 
+const char DISK_FILE_TEMP_SUFFIX[] = ".citra_tmp";
+
+/// Size above which the write cache of a file is written out, and writes bypass the cache
+static const size_t WRITE_CACHE_LIMIT = 256 * 1024;
+
+/// Age after which cached writes are written out, checked on subsequent writes
+static const std::chrono::seconds WRITE_CACHE_MAX_AGE(5);
+
+/// Age after which the temporary copy of a file with atomic writes replaces the original, checked
+/// on subsequent writes and flushes
+static const std::chrono::seconds TRANSACTION_MAX_AGE(5);
+
+/// Returns true if the host file is a temporary copy made by a DiskFile
+static bool IsTempFile(const std::string& filename) {
+    const size_t suffix_length = sizeof(DISK_FILE_TEMP_SUFFIX) - 1;
+    return filename.size() > suffix_length &&
+        filename.compare(filename.size() - suffix_length, suffix_length, DISK_FILE_TEMP_SUFFIX) == 0;
+}
+
 std::unique_ptr<FileBackend> DiskArchive::OpenFile(const Path& path, const Mode mode) const {
     LOG_DEBUG(Service_FS, "called path=%s mode=%01X", path.DebugStr().c_str(), mode.hex);
     DiskFile* file = new DiskFile(this, path, mode);
@@ -81,6 +102,9 @@ DiskFile::DiskFile(const DiskArchive* archive, const Path& path, const Mode mode
     this->path = archive->GetMountPoint() + path.AsString();
     this->mode.hex = mode.hex;
     this->archive = archive;
+    in_transaction = false;
+    empty_copy = false;
+    write_cache_size = 0;
 }
 
 bool DiskFile::Open() {
@@ -89,6 +113,27 @@ bool DiskFile::Open() {
         return false;
     }
 
+    if (archive->UseAtomicWrites()) {
+        temp_path = path + DISK_FILE_TEMP_SUFFIX;
+
+        // A copy left behind by an interrupted write is incomplete, while the original is intact
+        if (FileUtil::Exists(temp_path))
+            FileUtil::Delete(temp_path);
+
+        if (mode.create_flag) {
+            // Truncate the file through an empty copy, so that its contents are only lost once the
+            // new ones are committed
+            if (!FileUtil::Exists(path))
+                FileUtil::CreateEmptyFile(path);
+            file.reset(new FileUtil::IOFile(path, "rb"));
+            empty_copy = true;
+            return BeginTransaction();
+        }
+
+        file.reset(new FileUtil::IOFile(path, mode.write_flag ? "r+b" : "rb"));
+        return true;
+    }
+
     std::string mode_string;
     if (mode.create_flag)
         mode_string = "w+";
@@ -100,37 +145,214 @@ bool DiskFile::Open() {
     // Open the file in binary mode, to avoid problems with CR/LF on Windows systems
     mode_string += "b";
 
-    file = new FileUtil::IOFile(path, mode_string.c_str());
+    file.reset(new FileUtil::IOFile(path, mode_string.c_str()));
     return true;
 }
 
 size_t DiskFile::Read(const u64 offset, const u32 length, u8* buffer) const {
     file->Seek(offset, SEEK_SET);
-    return file->ReadBytes(buffer, length);
+    size_t read = file->ReadBytes(buffer, length);
+    if (write_cache.empty())
+        return read;
+
+    // Reading past the end of the file fails the stream, but cached writes may extend it
+    file->Clear();
+
+    // Overlay the cached writes onto the data from the host file. Any gap between the end of the
+    // host file and a cached write reads as zeroes, as it will once the write is performed.
+    const u64 end = offset + length;
+    auto extent = write_cache.upper_bound(offset);
+    if (extent != write_cache.begin())
+        --extent;
+
+    for (; extent != write_cache.end() && extent->first < end; ++extent) {
+        const u64 extent_end = extent->first + extent->second.size();
+        if (extent_end <= offset)
+            continue;
+
+        const u64 copy_begin = std::max(extent->first, offset);
+        const u64 copy_end = std::min(extent_end, end);
+        if (copy_begin - offset > read)
+            memset(buffer + read, 0, static_cast<size_t>(copy_begin - offset - read));
+        memcpy(buffer + (copy_begin - offset), &extent->second[copy_begin - extent->first],
+               static_cast<size_t>(copy_end - copy_begin));
+        read = std::max(read, static_cast<size_t>(copy_end - offset));
+    }
+    return read;
 }
 
 size_t DiskFile::Write(const u64 offset, const u32 length, const u32 flush, const u8* buffer) const {
-    file->Seek(offset, SEEK_SET);
-    size_t written = file->WriteBytes(buffer, length);
-    if (flush)
-        file->Flush();
+    if (!mode.write_flag && !mode.create_flag) {
+        LOG_ERROR(Service_FS, "File %s wasn't opened for writing", path.c_str());
+        return 0;
+    }
+
+    if (!BeginTransaction())
+        return 0;
+
+    size_t written;
+    if (length >= WRITE_CACHE_LIMIT) {
+        // Large writes gain nothing from the cache, perform them right away
+        FlushWriteCache();
+        file->Seek(offset, SEEK_SET);
+        written = file->WriteBytes(buffer, length);
+    } else {
+        CacheWrite(offset, length, buffer);
+        written = length;
+    }
+
+    if (flush) {
+        Flush();
+    } else if (write_cache_size > WRITE_CACHE_LIMIT ||
+               (write_cache_size != 0 &&
+                std::chrono::steady_clock::now() - oldest_cached_write > WRITE_CACHE_MAX_AGE)) {
+        FlushWriteCache();
+        CommitOldTransaction();
+    }
     return written;
 }
 
 size_t DiskFile::GetSize() const {
-    return static_cast<size_t>(file->GetSize());
+    u64 size = file->GetSize();
+    if (!write_cache.empty()) {
+        const auto& last_extent = *write_cache.rbegin();
+        size = std::max<u64>(size, last_extent.first + last_extent.second.size());
+    }
+    return static_cast<size_t>(size);
 }
 
 bool DiskFile::SetSize(const u64 size) const {
+    if (!BeginTransaction())
+        return false;
+
+    FlushWriteCache();
     file->Resize(size);
     file->Flush();
     return true;
 }
 
 bool DiskFile::Close() const {
+    if (file == nullptr || !file->IsOpen())
+        return true;
+
+    FlushWriteCache();
+    CommitTransaction();
     return file->Close();
 }
 
+void DiskFile::Flush() const {
+    FlushWriteCache();
+    file->Flush();
+    CommitOldTransaction();
+}
+
+void DiskFile::CacheWrite(u64 offset, u32 length, const u8* buffer) const {
+    if (length == 0)
+        return;
+
+    if (write_cache.empty())
+        oldest_cached_write = std::chrono::steady_clock::now();
+
+    // Find the extents overlapping or touching the write, starting with the last one before it
+    auto first = write_cache.upper_bound(offset);
+    if (first != write_cache.begin()) {
+        auto previous = std::prev(first);
+        if (previous->first + previous->second.size() >= offset)
+            first = previous;
+    }
+
+    u64 begin = offset;
+    u64 end = offset + length;
+    auto last = first;
+    for (; last != write_cache.end() && last->first <= end; ++last) {
+        begin = std::min(begin, last->first);
+        end = std::max<u64>(end, last->first + last->second.size());
+        write_cache_size -= last->second.size();
+    }
+
+    // Extend the first extent in place when the write doesn't start before it, which is the common
+    // case of sequential writes
+    std::vector<u8> data;
+    auto extent = first;
+    if (first != last && first->first == begin) {
+        data.swap(first->second);
+        ++extent;
+    }
+    data.resize(static_cast<size_t>(end - begin));
+    for (; extent != last; ++extent)
+        memcpy(&data[extent->first - begin], extent->second.data(), extent->second.size());
+    memcpy(&data[offset - begin], buffer, length);
+
+    write_cache.erase(first, last);
+    write_cache_size += data.size();
+    write_cache.emplace(begin, std::move(data));
+}
+
+bool DiskFile::FlushWriteCache() const {
+    bool success = true;
+    for (const auto& extent : write_cache) {
+        if (!file->Seek(extent.first, SEEK_SET) ||
+            file->WriteBytes(extent.second.data(), extent.second.size()) != extent.second.size()) {
+            success = false;
+        }
+    }
+
+    if (!success)
+        LOG_ERROR(Service_FS, "Failed to write cached data to %s", path.c_str());
+
+    write_cache.clear();
+    write_cache_size = 0;
+    return success;
+}
+
+bool DiskFile::BeginTransaction() const {
+    if (in_transaction || !archive->UseAtomicWrites())
+        return true;
+
+    bool copied = empty_copy ? FileUtil::CreateEmptyFile(temp_path) : FileUtil::Copy(path, temp_path);
+    if (!copied || !file->Open(temp_path, "r+b")) {
+        LOG_ERROR(Service_FS, "Failed to create temporary copy of %s", path.c_str());
+        return false;
+    }
+
+    in_transaction = true;
+    empty_copy = false;
+    transaction_start = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool DiskFile::CommitTransaction() const {
+    if (!in_transaction)
+        return true;
+
+    // Without syncing the copy first, a power loss shortly after the rename could leave the file
+    // empty or partially written instead of with either its old or its new contents
+    const bool synced = file->Sync();
+    file->Close();
+    in_transaction = false;
+
+    bool replaced = synced && FileUtil::Replace(temp_path, path);
+    if (!replaced) {
+        LOG_ERROR(Service_FS, "Failed to replace %s, its latest changes were lost", path.c_str());
+        FileUtil::Delete(temp_path);
+    }
+
+    file->Open(path, "r+b");
+    return replaced;
+}
+
+bool DiskFile::CommitOldTransaction() const {
+    // Committing replaces the file, and the next write copies it again. Games may flush after
+    // every small write, so doing this on each flush would copy the whole file every time.
+    if (!in_transaction ||
+        std::chrono::steady_clock::now() - transaction_start <= TRANSACTION_MAX_AGE) {
+        return true;
+    }
+
+    FlushWriteCache();
+    return CommitTransaction();
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 DiskDirectory::DiskDirectory(const DiskArchive* archive, const Path& path) {
@@ -157,6 +379,11 @@ u32 DiskDirectory::Read(const u32 count, Entry* entries) {
         const std::string& filename = file.virtualName;
         Entry& entry = entries[entries_read];
 
+        if (IsTempFile(filename)) {
+            ++children_iterator;
+            continue;
+        }
+
         LOG_TRACE(Service_FS, "File %s: size=%llu dir=%d", filename.c_str(), file.size, file.isDirectory);
 
         // TODO(Link Mauve): use a proper conversion to UTF-16.
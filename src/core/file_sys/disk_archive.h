@@ -4,6 +4,11 @@
 
 #pragma once
 
+#include <chrono>
+#include <map>
+#include <memory>
+#include <vector>
+
 #include "common/common_types.h"
 #include "common/file_util.h"
 
@@ -42,10 +47,32 @@ public:
         return mount_point;
     }
 
+    /**
+     * Whether writes to files of this archive should be atomic. If so, files are modified through
+     * a temporary copy, which is synced to disk and replaces the original when the guest closes
+     * the file, or on a later write or flush once the copy is a few seconds old, so that a crash
+     * leaves either the old or the new contents rather than a half-written file. Flushes don't
+     * commit a younger copy: if the emulator crashes before the next commit, the changes made
+     * since the copy was made are lost, even those the guest flushed.
+     * @return True if the archive uses atomic writes
+     */
+    virtual bool UseAtomicWrites() const {
+        return false;
+    }
+
 protected:
     std::string mount_point;
 };
 
+/// Suffix of the temporary copies through which files of archives with atomic writes are modified
+extern const char DISK_FILE_TEMP_SUFFIX[];
+
+/**
+ * File on the host filesystem. Writes are held in a write-back cache, which coalesces the small
+ * adjacent writes games typically perform into larger host writes. The cache is written out when
+ * it grows too large or too old, when the guest flushes or closes the file, and when the file is
+ * destroyed on emulator shutdown.
+ */
 class DiskFile : public FileBackend {
 public:
     DiskFile();
@@ -61,16 +88,49 @@ public:
     size_t GetSize() const override;
     bool SetSize(const u64 size) const override;
     bool Close() const override;
-    
-    void Flush() const override {
-        file->Flush();
-    }
+    void Flush() const override;
 
 protected:
+    /**
+     * Adds a write to the write cache, merging it with the cached extents it overlaps or touches
+     * @param offset Offset of the write in the file
+     * @param length Length in bytes of the write
+     * @param buffer Data to write
+     */
+    void CacheWrite(u64 offset, u32 length, const u8* buffer) const;
+
+    /// Writes the cached extents to the host file and empties the write cache
+    bool FlushWriteCache() const;
+
+    /// Starts modifying a temporary copy of the file, if the archive uses atomic writes
+    bool BeginTransaction() const;
+
+    /// Replaces the file with the temporary copy being modified, if any
+    bool CommitTransaction() const;
+
+    /// Commits the temporary copy being modified if it was started long enough ago
+    bool CommitOldTransaction() const;
+
     const DiskArchive* archive;
     std::string path;
     Mode mode;
-    FileUtil::IOFile* file;
+    std::unique_ptr<FileUtil::IOFile> file;
+
+    /// Path of the temporary copy of the file, used by archives with atomic writes
+    std::string temp_path;
+    /// Whether the file currently open is the temporary copy
+    mutable bool in_transaction;
+    /// Whether the next temporary copy starts out empty instead of as a copy of the file
+    mutable bool empty_copy;
+    /// Time at which the temporary copy being modified was made
+    mutable std::chrono::steady_clock::time_point transaction_start;
+
+    /// Writes not yet passed to the host file, as non-overlapping extents keyed by their offset
+    mutable std::map<u64, std::vector<u8>> write_cache;
+    /// Total size in bytes of the cached extents
+    mutable size_t write_cache_size;
+    /// Time of the oldest write in the cache
+    mutable std::chrono::steady_clock::time_point oldest_cached_write;
 };
 
 class DiskDirectory : public DirectoryBackend {
@@ -2,6 +2,8 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+
 #include "common/common_types.h"
 
 #include "core/file_sys/file_romfs.h"
@@ -17,6 +19,25 @@ namespace FileSys {
  * @return true if the file opened correctly
  */
 bool File_RomFS::Open() {
+    if (path.GetType() != Char && path.GetType() != Wchar) {
+        data_offset = 0;
+        size = archive->romfs_size;
+        return true;
+    }
+
+    const RomFSIndex& index = archive->index;
+    RomFSFileEntry file;
+    if (!index.GetFile(index.FindFile(path.AsU16Str()), file)) {
+        LOG_ERROR(Service_FS, "File %s not found in RomFS", path.DebugStr().c_str());
+        return false;
+    }
+
+    data_offset = index.GetFileDataOffset(file);
+    size = file.data_size;
+    if (data_offset > archive->romfs_size || size > archive->romfs_size - data_offset) {
+        LOG_ERROR(Service_FS, "File %s lies outside of the RomFS", path.DebugStr().c_str());
+        return false;
+    }
     return true;
 }
 
@@ -29,8 +50,10 @@ bool File_RomFS::Open() {
  */
 size_t File_RomFS::Read(const u64 offset, const u32 length, u8* buffer) const {
     LOG_TRACE(Service_FS, "called offset=%llu, length=%d", offset, length);
-    memcpy(buffer, &archive->raw_data[(u32)offset], length);
-    return length;
+    if (offset >= size)
+        return 0;
+    // Read straight from the mapped RomFS into the destination buffer
+    return archive->Read(data_offset + offset, (u32)std::min<u64>(length, size - offset), buffer);
 }
 
 /**
@@ -51,7 +74,7 @@ size_t File_RomFS::Write(const u64 offset, const u32 length, const u32 flush, co
  * @return Size of the file in bytes
  */
 size_t File_RomFS::GetSize() const {
-    return sizeof(u8) * archive->raw_data.size();
+    return (size_t)size;
 }
 
 /**
@@ -6,6 +6,7 @@
 
 #include "common/common_types.h"
 
+#include "core/file_sys/archive_backend.h"
 #include "core/file_sys/file_backend.h"
 #include "core/loader/loader.h"
 
@@ -18,7 +19,14 @@ class Archive_RomFS;
 
 class File_RomFS final : public FileBackend {
 public:
-    File_RomFS(const Archive_RomFS* archive) : archive(archive) {}
+    /**
+     * Creates a file of the RomFS. Files opened with a binary path are the whole RomFS, which
+     * applications usually parse themselves, while string paths refer to individual files.
+     * @param archive Archive containing the file
+     * @param path Path of the file
+     */
+    File_RomFS(const Archive_RomFS* archive, const Path& path)
+        : archive(archive), path(path), data_offset(0), size(0) {}
 
     /**
      * Open the file
@@ -68,6 +76,10 @@ public:
 
 private:
     const Archive_RomFS* archive;
+    Path path;
+
+    u64 data_offset; ///< Offset of the file data from the start of the RomFS
+    u64 size;
 };
 
 } // namespace FileSys
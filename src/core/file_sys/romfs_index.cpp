@@ -0,0 +1,208 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstring>
+
+#include "common/common_types.h"
+
+#include "core/file_sys/romfs_index.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// FileSys namespace
+
+namespace FileSys {
+
+/**
+ * Hash function used for the bucket index of RomFS directories and files
+ * @param parent Offset of the parent directory entry
+ * @param name Name of the directory or file
+ * @param name_length Length of the name in characters
+ * @return Hash of the parent/name pair
+ */
+static u32 CalculatePathHash(u32 parent, const char16_t* name, size_t name_length) {
+    u32 hash = parent ^ 123456789;
+    for (size_t i = 0; i < name_length; ++i) {
+        hash = (hash >> 5) | (hash << 27);
+        hash ^= name[i];
+    }
+    return hash;
+}
+
+/**
+ * Reads a region of a RomFS, checking that it lies within the file
+ * @param romfs File to read from
+ * @param offset Offset of the region
+ * @param length Length in bytes of the region
+ * @param buffer Buffer to read data into
+ * @return true if the whole region was read
+ */
+static bool ReadRegion(const FileBackend& romfs, u32 offset, u32 length, void* buffer) {
+    if ((u64)offset + length > romfs.GetSize())
+        return false;
+    return romfs.Read(offset, length, static_cast<u8*>(buffer)) == length;
+}
+
+/**
+ * Gets an entry (directory or file) from one of the tables of a RomFS
+ * @param table Table containing the entry
+ * @param offset Offset of the entry in the table
+ * @param entry Receives the entry
+ * @param name If not null, receives the name of the entry
+ * @return true if the entry and its name are within the table
+ */
+template <typename T>
+static bool GetTableEntry(const std::vector<u8>& table, u32 offset, T& entry, std::u16string* name) {
+    if (offset % 4 != 0 || (u64)offset + sizeof(T) > table.size())
+        return false;
+    memcpy(&entry, &table[offset], sizeof(T));
+
+    if (entry.name_length % 2 != 0 || (u64)offset + sizeof(T) + entry.name_length > table.size())
+        return false;
+    if (name != nullptr) {
+        name->resize(entry.name_length / 2);
+        memcpy(&(*name)[0], &table[offset + sizeof(T)], entry.name_length);
+    }
+    return true;
+}
+
+/**
+ * Looks up an entry (directory or file) by parent and name through the hash table of a RomFS
+ * @param hash_table Hash table of the entries
+ * @param table Table containing the entries
+ * @param parent Offset of the parent directory entry
+ * @param name Name of the entry
+ * @param name_length Length of the name in characters
+ * @return Offset of the entry, or INVALID_OFFSET if there is none
+ */
+template <typename T>
+static u32 FindTableEntry(const std::vector<u32>& hash_table, const std::vector<u8>& table,
+                          u32 parent, const char16_t* name, size_t name_length) {
+    if (hash_table.empty())
+        return RomFSIndex::INVALID_OFFSET;
+
+    u32 offset = hash_table[CalculatePathHash(parent, name, name_length) % hash_table.size()];
+
+    // Bound the walk by the number of entries that fit in the table, in case the chain has a cycle
+    for (size_t i = 0; i < table.size() / sizeof(T) && offset != RomFSIndex::INVALID_OFFSET; ++i) {
+        T entry;
+        if (!GetTableEntry(table, offset, entry, nullptr))
+            break;
+
+        if (entry.parent == parent && entry.name_length == name_length * 2 &&
+            memcmp(&table[offset + sizeof(T)], name, entry.name_length) == 0) {
+            return offset;
+        }
+        offset = entry.next_in_bucket;
+    }
+    return RomFSIndex::INVALID_OFFSET;
+}
+
+bool RomFSIndex::Load(const FileBackend& romfs) {
+    RomFSHeader header;
+    if (!ReadRegion(romfs, 0, sizeof(header), &header) || header.header_length != sizeof(header)) {
+        LOG_ERROR(Service_FS, "RomFS header is invalid");
+        return false;
+    }
+
+    if (header.directory_hash_table_length % 4 != 0 || header.file_hash_table_length % 4 != 0) {
+        LOG_ERROR(Service_FS, "RomFS hash tables are misaligned");
+        return false;
+    }
+
+    directory_hash_table.resize(header.directory_hash_table_length / 4);
+    directory_table.resize(header.directory_table_length);
+    file_hash_table.resize(header.file_hash_table_length / 4);
+    file_table.resize(header.file_table_length);
+
+    if (!ReadRegion(romfs, header.directory_hash_table_offset, header.directory_hash_table_length,
+                    directory_hash_table.data()) ||
+        !ReadRegion(romfs, header.directory_table_offset, header.directory_table_length,
+                    directory_table.data()) ||
+        !ReadRegion(romfs, header.file_hash_table_offset, header.file_hash_table_length,
+                    file_hash_table.data()) ||
+        !ReadRegion(romfs, header.file_table_offset, header.file_table_length,
+                    file_table.data())) {
+        LOG_ERROR(Service_FS, "RomFS tables lie outside of the RomFS");
+        directory_table.clear();
+        return false;
+    }
+
+    RomFSDirectoryEntry root;
+    if (!GetDirectory(ROOT_DIRECTORY, root)) {
+        LOG_ERROR(Service_FS, "RomFS has no root directory");
+        directory_table.clear();
+        return false;
+    }
+
+    file_data_offset = header.file_data_offset;
+
+    LOG_DEBUG(Service_FS, "RomFS index: %u directory buckets, %u file buckets",
+              (u32)directory_hash_table.size(), (u32)file_hash_table.size());
+    return true;
+}
+
+u32 RomFSIndex::FindChildDirectory(u32 parent, const char16_t* name, size_t name_length) const {
+    return FindTableEntry<RomFSDirectoryEntry>(directory_hash_table, directory_table,
+                                               parent, name, name_length);
+}
+
+u32 RomFSIndex::FindChildFile(u32 parent, const char16_t* name, size_t name_length) const {
+    return FindTableEntry<RomFSFileEntry>(file_hash_table, file_table, parent, name, name_length);
+}
+
+u32 RomFSIndex::FindParentDirectory(const std::u16string& path, size_t& name_begin) const {
+    u32 directory = ROOT_DIRECTORY;
+    size_t position = 0;
+
+    while (true) {
+        // Skip the separator(s) before the next component
+        while (position < path.size() && path[position] == u'/')
+            ++position;
+
+        size_t separator = path.find(u'/', position);
+        if (separator == std::u16string::npos) {
+            name_begin = position;
+            return directory;
+        }
+
+        directory = FindChildDirectory(directory, &path[position], separator - position);
+        if (directory == INVALID_OFFSET)
+            return INVALID_OFFSET;
+        position = separator + 1;
+    }
+}
+
+u32 RomFSIndex::FindDirectory(const std::u16string& path) const {
+    if (!IsLoaded())
+        return INVALID_OFFSET;
+
+    size_t name_begin;
+    u32 parent = FindParentDirectory(path, name_begin);
+    if (parent == INVALID_OFFSET || name_begin == path.size())
+        return parent;
+
+    return FindChildDirectory(parent, &path[name_begin], path.size() - name_begin);
+}
+
+u32 RomFSIndex::FindFile(const std::u16string& path) const {
+    if (!IsLoaded())
+        return INVALID_OFFSET;
+
+    size_t name_begin;
+    u32 parent = FindParentDirectory(path, name_begin);
+    if (parent == INVALID_OFFSET || name_begin == path.size())
+        return INVALID_OFFSET;
+
+    return FindChildFile(parent, &path[name_begin], path.size() - name_begin);
+}
+
+bool RomFSIndex::GetDirectory(u32 offset, RomFSDirectoryEntry& entry, std::u16string* name) const {
+    return GetTableEntry(directory_table, offset, entry, name);
+}
+
+bool RomFSIndex::GetFile(u32 offset, RomFSFileEntry& entry, std::u16string* name) const {
+    return GetTableEntry(file_table, offset, entry, name);
+}
+
+} // namespace FileSys
@@ -0,0 +1,139 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "common/common_types.h"
+
+#include "core/file_sys/file_backend.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// FileSys namespace
+
+namespace FileSys {
+
+// Structures of the level 3 (filesystem) partition of a RomFS, from http://3dbrew.org/wiki/RomFS
+
+struct RomFSHeader {
+    u32 header_length;
+    u32 directory_hash_table_offset;
+    u32 directory_hash_table_length;
+    u32 directory_table_offset;
+    u32 directory_table_length;
+    u32 file_hash_table_offset;
+    u32 file_hash_table_length;
+    u32 file_table_offset;
+    u32 file_table_length;
+    u32 file_data_offset;
+};
+static_assert(sizeof(RomFSHeader) == 0x28, "RomFS header isn't exactly 0x28 bytes long!");
+
+/// Entry of the directory table, followed by its UTF-16 name padded to 4 bytes
+struct RomFSDirectoryEntry {
+    u32 parent;
+    u32 next_sibling;
+    u32 first_child_directory;
+    u32 first_file;
+    u32 next_in_bucket;
+    u32 name_length; ///< Length of the name in bytes
+};
+static_assert(sizeof(RomFSDirectoryEntry) == 0x18, "RomFS directory entry isn't exactly 0x18 bytes long!");
+
+/// Entry of the file table, followed by its UTF-16 name padded to 4 bytes
+struct RomFSFileEntry {
+    u32 parent;
+    u32 next_sibling;
+    u64 data_offset; ///< Offset of the file data, relative to the file data region
+    u64 data_size;
+    u32 next_in_bucket;
+    u32 name_length; ///< Length of the name in bytes
+};
+static_assert(sizeof(RomFSFileEntry) == 0x20, "RomFS file entry isn't exactly 0x20 bytes long!");
+
+/**
+ * Index of the directories and files of a RomFS. The directory and file tables are copied in memory
+ * when loading, and paths are resolved through the hash buckets of the tables, as the 3DS does.
+ * Directories and files are identified by the offset of their entry in their respective table.
+ */
+class RomFSIndex {
+public:
+    /// Offset used by the tables to mark the end of a list
+    static const u32 INVALID_OFFSET = 0xFFFFFFFF;
+    /// Offset of the root directory in the directory table
+    static const u32 ROOT_DIRECTORY = 0;
+
+    RomFSIndex() : file_data_offset(0) {}
+
+    /**
+     * Reads the directory and file tables of a RomFS
+     * @param romfs File containing the level 3 partition of the RomFS
+     * @return true if the tables were read and appear valid
+     */
+    bool Load(const FileBackend& romfs);
+
+    /// Returns true if the tables have been loaded
+    bool IsLoaded() const { return !directory_table.empty(); }
+
+    /**
+     * Resolves a path to a directory
+     * @param path Path relative to the root of the RomFS, components separated by '/'
+     * @return Offset of the directory entry, or INVALID_OFFSET if it doesn't exist
+     */
+    u32 FindDirectory(const std::u16string& path) const;
+
+    /**
+     * Resolves a path to a file
+     * @param path Path relative to the root of the RomFS, components separated by '/'
+     * @return Offset of the file entry, or INVALID_OFFSET if it doesn't exist
+     */
+    u32 FindFile(const std::u16string& path) const;
+
+    /**
+     * Gets a directory entry
+     * @param offset Offset of the entry in the directory table
+     * @param entry Receives the entry
+     * @param name If not null, receives the name of the directory
+     * @return true if the offset refers to a valid entry
+     */
+    bool GetDirectory(u32 offset, RomFSDirectoryEntry& entry, std::u16string* name = nullptr) const;
+
+    /**
+     * Gets a file entry
+     * @param offset Offset of the entry in the file table
+     * @param entry Receives the entry
+     * @param name If not null, receives the name of the file
+     * @return true if the offset refers to a valid entry
+     */
+    bool GetFile(u32 offset, RomFSFileEntry& entry, std::u16string* name = nullptr) const;
+
+    /// Returns the offset of the data of a file from the start of the RomFS
+    u64 GetFileDataOffset(const RomFSFileEntry& file) const {
+        return file_data_offset + file.data_offset;
+    }
+
+private:
+    /**
+     * Resolves all components but the last of a path
+     * @param path Path to resolve
+     * @param name_begin Receives the position of the last component in the path
+     * @return Offset of the parent directory of the last component, or INVALID_OFFSET
+     */
+    u32 FindParentDirectory(const std::u16string& path, size_t& name_begin) const;
+
+    /// Looks up a subdirectory by name in the directory hash table
+    u32 FindChildDirectory(u32 parent, const char16_t* name, size_t name_length) const;
+    /// Looks up a file by name in the file hash table
+    u32 FindChildFile(u32 parent, const char16_t* name, size_t name_length) const;
+
+    std::vector<u32> directory_hash_table;
+    std::vector<u8> directory_table;
+    std::vector<u32> file_hash_table;
+    std::vector<u8> file_table;
+    u64 file_data_offset;
+};
+
+} // namespace FileSys
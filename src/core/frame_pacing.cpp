@@ -0,0 +1,117 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+#include "common/common.h"
+#include "common/profiler.h"
+#include "common/string_util.h"
+#include "common/trace.h"
+
+#include "core/frame_pacing.h"
+
+namespace FramePacing {
+
+using Common::Profiling::TicksToNanoseconds;
+
+// Frames are added from the emulation thread, the statistics are read from the frontend's
+static std::mutex mutex;
+static u32 refresh_rate = 60;
+static u64 num_frames = 0;
+static u64 last_vblank_ticks = 0;
+static u64 pending_swap_ticks = 0;      ///< Time spent in SwapBuffers during the current frame
+
+// Ring buffers of the durations of the recent frames, and of the time spent presenting them
+static std::array<u64, HISTORY_LENGTH> frame_ticks;
+static std::array<u64, HISTORY_LENGTH> swap_ticks;
+static size_t history_size = 0;
+static size_t next_frame = 0;
+
+void Reset(u32 rate) {
+    std::lock_guard<std::mutex> lock(mutex);
+    refresh_rate = std::max<u32>(rate, 1);
+    num_frames = 0;
+    last_vblank_ticks = 0;
+    pending_swap_ticks = 0;
+    history_size = 0;
+    next_frame = 0;
+}
+
+void OnVBlank() {
+    const u64 now = Common::Profiling::GetTicks();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (last_vblank_ticks != 0) {
+        frame_ticks[next_frame] = now - last_vblank_ticks;
+        swap_ticks[next_frame] = pending_swap_ticks;
+        next_frame = (next_frame + 1) % HISTORY_LENGTH;
+        history_size = std::min(history_size + 1, HISTORY_LENGTH);
+
+        if (Common::Trace::IsRecording()) {
+            Common::Trace::AddEvent(Common::Trace::Track::Frames, "Frame", last_vblank_ticks, now,
+                                    num_frames);
+        }
+        ++num_frames;
+    }
+    last_vblank_ticks = now;
+    pending_swap_ticks = 0;
+}
+
+void OnSwapBuffers(u64 start_ticks, u64 end_ticks) {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending_swap_ticks += end_ticks - start_ticks;
+}
+
+/// Gets the value under which the given fraction of the sorted values are
+static double Percentile(const std::vector<double>& sorted_values, double fraction) {
+    const size_t rank = (size_t)std::ceil(fraction * sorted_values.size());
+    return sorted_values[std::max<size_t>(rank, 1) - 1];
+}
+
+Stats GetStats() {
+    Stats stats = {};
+    std::vector<double> frame_times_ms;
+    u64 total_frame_ticks = 0, total_swap_ticks = 0;
+    u32 rate;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.num_frames = num_frames;
+        rate = refresh_rate;
+        for (size_t i = 0; i < history_size; ++i) {
+            frame_times_ms.push_back(TicksToNanoseconds(frame_ticks[i]) / 1e6);
+            total_frame_ticks += frame_ticks[i];
+            total_swap_ticks += swap_ticks[i];
+        }
+    }
+
+    if (frame_times_ms.empty())
+        return stats;
+
+    const double seconds = TicksToNanoseconds(total_frame_ticks) / 1e9;
+    stats.num_recent_frames = (u32)frame_times_ms.size();
+    stats.fps = seconds > 0 ? frame_times_ms.size() / seconds : 0.0;
+    stats.emulation_speed = stats.fps / rate;
+    stats.frame_time_avg_ms = seconds * 1e3 / frame_times_ms.size();
+    stats.swap_time_avg_ms = TicksToNanoseconds(total_swap_ticks) / 1e6 / frame_times_ms.size();
+
+    std::sort(frame_times_ms.begin(), frame_times_ms.end());
+    stats.frame_time_p50_ms = Percentile(frame_times_ms, 0.5);
+    stats.frame_time_p90_ms = Percentile(frame_times_ms, 0.9);
+    stats.frame_time_p99_ms = Percentile(frame_times_ms, 0.99);
+    stats.frame_time_max_ms = frame_times_ms.back();
+    return stats;
+}
+
+std::string FormatStats(const Stats& stats) {
+    return Common::StringFromFormat("%.1f fps (%.0f%%) | frame %.1f ms, p99 %.1f ms, max %.1f ms",
+                                    stats.fps, stats.emulation_speed * 100,
+                                    stats.frame_time_avg_ms, stats.frame_time_p99_ms,
+                                    stats.frame_time_max_ms);
+}
+
+} // namespace
@@ -0,0 +1,57 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <string>
+
+#include "common/common_types.h"
+
+/**
+ * Frame pacing statistics: the host time at which each emulated frame starts (at VBlank) and the
+ * time spent presenting it (SwapBuffers), from which the framerate, the emulation speed and the
+ * distribution of frame times over the last HISTORY_LENGTH frames are computed. Frames are also
+ * added to the Frames track of Common::Trace while it records.
+ */
+namespace FramePacing {
+
+/// Number of recent frames the statistics are computed over
+const size_t HISTORY_LENGTH = 600;
+
+struct Stats {
+    u64 num_frames;             ///< Frames since Reset
+    u32 num_recent_frames;      ///< Frames the following statistics are computed over
+    double fps;                 ///< Frames per host second
+    double emulation_speed;     ///< Emulated time per host time, 1.0 being full speed
+    double frame_time_avg_ms;
+    double frame_time_p50_ms;
+    double frame_time_p90_ms;
+    double frame_time_p99_ms;
+    double frame_time_max_ms;
+    double swap_time_avg_ms;    ///< Time spent in SwapBuffers per frame
+};
+
+/**
+ * Forgets all frames
+ * @param refresh_rate Emulated frames per second at full speed
+ */
+void Reset(u32 refresh_rate);
+
+/// Called at each emulated VBlank, when a frame starts
+void OnVBlank();
+
+/**
+ * Called after a frame was presented
+ * @param start_ticks Time at which SwapBuffers was called, from Common::Profiling::GetTicks
+ * @param end_ticks Time at which SwapBuffers returned, from Common::Profiling::GetTicks
+ */
+void OnSwapBuffers(u64 start_ticks, u64 end_ticks);
+
+/// Gets the statistics of the recent frames, can be called from any thread
+Stats GetStats();
+
+/// Formats statistics as a short line, e.g. for a window title
+std::string FormatStats(const Stats& stats);
+
+} // namespace
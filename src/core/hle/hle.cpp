@@ -2,10 +2,13 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
-#include <vector>
+#include "common/file_util.h"
+#include "common/trace.h"
 
 #include "core/mem_map.h"
 #include "core/hle/hle.h"
+#include "core/hle/profiler.h"
+#include "core/hle/svc.h"
 #include "core/hle/kernel/thread.h"
 #include "core/hle/service/service.h"
 #include "core/hle/service/fs/archive.h"
@@ -15,29 +18,26 @@
 
 namespace HLE {
 
-static std::vector<ModuleDef> g_module_db;
-
 bool g_reschedule = false;  ///< If true, immediately reschedules the CPU to a new thread
 
-const FunctionDef* GetSVCInfo(u32 opcode) {
-    u32 func_num = opcode & 0xFFFFFF; // 8 bits
-    if (func_num > 0xFF) {
-        LOG_ERROR(Kernel_SVC,"unknown svc=0x%02X", func_num);
-        return nullptr;
-    }
-    return &g_module_db[0].func_table[func_num];
+const char* GetSVCName(u32 svc) {
+    return (svc < SVC::NUM_SVCS) ? SVC::SVC_Table[svc].name : "Unknown";
 }
 
-void CallSVC(u32 opcode) {
-    const FunctionDef *info = GetSVCInfo(opcode);
-
-    if (!info) {
+void CallSVC(u32 svc, u32* regs) {
+    if (svc >= SVC::NUM_SVCS) {
+        LOG_ERROR(Kernel_SVC, "unknown svc=0x%02X", svc);
         return;
     }
-    if (info->func) {
-        info->func();
+
+    const FunctionDef& info = SVC::SVC_Table[svc];
+    if (info.func) {
+        PROFILE_SCOPE(Profiler::g_svc_stats[svc]);
+        PROFILE_SUBSYSTEM(SVC);
+        TRACE_SCOPE(HLE, info.name);
+        info.func(regs);
     } else {
-        LOG_ERROR(Kernel_SVC, "unimplemented SVC function %s(..)", info->name.c_str());
+        LOG_ERROR(Kernel_SVC, "unimplemented SVC function %s(..)", info.name);
     }
 }
 
@@ -47,32 +47,25 @@ void Reschedule(const char *reason) {
     g_reschedule = true;
 }
 
-void RegisterModule(std::string name, int num_functions, const FunctionDef* func_table) {
-    ModuleDef module = {name, num_functions, func_table};
-    g_module_db.push_back(module);
-}
-
-void RegisterAllModules() {
-    SVC::Register();
-}
-
 void Init() {
     Service::Init();
     Service::FS::ArchiveInit();
     Service::CFG::CFGInit();
 
-    RegisterAllModules();
-
     LOG_DEBUG(Kernel, "initialized OK");
 }
 
 void Shutdown() {
+    if (Common::Profiling::IS_ENABLED) {
+        const std::string& logs_dir = FileUtil::GetUserPath(D_LOGS_IDX);
+        FileUtil::CreateFullPath(logs_dir);
+        Profiler::Dump(logs_dir + HLE_PROFILE);
+    }
+
     Service::CFG::CFGShutdown();
     Service::FS::ArchiveShutdown();
     Service::Shutdown();
 
-    g_module_db.clear();
-
     LOG_DEBUG(Kernel, "shutdown OK");
 }
 
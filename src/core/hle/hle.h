@@ -14,23 +14,29 @@ namespace HLE {
 extern bool g_reschedule;   ///< If true, immediately reschedules the CPU to a new thread
 
 typedef u32 Addr;
-typedef void (*Func)();
+
+/// HLE function handler, receives the register file of the CPU core that called it
+typedef void (*Func)(u32* regs);
 
 struct FunctionDef {
     u32                 id;
     Func                func;
-    std::string         name;
-};
-
-struct ModuleDef {
-    std::string         name;
-    int                 num_funcs;
-    const FunctionDef*  func_table;
+    const char*         name;
 };
 
-void RegisterModule(std::string name, int num_functions, const FunctionDef *func_table);
-
-void CallSVC(u32 opcode);
+/**
+ * Gets the name of an SVC
+ * @param svc SVC number
+ * @return Name of the SVC, "Unknown" if it isn't a known SVC
+ */
+const char* GetSVCName(u32 svc);
+
+/**
+ * Executes an SVC
+ * @param svc SVC number, as encoded in the immediate of the SVC instruction
+ * @param regs Register file of the calling CPU core, used to pass arguments and results
+ */
+void CallSVC(u32 svc, u32* regs);
 
 void Reschedule(const char *reason);
 
@@ -3,6 +3,7 @@
 // Refer to the license.txt file included.
 
 #include "common/common_types.h"
+#include "common/chunk_file.h"
 
 #include "core/mem_map.h"
 
@@ -24,6 +25,10 @@ public:
     Kernel::HandleType GetHandleType() const override { return HandleType::AddressArbiter; }
 
     std::string name;   ///< Name of address arbiter object (optional)
+
+    void DoState(PointerWrap& p) override {
+        p.Do(name);
+    }
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -62,7 +67,7 @@ ResultCode ArbitrateAddress(Handle handle, ArbitrationType type, u32 address, s3
 /// Create an address arbiter
 AddressArbiter* CreateAddressArbiter(Handle& handle, const std::string& name) {
     AddressArbiter* address_arbiter = new AddressArbiter;
-    handle = Kernel::g_object_pool.Create(address_arbiter);
+    handle = Kernel::g_handle_table.Create(address_arbiter);
     address_arbiter->name = name;
     return address_arbiter;
 }
@@ -74,4 +79,8 @@ Handle CreateAddressArbiter(const std::string& name) {
     return handle;
 }
 
+Object* CreateEmptyAddressArbiter() {
+    return new AddressArbiter;
+}
+
 } // namespace Kernel
@@ -33,4 +33,7 @@ ResultCode ArbitrateAddress(Handle handle, ArbitrationType type, u32 address, s3
 /// Create an address arbiter
 Handle CreateAddressArbiter(const std::string& name = "Unknown");
 
+/// Creates an address arbiter without a handle, to load its state from a savestate
+Object* CreateEmptyAddressArbiter();
+
 } // namespace FileSys
@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "common/common.h"
+#include "common/chunk_file.h"
 
 #include "core/hle/kernel/kernel.h"
 #include "core/hle/kernel/event.h"
@@ -44,6 +45,15 @@ public:
         }
         return MakeResult<bool>(wait);
     }
+
+    void DoState(PointerWrap& p) override {
+        p.Do(intitial_reset_type);
+        p.Do(reset_type);
+        p.Do(locked);
+        p.Do(permanent_locked);
+        p.Do(waiting_threads);
+        p.Do(name);
+    }
 };
 
 /**
@@ -53,7 +63,7 @@ public:
  * @return Result of operation, 0 on success, otherwise error code
  */
 ResultCode SetPermanentLock(Handle handle, const bool permanent_locked) {
-    Event* evt = g_object_pool.Get<Event>(handle);
+    Event* evt = g_handle_table.Get<Event>(handle);
     if (evt == nullptr) return InvalidHandle(ErrorModule::Kernel);
 
     evt->permanent_locked = permanent_locked;
@@ -67,7 +77,7 @@ ResultCode SetPermanentLock(Handle handle, const bool permanent_locked) {
  * @return Result of operation, 0 on success, otherwise error code
  */
 ResultCode SetEventLocked(const Handle handle, const bool locked) {
-    Event* evt = g_object_pool.Get<Event>(handle);
+    Event* evt = g_handle_table.Get<Event>(handle);
     if (evt == nullptr) return InvalidHandle(ErrorModule::Kernel);
 
     if (!evt->permanent_locked) {
@@ -82,7 +92,7 @@ ResultCode SetEventLocked(const Handle handle, const bool locked) {
  * @return Result of operation, 0 on success, otherwise error code
  */
 ResultCode SignalEvent(const Handle handle) {
-    Event* evt = g_object_pool.Get<Event>(handle);
+    Event* evt = g_handle_table.Get<Event>(handle);
     if (evt == nullptr) return InvalidHandle(ErrorModule::Kernel);
 
     // Resume threads waiting for event to signal
@@ -110,7 +120,7 @@ ResultCode SignalEvent(const Handle handle) {
  * @return Result of operation, 0 on success, otherwise error code
  */
 ResultCode ClearEvent(Handle handle) {
-    Event* evt = g_object_pool.Get<Event>(handle);
+    Event* evt = g_handle_table.Get<Event>(handle);
     if (evt == nullptr) return InvalidHandle(ErrorModule::Kernel);
 
     if (!evt->permanent_locked) {
@@ -129,7 +139,7 @@ ResultCode ClearEvent(Handle handle) {
 Event* CreateEvent(Handle& handle, const ResetType reset_type, const std::string& name) {
     Event* evt = new Event;
 
-    handle = Kernel::g_object_pool.Create(evt);
+    handle = Kernel::g_handle_table.Create(evt);
 
     evt->locked = true;
     evt->permanent_locked = false;
@@ -151,4 +161,8 @@ Handle CreateEvent(const ResetType reset_type, const std::string& name) {
     return handle;
 }
 
+Object* CreateEmptyEvent() {
+    return new Event;
+}
+
 } // namespace
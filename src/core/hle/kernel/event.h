@@ -45,4 +45,7 @@ ResultCode ClearEvent(Handle handle);
  */
 Handle CreateEvent(const ResetType reset_type, const std::string& name="Unknown");
 
+/// Creates an event without a handle, to load its state from a savestate
+Object* CreateEmptyEvent();
+
 } // namespace
@@ -3,99 +3,231 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <map>
 
 #include "common/common.h"
+#include "common/chunk_file.h"
 
 #include "core/core.h"
+#include "core/hle/kernel/address_arbiter.h"
+#include "core/hle/kernel/event.h"
 #include "core/hle/kernel/kernel.h"
+#include "core/hle/kernel/mutex.h"
+#include "core/hle/kernel/semaphore.h"
+#include "core/hle/kernel/shared_memory.h"
 #include "core/hle/kernel/thread.h"
 
 namespace Kernel {
 
 Handle g_main_thread = 0;
-ObjectPool g_object_pool;
+HandleTable g_handle_table;
 u64 g_program_id = 0;
 
-ObjectPool::ObjectPool() {
-    next_id = INITIAL_NEXT_ID;
+static std::map<std::string, ObjectFactory> object_factories;
+
+void RegisterObjectFactory(const std::string& type_name, ObjectFactory factory) {
+    object_factories[type_name] = factory;
 }
 
-Handle ObjectPool::Create(Object* obj, int range_bottom, int range_top) {
-    if (range_top > MAX_COUNT) {
-        range_top = MAX_COUNT;
-    }
-    if (next_id >= range_bottom && next_id < range_top) {
-        range_bottom = next_id++;
-    }
-    for (int i = range_bottom; i < range_top; i++) {
-        if (!occupied[i]) {
-            occupied[i] = true;
-            pool[i] = obj;
-            pool[i]->handle = i + HANDLE_OFFSET;
-            return i + HANDLE_OFFSET;
-        }
+HandleTable::HandleTable() {
+    Clear();
+}
+
+Handle HandleTable::Create(Object* obj) {
+    if (next_free_slot == NO_FREE_SLOT && !Grow()) {
+        LOG_ERROR(Kernel, "Unable to allocate kernel object, too many objects slots in use.");
+        return 0;
     }
-    LOG_ERROR(Kernel, "Unable to allocate kernel object, too many objects slots in use.");
-    return 0;
+
+    const u16 slot = next_free_slot;
+    Entry& entry = entries[slot];
+    next_free_slot = entry.next_free;
+
+    entry.object = obj;
+    entry.type = obj->GetHandleType();
+    ++num_used;
+
+    obj->handle = (entry.generation << SLOT_BITS) | slot;
+    return obj->handle;
 }
 
-bool ObjectPool::IsValid(Handle handle) const {
-    int index = handle - HANDLE_OFFSET;
-    if (index < 0)
-        return false;
-    if (index >= MAX_COUNT)
+bool HandleTable::Grow() {
+    const size_t old_size = entries.size();
+    if (old_size >= MAX_COUNT) {
         return false;
+    }
+    const size_t new_size = std::min<size_t>(std::max<size_t>(old_size * 2, INITIAL_COUNT), MAX_COUNT);
+
+    entries.resize(new_size);
+    for (size_t i = old_size; i < new_size; ++i) {
+        entries[i].object = nullptr;
+        entries[i].type = HandleType::Unknown;
+        entries[i].generation = 1;
+        entries[i].next_free = static_cast<u16>(i + 1);
+    }
+    entries[new_size - 1].next_free = next_free_slot;
+    next_free_slot = static_cast<u16>(old_size);
+    return true;
+}
 
-    return occupied[index];
+void HandleTable::Release(u16 slot) {
+    Entry& entry = entries[slot];
+    entry.object = nullptr;
+    entry.type = HandleType::Unknown;
+    entry.generation = (entry.generation + 1) & GENERATION_MASK;
+    if (entry.generation == 0) {
+        entry.generation = 1;
+    }
+    entry.next_free = next_free_slot;
+    next_free_slot = slot;
+    --num_used;
 }
 
-void ObjectPool::Clear() {
-    for (int i = 0; i < MAX_COUNT; i++) {
+void HandleTable::Clear() {
+    for (const Entry& entry : entries) {
         //brutally clear everything, no validation
-        if (occupied[i])
-            delete pool[i];
-        occupied[i] = false;
+        delete entry.object;
     }
-    pool.fill(nullptr);
-    next_id = INITIAL_NEXT_ID;
+    entries.clear();
+    next_free_slot = NO_FREE_SLOT;
+    num_used = 0;
+    Grow();
 }
 
-Object* &ObjectPool::operator [](Handle handle)
-{
-    _dbg_assert_msg_(Kernel, IsValid(handle), "GRABBING UNALLOCED KERNEL OBJ");
-    return pool[handle - HANDLE_OFFSET];
+void HandleTable::List() {
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (entries[i].object != nullptr) {
+            LOG_DEBUG(Kernel, "KO %08x: %s \"%s\"", entries[i].object->GetHandle(),
+                entries[i].object->GetTypeName().c_str(), entries[i].object->GetName().c_str());
+        }
+    }
 }
 
-void ObjectPool::List() {
-    for (int i = 0; i < MAX_COUNT; i++) {
-        if (occupied[i]) {
-            if (pool[i]) {
-                LOG_DEBUG(Kernel, "KO %i: %s \"%s\"", i + HANDLE_OFFSET, pool[i]->GetTypeName().c_str(),
-                    pool[i]->GetName().c_str());
+void HandleTable::DoState(PointerWrap& p) {
+    auto s = p.Section("HandleTable", 1);
+    if (!s)
+        return;
+
+    // Every slot is saved, free ones included, so that the free list and the generations, and thus
+    // the handles allocated after loading, are the same as when saving
+    u32 num_entries = (u32)entries.size();
+    p.Do(num_entries);
+    if (num_entries == 0 || num_entries > MAX_COUNT) {
+        LOG_ERROR(Kernel, "Savestate error: invalid handle table size %u", num_entries);
+        p.SetError(PointerWrap::ERROR_FAILURE);
+        return;
+    }
+
+    std::vector<Entry> new_entries(num_entries);
+    std::vector<std::string> type_names(num_entries);
+    std::vector<std::string> names(num_entries);
+    for (u32 i = 0; i < num_entries; ++i) {
+        Entry& entry = (p.GetMode() == PointerWrap::MODE_READ) ? new_entries[i] : entries[i];
+        p.Do(entry.generation);
+        p.Do(entry.next_free);
+
+        bool used = entry.object != nullptr;
+        p.Do(used);
+        if (used) {
+            if (p.GetMode() != PointerWrap::MODE_READ) {
+                type_names[i] = entry.object->GetTypeName();
+                names[i] = entry.object->GetName();
             }
+            p.Do(type_names[i]);
+            p.Do(names[i]);
         }
     }
-}
 
-int ObjectPool::GetCount() const {
-    return std::count(occupied.begin(), occupied.end(), true);
-}
+    u16 new_next_free_slot = next_free_slot;
+    int new_num_used = num_used;
+    p.Do(new_next_free_slot);
+    p.Do(new_num_used);
+
+    if (p.GetMode() == PointerWrap::MODE_READ) {
+        // Check that the objects which can't be recreated are where the state expects them before
+        // changing anything. A slot is kept as is if it holds one of them.
+        std::vector<bool> keep(std::max<size_t>(entries.size(), num_entries), false);
+        for (u32 i = 0; i < num_entries; ++i) {
+            if (type_names[i].empty() || object_factories.count(type_names[i]))
+                continue;
+
+            const Object* object = (i < entries.size()) ? entries[i].object : nullptr;
+            if (object == nullptr || entries[i].generation != new_entries[i].generation ||
+                object->GetTypeName() != type_names[i] || object->GetName() != names[i]) {
+                LOG_ERROR(Kernel, "Savestate error: %s \"%s\" (slot %u) doesn't exist",
+                          type_names[i].c_str(), names[i].c_str(), i);
+                p.SetError(PointerWrap::ERROR_FAILURE);
+                return;
+            }
+            keep[i] = true;
+        }
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const Object* object = entries[i].object;
+            if (object != nullptr && !keep[i] && !object_factories.count(object->GetTypeName())) {
+                LOG_ERROR(Kernel, "Savestate error: %s \"%s\" (slot %u) isn't in the state",
+                          object->GetTypeName().c_str(), object->GetName().c_str(), (u32)i);
+                p.SetError(PointerWrap::ERROR_FAILURE);
+                return;
+            }
+        }
+
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (!keep[i])
+                delete entries[i].object;
+        }
+        for (u32 i = 0; i < num_entries; ++i) {
+            Entry& entry = new_entries[i];
+            if (keep[i]) {
+                entry.object = entries[i].object;
+            } else if (!type_names[i].empty()) {
+                entry.object = object_factories[type_names[i]]();
+                entry.object->handle = (entry.generation << SLOT_BITS) | i;
+            } else {
+                entry.object = nullptr;
+            }
+            entry.type = entry.object ? entry.object->GetHandleType() : HandleType::Unknown;
+        }
 
-Object* ObjectPool::CreateByIDType(int type) {
-    LOG_ERROR(Kernel, "Unimplemented: %d.", type);
-    return nullptr;
+        entries.swap(new_entries);
+        next_free_slot = new_next_free_slot;
+        num_used = new_num_used;
+    }
+
+    for (const Entry& entry : entries) {
+        if (entry.object != nullptr)
+            entry.object->DoState(p);
+    }
 }
 
 /// Initialize the kernel
 void Init() {
     Kernel::ThreadingInit();
+
+    RegisterObjectFactory("Arbiter", CreateEmptyAddressArbiter);
+    RegisterObjectFactory("Event", CreateEmptyEvent);
+    RegisterObjectFactory("Mutex", CreateEmptyMutex);
+    RegisterObjectFactory("Semaphore", CreateEmptySemaphore);
+    RegisterObjectFactory("SharedMemory", CreateEmptySharedMemory);
+    RegisterObjectFactory("Thread", CreateEmptyThread);
 }
 
 /// Shutdown the kernel
 void Shutdown() {
     Kernel::ThreadingShutdown();
 
-    g_object_pool.Clear(); // Free all kernel objects
+    g_handle_table.Clear(); // Free all kernel objects
+}
+
+void DoState(PointerWrap& p) {
+    auto s = p.Section("Kernel", 1);
+    if (!s)
+        return;
+
+    p.Do(g_main_thread);
+    p.Do(g_program_id);
+    g_handle_table.DoState(p);
+    ThreadingDoState(p);
+    MutexDoState(p);
 }
 
 /**
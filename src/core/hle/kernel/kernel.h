@@ -6,12 +6,15 @@
 
 #include <array>
 #include <string>
+#include <vector>
 #include "common/common.h"
 #include "core/hle/result.h"
 
 typedef u32 Handle;
 typedef s32 Result;
 
+class PointerWrap;
+
 namespace Kernel {
 
 // From kernel.h. Declarations duplicated here to avoid a circular header dependency.
@@ -41,10 +44,10 @@ enum {
     DEFAULT_STACK_SIZE  = 0x4000,
 };
 
-class ObjectPool;
+class HandleTable;
 
 class Object : NonCopyable {
-    friend class ObjectPool;
+    friend class HandleTable;
     u32 handle;
 public:
     virtual ~Object() {}
@@ -61,106 +64,180 @@ public:
         LOG_ERROR(Kernel, "(UNIMPLEMENTED)");
         return UnimplementedFunction(ErrorModule::Kernel);
     }
+
+    /**
+     * Saves or loads the state of the object. When loading, objects of types with a registered
+     * factory are freshly created by it first, others are loaded in place.
+     */
+    virtual void DoState(PointerWrap& p) {}
 };
 
-class ObjectPool : NonCopyable {
-public:
-    ObjectPool();
-    ~ObjectPool() {}
+/// Creates an object in a default state, to be filled in by loading its state
+typedef Object* (*ObjectFactory)();
 
-    // Allocates a handle within the range and inserts the object into the map.
-    Handle Create(Object* obj, int range_bottom=INITIAL_NEXT_ID, int range_top=0x7FFFFFFF);
+/**
+ * Registers the factory of a type of object, used to recreate the objects of that type when
+ * loading a savestate. Objects of types without a factory (e.g. service sessions, which are created
+ * when the emulator starts) must already exist in the same slot when loading.
+ * @param type_name Name of the type, as returned by Object::GetTypeName
+ * @param factory Function creating an empty object of the type
+ */
+void RegisterObjectFactory(const std::string& type_name, ObjectFactory factory);
 
-    static Object* CreateByIDType(int type);
+/**
+ * This class allows the creation of Handles, which are references to objects that can be tested
+ * for validity and looked up. Here they are used to pass references to kernel objects to/from the
+ * emulated process.
+ *
+ * Handles are made up of two parts: the slot index in the table (low 15 bits) and a generation
+ * counter (the next 15 bits). The generation is incremented every time a slot is released, so a
+ * stale handle to a destroyed object is rejected instead of silently referring to whatever object
+ * reused its slot. Bits 30-31 are always clear, so handles never collide with the pseudo-handles
+ * in KernelHandle, and the generation is never 0, so a valid handle is never 0 either.
+ *
+ * Free slots are kept in an intrusive singly-linked list, making both allocation and release
+ * O(1). The table starts small and doubles in size as needed, up to MAX_COUNT entries. The type of
+ * each object is cached next to its pointer so that typed lookups don't need a virtual call.
+ *
+ * g_handle_table is the only instance until Process objects exist, at which point each process
+ * will own its own table.
+ */
+class HandleTable : NonCopyable {
+public:
+    HandleTable();
+    ~HandleTable() {}
 
+    /**
+     * Allocates a handle for the given object and stores the object in the table.
+     * @return The new handle, or 0 if the table is full
+     */
+    Handle Create(Object* obj);
+
+    /**
+     * Releases the handle and deletes the object it refers to, if the handle is valid and refers
+     * to an object of type T.
+     */
     template <class T>
     void Destroy(Handle handle) {
         if (Get<T>(handle)) {
-            occupied[handle - HANDLE_OFFSET] = false;
-            delete pool[handle - HANDLE_OFFSET];
+            const u16 slot = GetSlot(handle);
+            Object* object = entries[slot].object;
+            Release(slot);
+            delete object;
         }
     }
 
-    bool IsValid(Handle handle) const;
+    /// Checks if a handle refers to an object currently in the table
+    bool IsValid(Handle handle) const {
+        // Handles only use their low 30 bits, aliases such as CurrentProcess set the top ones
+        if ((handle >> (SLOT_BITS + GENERATION_BITS)) != 0)
+            return false;
+        const u16 slot = GetSlot(handle);
+        return slot < entries.size() && entries[slot].object != nullptr &&
+               entries[slot].generation == GetGeneration(handle);
+    }
 
+    /**
+     * Looks up a handle, checking that it refers to an object of type T.
+     * @return Pointer to the object, or nullptr if the handle is invalid or of the wrong type
+     */
     template <class T>
     T* Get(Handle handle) {
         if (handle == CurrentThread) {
             return reinterpret_cast<T*>(GetCurrentThread());
         }
 
-        if (handle < HANDLE_OFFSET || handle >= HANDLE_OFFSET + MAX_COUNT || !occupied[handle - HANDLE_OFFSET]) {
+        if (!IsValid(handle)) {
             if (handle != 0) {
                 LOG_ERROR(Kernel, "Bad object handle %08x", handle);
             }
             return nullptr;
-        } else {
-            Object* t = pool[handle - HANDLE_OFFSET];
-            if (t->GetHandleType() != T::GetStaticHandleType()) {
-                LOG_ERROR(Kernel, "Wrong object type for %08x", handle);
-                return nullptr;
-            }
-            return static_cast<T*>(t);
         }
+
+        const Entry& entry = entries[GetSlot(handle)];
+        if (entry.type != T::GetStaticHandleType()) {
+            LOG_ERROR(Kernel, "Wrong object type for %08x", handle);
+            return nullptr;
+        }
+        return static_cast<T*>(entry.object);
     }
 
     // ONLY use this when you know the handle is valid.
     template <class T>
-    T *GetFast(Handle handle) {
+    T* GetFast(Handle handle) {
         if (handle == CurrentThread) {
             return reinterpret_cast<T*>(GetCurrentThread());
         }
 
-        const Handle realHandle = handle - HANDLE_OFFSET;
-        _dbg_assert_(Kernel, realHandle >= 0 && realHandle < MAX_COUNT && occupied[realHandle]);
-        return static_cast<T*>(pool[realHandle]);
+        _dbg_assert_(Kernel, IsValid(handle));
+        return static_cast<T*>(entries[GetSlot(handle)].object);
     }
 
-    template <class T, typename ArgT>
-    void Iterate(bool func(T*, ArgT), ArgT arg) {
-        int type = T::GetStaticIDType();
-        for (int i = 0; i < MAX_COUNT; i++)
-        {
-            if (!occupied[i])
-                continue;
-            T* t = static_cast<T*>(pool[i]);
-            if (t->GetIDType() == type) {
-                if (!func(t, arg))
-                    break;
-            }
-        }
+    /**
+     * Looks up a handle without checking the type of the object it refers to.
+     * @return Pointer to the object, or nullptr if the handle is invalid
+     */
+    Object* GetGeneric(Handle handle) const {
+        return IsValid(handle) ? entries[GetSlot(handle)].object : nullptr;
     }
 
-    bool GetIDType(Handle handle, HandleType* type) const {
-        if ((handle < HANDLE_OFFSET) || (handle >= HANDLE_OFFSET + MAX_COUNT) ||
-                !occupied[handle - HANDLE_OFFSET]) {
+    /**
+     * Gets the type of the object referred to by a handle.
+     * @return False if the handle is invalid
+     */
+    bool GetHandleType(Handle handle, HandleType* type) const {
+        if (!IsValid(handle)) {
             LOG_ERROR(Kernel, "Bad object handle %08X", handle);
             return false;
         }
-        Object* t = pool[handle - HANDLE_OFFSET];
-        *type = t->GetHandleType();
+        *type = entries[GetSlot(handle)].type;
         return true;
     }
 
-    Object* &operator [](Handle handle);
     void List();
     void Clear();
-    int GetCount() const;
+    int GetCount() const { return num_used; }
+
+    /**
+     * Saves or loads the table along with the state of all the objects in it. Nothing is changed
+     * if the state doesn't match the objects that can't be recreated.
+     */
+    void DoState(PointerWrap& p);
 
 private:
 
     enum {
-        MAX_COUNT       = 0x1000,
-        HANDLE_OFFSET   = 0x100,
-        INITIAL_NEXT_ID = 0x10,
+        MAX_COUNT       = 0x8000, ///< Maximum number of slots, limited by the 15-bit index
+        INITIAL_COUNT   = 0x100,  ///< Number of slots allocated when the table is created
+        SLOT_BITS       = 15,
+        SLOT_MASK       = (1 << SLOT_BITS) - 1,
+        GENERATION_BITS = 15,
+        GENERATION_MASK = (1 << GENERATION_BITS) - 1,
+        NO_FREE_SLOT    = 0xFFFF, ///< Terminator of the free slot list
+    };
+
+    struct Entry {
+        Object*    object;     ///< Object in this slot, nullptr if the slot is free
+        HandleType type;       ///< Cached result of object->GetHandleType()
+        u16        generation; ///< Generation of the handle currently using this slot
+        u16        next_free;  ///< Next slot in the free list, only meaningful for free slots
     };
 
-    std::array<Object*, MAX_COUNT> pool;
-    std::array<bool, MAX_COUNT> occupied;
-    int next_id;
+    static u16 GetSlot(Handle handle) { return handle & SLOT_MASK; }
+    static u16 GetGeneration(Handle handle) { return (handle >> SLOT_BITS) & GENERATION_MASK; }
+
+    /// Appends new free slots to the table, returns false if it is already at its maximum size
+    bool Grow();
+
+    /// Returns a slot to the free list and invalidates all outstanding handles to it
+    void Release(u16 slot);
+
+    std::vector<Entry> entries;
+    u16 next_free_slot; ///< Head of the free slot list
+    int num_used;
 };
 
-extern ObjectPool g_object_pool;
+extern HandleTable g_handle_table;
 extern Handle g_main_thread;
 
 /// The ID code of the currently running game
@@ -175,6 +252,9 @@ void Init();
 /// Shutdown the kernel
 void Shutdown();
 
+/// Saves or loads the state of the kernel: all the objects and the scheduler
+void DoState(PointerWrap& p);
+
 /**
  * Loads executable stored at specified address
  * @entry_point Entry point in memory of loaded executable
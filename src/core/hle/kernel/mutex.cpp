@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "common/common.h"
+#include "common/chunk_file.h"
 
 #include "core/hle/kernel/kernel.h"
 #include "core/hle/kernel/mutex.h"
@@ -28,6 +29,14 @@ public:
     std::string name;                           ///< Name of mutex (optional)
 
     ResultVal<bool> WaitSynchronization() override;
+
+    void DoState(PointerWrap& p) override {
+        p.Do(initial_locked);
+        p.Do(locked);
+        p.Do(lock_thread);
+        p.Do(waiting_threads);
+        p.Do(name);
+    }
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -87,7 +96,7 @@ void ReleaseThreadMutexes(Handle thread) {
     
     // Release every mutex that the thread holds, and resume execution on the waiting threads
     for (MutexMap::iterator iter = locked.first; iter != locked.second; ++iter) {
-        Mutex* mutex = g_object_pool.GetFast<Mutex>(iter->second);
+        Mutex* mutex = g_handle_table.GetFast<Mutex>(iter->second);
         ResumeWaitingThread(mutex);
     }
 
@@ -115,7 +124,7 @@ bool ReleaseMutex(Mutex* mutex) {
  * @param handle Handle to mutex to release
  */
 ResultCode ReleaseMutex(Handle handle) {
-    Mutex* mutex = Kernel::g_object_pool.Get<Mutex>(handle);
+    Mutex* mutex = Kernel::g_handle_table.Get<Mutex>(handle);
     if (mutex == nullptr) return InvalidHandle(ErrorModule::Kernel);
 
     if (!ReleaseMutex(mutex)) {
@@ -136,7 +145,7 @@ ResultCode ReleaseMutex(Handle handle) {
  */
 Mutex* CreateMutex(Handle& handle, bool initial_locked, const std::string& name) {
     Mutex* mutex = new Mutex;
-    handle = Kernel::g_object_pool.Create(mutex);
+    handle = Kernel::g_handle_table.Create(mutex);
 
     mutex->locked = mutex->initial_locked = initial_locked;
     mutex->name = name;
@@ -177,4 +186,17 @@ ResultVal<bool> Mutex::WaitSynchronization() {
 
     return MakeResult<bool>(wait);
 }
+
+Object* CreateEmptyMutex() {
+    return new Mutex;
+}
+
+void MutexDoState(PointerWrap& p) {
+    auto s = p.Section("Mutex", 1);
+    if (!s)
+        return;
+
+    p.Do(g_mutex_held_locks);
+}
+
 } // namespace
@@ -30,4 +30,10 @@ Handle CreateMutex(bool initial_locked, const std::string& name="Unknown");
  */
 void ReleaseThreadMutexes(Handle thread);
 
+/// Creates a mutex without a handle, to load its state from a savestate
+Object* CreateEmptyMutex();
+
+/// Saves or loads the mutexes held by each thread
+void MutexDoState(PointerWrap& p);
+
 } // namespace
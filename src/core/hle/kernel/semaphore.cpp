@@ -3,8 +3,10 @@
 // Refer to the license.txt file included.
 
 #include <queue>
+#include <vector>
 
 #include "common/common.h"
+#include "common/chunk_file.h"
 
 #include "core/hle/kernel/kernel.h"
 #include "core/hle/kernel/semaphore.h"
@@ -45,6 +47,25 @@ public:
 
         return MakeResult<bool>(wait);
     }
+
+    void DoState(PointerWrap& p) override {
+        p.Do(max_count);
+        p.Do(available_count);
+        p.Do(name);
+
+        // PointerWrap doesn't handle queues, go through a vector
+        std::vector<Handle> threads;
+        if (p.GetMode() != PointerWrap::MODE_READ) {
+            for (std::queue<Handle> copy = waiting_threads; !copy.empty(); copy.pop())
+                threads.push_back(copy.front());
+        }
+        p.Do(threads);
+        if (p.GetMode() == PointerWrap::MODE_READ) {
+            waiting_threads = std::queue<Handle>();
+            for (Handle thread : threads)
+                waiting_threads.push(thread);
+        }
+    }
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -57,7 +78,7 @@ ResultCode CreateSemaphore(Handle* handle, s32 initial_count,
                           ErrorSummary::WrongArgument, ErrorLevel::Permanent);
 
     Semaphore* semaphore = new Semaphore;
-    *handle = g_object_pool.Create(semaphore);
+    *handle = g_handle_table.Create(semaphore);
 
     // When the semaphore is created, some slots are reserved for other threads,
     // and the rest is reserved for the caller thread
@@ -69,7 +90,7 @@ ResultCode CreateSemaphore(Handle* handle, s32 initial_count,
 }
 
 ResultCode ReleaseSemaphore(s32* count, Handle handle, s32 release_count) {
-    Semaphore* semaphore = g_object_pool.Get<Semaphore>(handle);
+    Semaphore* semaphore = g_handle_table.Get<Semaphore>(handle);
     if (semaphore == nullptr)
         return InvalidHandle(ErrorModule::Kernel);
 
@@ -91,4 +112,8 @@ ResultCode ReleaseSemaphore(s32* count, Handle handle, s32 release_count) {
     return RESULT_SUCCESS;
 }
 
+Object* CreateEmptySemaphore() {
+    return new Semaphore;
+}
+
 } // namespace
@@ -29,4 +29,7 @@ ResultCode CreateSemaphore(Handle* handle, s32 initial_count, s32 max_count, con
  */
 ResultCode ReleaseSemaphore(s32* count, Handle handle, s32 release_count);
 
+/// Creates a semaphore without a handle, to load its state from a savestate
+Object* CreateEmptySemaphore();
+
 } // namespace
@@ -9,6 +9,7 @@
 namespace Kernel {
 
 static const int kCommandHeaderOffset = 0x80; ///< Offset into command buffer of header
+static const int kCommandBufferSize = 0x100;  ///< Size of the command buffer, in bytes
 
 /**
  * Returns a pointer to the command buffer in kernel memory
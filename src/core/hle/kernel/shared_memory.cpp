@@ -3,6 +3,7 @@
 // Refer to the license.txt file included.
 
 #include "common/common.h"
+#include "common/chunk_file.h"
 
 #include "core/mem_map.h"
 #include "core/hle/kernel/shared_memory.h"
@@ -20,6 +21,13 @@ public:
     MemoryPermission permissions;       ///< Permissions of shared memory block (SVC field)
     MemoryPermission other_permissions; ///< Other permissions of shared memory block (SVC field)
     std::string name;                   ///< Name of shared memory object (optional)
+
+    void DoState(PointerWrap& p) override {
+        p.Do(base_address);
+        p.Do(permissions);
+        p.Do(other_permissions);
+        p.Do(name);
+    }
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -32,7 +40,7 @@ public:
  */
 SharedMemory* CreateSharedMemory(Handle& handle, const std::string& name) {
     SharedMemory* shared_memory = new SharedMemory;
-    handle = Kernel::g_object_pool.Create(shared_memory);
+    handle = Kernel::g_handle_table.Create(shared_memory);
     shared_memory->name = name;
     return shared_memory;
 }
@@ -60,7 +68,7 @@ ResultCode MapSharedMemory(u32 handle, u32 address, MemoryPermission permissions
         return ResultCode(ErrorDescription::InvalidAddress, ErrorModule::Kernel,
                 ErrorSummary::InvalidArgument, ErrorLevel::Permanent);
     }
-    SharedMemory* shared_memory = Kernel::g_object_pool.Get<SharedMemory>(handle);
+    SharedMemory* shared_memory = Kernel::g_handle_table.Get<SharedMemory>(handle);
     if (shared_memory == nullptr) return InvalidHandle(ErrorModule::Kernel);
 
     shared_memory->base_address = address;
@@ -71,7 +79,7 @@ ResultCode MapSharedMemory(u32 handle, u32 address, MemoryPermission permissions
 }
 
 ResultVal<u8*> GetSharedMemoryPointer(Handle handle, u32 offset) {
-    SharedMemory* shared_memory = Kernel::g_object_pool.Get<SharedMemory>(handle);
+    SharedMemory* shared_memory = Kernel::g_handle_table.Get<SharedMemory>(handle);
     if (shared_memory == nullptr) return InvalidHandle(ErrorModule::Kernel);
 
     if (0 != shared_memory->base_address)
@@ -83,4 +91,8 @@ ResultVal<u8*> GetSharedMemoryPointer(Handle handle, u32 offset) {
             ErrorSummary::InvalidState, ErrorLevel::Permanent);
 }
 
+Object* CreateEmptySharedMemory() {
+    return new SharedMemory;
+}
+
 } // namespace
@@ -48,4 +48,7 @@ ResultCode MapSharedMemory(Handle handle, u32 address, MemoryPermission permissi
  */
 ResultVal<u8*> GetSharedMemoryPointer(Handle handle, u32 offset);
 
+/// Creates a shared memory object without a handle, to load its state from a savestate
+Object* CreateEmptySharedMemory();
+
 } // namespace
@@ -3,11 +3,13 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <array>
 #include <list>
 #include <map>
 #include <vector>
 
 #include "common/common.h"
+#include "common/chunk_file.h"
 #include "common/thread_queue_list.h"
 
 #include "core/core.h"
@@ -15,6 +17,7 @@
 #include "core/hle/kernel/kernel.h"
 #include "core/hle/kernel/thread.h"
 #include "core/hle/kernel/mutex.h"
+#include "core/hle/kernel/session.h"
 #include "core/hle/result.h"
 #include "core/mem_map.h"
 
@@ -48,7 +51,26 @@ public:
         return MakeResult<bool>(wait);
     }
 
+    void DoState(PointerWrap& p) override {
+        p.Do(context);
+        p.Do(command_buffer);
+        p.Do(thread_id);
+        p.Do(status);
+        p.Do(entry_point);
+        p.Do(stack_top);
+        p.Do(stack_size);
+        p.Do(initial_priority);
+        p.Do(current_priority);
+        p.Do(processor_id);
+        p.Do(wait_type);
+        p.Do(wait_handle);
+        p.Do(wait_address);
+        p.Do(waiting_threads);
+        p.Do(name);
+    }
+
     ThreadContext context;
+    std::array<u32, kCommandBufferSize / sizeof(u32)> command_buffer; ///< Saved IPC command buffer
 
     u32 thread_id;
 
@@ -111,6 +133,7 @@ void LoadContext(ThreadContext& ctx) {
 /// Resets a thread
 void ResetThread(Thread* t, u32 arg, s32 lowest_priority) {
     memset(&t->context, 0, sizeof(ThreadContext));
+    t->command_buffer.fill(0);
 
     t->context.cpu_registers[0] = arg;
     t->context.pc = t->context.reg_15 = t->entry_point;
@@ -164,7 +187,7 @@ static bool CheckWaitType(const Thread* thread, WaitType type, Handle wait_handl
 
 /// Stops the current thread
 ResultCode StopThread(Handle handle, const char* reason) {
-    Thread* thread = g_object_pool.Get<Thread>(handle);
+    Thread* thread = g_handle_table.Get<Thread>(handle);
     if (thread == nullptr) return InvalidHandle(ErrorModule::Kernel);
 
     // Release all the mutexes that this thread holds
@@ -173,7 +196,7 @@ ResultCode StopThread(Handle handle, const char* reason) {
     ChangeReadyState(thread, false);
     thread->status = THREADSTATUS_DORMANT;
     for (Handle waiting_handle : thread->waiting_threads) {
-        Thread* waiting_thread = g_object_pool.Get<Thread>(waiting_handle);
+        Thread* waiting_thread = g_handle_table.Get<Thread>(waiting_handle);
 
         if (CheckWaitType(waiting_thread, WAITTYPE_THREADEND, handle))
             ResumeThreadFromWait(waiting_handle);
@@ -210,7 +233,7 @@ Handle ArbitrateHighestPriorityThread(u32 arbiter, u32 address) {
 
     // Iterate through threads, find highest priority thread that is waiting to be arbitrated...
     for (Handle handle : thread_queue) {
-        Thread* thread = g_object_pool.Get<Thread>(handle);
+        Thread* thread = g_handle_table.Get<Thread>(handle);
 
         if (!CheckWaitType(thread, WAITTYPE_ARB, arbiter, address))
             continue;
@@ -235,7 +258,7 @@ void ArbitrateAllThreads(u32 arbiter, u32 address) {
 
     // Iterate through threads, find highest priority thread that is waiting to be arbitrated...
     for (Handle handle : thread_queue) {
-        Thread* thread = g_object_pool.Get<Thread>(handle);
+        Thread* thread = g_handle_table.Get<Thread>(handle);
 
         if (CheckWaitType(thread, WAITTYPE_ARB, arbiter, address))
             ResumeThreadFromWait(handle);
@@ -258,6 +281,7 @@ void SwitchContext(Thread* t) {
     // Save context for current thread
     if (cur) {
         SaveContext(cur->context);
+        memcpy(cur->command_buffer.data(), GetCommandBuffer(), kCommandBufferSize);
 
         if (cur->IsRunning()) {
             ChangeReadyState(cur, true);
@@ -270,6 +294,7 @@ void SwitchContext(Thread* t) {
         t->status = (t->status | THREADSTATUS_RUNNING) & ~THREADSTATUS_READY;
         t->wait_type = WAITTYPE_NONE;
         LoadContext(t->context);
+        memcpy(GetCommandBuffer(), t->command_buffer.data(), kCommandBufferSize);
     } else {
         SetCurrentThread(nullptr);
     }
@@ -288,7 +313,7 @@ Thread* NextThread() {
     if (next == 0) {
         return nullptr;
     }
-    return Kernel::g_object_pool.Get<Thread>(next);
+    return Kernel::g_handle_table.Get<Thread>(next);
 }
 
 void WaitCurrentThread(WaitType wait_type, Handle wait_handle) {
@@ -303,9 +328,23 @@ void WaitCurrentThread(WaitType wait_type, Handle wait_handle, VAddr wait_addres
     GetCurrentThread()->wait_address = wait_address;
 }
 
+u32* GetThreadCommandBuffer(Handle handle) {
+    if (handle == GetCurrentThreadHandle())
+        return GetCommandBuffer();
+
+    Thread* thread = g_handle_table.Get<Thread>(handle);
+    if (thread == nullptr)
+        return nullptr;
+    return thread->command_buffer.data();
+}
+
+bool HaveReadyThreads() {
+    return !thread_ready_queue.empty();
+}
+
 /// Resumes a thread from waiting by marking it as "ready"
 void ResumeThreadFromWait(Handle handle) {
-    Thread* thread = Kernel::g_object_pool.Get<Thread>(handle);
+    Thread* thread = Kernel::g_handle_table.Get<Thread>(handle);
     if (thread) {
         thread->status &= ~THREADSTATUS_WAIT;
         thread->wait_handle = 0;
@@ -341,7 +380,7 @@ Thread* CreateThread(Handle& handle, const char* name, u32 entry_point, s32 prio
 
     Thread* thread = new Thread;
 
-    handle = Kernel::g_object_pool.Create(thread);
+    handle = Kernel::g_handle_table.Create(thread);
 
     thread_queue.push_back(handle);
     thread_ready_queue.prepare(priority);
@@ -398,7 +437,7 @@ Handle CreateThread(const char* name, u32 entry_point, s32 priority, u32 arg, s3
 
 /// Get the priority of the thread specified by handle
 ResultVal<u32> GetThreadPriority(const Handle handle) {
-    Thread* thread = g_object_pool.Get<Thread>(handle);
+    Thread* thread = g_handle_table.Get<Thread>(handle);
     if (thread == nullptr) return InvalidHandle(ErrorModule::Kernel);
 
     return MakeResult<u32>(thread->current_priority);
@@ -410,7 +449,7 @@ ResultCode SetThreadPriority(Handle handle, s32 priority) {
     if (!handle) {
         thread = GetCurrentThread(); // TODO(bunnei): Is this correct behavior?
     } else {
-        thread = g_object_pool.Get<Thread>(handle);
+        thread = g_handle_table.Get<Thread>(handle);
         if (thread == nullptr) {
             return InvalidHandle(ErrorModule::Kernel);
         }
@@ -481,7 +520,7 @@ void Reschedule() {
         LOG_TRACE(Kernel, "cannot context switch from 0x%08X, no higher priority thread!", prev->GetHandle());
 
         for (Handle handle : thread_queue) {
-            Thread* thread = g_object_pool.Get<Thread>(handle);
+            Thread* thread = g_handle_table.Get<Thread>(handle);
             LOG_TRACE(Kernel, "\thandle=0x%08X prio=0x%02X, status=0x%08X wait_type=0x%08X wait_handle=0x%08X",
                 thread->GetHandle(), thread->current_priority, thread->status, thread->wait_type, thread->wait_handle);
         }
@@ -497,7 +536,7 @@ void Reschedule() {
 }
 
 ResultCode GetThreadId(u32* thread_id, Handle handle) {
-    Thread* thread = g_object_pool.Get<Thread>(handle);
+    Thread* thread = g_handle_table.Get<Thread>(handle);
     if (thread == nullptr)
         return ResultCode(ErrorDescription::InvalidHandle, ErrorModule::OS, 
                           ErrorSummary::WrongArgument, ErrorLevel::Permanent);
@@ -516,4 +555,26 @@ void ThreadingInit() {
 void ThreadingShutdown() {
 }
 
+Object* CreateEmptyThread() {
+    return new Thread;
+}
+
+void ThreadingDoState(PointerWrap& p) {
+    auto s = p.Section("Threading", 1);
+    if (!s)
+        return;
+
+    p.Do(thread_queue);
+    thread_ready_queue.DoState(p);
+    p.Do(next_thread_id);
+
+    // The current thread is saved by handle, the handle table has already been loaded
+    Handle current = current_thread ? current_thread_handle : 0;
+    p.Do(current);
+    if (p.GetMode() == PointerWrap::MODE_READ) {
+        current_thread = current ? g_handle_table.Get<Thread>(current) : nullptr;
+        current_thread_handle = current;
+    }
+}
+
 } // namespace
@@ -83,6 +83,18 @@ Thread* GetCurrentThread();
 /// Gets the current thread handle
 Handle GetCurrentThreadHandle();
 
+/**
+ * Gets the IPC command buffer of a thread. Each thread has its own command buffer, which is
+ * swapped in and out of the TLS area on context switches, so that a reply can be written for a
+ * thread which is waiting on a request while other threads make their own requests.
+ * @param handle Handle of the thread
+ * @return Pointer to the command buffer of the thread, or nullptr if the handle is invalid
+ */
+u32* GetThreadCommandBuffer(Handle handle);
+
+/// Returns true if another thread is ready to run in place of the current one
+bool HaveReadyThreads();
+
 /**
  * Puts the current thread in the wait state for the given type
  * @param wait_type Type of wait
@@ -113,4 +125,10 @@ void ThreadingInit();
 /// Shutdown threading
 void ThreadingShutdown();
 
+/// Creates a thread without a handle, to load its state from a savestate
+Object* CreateEmptyThread();
+
+/// Saves or loads the state of the scheduler, after the threads themselves
+void ThreadingDoState(PointerWrap& p);
+
 } // namespace
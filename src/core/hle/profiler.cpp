@@ -0,0 +1,133 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include "common/common.h"
+#include "common/file_util.h"
+#include "common/string_util.h"
+
+#include "core/hle/hle.h"
+#include "core/hle/profiler.h"
+#include "core/hle/service/service.h"
+#include "core/hle/service/fs/async_io.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Namespace HLE::Profiler
+
+namespace HLE {
+namespace Profiler {
+
+using Common::Profiling::CallStats;
+using Common::Profiling::TicksToNanoseconds;
+
+std::array<CallStats, SVC::NUM_SVCS> g_svc_stats;
+
+/// Calls func(kind, port, command_id, name, stats) for every SVC and service command called so far
+template <typename Func>
+static void ForEachCalledFunction(Func func) {
+    for (u32 i = 0; i < SVC::NUM_SVCS; ++i) {
+        if (g_svc_stats[i].num_calls != 0) {
+            func("svc", "", i, GetSVCName(i), g_svc_stats[i]);
+        }
+    }
+
+    // Asynchronous FS requests, timed from submission to completion on the host
+    const Service::FS::AsyncIOStats& async_io_stats = Service::FS::GetAsyncIOStats();
+    if (async_io_stats.read_latency.num_calls != 0) {
+        func("fs_async_io", "", 0, "Read", async_io_stats.read_latency);
+    }
+    if (async_io_stats.write_latency.num_calls != 0) {
+        func("fs_async_io", "", 1, "Write", async_io_stats.write_latency);
+    }
+
+    if (Service::g_manager == nullptr)
+        return;
+
+    for (const Service::Interface* service : Service::g_manager->GetServices()) {
+        const std::string port_name = service->GetPortName();
+        const auto& functions = service->GetFunctions();
+        const auto& stats = service->GetFunctionStats();
+
+        for (size_t i = 0; i < functions.size(); ++i) {
+            if (stats[i].num_calls != 0) {
+                func("service", port_name.c_str(), functions[i].id, functions[i].name, stats[i]);
+            }
+        }
+    }
+}
+
+std::string FormatJSON() {
+    std::string histogram_bounds;
+    for (int i = 0; i < Common::Profiling::NUM_HISTOGRAM_BUCKETS; ++i) {
+        histogram_bounds += Common::StringFromFormat("%s%.0f", i ? ", " : "",
+            TicksToNanoseconds(1ULL << i));
+    }
+
+    std::string entries;
+    ForEachCalledFunction([&](const char* kind, const char* port, u32 id, const char* name,
+                              const CallStats& stats) {
+        std::string histogram;
+        for (int i = 0; i < Common::Profiling::NUM_HISTOGRAM_BUCKETS; ++i) {
+            histogram += Common::StringFromFormat("%s%u", i ? ", " : "", stats.histogram[i]);
+        }
+
+        entries += Common::StringFromFormat("%s\n    {\"kind\": \"%s\", \"port\": \"%s\", "
+            "\"id\": %u, \"name\": \"%s\", \"calls\": %llu, \"total_ns\": %.0f, \"max_ns\": %.0f, "
+            "\"histogram\": [%s]}", entries.empty() ? "" : ",", kind, port, id, name,
+            (unsigned long long)stats.num_calls, TicksToNanoseconds(stats.total_ticks),
+            TicksToNanoseconds(stats.max_ticks), histogram.c_str());
+    });
+
+    return Common::StringFromFormat("{\n  \"timed\": %s,\n  \"histogram_bucket_ns\": [%s],\n"
+        "  \"functions\": [%s\n  ]\n}\n", Common::Profiling::IS_ENABLED ? "true" : "false",
+        histogram_bounds.c_str(), entries.c_str());
+}
+
+std::string FormatCSV() {
+    std::string csv = "kind,port,id,name,calls,total_ns,max_ns";
+    for (int i = 0; i < Common::Profiling::NUM_HISTOGRAM_BUCKETS; ++i) {
+        csv += Common::StringFromFormat(",bucket_%.0fns", TicksToNanoseconds(1ULL << i));
+    }
+    csv += "\n";
+
+    ForEachCalledFunction([&](const char* kind, const char* port, u32 id, const char* name,
+                              const CallStats& stats) {
+        csv += Common::StringFromFormat("%s,%s,0x%08X,%s,%llu,%.0f,%.0f", kind, port, id, name,
+            (unsigned long long)stats.num_calls, TicksToNanoseconds(stats.total_ticks),
+            TicksToNanoseconds(stats.max_ticks));
+        for (int i = 0; i < Common::Profiling::NUM_HISTOGRAM_BUCKETS; ++i) {
+            csv += Common::StringFromFormat(",%u", stats.histogram[i]);
+        }
+        csv += "\n";
+    });
+
+    return csv;
+}
+
+bool Dump(const std::string& filename) {
+    const bool is_csv = filename.size() >= 4 &&
+        filename.compare(filename.size() - 4, 4, ".csv") == 0;
+    const std::string contents = is_csv ? FormatCSV() : FormatJSON();
+
+    if (FileUtil::WriteStringToFile(true, contents, filename.c_str()) != contents.size()) {
+        LOG_ERROR(Kernel, "Failed to write HLE profile to %s", filename.c_str());
+        return false;
+    }
+
+    LOG_INFO(Kernel, "Wrote HLE profile to %s", filename.c_str());
+    return true;
+}
+
+void Reset() {
+    g_svc_stats.fill(CallStats());
+
+    if (Service::g_manager == nullptr)
+        return;
+
+    for (Service::Interface* service : Service::g_manager->GetServices()) {
+        service->ResetFunctionStats();
+    }
+}
+
+} // namespace
+} // namespace
@@ -0,0 +1,56 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <string>
+
+#include "common/common_types.h"
+#include "common/profiler.h"
+
+#include "core/hle/svc.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Namespace HLE::Profiler
+
+/**
+ * Collects the number of calls to each SVC and each service command, and the host time spent
+ * handling them. Calls are always counted, but the timings and latency histograms are only
+ * recorded when the emulator is built with ENABLE_PROFILING. The statistics are updated from the
+ * emulation thread without synchronization, so a dump taken while the emulation is running may be
+ * slightly inconsistent.
+ */
+namespace HLE {
+namespace Profiler {
+
+/// Statistics of each SVC, indexed by SVC number
+extern std::array<Common::Profiling::CallStats, SVC::NUM_SVCS> g_svc_stats;
+
+/**
+ * Formats the statistics of all SVCs and service commands which have been called as JSON
+ * @return JSON document describing the collected statistics
+ */
+std::string FormatJSON();
+
+/**
+ * Formats the statistics of all SVCs and service commands which have been called as CSV, one row
+ * per SVC or command
+ * @return CSV table describing the collected statistics
+ */
+std::string FormatCSV();
+
+/**
+ * Writes the collected statistics to a file. The file is written as CSV if its name ends with
+ * ".csv" and as JSON otherwise.
+ * @param filename Path of the file to write
+ * @return True on success, otherwise false
+ */
+bool Dump(const std::string& filename);
+
+/// Clears all collected statistics
+void Reset();
+
+} // namespace
+} // namespace
@@ -3,6 +3,7 @@
 // Refer to the license.txt file included.
 
 
+#include "common/chunk_file.h"
 #include "common/common.h"
 #include "common/file_util.h"
 
@@ -300,6 +301,13 @@ const Interface::FunctionInfo FunctionTable[] = {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Interface class
 
+void Interface::DoState(PointerWrap& p) {
+    Service::Interface::DoState(p);
+
+    p.Do(shared_font_mem);
+    p.Do(lock_handle);
+}
+
 Interface::Interface() {
     // Load the shared system font (if available).
     // The expected format is a decrypted, uncompressed BCFNT file with the 0x80 byte header
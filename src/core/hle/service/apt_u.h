@@ -32,6 +32,8 @@ public:
     std::string GetPortName() const override {
         return "APT:U";
     }
+
+    void DoState(PointerWrap& p) override;
 };
 
 } // namespace
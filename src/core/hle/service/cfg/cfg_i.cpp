@@ -2,7 +2,10 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <vector>
+
 #include "common/log.h"
+#include "core/mem_map.h"
 #include "core/hle/hle.h"
 #include "core/hle/service/cfg/cfg.h"
 #include "core/hle/service/cfg/cfg_i.h"
@@ -29,14 +32,20 @@ static void GetConfigInfoBlk8(Service::Interface* self) {
     u32* cmd_buffer = Kernel::GetCommandBuffer();
     u32 size = cmd_buffer[1];
     u32 block_id = cmd_buffer[2];
-    u8* data_pointer = Memory::GetPointer(cmd_buffer[4]);
+    Memory::GuestBuffer output(cmd_buffer[4], size);
 
-    if (data_pointer == nullptr) {
+    if (!output.IsValid()) {
         cmd_buffer[1] = -1; // TODO(Subv): Find the right error code
         return;
     }
 
-    cmd_buffer[1] = Service::CFG::GetConfigInfoBlock(block_id, size, 0x8, data_pointer).raw;
+    if (output.IsContiguous()) {
+        cmd_buffer[1] = Service::CFG::GetConfigInfoBlock(block_id, size, 0x8, output.GetContiguousPointer()).raw;
+    } else {
+        std::vector<u8> data(size);
+        cmd_buffer[1] = Service::CFG::GetConfigInfoBlock(block_id, size, 0x8, data.data()).raw;
+        output.CopyFrom(data.data());
+    }
 }
 
 /**
@@ -2,6 +2,7 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include "common/chunk_file.h"
 #include "common/log.h"
 #include "core/hle/hle.h"
 #include "core/hle/kernel/event.h"
@@ -182,6 +183,14 @@ const Interface::FunctionInfo FunctionTable[] = {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Interface class
 
+void Interface::DoState(PointerWrap& p) {
+    Service::Interface::DoState(p);
+
+    p.Do(read_pipe_count);
+    p.Do(semaphore_event);
+    p.Do(interrupt_event);
+}
+
 Interface::Interface() {
     semaphore_event = Kernel::CreateEvent(RESETTYPE_ONESHOT, "DSP_DSP::semaphore_event");
     interrupt_event = 0;
@@ -22,6 +22,8 @@ public:
     std::string GetPortName() const override {
         return "dsp::DSP";
     }
+
+    void DoState(PointerWrap& p) override;
 };
 
 } // namespace
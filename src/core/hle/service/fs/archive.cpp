@@ -2,10 +2,14 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <map>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include "common/common_types.h"
+#include "common/chunk_file.h"
 #include "common/file_util.h"
 #include "common/make_unique.h"
 #include "common/math_util.h"
@@ -14,7 +18,9 @@
 #include "core/file_sys/archive_backend.h"
 #include "core/file_sys/archive_sdmc.h"
 #include "core/file_sys/directory_backend.h"
+#include "core/mem_map.h"
 #include "core/hle/service/fs/archive.h"
+#include "core/hle/service/fs/async_io.h"
 #include "core/hle/kernel/session.h"
 #include "core/hle/result.h"
 
@@ -59,6 +65,45 @@ enum class DirectoryCommand : u32 {
     Close           = 0x08020000,
 };
 
+/// Error returned when the buffer of a request isn't backed by guest memory
+static ResultCode InvalidBufferError() {
+    return ResultCode(ErrorDescription::InvalidPointer, ErrorModule::FS,
+            ErrorSummary::InvalidArgument, ErrorLevel::Permanent);
+}
+
+/**
+ * Reads from a file into a guest buffer. A contiguous buffer is read into directly, one that spans
+ * several memory regions goes through a host buffer which is then scattered into it.
+ * @return Number of bytes read
+ */
+static size_t ReadToGuest(const FileSys::FileBackend& backend, u64 offset,
+                          const Memory::GuestBuffer& buffer) {
+    if (buffer.IsContiguous()) {
+        Memory::PrepareHostWrite(buffer.GetContiguousPointer(), buffer.GetSize());
+        return backend.Read(offset, buffer.GetSize(), buffer.GetContiguousPointer());
+    }
+
+    std::vector<u8> data(buffer.GetSize());
+    size_t read = backend.Read(offset, buffer.GetSize(), data.data());
+    buffer.Write(0, data.data(), (u32)read);
+    return read;
+}
+
+/**
+ * Writes a guest buffer to a file, gathering it into a host buffer first if it spans several
+ * memory regions
+ * @return Number of bytes written
+ */
+static size_t WriteFromGuest(const FileSys::FileBackend& backend, u64 offset, u32 flush,
+                             const Memory::GuestBuffer& buffer) {
+    if (buffer.IsContiguous())
+        return backend.Write(offset, buffer.GetSize(), flush, buffer.GetContiguousPointer());
+
+    std::vector<u8> data(buffer.GetSize());
+    buffer.CopyTo(data.data());
+    return backend.Write(offset, buffer.GetSize(), flush, data.data());
+}
+
 class Archive {
 public:
     Archive(std::unique_ptr<FileSys::ArchiveBackend>&& backend, ArchiveIdCode id_code)
@@ -71,20 +116,54 @@ public:
     std::unique_ptr<FileSys::ArchiveBackend> backend; ///< Archive backend interface
 };
 
+/**
+ * Finds the archive with the given id code when loading a savestate. The save data archive is only
+ * registered once formatted, so it is registered again if the state was saved after that.
+ * @return The archive, or nullptr if it isn't registered
+ */
+static Archive* GetArchiveForState(ArchiveIdCode id_code);
+
 class File : public Kernel::Session {
 public:
-    File(std::unique_ptr<FileSys::FileBackend>&& backend, const FileSys::Path& path)
-            : backend(std::move(backend)), path(path) {
+    File() {}
+
+    File(std::unique_ptr<FileSys::FileBackend>&& backend, const FileSys::Path& path,
+         ArchiveIdCode archive_id_code, FileSys::Mode mode)
+            : backend(std::move(backend)), path(path), archive_id_code(archive_id_code), mode(mode) {
     }
 
+    std::string GetTypeName() const override { return "File"; }
     std::string GetName() const override { return "Path: " + path.DebugStr(); }
 
     FileSys::Path path; ///< Path of the file
     std::unique_ptr<FileSys::FileBackend> backend; ///< File backend interface
 
+    ArchiveIdCode archive_id_code; ///< Archive the file was opened from, to reopen it
+    FileSys::Mode mode;            ///< Mode the file was opened with, to reopen it
+
+    /// Host files can't be saved, loading a state opens the file again
+    void DoState(PointerWrap& p) override {
+        p.Do(archive_id_code);
+        p.Do(mode.hex);
+        path.DoState(p);
+
+        if (p.GetMode() == PointerWrap::MODE_READ) {
+            Archive* archive = GetArchiveForState(archive_id_code);
+            backend = archive ? archive->backend->OpenFile(path, mode) : nullptr;
+            if (backend == nullptr) {
+                LOG_ERROR(Service_FS, "Savestate error: can't reopen file %s", GetName().c_str());
+                p.SetError(PointerWrap::ERROR_FAILURE);
+            }
+        }
+    }
+
+    /// Serializes accesses to the backend, which may be used by asynchronous I/O worker threads
+    std::mutex backend_mutex;
+
     ResultVal<bool> SyncRequest() override {
         u32* cmd_buff = Kernel::GetCommandBuffer();
         FileCommand cmd = static_cast<FileCommand>(cmd_buff[0]);
+        std::unique_lock<std::mutex> lock(backend_mutex);
         switch (cmd) {
 
         // Read from file...
@@ -95,7 +174,19 @@ public:
             u32 address = cmd_buff[5];
             LOG_TRACE(Service_FS, "Read %s %s: offset=0x%llx length=%d address=0x%x",
                       GetTypeName().c_str(), GetName().c_str(), offset, length, address);
-            cmd_buff[2] = backend->Read(offset, length, Memory::GetPointer(address));
+            Memory::GuestBuffer buffer(address, length);
+            if (!buffer.IsValid()) {
+                cmd_buff[1] = InvalidBufferError().raw;
+                return MakeResult<bool>(false);
+            }
+            if (ShouldUseAsyncIO(length)) {
+                QueueAsyncIO([=] {
+                    std::lock_guard<std::mutex> lock(backend_mutex);
+                    return ReadToGuest(*backend, offset, buffer);
+                }, length, false);
+                return MakeResult<bool>(true);
+            }
+            cmd_buff[2] = ReadToGuest(*backend, offset, buffer);
             break;
         }
 
@@ -108,7 +199,19 @@ public:
             u32 address = cmd_buff[6];
             LOG_TRACE(Service_FS, "Write %s %s: offset=0x%llx length=%d address=0x%x, flush=0x%x",
                       GetTypeName().c_str(), GetName().c_str(), offset, length, address, flush);
-            cmd_buff[2] = backend->Write(offset, length, flush, Memory::GetPointer(address));
+            Memory::GuestBuffer buffer(address, length);
+            if (!buffer.IsValid()) {
+                cmd_buff[1] = InvalidBufferError().raw;
+                return MakeResult<bool>(false);
+            }
+            if (ShouldUseAsyncIO(length)) {
+                QueueAsyncIO([=] {
+                    std::lock_guard<std::mutex> lock(backend_mutex);
+                    return WriteFromGuest(*backend, offset, flush, buffer);
+                }, length, true);
+                return MakeResult<bool>(true);
+            }
+            cmd_buff[2] = WriteFromGuest(*backend, offset, flush, buffer);
             break;
         }
 
@@ -133,7 +236,10 @@ public:
         case FileCommand::Close:
         {
             LOG_TRACE(Service_FS, "Close %s %s", GetTypeName().c_str(), GetName().c_str());
-            Kernel::g_object_pool.Destroy<File>(GetHandle());
+            // Requests of other threads might still be using this file
+            lock.unlock();
+            FlushAsyncIO();
+            Kernel::g_handle_table.Destroy<File>(GetHandle());
             break;
         }
 
@@ -158,15 +264,39 @@ public:
 
 class Directory : public Kernel::Session {
 public:
-    Directory(std::unique_ptr<FileSys::DirectoryBackend>&& backend, const FileSys::Path& path)
-            : backend(std::move(backend)), path(path) {
+    Directory() {}
+
+    Directory(std::unique_ptr<FileSys::DirectoryBackend>&& backend, const FileSys::Path& path,
+              ArchiveIdCode archive_id_code)
+            : backend(std::move(backend)), path(path), archive_id_code(archive_id_code) {
     }
 
+    std::string GetTypeName() const override { return "Directory"; }
     std::string GetName() const override { return "Directory: " + path.DebugStr(); }
 
     FileSys::Path path; ///< Path of the directory
     std::unique_ptr<FileSys::DirectoryBackend> backend; ///< File backend interface
 
+    ArchiveIdCode archive_id_code; ///< Archive the directory was opened from, to reopen it
+
+    /**
+     * Loading a state opens the directory again, so the entries already read by the guest are
+     * listed again
+     */
+    void DoState(PointerWrap& p) override {
+        p.Do(archive_id_code);
+        path.DoState(p);
+
+        if (p.GetMode() == PointerWrap::MODE_READ) {
+            Archive* archive = GetArchiveForState(archive_id_code);
+            backend = archive ? archive->backend->OpenDirectory(path) : nullptr;
+            if (backend == nullptr) {
+                LOG_ERROR(Service_FS, "Savestate error: can't reopen directory %s", GetName().c_str());
+                p.SetError(PointerWrap::ERROR_FAILURE);
+            }
+        }
+    }
+
     ResultVal<bool> SyncRequest() override {
         u32* cmd_buff = Kernel::GetCommandBuffer();
         DirectoryCommand cmd = static_cast<DirectoryCommand>(cmd_buff[0]);
@@ -177,19 +307,32 @@ public:
         {
             u32 count = cmd_buff[1];
             u32 address = cmd_buff[3];
-            auto entries = reinterpret_cast<FileSys::Entry*>(Memory::GetPointer(address));
             LOG_TRACE(Service_FS, "Read %s %s: count=%d",
                     GetTypeName().c_str(), GetName().c_str(), count);
 
+            Memory::GuestSpan<FileSys::Entry> entries(address, count);
+            if (!entries.IsValid()) {
+                cmd_buff[1] = InvalidBufferError().raw;
+                return MakeResult<bool>(false);
+            }
+
             // Number of entries actually read
-            cmd_buff[2] = backend->Read(count, entries);
+            if (entries.IsContiguous()) {
+                Memory::PrepareHostWrite(reinterpret_cast<u8*>(entries.GetPointer()),
+                                         count * sizeof(FileSys::Entry));
+                cmd_buff[2] = backend->Read(count, entries.GetPointer());
+            } else {
+                std::vector<FileSys::Entry> data(count);
+                cmd_buff[2] = backend->Read(count, data.data());
+                entries.Write(0, data.data(), cmd_buff[2] * sizeof(FileSys::Entry));
+            }
             break;
         }
 
         case DirectoryCommand::Close:
         {
             LOG_TRACE(Service_FS, "Close %s %s", GetTypeName().c_str(), GetName().c_str());
-            Kernel::g_object_pool.Destroy<Directory>(GetHandle());
+            Kernel::g_handle_table.Destroy<Directory>(GetHandle());
             break;
         }
 
@@ -224,6 +367,21 @@ static Archive* GetArchive(ArchiveHandle handle) {
     return (itr == handle_map.end()) ? nullptr : itr->second;
 }
 
+static Archive* GetArchiveForState(ArchiveIdCode id_code) {
+    auto itr = id_code_map.find(id_code);
+    if (itr == id_code_map.end() && id_code == ArchiveIdCode::SaveData && FormatSaveData().IsSuccess())
+        itr = id_code_map.find(id_code);
+    return (itr == id_code_map.end()) ? nullptr : itr->second.get();
+}
+
+static Kernel::Object* CreateEmptyFile() {
+    return new File;
+}
+
+static Kernel::Object* CreateEmptyDirectory() {
+    return new Directory;
+}
+
 ResultVal<ArchiveHandle> OpenArchive(ArchiveIdCode id_code) {
     LOG_TRACE(Service_FS, "Opening archive with id code 0x%08X", id_code);
 
@@ -282,8 +440,8 @@ ResultVal<Handle> OpenFileFromArchive(ArchiveHandle archive_handle, const FileSy
                           ErrorSummary::NotFound, ErrorLevel::Status);
     }
 
-    auto file = Common::make_unique<File>(std::move(backend), path);
-    Handle handle = Kernel::g_object_pool.Create(file.release());
+    auto file = Common::make_unique<File>(std::move(backend), path, archive->id_code, mode);
+    Handle handle = Kernel::g_handle_table.Create(file.release());
     return MakeResult<Handle>(handle);
 }
 
@@ -387,8 +545,8 @@ ResultVal<Handle> OpenDirectoryFromArchive(ArchiveHandle archive_handle, const F
                           ErrorSummary::NotFound, ErrorLevel::Permanent);
     }
 
-    auto directory = Common::make_unique<Directory>(std::move(backend), path);
-    Handle handle = Kernel::g_object_pool.Create(directory.release());
+    auto directory = Common::make_unique<Directory>(std::move(backend), path, archive->id_code);
+    Handle handle = Kernel::g_handle_table.Create(directory.release());
     return MakeResult<Handle>(handle);
 }
 
@@ -414,10 +572,43 @@ ResultCode FormatSaveData() {
     }
 }
 
+void ArchiveDoState(PointerWrap& p) {
+    auto s = p.Section("Archives", 1);
+    if (!s)
+        return;
+
+    p.Do(next_handle);
+
+    // Archives are identified by their id code
+    std::map<ArchiveHandle, ArchiveIdCode> handles;
+    for (const auto& entry : handle_map)
+        handles[entry.first] = entry.second->id_code;
+    p.Do(handles);
+
+    if (p.GetMode() == PointerWrap::MODE_READ) {
+        handle_map.clear();
+        for (const auto& entry : handles) {
+            Archive* archive = GetArchiveForState(entry.second);
+            if (archive == nullptr) {
+                LOG_ERROR(Service_FS, "Savestate error: archive 0x%08X isn't registered",
+                          (u32)entry.second);
+                p.SetError(PointerWrap::ERROR_FAILURE);
+                return;
+            }
+            handle_map.emplace(entry.first, archive);
+        }
+    }
+}
+
 /// Initialize archives
 void ArchiveInit() {
     next_handle = 1;
 
+    AsyncIOInit();
+
+    Kernel::RegisterObjectFactory("File", CreateEmptyFile);
+    Kernel::RegisterObjectFactory("Directory", CreateEmptyDirectory);
+
     // TODO(Link Mauve): Add the other archive types (see here for the known types:
     // http://3dbrew.org/wiki/FS:OpenArchive#Archive_idcodes).  Currently the only half-finished
     // archive type is SDMC, so it is the only one getting exposed.
@@ -432,6 +623,7 @@ void ArchiveInit() {
 
 /// Shutdown archives
 void ArchiveShutdown() {
+    AsyncIOShutdown();
     handle_map.clear();
     id_code_map.clear();
 }
@@ -124,6 +124,12 @@ ResultVal<Handle> OpenDirectoryFromArchive(ArchiveHandle archive_handle, const F
  */
 ResultCode FormatSaveData();
 
+/**
+ * Saves or loads the open archive handles. Archives are host directories, so only the handles are
+ * saved, along with whether the save data archive was formatted.
+ */
+void ArchiveDoState(PointerWrap& p);
+
 /// Initialize archives
 void ArchiveInit();
 
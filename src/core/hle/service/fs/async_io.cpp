@@ -0,0 +1,207 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common/common.h"
+#include "common/math_util.h"
+
+#include "core/movie.h"
+#include "core/settings.h"
+#include "core/hle/hle.h"
+#include "core/hle/result.h"
+#include "core/hle/kernel/thread.h"
+#include "core/hle/service/fs/async_io.h"
+
+namespace Service {
+namespace FS {
+
+struct AsyncIORequest {
+    Handle thread;                      ///< Guest thread waiting for the request
+    std::function<size_t()> operation;
+    u32 length;
+    bool is_write;
+
+    u64 submit_ticks;
+    u64 complete_ticks;
+    size_t result;                      ///< Number of bytes transferred
+};
+
+static std::vector<std::thread> workers;
+static bool stop_workers;
+
+/// Requests waiting for a worker, and the condition signaled when one is added
+static std::deque<AsyncIORequest*> pending_requests;
+static std::mutex pending_mutex;
+static std::condition_variable pending_cv;
+
+/// Requests completed by a worker but not yet replied to by the emulation thread
+static std::vector<AsyncIORequest*> completed_requests;
+static std::mutex completed_mutex;
+static std::condition_variable completed_cv;
+static std::atomic<u32> num_completed;
+
+/// Number of requests submitted and not yet replied to. Only accessed by the emulation thread.
+static u32 num_in_flight;
+
+static AsyncIOStats stats;
+
+static void WorkerLoop() {
+    while (true) {
+        AsyncIORequest* request;
+        {
+            std::unique_lock<std::mutex> lock(pending_mutex);
+            pending_cv.wait(lock, []{ return stop_workers || !pending_requests.empty(); });
+            if (pending_requests.empty())
+                return;
+            request = pending_requests.front();
+            pending_requests.pop_front();
+        }
+
+        request->result = request->operation();
+        request->complete_ticks = Common::Profiling::GetTicks();
+
+        {
+            std::lock_guard<std::mutex> lock(completed_mutex);
+            completed_requests.push_back(request);
+            num_completed.store((u32)completed_requests.size(), std::memory_order_release);
+        }
+        completed_cv.notify_all();
+    }
+}
+
+bool ShouldUseAsyncIO(u32 length) {
+    // When the requests complete depends on the host, which would make movies desync
+    return Settings::values.use_async_io && !workers.empty() && length >= ASYNC_IO_MIN_LENGTH &&
+        Kernel::HaveReadyThreads() && !Movie::IsActive();
+}
+
+void QueueAsyncIO(std::function<size_t()> operation, u32 length, bool is_write) {
+    AsyncIORequest* request = new AsyncIORequest;
+    request->thread = Kernel::GetCurrentThreadHandle();
+    request->operation = std::move(operation);
+    request->length = length;
+    request->is_write = is_write;
+    request->submit_ticks = Common::Profiling::GetTicks();
+    request->complete_ticks = 0;
+    request->result = 0;
+
+    ++num_in_flight;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        pending_requests.push_back(request);
+    }
+    pending_cv.notify_one();
+
+    // Let another thread run while this one waits
+    HLE::Reschedule(__func__);
+}
+
+void ProcessAsyncIO() {
+    if (num_completed.load(std::memory_order_acquire) == 0)
+        return;
+
+    std::vector<AsyncIORequest*> requests;
+    {
+        std::lock_guard<std::mutex> lock(completed_mutex);
+        requests.swap(completed_requests);
+        num_completed.store(0, std::memory_order_relaxed);
+    }
+
+    for (AsyncIORequest* request : requests) {
+        const u64 latency = request->complete_ticks - request->submit_ticks;
+        if (request->is_write) {
+            stats.write_latency.AddCall(latency);
+            stats.bytes_written += request->result;
+        } else {
+            stats.read_latency.AddCall(latency);
+            stats.bytes_read += request->result;
+        }
+        stats.size_histogram[std::min<int>((int)Log2(request->length), NUM_ASYNC_IO_SIZE_BUCKETS - 1)]++;
+
+        // The thread might have been terminated while waiting
+        u32* cmd_buff = Kernel::GetThreadCommandBuffer(request->thread);
+        if (cmd_buff != nullptr) {
+            cmd_buff[1] = RESULT_SUCCESS.raw;
+            cmd_buff[2] = (u32)request->result;
+            Kernel::ResumeThreadFromWait(request->thread);
+        }
+
+        delete request;
+        --num_in_flight;
+    }
+
+    HLE::Reschedule(__func__);
+}
+
+void FlushAsyncIO() {
+    if (num_in_flight == 0)
+        return;
+
+    {
+        std::unique_lock<std::mutex> lock(completed_mutex);
+        completed_cv.wait(lock, []{ return completed_requests.size() == num_in_flight; });
+    }
+    ProcessAsyncIO();
+}
+
+const AsyncIOStats& GetAsyncIOStats() {
+    return stats;
+}
+
+void AsyncIOInit() {
+    stats = AsyncIOStats();
+    num_in_flight = 0;
+    num_completed = 0;
+    stop_workers = false;
+
+    if (!Settings::values.use_async_io)
+        return;
+
+    // I/O is mostly waiting on the host, so a few threads are enough even on small machines
+    const unsigned int num_workers = MathUtil::Clamp(std::thread::hardware_concurrency(), 2u, 4u);
+    for (unsigned int i = 0; i < num_workers; ++i) {
+        workers.emplace_back(WorkerLoop);
+    }
+    LOG_INFO(Service_FS, "Started %u asynchronous I/O worker threads", num_workers);
+}
+
+void AsyncIOShutdown() {
+    FlushAsyncIO();
+
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        stop_workers = true;
+    }
+    pending_cv.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+
+    const u64 num_requests = stats.read_latency.num_calls + stats.write_latency.num_calls;
+    if (num_requests != 0) {
+        LOG_INFO(Service_FS, "Asynchronous I/O: %llu reads (%llu bytes, mean %.0f us, max %.0f us), "
+                 "%llu writes (%llu bytes, mean %.0f us, max %.0f us)",
+                 (unsigned long long)stats.read_latency.num_calls,
+                 (unsigned long long)stats.bytes_read,
+                 Common::Profiling::TicksToNanoseconds(stats.read_latency.total_ticks) / 1000 /
+                     std::max<u64>(stats.read_latency.num_calls, 1),
+                 Common::Profiling::TicksToNanoseconds(stats.read_latency.max_ticks) / 1000,
+                 (unsigned long long)stats.write_latency.num_calls,
+                 (unsigned long long)stats.bytes_written,
+                 Common::Profiling::TicksToNanoseconds(stats.write_latency.total_ticks) / 1000 /
+                     std::max<u64>(stats.write_latency.num_calls, 1),
+                 Common::Profiling::TicksToNanoseconds(stats.write_latency.max_ticks) / 1000);
+    }
+}
+
+} // namespace FS
+} // namespace Service
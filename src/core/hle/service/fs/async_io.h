@@ -0,0 +1,77 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <functional>
+
+#include "common/common_types.h"
+#include "common/profiler.h"
+
+/**
+ * Asynchronous file I/O for the FS service. Large reads and writes are performed by a pool of host
+ * worker threads while the guest thread which requested them waits, so that other guest threads
+ * keep running during slow host I/O. Completed requests are picked up by the emulation thread,
+ * which writes the reply to the command buffer of the waiting thread and resumes it.
+ */
+namespace Service {
+namespace FS {
+
+/// Reads and writes of at least this many bytes are performed asynchronously, if enabled
+const u32 ASYNC_IO_MIN_LENGTH = 0x8000;
+
+/// Number of buckets in the request size histogram of AsyncIOStats
+const int NUM_ASYNC_IO_SIZE_BUCKETS = 32;
+
+struct AsyncIOStats {
+    /// Time from the submission of requests to their completion by a worker thread
+    Common::Profiling::CallStats read_latency;
+    Common::Profiling::CallStats write_latency;
+
+    u64 bytes_read = 0;
+    u64 bytes_written = 0;
+
+    /// Bucket i counts the requests of [2^i, 2^(i+1)) bytes
+    std::array<u32, NUM_ASYNC_IO_SIZE_BUCKETS> size_histogram;
+
+    AsyncIOStats() { size_histogram.fill(0); }
+};
+
+/**
+ * Determines whether a read or write should be performed asynchronously. This is only the case
+ * for large requests, and when another guest thread can run in the meantime.
+ * @param length Length in bytes of the request
+ * @return True if the request should be passed to QueueAsyncIO
+ */
+bool ShouldUseAsyncIO(u32 length);
+
+/**
+ * Performs a read or write on a worker thread on behalf of the current guest thread, which the
+ * caller must put to wait (by returning true from SyncRequest). When the operation completes, the
+ * number of bytes transferred is stored in the thread's command buffer and the thread is resumed.
+ * @param operation Function performing the read or write, called from a worker thread. Returns
+ *        the number of bytes transferred.
+ * @param length Length in bytes of the request
+ * @param is_write True if the operation is a write
+ */
+void QueueAsyncIO(std::function<size_t()> operation, u32 length, bool is_write);
+
+/// Replies to and resumes the threads whose requests have completed. Called by the emulation loop.
+void ProcessAsyncIO();
+
+/// Waits for all pending requests to complete, then replies to and resumes their threads
+void FlushAsyncIO();
+
+/// Gets the statistics of the requests completed so far
+const AsyncIOStats& GetAsyncIOStats();
+
+/// Starts the worker threads
+void AsyncIOInit();
+
+/// Completes all pending requests and stops the worker threads
+void AsyncIOShutdown();
+
+} // namespace FS
+} // namespace Service
@@ -3,6 +3,7 @@
 // Refer to the license.txt file included.
 
 #include "common/common.h"
+#include "common/chunk_file.h"
 #include "common/file_util.h"
 #include "common/scope_exit.h"
 #include "common/string_util.h"
@@ -576,6 +577,12 @@ const FSUserInterface::FunctionInfo FunctionTable[] = {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Interface class
 
+void FSUserInterface::DoState(PointerWrap& p) {
+    Service::Interface::DoState(p);
+
+    ArchiveDoState(p);
+}
+
 FSUserInterface::FSUserInterface() {
     Register(FunctionTable, ARRAY_SIZE(FunctionTable));
 }
@@ -27,6 +27,8 @@ public:
     std::string GetPortName() const override {
         return "fs:USER";
     }
+
+    void DoState(PointerWrap& p) override;
 };
 
 } // namespace FS
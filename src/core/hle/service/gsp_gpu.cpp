@@ -3,6 +3,9 @@
 // Refer to the license.txt file included.
 
 
+#include <vector>
+
+#include "common/chunk_file.h"
 #include "common/log.h"
 #include "common/bit_field.h"
 
@@ -76,9 +79,21 @@ static void WriteHWRegs(Service::Interface* self) {
     u32 reg_addr = cmd_buff[1];
     u32 size = cmd_buff[2];
 
-    u32* src = (u32*)Memory::GetPointer(cmd_buff[0x4]);
+    // Resolve the whole source buffer up front rather than trusting the guest pointer per word
+    Memory::GuestSpan<u32> src(cmd_buff[0x4], size / 4);
+    if (!src.IsValid()) {
+        LOG_ERROR(Service_GSP, "Invalid source buffer (address=0x%08x, size=0x%08x)",
+                  cmd_buff[0x4], size);
+        return;
+    }
 
-    WriteHWRegs(reg_addr, size, src);
+    if (src.IsContiguous()) {
+        WriteHWRegs(reg_addr, size, src.GetPointer());
+    } else {
+        std::vector<u32> data(src.GetCount());
+        src.CopyTo(data.data());
+        WriteHWRegs(reg_addr, size, data.data());
+    }
 }
 
 /// Read a GSP GPU hardware register
@@ -99,15 +114,18 @@ static void ReadHWRegs(Service::Interface* self) {
         return;
     }
 
-    u32* dst = (u32*)Memory::GetPointer(cmd_buff[0x41]);
-
-    while (size > 0) {
-        GPU::Read<u32>(*dst, reg_addr + 0x1EB00000);
-
-        size -= 4;
-        ++dst;
-        reg_addr += 4;
+    Memory::GuestSpan<u32> dst(cmd_buff[0x41], size / 4);
+    if (!dst.IsValid()) {
+        LOG_ERROR(Service_GSP, "Invalid destination buffer (address=0x%08x, size=0x%08x)",
+                  cmd_buff[0x41], size);
+        return;
     }
+
+    // Gather the registers on the host, then copy them to the guest in bulk
+    std::vector<u32> data(dst.GetCount());
+    for (u32 i = 0; i < dst.GetCount(); ++i)
+        GPU::Read<u32>(data[i], reg_addr + 0x1EB00000 + 4 * i);
+    dst.CopyFrom(data.data());
 }
 
 static void SetBufferSwap(u32 screen_id, const FrameBufferInfo& info) {
@@ -233,11 +251,18 @@ static void ExecuteCommand(const Command& command, u32 thread_id) {
 
     // GX request DMA - typically used for copying memory from GSP heap to VRAM
     case CommandId::REQUEST_DMA:
-        memcpy(Memory::GetPointer(command.dma_request.dest_address),
-               Memory::GetPointer(command.dma_request.source_address),
-               command.dma_request.size);
+    {
+        Memory::GuestBuffer dest(command.dma_request.dest_address, command.dma_request.size);
+        Memory::GuestBuffer source(command.dma_request.source_address, command.dma_request.size);
+        if (dest.IsValid() && source.IsValid())
+            dest.CopyFrom(source);
+        else
+            LOG_ERROR(Service_GSP, "Invalid DMA request (source=0x%08x, dest=0x%08x, size=0x%08x)",
+                      command.dma_request.source_address, command.dma_request.dest_address,
+                      command.dma_request.size);
         SignalInterrupt(InterruptId::DMA);
         break;
+    }
 
     // ctrulib homebrew sends all relevant command list data with this command,
     // hence we do all "interesting" stuff here and do nothing in SET_COMMAND_LIST_FIRST.
@@ -388,6 +413,14 @@ const Interface::FunctionInfo FunctionTable[] = {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Interface class
 
+void Interface::DoState(PointerWrap& p) {
+    Service::Interface::DoState(p);
+
+    p.Do(g_interrupt_event);
+    p.Do(g_shared_memory);
+    p.Do(g_thread_id);
+}
+
 Interface::Interface() {
     Register(FunctionTable, ARRAY_SIZE(FunctionTable));
 
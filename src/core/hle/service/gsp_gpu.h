@@ -171,6 +171,8 @@ public:
         return "gsp::Gpu";
     }
 
+    void DoState(PointerWrap& p) override;
+
 };
 
 /**
@@ -2,8 +2,12 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <atomic>
+
+#include "common/chunk_file.h"
 #include "common/log.h"
 
+#include "core/movie.h"
 #include "core/hle/hle.h"
 #include "core/hle/kernel/event.h"
 #include "core/hle/kernel/shared_memory.h"
@@ -24,11 +28,15 @@ static Handle event_accelerometer = 0;
 static Handle event_gyroscope = 0;
 static Handle event_debug_pad = 0;
 
-// Next Pad state update information
+// Pad state being changed by the frontend, and the last complete one (see PadUpdateComplete)
 static PadState next_state = {{0}};
+static std::atomic<u32> published_state(0);
+
+// Pad state given to the emulated system
+static PadState current_state = {{0}};
+static s16 current_circle_x = 0;
+static s16 current_circle_y = 0;
 static u32 next_index = 0;
-static s16 next_circle_x = 0;
-static s16 next_circle_y = 0;
 
 /**
  * Gets a pointer to the PadData structure inside HID shared memory
@@ -44,12 +52,12 @@ static inline PadData* GetPadData() {
  *
  * Indicate the circle pad is pushed completely to the edge in 1 of 8 directions.
  */
-static void UpdateNextCirclePadState() {
+static void GetCirclePadFromKeys(PadState state, s16& circle_x, s16& circle_y) {
     static const s16 max_value = 0x9C;
-    next_circle_x = next_state.circle_left ? -max_value : 0x0;
-    next_circle_x += next_state.circle_right ? max_value : 0x0;
-    next_circle_y = next_state.circle_down ? -max_value : 0x0;
-    next_circle_y += next_state.circle_up ? max_value : 0x0;
+    circle_x = state.circle_left ? -max_value : 0x0;
+    circle_x += state.circle_right ? max_value : 0x0;
+    circle_y = state.circle_down ? -max_value : 0x0;
+    circle_y += state.circle_up ? max_value : 0x0;
 }
 
 /**
@@ -57,7 +65,6 @@ static void UpdateNextCirclePadState() {
  */
 void PadButtonPress(const PadState& pad_state) {
     next_state.hex |= pad_state.hex;
-    UpdateNextCirclePadState();
 }
 
 /**
@@ -65,7 +72,6 @@ void PadButtonPress(const PadState& pad_state) {
  */
 void PadButtonRelease(const PadState& pad_state) {
     next_state.hex &= ~pad_state.hex;
-    UpdateNextCirclePadState();
 }
 
 /**
@@ -73,6 +79,15 @@ void PadButtonRelease(const PadState& pad_state) {
  * including both Pad key changes and analog circle Pad changes.
  */
 void PadUpdateComplete() {
+    // The frontend may run on another thread than the emulation, which picks this up in Update
+    published_state.store(next_state.hex, std::memory_order_release);
+}
+
+/**
+ * Writes the current Pad state to the PadData structure in shared memory and signals the
+ * emulated program.
+ */
+static void UpdatePadData() {
     PadData* pad_data = GetPadData();
 
     if (pad_data == nullptr) {
@@ -80,7 +95,7 @@ void PadUpdateComplete() {
     }
 
     // Update PadData struct
-    pad_data->current_state.hex = next_state.hex;
+    pad_data->current_state.hex = current_state.hex;
     pad_data->index = next_index;
     next_index = (next_index + 1) % pad_data->entries.size();
 
@@ -90,11 +105,11 @@ void PadUpdateComplete() {
 
     // Compute bitmask with 1s for bits different from the old state
     PadState changed;
-    changed.hex = (next_state.hex ^ old_state.hex);
+    changed.hex = (current_state.hex ^ old_state.hex);
 
     // Compute what was added
     PadState additions;
-    additions.hex = changed.hex & next_state.hex;
+    additions.hex = changed.hex & current_state.hex;
 
     // Compute what was removed
     PadState removals;
@@ -104,13 +119,13 @@ void PadUpdateComplete() {
     PadDataEntry* current_pad_entry = &pad_data->entries[pad_data->index];
 
     // Update entry properties
-    current_pad_entry->current_state.hex = next_state.hex;
+    current_pad_entry->current_state.hex = current_state.hex;
     current_pad_entry->delta_additions.hex = additions.hex;
     current_pad_entry->delta_removals.hex = removals.hex;
 
     // Set circle Pad
-    current_pad_entry->circle_pad_x = next_circle_x;
-    current_pad_entry->circle_pad_y = next_circle_y;
+    current_pad_entry->circle_pad_x = current_circle_x;
+    current_pad_entry->circle_pad_y = current_circle_y;
 
     // If we just updated index 0, provide a new timestamp
     if (pad_data->index == 0) {
@@ -123,6 +138,25 @@ void PadUpdateComplete() {
     Kernel::SignalEvent(event_pad_or_touch_2);
 }
 
+void Update() {
+    Movie::InputState input;
+    input.pad = published_state.load(std::memory_order_acquire);
+    PadState keys;
+    keys.hex = input.pad;
+    GetCirclePadFromKeys(keys, input.circle_pad_x, input.circle_pad_y);
+
+    Movie::UpdateInput(input);
+
+    if (input.pad == current_state.hex && input.circle_pad_x == current_circle_x &&
+        input.circle_pad_y == current_circle_y) {
+        return;
+    }
+    current_state.hex = input.pad;
+    current_circle_x = input.circle_pad_x;
+    current_circle_y = input.circle_pad_y;
+    UpdatePadData();
+}
+
 
 // TODO(peachum):
 // Add a method for setting analog input from joystick device for the circle Pad.
@@ -183,6 +217,21 @@ const Interface::FunctionInfo FunctionTable[] = {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Interface class
 
+void Interface::DoState(PointerWrap& p) {
+    Service::Interface::DoState(p);
+
+    p.Do(shared_mem);
+    p.Do(event_pad_or_touch_1);
+    p.Do(event_pad_or_touch_2);
+    p.Do(event_accelerometer);
+    p.Do(event_gyroscope);
+    p.Do(event_debug_pad);
+    p.Do(current_state.hex);
+    p.Do(current_circle_x);
+    p.Do(current_circle_y);
+    p.Do(next_index);
+}
+
 Interface::Interface() {
     shared_mem = Kernel::CreateSharedMemory("HID_User:SharedMem"); // Create shared memory object
 
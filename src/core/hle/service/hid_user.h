@@ -92,11 +92,18 @@ const PadState PAD_CIRCLE_LEFT  = {{1u << 29}};
 const PadState PAD_CIRCLE_UP    = {{1u << 30}};
 const PadState PAD_CIRCLE_DOWN  = {{1u << 31}};
 
-// Methods for updating the HID module's state
+// Methods for updating the HID module's state, called by the frontend. The changes are handed to
+// the emulated system by the next call to Update.
 void PadButtonPress(const PadState& pad_state);
 void PadButtonRelease(const PadState& pad_state);
 void PadUpdateComplete();
 
+/**
+ * Hands the input from the frontend (or from the movie being replayed) to the emulated system.
+ * Called by the GPU once per emulated frame, so that the input only depends on emulated time.
+ */
+void Update();
+
 /**
  * HID service interface.
  */
@@ -115,6 +122,8 @@ public:
         return "hid:USER";
     }
 
+    void DoState(PointerWrap& p) override;
+
 };
 
 } // namespace
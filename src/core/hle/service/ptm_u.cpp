@@ -2,6 +2,7 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include "common/chunk_file.h"
 #include "common/log.h"
 #include "core/hle/hle.h"
 #include "core/hle/service/ptm_u.h"
@@ -118,6 +119,13 @@ const Interface::FunctionInfo FunctionTable[] = {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Interface class
 
+void Interface::DoState(PointerWrap& p) {
+    Service::Interface::DoState(p);
+
+    p.Do(shell_open);
+    p.Do(battery_is_charging);
+}
+
 Interface::Interface() {
     Register(FunctionTable, ARRAY_SIZE(FunctionTable));
 }
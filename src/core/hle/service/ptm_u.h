@@ -24,6 +24,8 @@ public:
     std::string GetPortName() const override {
         return "ptm:u";
     }
+
+    void DoState(PointerWrap& p) override;
 };
 
 } // namespace
@@ -3,7 +3,9 @@
 // Refer to the license.txt file included.
 
 #include "common/common.h"
+#include "common/chunk_file.h"
 #include "common/string_util.h"
+#include "common/trace.h"
 
 #include "core/hle/service/service.h"
 #include "core/hle/service/ac_u.h"
@@ -38,6 +40,80 @@ namespace Service {
 
 Manager* g_manager = nullptr;  ///< Service manager
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Service Interface class
+
+ResultVal<bool> Interface::SyncRequest() {
+    u32* cmd_buff = Kernel::GetCommandBuffer();
+    int index = FindFunction(cmd_buff[0]);
+
+    if (index < 0 || m_functions[index].func == nullptr) {
+        // Number of params == bits 0-5 + bits 6-11
+        int num_params = (cmd_buff[0] & 0x3F) + ((cmd_buff[0] >> 6) & 0x3F);
+
+        std::string name = (index < 0) ? Common::StringFromFormat("0x%08X", cmd_buff[0]) : m_functions[index].name;
+
+        std::string error = Common::StringFromFormat("unknown/unimplemented function '%s': port=%s",
+                                                     name.c_str(), GetPortName().c_str());
+        for (int i = 1; i <= num_params; ++i) {
+            error += Common::StringFromFormat(", cmd_buff[%i]=%u", i, cmd_buff[i]);
+        }
+
+        LOG_ERROR(Service, "%s", error.c_str());
+
+        // TODO(bunnei): Hack - ignore error
+        cmd_buff[1] = 0;
+        return MakeResult<bool>(false);
+    }
+
+    PROFILE_SCOPE(m_function_stats[index]);
+    PROFILE_SUBSYSTEM(ServiceIPC);
+    TRACE_SCOPE(HLE, m_functions[index].name);
+    m_functions[index].func(this);
+
+    return MakeResult<bool>(false); // TODO: Implement return from actual function
+}
+
+void Interface::DoState(PointerWrap& p) {
+    p.Do(m_handles);
+}
+
+void Interface::Register(const FunctionInfo* functions, int len) {
+    for (int i = 0; i < len; i++) {
+        auto itr = std::lower_bound(m_functions.begin(), m_functions.end(), functions[i].id,
+            [](const FunctionInfo& info, u32 id) { return info.id < id; });
+
+        // Registering an already known command replaces its previous handler
+        if (itr != m_functions.end() && itr->id == functions[i].id) {
+            *itr = functions[i];
+        } else {
+            m_functions.insert(itr, functions[i]);
+        }
+    }
+    ResetFunctionStats();
+    m_last_function = 0;
+}
+
+void Interface::LogFunctionStats() const {
+    for (size_t i = 0; i < m_functions.size(); ++i) {
+        const Common::Profiling::CallStats& stats = m_function_stats[i];
+        if (stats.num_calls == 0)
+            continue;
+
+        if (!Common::Profiling::IS_ENABLED) {
+            LOG_INFO(Service, "%s %s: %llu calls", GetPortName().c_str(), m_functions[i].name,
+                (unsigned long long)stats.num_calls);
+            continue;
+        }
+
+        const double total_ns = Common::Profiling::TicksToNanoseconds(stats.total_ticks);
+        LOG_INFO(Service, "%s %s: %llu calls, %.0f us total, %.0f ns average, %.0f ns max",
+            GetPortName().c_str(), m_functions[i].name, (unsigned long long)stats.num_calls,
+            total_ns / 1000, total_ns / stats.num_calls,
+            Common::Profiling::TicksToNanoseconds(stats.max_ticks));
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Service Manager class
 
@@ -45,6 +121,9 @@ Manager::Manager() {
 }
 
 Manager::~Manager() {
+    for (Interface* service : m_services) {
+        service->LogFunctionStats();
+    }
     for(Interface* service : m_services) {
         DeleteService(service->GetPortName());
     }
@@ -52,7 +131,7 @@ Manager::~Manager() {
 
 /// Add a service to the manager (does not create it though)
 void Manager::AddService(Interface* service) {
-    m_port_map[service->GetPortName()] = Kernel::g_object_pool.Create(service);
+    m_port_map[service->GetPortName()] = Kernel::g_handle_table.Create(service);
     m_services.push_back(service);
 }
 
@@ -66,7 +145,7 @@ void Manager::DeleteService(const std::string& port_name) {
 
 /// Get a Service Interface from its Handle
 Interface* Manager::FetchFromHandle(Handle handle) {
-    return Kernel::g_object_pool.Get<Interface>(handle);
+    return Kernel::g_handle_table.Get<Interface>(handle);
 }
 
 /// Get a Service Interface from its port
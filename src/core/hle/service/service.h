@@ -10,6 +10,7 @@
 #include <string>
 
 #include "common/common.h"
+#include "common/profiler.h"
 #include "common/string_util.h"
 #include "core/mem_map.h"
 
@@ -41,7 +42,7 @@ public:
     struct FunctionInfo {
         u32         id;
         Function    func;
-        std::string name;
+        const char* name;
     };
 
     /**
@@ -54,7 +55,7 @@ public:
 
     /// Allocates a new handle for the service
     Handle CreateHandle(Kernel::Object *obj) {
-        Handle handle = Kernel::g_object_pool.Create(obj);
+        Handle handle = Kernel::g_handle_table.Create(obj);
         m_handles.push_back(handle);
         return handle;
     }
@@ -62,52 +63,68 @@ public:
     /// Frees a handle from the service
     template <class T>
     void DeleteHandle(const Handle handle) {
-        Kernel::g_object_pool.Destroy<T>(handle);
+        Kernel::g_handle_table.Destroy<T>(handle);
         m_handles.erase(std::remove(m_handles.begin(), m_handles.end(), handle), m_handles.end());
     }
 
-    ResultVal<bool> SyncRequest() override {
-        u32* cmd_buff = Kernel::GetCommandBuffer();
-        auto itr = m_functions.find(cmd_buff[0]);
+    ResultVal<bool> SyncRequest() override;
 
-        if (itr == m_functions.end() || itr->second.func == nullptr) {
-            // Number of params == bits 0-5 + bits 6-11
-            int num_params = (cmd_buff[0] & 0x3F) + ((cmd_buff[0] >> 6) & 0x3F);
-
-            std::string error = "unknown/unimplemented function '%s': port=%s";
-            for (int i = 1; i <= num_params; ++i) {
-                error += Common::StringFromFormat(", cmd_buff[%i]=%u", i, cmd_buff[i]);
-            }
-
-            std::string name = (itr == m_functions.end()) ? Common::StringFromFormat("0x%08X", cmd_buff[0]) : itr->second.name;
-
-            LOG_ERROR(Service, error.c_str(), name.c_str(), GetPortName().c_str());
+    /**
+     * Saves or loads the state of the session. Services override this to also save the state of
+     * their module, calling the base version first.
+     */
+    void DoState(PointerWrap& p) override;
 
-            // TODO(bunnei): Hack - ignore error
-            cmd_buff[1] = 0;
-            return MakeResult<bool>(false);
-        }
+    /// Returns the registered functions of the service, sorted by command header
+    const std::vector<FunctionInfo>& GetFunctions() const { return m_functions; }
 
-        itr->second.func(this);
+    /**
+     * Returns the call statistics of each registered function, in the same order as GetFunctions.
+     * Calls are always counted, but only timed when the emulator is built with ENABLE_PROFILING.
+     */
+    const std::vector<Common::Profiling::CallStats>& GetFunctionStats() const { return m_function_stats; }
 
-        return MakeResult<bool>(false); // TODO: Implement return from actual function
+    /// Clears the call statistics of all functions of this service
+    void ResetFunctionStats() {
+        m_function_stats.assign(m_functions.size(), Common::Profiling::CallStats());
     }
 
+    /// Logs the call statistics of every function of this service that has been called
+    void LogFunctionStats() const;
+
 protected:
 
     /**
      * Registers the functions in the service
      */
-    void Register(const FunctionInfo* functions, int len) {
-        for (int i = 0; i < len; i++) {
-            m_functions[functions[i].id] = functions[i];
-        }
-    }
+    void Register(const FunctionInfo* functions, int len);
 
 private:
 
+    /**
+     * Looks up the function registered for a command header
+     * @return Index of the function in m_functions, or -1 if it isn't registered
+     */
+    int FindFunction(u32 command_header) {
+        // Sessions tend to issue the same command repeatedly (e.g. polling), so check the last
+        // resolved command before falling back to a binary search.
+        if (m_last_function < m_functions.size() && m_functions[m_last_function].id == command_header) {
+            return m_last_function;
+        }
+
+        auto itr = std::lower_bound(m_functions.begin(), m_functions.end(), command_header,
+            [](const FunctionInfo& info, u32 id) { return info.id < id; });
+        if (itr == m_functions.end() || itr->id != command_header) {
+            return -1;
+        }
+        m_last_function = itr - m_functions.begin();
+        return m_last_function;
+    }
+
     std::vector<Handle>         m_handles;
-    std::map<u32, FunctionInfo> m_functions;
+    std::vector<FunctionInfo>   m_functions;        ///< Registered functions, sorted by id
+    std::vector<Common::Profiling::CallStats> m_function_stats; ///< Indexed like m_functions
+    size_t                      m_last_function = 0; ///< Index of the last resolved function
 
 };
 
@@ -131,6 +148,9 @@ public:
     /// Get a Service Interface from its port
     Interface* FetchFromPortName(const std::string& port_name);
 
+    /// Get all services added to the manager
+    const std::vector<Interface*>& GetServices() const { return m_services; }
+
 private:
 
     std::vector<Interface*>     m_services;
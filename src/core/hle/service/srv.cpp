@@ -2,6 +2,8 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include "common/chunk_file.h"
+
 #include "core/hle/hle.h"
 #include "core/hle/service/srv.h"
 #include "core/hle/kernel/event.h"
@@ -64,6 +66,12 @@ const Interface::FunctionInfo FunctionTable[] = {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Interface class
 
+void Interface::DoState(PointerWrap& p) {
+    Service::Interface::DoState(p);
+
+    p.Do(g_event_handle);
+}
+
 Interface::Interface() {
     Register(FunctionTable, ARRAY_SIZE(FunctionTable));
 }
@@ -26,6 +26,8 @@ public:
         return "srv:";
     }
 
+    void DoState(PointerWrap& p) override;
+
 };
 
 } // namespace
@@ -92,7 +92,7 @@ static Result ConnectToPort(Handle* out, const char* port_name) {
 
 /// Synchronize to an OS service
 static Result SendSyncRequest(Handle handle) {
-    Kernel::Session* session = Kernel::g_object_pool.Get<Kernel::Session>(handle);
+    Kernel::Session* session = Kernel::g_handle_table.Get<Kernel::Session>(handle);
     if (session == nullptr) {
         return InvalidHandle(ErrorModule::Kernel).raw;
     }
@@ -119,11 +119,10 @@ static Result WaitSynchronization1(Handle handle, s64 nano_seconds) {
     // TODO(bunnei): Do something with nano_seconds, currently ignoring this
     bool wait_infinite = (nano_seconds == -1); // Used to wait until a thread has terminated
 
-    if (!Kernel::g_object_pool.IsValid(handle)) {
+    Kernel::Object* object = Kernel::g_handle_table.GetGeneric(handle);
+    if (object == nullptr) {
         return InvalidHandle(ErrorModule::Kernel).raw;
     }
-    Kernel::Object* object = Kernel::g_object_pool.GetFast<Kernel::Object>(handle);
-    _dbg_assert_(Kernel, object != nullptr);
 
     LOG_TRACE(Kernel_SVC, "called handle=0x%08X(%s:%s), nanoseconds=%lld", handle, object->GetTypeName().c_str(),
             object->GetName().c_str(), nano_seconds);
@@ -150,10 +149,10 @@ static Result WaitSynchronizationN(s32* out, Handle* handles, s32 handle_count,
 
     // Iterate through each handle, synchronize kernel object
     for (s32 i = 0; i < handle_count; i++) {
-        if (!Kernel::g_object_pool.IsValid(handles[i])) {
+        Kernel::Object* object = Kernel::g_handle_table.GetGeneric(handles[i]);
+        if (object == nullptr) {
             return InvalidHandle(ErrorModule::Kernel).raw;
         }
-        Kernel::Object* object = Kernel::g_object_pool.GetFast<Kernel::Object>(handles[i]);
 
         LOG_TRACE(Kernel_SVC, "\thandle[%d] = 0x%08X(%s:%s)", i, handles[i], object->GetTypeName().c_str(),
             object->GetName().c_str());
@@ -357,12 +356,14 @@ static void SleepThread(s64 nanoseconds) {
     HLE::Reschedule(__func__);
 }
 
-/// This returns the total CPU ticks elapsed since the CPU was powered-on
+/// This returns the total CPU ticks elapsed since the CPU was powered-on, in emulated time
 static s64 GetSystemTick() {
     return (s64)Core::g_app_core->GetTicks();
 }
 
-const HLE::FunctionDef SVC_Table[] = {
+// This table has no dynamic initializer, so it is constant-initialized by the compiler and CallSVC
+// can index it directly by SVC number.
+const HLE::FunctionDef SVC_Table[NUM_SVCS] = {
     {0x00, nullptr,                         "Unknown"},
     {0x01, HLE::Wrap<ControlMemory>,        "ControlMemory"},
     {0x02, HLE::Wrap<QueryMemory>,          "QueryMemory"},
@@ -489,10 +490,8 @@ const HLE::FunctionDef SVC_Table[] = {
     {0x7B, nullptr,                         "Unknown"},
     {0x7C, nullptr,                         "KernelSetState"},
     {0x7D, nullptr,                         "QueryProcessMemory"},
+    {0x7E, nullptr,                         "Unknown"},
+    {0x7F, nullptr,                         "Unknown"},
 };
 
-void Register() {
-    HLE::RegisterModule("SVC_Table", ARRAY_SIZE(SVC_Table), SVC_Table);
-}
-
 } // namespace
@@ -54,8 +54,15 @@ enum ArbitrationType {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Namespace SVC
 
+namespace HLE {
+struct FunctionDef;
+}
+
 namespace SVC {
 
-void Register();
+const u32 NUM_SVCS = 0x80; ///< Number of entries in SVC_Table
+
+/// Table of SVC handlers, indexed directly by SVC number
+extern const HLE::FunctionDef SVC_Table[NUM_SVCS];
 
 } // namespace
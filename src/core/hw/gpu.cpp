@@ -3,13 +3,18 @@
 // Refer to the license.txt file included.
 
 #include "common/common_types.h"
+#include "common/chunk_file.h"
+#include "common/profiler.h"
+#include "common/trace.h"
 
 #include "core/settings.h"
 #include "core/core.h"
+#include "core/frame_pacing.h"
 #include "core/mem_map.h"
 
 #include "core/hle/hle.h"
 #include "core/hle/service/gsp_gpu.h"
+#include "core/hle/service/hid_user.h"
 
 #include "core/hw/gpu.h"
 
@@ -82,6 +87,9 @@ inline void Write(u32 addr, const T data) {
     {
         const auto& config = g_regs.display_transfer_config;
         if (config.trigger & 1) {
+            PROFILE_SUBSYSTEM(DisplayTransfer);
+            TRACE_SCOPE(GPU, "DisplayTransfer");
+
             u8* source_pointer = Memory::GetPointer(Memory::PhysicalToVirtualAddress(config.GetPhysicalInputAddress()));
             u8* dest_pointer = Memory::GetPointer(Memory::PhysicalToVirtualAddress(config.GetPhysicalOutputAddress()));
 
@@ -190,8 +198,22 @@ void Update() {
     // threading reschedule).
 
     if ((current_ticks - g_last_frame_ticks) > GPU::kFrameTicks) {
-        VideoCore::g_renderer->SwapBuffers();
-        g_last_frame_ticks = current_ticks;
+        FramePacing::OnVBlank();
+        {
+            TRACE_SCOPE(GPU, "SwapBuffers");
+            const u64 swap_start_ticks = Common::Profiling::GetTicks();
+            VideoCore::g_renderer->SwapBuffers();
+            FramePacing::OnSwapBuffers(swap_start_ticks, Common::Profiling::GetTicks());
+        }
+
+        // Frames start every kFrameTicks, rather than kFrameTicks after the point at which the
+        // previous one was noticed, so that their timing doesn't depend on how often Update is
+        // called. Resynchronize if frames were missed entirely.
+        g_last_frame_ticks += GPU::kFrameTicks;
+        if ((current_ticks - g_last_frame_ticks) > GPU::kFrameTicks)
+            g_last_frame_ticks = current_ticks;
+
+        HID_User::Update();
     }
 
     // Synchronize GPU on a thread reschedule: Because we cannot accurately predict a vertical
@@ -222,6 +244,7 @@ void Init() {
 
     g_cur_line = 0;
     g_last_frame_ticks = g_last_line_ticks = Core::g_app_core->GetTicks();
+    FramePacing::Reset(Settings::values.gpu_refresh_rate);
 
     auto& framebuffer_top = g_regs.framebuffer_config[0];
     auto& framebuffer_sub = g_regs.framebuffer_config[1];
@@ -259,4 +282,16 @@ void Shutdown() {
     LOG_DEBUG(HW_GPU, "shutdown OK");
 }
 
+void DoState(PointerWrap& p) {
+    auto s = p.Section("GPU", 1);
+    if (!s)
+        return;
+
+    // The register set is plain data, but its BitFields keep it from being recognized as POD
+    p.DoVoid(&g_regs, sizeof(g_regs));
+    p.Do(g_cur_line);
+    p.Do(g_last_line_ticks);
+    p.Do(g_last_frame_ticks);
+}
+
 } // namespace
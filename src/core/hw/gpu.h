@@ -9,6 +9,8 @@
 #include "common/common_types.h"
 #include "common/bit_field.h"
 
+class PointerWrap;
+
 namespace GPU {
 
 // Returns index corresponding to the Regs member labeled by field_name
@@ -257,5 +259,8 @@ void Init();
 /// Shutdown hardware
 void Shutdown();
 
+/// Saves or loads the GPU registers and the screen timing
+void DoState(PointerWrap& p);
+
 
 } // namespace
@@ -89,4 +89,8 @@ void Shutdown() {
     LOG_DEBUG(HW, "shutdown OK");
 }
 
+void DoState(PointerWrap& p) {
+    GPU::DoState(p);
+}
+
 }
\ No newline at end of file
@@ -6,6 +6,8 @@
 
 #include "common/common_types.h"
 
+class PointerWrap;
+
 namespace HW {
 
 template <typename T>
@@ -23,4 +25,7 @@ void Init();
 /// Shutdown hardware
 void Shutdown();
 
+/// Saves or loads the state of the hardware
+void DoState(PointerWrap& p);
+
 } // namespace
@@ -5,6 +5,8 @@
 #include <algorithm>
 #include <vector>
 
+#include "common/file_util.h"
+
 #include "core/file_sys/archive_romfs.h"
 #include "core/loader/elf.h"
 #include "core/loader/ncch.h"
@@ -43,7 +45,6 @@ enum THREEDSX_Error {
     ERROR_FILE = 2,
     ERROR_ALLOC = 3
 };
-static const u32 RELOCBUFSIZE = 512;
 
 // File header
 static const u32 THREEDSX_MAGIC = 0x58534433; // '3DSX'
@@ -104,13 +105,38 @@ static u32 TranslateAddr(u32 addr, THREEloadinfo *loadinfo, u32* offsets)
 
 int THREEDSXReader::Load3DSXFile(const std::string& filename, u32 base_addr)
 {
-    FileUtil::IOFile file(filename, "rb");
-    if (!file.IsOpen()) {
-        return ERROR_FILE;
+    // Map the file so that segments and relocation tables are read from it in place. Fall back to
+    // reading it whole if it can't be mapped.
+    u64 file_size = FileUtil::GetSize(filename);
+    FileUtil::MappedFile mapping;
+    std::vector<u8> buffer;
+    const u8* file_data;
+    if (mapping.Open(filename, 0, file_size)) {
+        file_data = mapping.GetData();
+    } else {
+        FileUtil::IOFile file(filename, "rb");
+        if (!file.IsOpen())
+            return ERROR_FILE;
+        buffer.resize((size_t)file_size);
+        if (file.ReadBytes(buffer.data(), buffer.size()) != buffer.size())
+            return ERROR_READ;
+        file_data = buffer.data();
     }
+
+    // Returns a pointer to [offset, offset + size) of the file, or nullptr if it's out of bounds
+    auto GetFileData = [&](u64 offset, u64 size) -> const u8* {
+        if (offset > file_size || size > file_size - offset)
+            return nullptr;
+        return file_data + offset;
+    };
+
     THREEDSX_Header hdr;
-    if (file.ReadBytes(&hdr, sizeof(hdr)) != sizeof(hdr))
+    const u8* hdr_data = GetFileData(0, sizeof(hdr));
+    if (hdr_data == nullptr)
         return ERROR_READ;
+    memcpy(&hdr, hdr_data, sizeof(hdr));
+    if (hdr.bss_size > hdr.data_seg_size)
+        return ERROR_FILE;
 
     THREEloadinfo loadinfo;
     //loadinfo segments must be a multiple of 0x1000
@@ -121,84 +147,83 @@ int THREEDSXReader::Load3DSXFile(const std::string& filename, u32 base_addr)
     u32 data_load_size = (hdr.data_seg_size - hdr.bss_size + 0xFFF) &~0xFFF;
     u32 bss_load_size = loadinfo.seg_sizes[2] - data_load_size;
     u32 n_reloc_tables = hdr.reloc_hdr_size / 4;
-    std::vector<u8> all_mem(loadinfo.seg_sizes[0] + loadinfo.seg_sizes[1] + loadinfo.seg_sizes[2] + 3 * n_reloc_tables);
+    u64 image_size = (u64)loadinfo.seg_sizes[0] + loadinfo.seg_sizes[1] + loadinfo.seg_sizes[2];
+
+    // The segments are loaded and relocated directly in guest memory
+    Memory::GuestBuffer image(base_addr, image_size);
+    u8* image_ptr = image.GetContiguousPointer();
+    if (image_ptr == nullptr) {
+        LOG_ERROR(Loader, "3DSX image doesn't fit in memory (size=0x%llX)",
+                  (unsigned long long)image_size);
+        return ERROR_ALLOC;
+    }
 
     loadinfo.seg_addrs[0] = base_addr;
     loadinfo.seg_addrs[1] = loadinfo.seg_addrs[0] + loadinfo.seg_sizes[0];
     loadinfo.seg_addrs[2] = loadinfo.seg_addrs[1] + loadinfo.seg_sizes[1];
-    loadinfo.seg_ptrs[0] = &all_mem[0];
+    loadinfo.seg_ptrs[0] = image_ptr;
     loadinfo.seg_ptrs[1] = loadinfo.seg_ptrs[0] + loadinfo.seg_sizes[0];
     loadinfo.seg_ptrs[2] = loadinfo.seg_ptrs[1] + loadinfo.seg_sizes[1];
 
     // Skip header for future compatibility
-    file.Seek(hdr.header_size, SEEK_SET);
+    u64 offset = hdr.header_size;
 
-    // Read the relocation headers
-    u32* relocs = (u32*)(loadinfo.seg_ptrs[2] + hdr.data_seg_size);
+    // The relocation headers of the three segments
+    const u8* relocs_data = GetFileData(offset, 3 * n_reloc_tables * 4);
+    if (relocs_data == nullptr)
+        return ERROR_READ;
+    std::vector<u32> relocs(3 * n_reloc_tables);
+    if (!relocs.empty())
+        memcpy(relocs.data(), relocs_data, relocs.size() * 4);
+    offset += relocs.size() * 4;
 
+    // Copy the segments, zeroing the page padding after each of them and the BSS
+    const u32 seg_load_sizes[3] = { hdr.code_seg_size, hdr.rodata_seg_size, hdr.data_seg_size - hdr.bss_size };
     for (u32 current_segment = 0; current_segment < 3; current_segment++) {
-        if (file.ReadBytes(&relocs[current_segment*n_reloc_tables], n_reloc_tables * 4) != n_reloc_tables * 4)
+        u32 load_size = seg_load_sizes[current_segment];
+        const u8* seg_data = GetFileData(offset, load_size);
+        if (seg_data == nullptr)
             return ERROR_READ;
+        memcpy(loadinfo.seg_ptrs[current_segment], seg_data, load_size);
+        memset(loadinfo.seg_ptrs[current_segment] + load_size, 0, loadinfo.seg_sizes[current_segment] - load_size);
+        offset += load_size;
     }
 
-    // Read the segments
-    if (file.ReadBytes(loadinfo.seg_ptrs[0], hdr.code_seg_size) != hdr.code_seg_size)
-        return ERROR_READ;
-    if (file.ReadBytes(loadinfo.seg_ptrs[1], hdr.rodata_seg_size) != hdr.rodata_seg_size)
-        return ERROR_READ;
-    if (file.ReadBytes(loadinfo.seg_ptrs[2], hdr.data_seg_size - hdr.bss_size) != hdr.data_seg_size - hdr.bss_size)
-        return ERROR_READ;
-
-    // BSS clear
-    memset((char*)loadinfo.seg_ptrs[2] + hdr.data_seg_size - hdr.bss_size, 0, hdr.bss_size);
-
-    // Relocate the segments
+    // Relocate the segments in place, reading the relocation tables straight from the file
     for (u32 current_segment = 0; current_segment < 3; current_segment++) {
         for (u32 current_segment_reloc_table = 0; current_segment_reloc_table < n_reloc_tables; current_segment_reloc_table++) {
             u32 n_relocs = relocs[current_segment*n_reloc_tables + current_segment_reloc_table];
+            const THREEDSX_Reloc* reloc_table = (const THREEDSX_Reloc*)GetFileData(offset, (u64)n_relocs * sizeof(THREEDSX_Reloc));
+            if (reloc_table == nullptr)
+                return ERROR_READ;
+            offset += (u64)n_relocs * sizeof(THREEDSX_Reloc);
+
             if (current_segment_reloc_table >= 2) {
                 // We are not using this table - ignore it because we don't know what it dose
-                file.Seek(n_relocs*sizeof(THREEDSX_Reloc), SEEK_CUR);
                 continue;
             }
-            static THREEDSX_Reloc reloc_table[RELOCBUFSIZE];
 
             u32* pos = (u32*)loadinfo.seg_ptrs[current_segment];
             u32* end_pos = pos + (loadinfo.seg_sizes[current_segment] / 4);
-
-            while (n_relocs) {
-                u32 remaining = std::min(RELOCBUFSIZE, n_relocs);
-                n_relocs -= remaining;
-
-                if (file.ReadBytes(reloc_table, remaining*sizeof(THREEDSX_Reloc)) != remaining*sizeof(THREEDSX_Reloc))
-                    return ERROR_READ;
-
-                for (u32 current_inprogress = 0; current_inprogress < remaining && pos < end_pos; current_inprogress++) {
-                    LOG_TRACE(Loader, "(t=%d,skip=%u,patch=%u)\n",
-                        current_segment_reloc_table, (u32)reloc_table[current_inprogress].skip, (u32)reloc_table[current_inprogress].patch);
-                    pos += reloc_table[current_inprogress].skip;
-                    s32 num_patches = reloc_table[current_inprogress].patch;
-                    while (0 < num_patches && pos < end_pos) {
-                        u32 in_addr = (char*)pos - (char*)&all_mem[0];
-                        u32 addr = TranslateAddr(*pos, &loadinfo, offsets);
-                        LOG_TRACE(Loader, "Patching %08X <-- rel(%08X,%d) (%08X)\n",
-                            base_addr + in_addr, addr, current_segment_reloc_table, *pos);
-                        switch (current_segment_reloc_table) {
-                        case 0: *pos = (addr); break;
-                        case 1: *pos = (addr - in_addr); break;
-                        default: break; //this should never happen
-                        }
-                        pos++;
-                        num_patches--;
+            const bool relative = (current_segment_reloc_table == 1);
+
+            for (u32 current_inprogress = 0; current_inprogress < n_relocs && pos < end_pos; current_inprogress++) {
+                pos += reloc_table[current_inprogress].skip;
+                u32* patch_end = std::min(pos + reloc_table[current_inprogress].patch, end_pos);
+                for (; pos < patch_end; pos++) {
+                    u32 addr = TranslateAddr(*pos, &loadinfo, offsets);
+                    if (relative) {
+                        // Relative to the address of the word being patched
+                        u32 in_addr = base_addr + (u32)((u8*)pos - image_ptr);
+                        *pos = addr - in_addr;
+                    } else {
+                        *pos = addr;
                     }
                 }
             }
         }
     }
 
-    // Write the data
-    memcpy(Memory::GetPointer(base_addr), &all_mem[0], loadinfo.seg_sizes[0] + loadinfo.seg_sizes[1] + loadinfo.seg_sizes[2]);
-
     LOG_DEBUG(Loader, "CODE:   %u pages\n", loadinfo.seg_sizes[0] / 0x1000);
     LOG_DEBUG(Loader, "RODATA: %u pages\n", loadinfo.seg_sizes[1] / 0x1000);
     LOG_DEBUG(Loader, "DATA:   %u pages\n", data_load_size / 0x1000);
@@ -221,13 +246,18 @@ int THREEDSXReader::Load3DSXFile(const std::string& filename, u32 base_addr)
     */
     ResultStatus AppLoader_THREEDSX::Load() {
         LOG_INFO(Loader, "Loading 3DSX file %s...", filename.c_str());
-        FileUtil::IOFile file(filename, "rb");
-        if (file.IsOpen()) {
-            THREEDSXReader::Load3DSXFile(filename, 0x00100000);
-            Kernel::LoadExec(0x00100000);
-        } else {
+        u32 entry_point;
+        ResultStatus result = LoadImage(filename, entry_point);
+        if (result != ResultStatus::Success)
+            return result;
+        Kernel::LoadExec(entry_point);
+        return ResultStatus::Success;
+    }
+
+    ResultStatus AppLoader_THREEDSX::LoadImage(const std::string& filename, u32& entry_point) {
+        if (THREEDSXReader::Load3DSXFile(filename, 0x00100000) != ERROR_NONE)
             return ResultStatus::Error;
-        }
+        entry_point = 0x00100000;
         return ResultStatus::Success;
     }
 
@@ -2,8 +2,10 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <limits>
 #include <string>
 #include <memory>
+#include <vector>
 
 #include "common/common.h"
 #include "common/file_util.h"
@@ -100,6 +102,13 @@ enum ElfSectionFlags
 #define PT_LOPROC  0x70000000
 #define PT_HIPROC  0x7FFFFFFF
 
+// ARM relocation types
+#define R_ARM_NONE          0
+#define R_ARM_ABS32         2
+#define R_ARM_RELATIVE     23
+
+#define ELF32_R_TYPE(info) ((info) & 0xFF)
+
 typedef unsigned int  Elf32_Addr;
 typedef unsigned short Elf32_Half;
 typedef unsigned int  Elf32_Off;
@@ -182,12 +191,24 @@ private:
     Elf32_Phdr *segments;
     Elf32_Shdr *sections;
 
+    u32 size;
+
     u32 *sectionAddrs;
     bool relocate;
     u32 entryPoint;
 
+    bool ApplyRelocations(u32 vaddr);
+
 public:
-    ElfReader(void *ptr);
+    ElfReader(void *ptr, u32 size);
+
+    /**
+     * Checks that the headers of an ELF image, and the tables they point to, fit in the image
+     * @param ptr Pointer to the image
+     * @param size Size of the image in bytes
+     * @return True if the image can be passed to ElfReader
+     */
+    static bool IsValid(const void *ptr, u32 size);
     ~ElfReader() { }
 
     u32 Read32(int off) const { return base32[off >> 2]; }
@@ -227,7 +248,7 @@ public:
     }
 };
 
-ElfReader::ElfReader(void *ptr) {
+ElfReader::ElfReader(void *ptr, u32 size) : size(size) {
     base = (char*)ptr;
     base32 = (u32 *)ptr;
     header = (Elf32_Ehdr*)ptr;
@@ -267,8 +288,7 @@ bool ElfReader::LoadInto(u32 vaddr) {
     }
     LOG_DEBUG(Loader, "%i segments:", header->e_phnum);
 
-    // First pass : Get the bits into RAM
-    u32 segment_addr[32];
+    // First pass : Get the bits into RAM, straight from the image
     u32 base_addr = relocate ? vaddr : 0;
 
     for (int i = 0; i < header->e_phnum; i++) {
@@ -276,17 +296,103 @@ bool ElfReader::LoadInto(u32 vaddr) {
         LOG_DEBUG(Loader, "Type: %i Vaddr: %08x Filesz: %i Memsz: %i ", p->p_type, p->p_vaddr,
             p->p_filesz, p->p_memsz);
 
-        if (p->p_type == PT_LOAD) {
-            segment_addr[i] = base_addr + p->p_vaddr;
-            memcpy(Memory::GetPointer(segment_addr[i]), GetSegmentPtr(i), p->p_filesz);
-            LOG_DEBUG(Loader, "Loadable Segment Copied to %08x, size %08x", segment_addr[i],
-                p->p_memsz);
+        if (p->p_type != PT_LOAD)
+            continue;
+
+        if (p->p_offset > size || p->p_filesz > size - p->p_offset || p->p_filesz > p->p_memsz) {
+            LOG_ERROR(Loader, "Segment %i lies outside of the file", i);
+            return false;
+        }
+
+        u32 segment_addr = base_addr + p->p_vaddr;
+        Memory::GuestBuffer dest(segment_addr, p->p_memsz);
+        if (!dest.IsValid()) {
+            LOG_ERROR(Loader, "Segment %i doesn't fit in memory (address=%08x, size=%08x)", i,
+                      segment_addr, p->p_memsz);
+            return false;
+        }
+
+        // The part of the segment which isn't in the file is zero-initialized (BSS)
+        if (u8* dest_ptr = dest.GetContiguousPointer()) {
+            memcpy(dest_ptr, GetSegmentPtr(i), p->p_filesz);
+            memset(dest_ptr + p->p_filesz, 0, p->p_memsz - p->p_filesz);
+        } else {
+            dest.Write(0, GetSegmentPtr(i), p->p_filesz);
+            std::vector<u8> zeros(p->p_memsz - p->p_filesz);
+            dest.Write(p->p_filesz, zeros.data(), (u32)zeros.size());
         }
+        LOG_DEBUG(Loader, "Loadable Segment Copied to %08x, size %08x", segment_addr, p->p_memsz);
     }
+
+    if (relocate && header->e_type == ET_DYN && !ApplyRelocations(vaddr))
+        return false;
+
     LOG_DEBUG(Loader, "Done loading.");
     return true;
 }
 
+/**
+ * Applies the REL relocations of a position-independent image loaded at vaddr. The relocation
+ * tables are read in place from the image and patched into guest memory in a single pass each;
+ * only R_ARM_RELATIVE is needed for images which have no external symbols.
+ * @param vaddr Address the image was loaded at
+ * @return True on success
+ */
+bool ElfReader::ApplyRelocations(u32 vaddr) {
+    u32 unsupported = 0;
+    for (int i = 0; i < header->e_shnum; i++) {
+        const Elf32_Shdr& section = sections[i];
+        if (section.sh_type != SHT_REL)
+            continue;
+
+        if (section.sh_offset > size || section.sh_size > size - section.sh_offset) {
+            LOG_ERROR(Loader, "Relocation section %i lies outside of the file", i);
+            return false;
+        }
+
+        const Elf32_Rel* rel = (const Elf32_Rel*)GetPtr(section.sh_offset);
+        const Elf32_Rel* rel_end = rel + section.sh_size / sizeof(Elf32_Rel);
+        for (; rel != rel_end; ++rel) {
+            switch (ELF32_R_TYPE(rel->r_info)) {
+            case R_ARM_NONE:
+                break;
+
+            case R_ARM_RELATIVE:
+            {
+                Memory::GuestSpan<u32> target(vaddr + rel->r_offset, 1);
+                if (!target.IsValid()) {
+                    LOG_ERROR(Loader, "Relocation target %08x is out of range", rel->r_offset);
+                    return false;
+                }
+                target.Set(0, target.Get(0) + vaddr);
+                break;
+            }
+
+            default:
+                ++unsupported;
+                break;
+            }
+        }
+    }
+
+    if (unsupported != 0)
+        LOG_WARNING(Loader, "Skipped %u relocations of unsupported types", unsupported);
+    return true;
+}
+
+bool ElfReader::IsValid(const void *ptr, u32 size) {
+    if (size < sizeof(Elf32_Ehdr))
+        return false;
+
+    const Elf32_Ehdr *header = (const Elf32_Ehdr*)ptr;
+    if (memcmp(header->e_ident, "\x7F" "ELF", 4) != 0)
+        return false;
+
+    const u64 phdrs_end = (u64)header->e_phoff + (u64)header->e_phnum * sizeof(Elf32_Phdr);
+    const u64 shdrs_end = (u64)header->e_shoff + (u64)header->e_shnum * sizeof(Elf32_Shdr);
+    return phdrs_end <= size && shdrs_end <= size;
+}
+
 SectionID ElfReader::GetSectionByName(const char *name, int firstSection) const {
     for (int i = firstSection; i < header->e_shnum; i++) {
         const char *secname = GetSectionName(i);
@@ -351,19 +457,45 @@ ResultStatus AppLoader_ELF::Load() {
     if (is_loaded)
         return ResultStatus::ErrorAlreadyLoaded;
 
-    FileUtil::IOFile file(filename, "rb");
-
-    if (file.IsOpen()) {
-        u32 size = (u32)file.GetSize();
-        std::unique_ptr<u8[]> buffer(new u8[size]);
-        file.ReadBytes(&buffer[0], size);
+    u32 entry_point;
+    ResultStatus result = LoadImage(filename, entry_point);
+    if (result != ResultStatus::Success)
+        return result;
+    Kernel::LoadExec(entry_point);
+    return ResultStatus::Success;
+}
 
-        ElfReader elf_reader(&buffer[0]);
-        elf_reader.LoadInto(0x00100000);
-        Kernel::LoadExec(elf_reader.GetEntryPoint());
+ResultStatus AppLoader_ELF::LoadImage(const std::string& filename, u32& entry_point) {
+    // Map the file so that segments and relocation tables are read from it in place. Fall back to
+    // reading it whole if it can't be mapped.
+    u64 file_size = FileUtil::GetSize(filename);
+    if (file_size > std::numeric_limits<u32>::max())
+        return ResultStatus::ErrorInvalidFormat;
+
+    FileUtil::MappedFile mapping;
+    std::vector<u8> buffer;
+    const u8* image;
+    if (mapping.Open(filename, 0, file_size)) {
+        image = mapping.GetData();
     } else {
-        return ResultStatus::Error;
+        FileUtil::IOFile file(filename, "rb");
+        if (!file.IsOpen())
+            return ResultStatus::Error;
+
+        buffer.resize((size_t)file_size);
+        if (file.ReadBytes(buffer.data(), buffer.size()) != buffer.size())
+            return ResultStatus::Error;
+        image = buffer.data();
     }
+
+    if (!ElfReader::IsValid(image, (u32)file_size))
+        return ResultStatus::ErrorInvalidFormat;
+
+    // ElfReader only reads from the image
+    ElfReader elf_reader(const_cast<u8*>(image), (u32)file_size);
+    if (!elf_reader.LoadInto(0x00100000))
+        return ResultStatus::Error;
+    entry_point = elf_reader.GetEntryPoint();
     return ResultStatus::Success;
 }
 
@@ -24,6 +24,14 @@ public:
      */
     ResultStatus Load() override;
 
+    /**
+     * Loads the segments of an ELF file into guest memory, without starting it
+     * @param filename Path of the file
+     * @param entry_point Set to the address execution starts at
+     * @return ResultStatus result of function
+     */
+    static ResultStatus LoadImage(const std::string& filename, u32& entry_point);
+
 private:
     std::string filename;
     bool        is_loaded;
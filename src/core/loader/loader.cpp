@@ -91,7 +91,9 @@ ResultStatus LoadFile(const std::string& filename) {
         FileUtil::IOFile file(filename, "rb");
 
         if (file.IsOpen()) {
-            file.ReadBytes(Memory::GetPointer(Memory::EXEFS_CODE_VADDR), (size_t)file.GetSize());
+            u8* code = Memory::GetPointer(Memory::EXEFS_CODE_VADDR);
+            Memory::PrepareHostWrite(code, (size_t)file.GetSize());
+            file.ReadBytes(code, (size_t)file.GetSize());
             Kernel::LoadExec(Memory::EXEFS_CODE_VADDR);
         } else {
             return ResultStatus::Error;
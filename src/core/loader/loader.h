@@ -86,11 +86,14 @@ public:
     }
 
     /**
-     * Get the RomFS of the application
-     * @param buffer Reference to buffer to store data
+     * Get the location of the RomFS of the application. The RomFS isn't read here, so that it can
+     * be mapped or read on demand instead of being loaded into memory all at once.
+     * @param romfs_file Reference to string to store the name of the file containing the RomFS
+     * @param offset Reference to store the offset of the RomFS within the file
+     * @param size Reference to store the size of the RomFS
      * @return ResultStatus result of function
      */
-    virtual ResultStatus ReadRomFS(std::vector<u8>& buffer) const {
+    virtual ResultStatus ReadRomFS(std::string& romfs_file, u64& offset, u64& size) const {
         return ResultStatus::ErrorNotImplemented;
     }
 };
@@ -2,67 +2,56 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <cstring>
 #include <memory>
 
 #include "common/file_util.h"
+#include "common/hash.h"
+#include "common/string_util.h"
 
 #include "core/loader/ncch.h"
 #include "core/hle/kernel/kernel.h"
 #include "core/mem_map.h"
+#include "core/settings.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Loader namespace
 
 namespace Loader {
 
-static const int kMaxSections   = 8;        ///< Maximum number of sections (files) in an ExeFs
 static const int kBlockSize     = 0x200;    ///< Size of ExeFS blocks (in bytes)
 
-/**
- * Get the decompressed size of an LZSS compressed ExeFS file
- * @param buffer Buffer of compressed file
- * @param size Size of compressed buffer
- * @return Size of decompressed buffer
- */
-static u32 LZSS_GetDecompressedSize(u8* buffer, u32 size) {
-    u32 offset_size = *(u32*)(buffer + size - 4);
+u32 LZSS_GetDecompressedSize(const u8* buffer, u32 size) {
+    u32 offset_size;
+    memcpy(&offset_size, buffer + size - 4, sizeof(u32));
     return offset_size + size;
 }
 
-/**
- * Decompress ExeFS file (compressed with LZSS)
- * @param compressed Compressed buffer
- * @param compressed_size Size of compressed buffer
- * @param decompressed Decompressed buffer
- * @param decompressed_size Size of decompressed buffer
- * @return True on success, otherwise false
- */
-static bool LZSS_Decompress(u8* compressed, u32 compressed_size, u8* decompressed, u32 decompressed_size) {
-    u8* footer = compressed + compressed_size - 8;
-    u32 buffer_top_and_bottom = *(u32*)footer;
-    u32 out = decompressed_size;
-    u32 index = compressed_size - ((buffer_top_and_bottom >> 24) & 0xFF);
-    u32 stop_index = compressed_size - (buffer_top_and_bottom & 0xFFFFFF);
+bool LZSS_Decompress(const u8* compressed, u32 compressed_size, u8* decompressed, u32 decompressed_size) {
+    if (compressed_size < 8 || decompressed_size < compressed_size)
+        return false;
 
-    memset(decompressed, 0, decompressed_size);
-    memcpy(decompressed, compressed, compressed_size);
+    u32 buffer_top_and_bottom;
+    memcpy(&buffer_top_and_bottom, compressed + compressed_size - 8, sizeof(u32));
+    u32 top = (buffer_top_and_bottom >> 24) & 0xFF;
+    u32 bottom = buffer_top_and_bottom & 0xFFFFFF;
+    if (top > compressed_size)
+        return false;
 
-    while(index > stop_index) {
-       u8 control = compressed[--index];
+    u32 out = decompressed_size;
+    u32 index = compressed_size - top;
+    // A compressed region starting before the file has nothing to decompress
+    u32 stop_index = (bottom > compressed_size) ? index : compressed_size - bottom;
 
-        for(u32 i = 0; i < 8; i++) {
-            if(index <= stop_index)
-                break;
-            if(index <= 0)
-                break;
-            if(out <= 0)
-                break;
+    while (index > stop_index && out > 0) {
+        u8 control = compressed[--index];
 
-            if(control & 0x80) {
+        for (int i = 0; i < 8 && index > stop_index && out > 0; i++, control <<= 1) {
+            if (control & 0x80) {
                 // Check if compression is out of bounds
-                if(index < 2) {
+                if (index < 2)
                     return false;
-                }
                 index -= 2;
 
                 u32 segment_offset = compressed[index] | (compressed[index + 1] << 8);
@@ -70,32 +59,258 @@ static bool LZSS_Decompress(u8* compressed, u32 compressed_size, u8* decompresse
                 segment_offset &= 0x0FFF;
                 segment_offset += 2;
 
-                // Check if compression is out of bounds
-                if(out < segment_size) {
+                // Check if compression is out of bounds, for the whole segment at once
+                if (out < segment_size || out + segment_offset >= decompressed_size)
                     return false;
+
+                // The segment is copied from higher to lower addresses, so when it overlaps its
+                // source it repeats the bytes it has just written
+                u8* dest = decompressed + out - segment_size;
+                const u8* src = dest + segment_offset + 1;
+                if (segment_offset + 1 >= segment_size) {
+                    memcpy(dest, src, segment_size);
+                } else {
+                    for (u32 j = segment_size; j-- > 0;)
+                        dest[j] = src[j];
                 }
-                for(u32 j = 0; j < segment_size; j++) {
-                    // Check if compression is out of bounds
-                    if(out + segment_offset >= decompressed_size) {
-                        return false;
-                    }
-
-                    u8 data  = decompressed[out + segment_offset];
-                    decompressed[--out] = data;
-                }
+                out -= segment_size;
             } else {
-                // Check if compression is out of bounds
-                if(out < 1) {
-                    return false;
-                }
                 decompressed[--out] = compressed[--index];
             }
-            control <<= 1;
         }
     }
+
+    // Everything below the decompressed data is stored as is, padded with zeroes
+    memcpy(decompressed, compressed, std::min(compressed_size, out));
+    if (out > compressed_size)
+        memset(decompressed + compressed_size, 0, out - compressed_size);
+    return true;
+}
+
+/// Header of the files of the decompressed code cache, followed by the code
+struct CodeCacheHeader {
+    u32 magic;
+    u32 version;
+    u64 program_id;
+    u32 code_size;
+    u32 reserved;
+    ExeFs_Header exefs_header; ///< ExeFS header of the application the code was decompressed from
+};
+
+static const u32 CODE_CACHE_MAGIC   = 0x444F4343; // 'CCOD'
+static const u32 CODE_CACHE_VERSION = 1;
+
+/**
+ * Get the path of the file caching the decompressed code of an application
+ * @param program_id Program ID of the application
+ * @param exefs_header ExeFS header of the application, which includes the hashes of its sections
+ * @return Path of the cache file
+ */
+static std::string GetCodeCachePath(u64 program_id, const ExeFs_Header& exefs_header) {
+    u32 exefs_hash = HashAdler32(reinterpret_cast<const u8*>(&exefs_header), sizeof(ExeFs_Header));
+    return FileUtil::GetUserPath(D_CACHE_IDX) + "code" DIR_SEP +
+        Common::StringFromFormat("%016llX_%08X.bin", (unsigned long long)program_id, exefs_hash);
+}
+
+/**
+ * Reads the decompressed code of an application from the code cache
+ * @param program_id Program ID of the application
+ * @param exefs_header ExeFS header of the application
+ * @param get_buffer Called with the size of the code, returns the buffer to read it into
+ * @return True if the code was read from the cache
+ */
+static bool LoadCachedCode(u64 program_id, const ExeFs_Header& exefs_header,
+                           const std::function<u8*(u32)>& get_buffer) {
+    FileUtil::IOFile file(GetCodeCachePath(program_id, exefs_header), "rb");
+    if (!file.IsOpen())
+        return false;
+
+    CodeCacheHeader header;
+    if (file.ReadBytes(&header, sizeof(header)) != sizeof(header) ||
+        header.magic != CODE_CACHE_MAGIC || header.version != CODE_CACHE_VERSION ||
+        header.program_id != program_id ||
+        memcmp(&header.exefs_header, &exefs_header, sizeof(ExeFs_Header)) != 0 ||
+        file.GetSize() != sizeof(header) + header.code_size) {
+        LOG_WARNING(Loader, "Ignoring stale or invalid code cache entry");
+        return false;
+    }
+
+    u8* buffer = get_buffer(header.code_size);
+    if (buffer == nullptr || file.ReadBytes(buffer, header.code_size) != header.code_size)
+        return false;
+
+    LOG_INFO(Loader, "Loaded decompressed code from the cache");
     return true;
 }
 
+/**
+ * Stores the decompressed code of an application in the code cache
+ * @param program_id Program ID of the application
+ * @param exefs_header ExeFS header of the application
+ * @param code Decompressed code
+ * @param code_size Size of the decompressed code
+ */
+static void StoreCachedCode(u64 program_id, const ExeFs_Header& exefs_header, const u8* code,
+                            u32 code_size) {
+    std::string path = GetCodeCachePath(program_id, exefs_header);
+    std::string temp_path = path + ".tmp";
+    if (!FileUtil::CreateFullPath(path))
+        return;
+
+    CodeCacheHeader header = {};
+    header.magic = CODE_CACHE_MAGIC;
+    header.version = CODE_CACHE_VERSION;
+    header.program_id = program_id;
+    header.code_size = code_size;
+    header.exefs_header = exefs_header;
+
+    // Write the entry to a temporary file first, so that an interrupted write leaves no broken entry
+    bool written;
+    {
+        FileUtil::IOFile file(temp_path, "wb");
+        written = file.WriteBytes(&header, sizeof(header)) == sizeof(header) &&
+                  file.WriteBytes(code, code_size) == code_size && file.Close();
+    }
+    if (!written || !FileUtil::Replace(temp_path, path)) {
+        LOG_WARNING(Loader, "Unable to write code cache entry %s", path.c_str());
+        FileUtil::Delete(temp_path);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// NCCHContainer class
+
+NCCHContainer::NCCHContainer() {
+    is_open = false;
+    num_partitions = 0;
+    ncch_offset = 0;
+    exefs_offset = 0;
+}
+
+ResultStatus NCCHContainer::Open(const std::string& filename, u32 partition) {
+    this->filename = filename;
+    is_open = false;
+
+    // Map the whole file, or keep it open if it can't be mapped
+    u64 file_size = FileUtil::GetSize(filename);
+    if (!mapping.Open(filename, 0, file_size) && !file.Open(filename, "rb")) {
+        LOG_ERROR(Loader, "Unable to read file %s!", filename.c_str());
+        return ResultStatus::Error;
+    }
+
+    if (Read(0, sizeof(NCCH_Header), &ncch_header) != sizeof(NCCH_Header))
+        return ResultStatus::ErrorInvalidFormat;
+
+    if (0 == memcmp(&ncch_header.magic, "NCSD", 4)) {
+        NCSD_Header ncsd_header;
+        if (Read(0, sizeof(NCSD_Header), &ncsd_header) != sizeof(NCSD_Header))
+            return ResultStatus::ErrorInvalidFormat;
+
+        num_partitions = 0;
+        for (const NCSD_Partition& ncsd_partition : ncsd_header.partitions) {
+            if (ncsd_partition.size != 0)
+                num_partitions++;
+        }
+
+        if (partition >= ARRAY_SIZE(ncsd_header.partitions) ||
+            ncsd_header.partitions[partition].size == 0) {
+            LOG_ERROR(Loader, "NCSD file %s has no partition %u", filename.c_str(), partition);
+            return ResultStatus::ErrorNotUsed;
+        }
+
+        ncch_offset = (u64)ncsd_header.partitions[partition].offset * kBlockSize;
+        if (Read(ncch_offset, sizeof(NCCH_Header), &ncch_header) != sizeof(NCCH_Header))
+            return ResultStatus::ErrorInvalidFormat;
+    } else {
+        num_partitions = 1;
+        ncch_offset = 0;
+    }
+
+    // Verify we are loading the correct file type...
+    if (0 != memcmp(&ncch_header.magic, "NCCH", 4))
+        return ResultStatus::ErrorInvalidFormat;
+
+    // The ExHeader follows the NCCH header
+    if (Read(ncch_offset + sizeof(NCCH_Header), sizeof(ExHeader_Header), &exheader_header) !=
+        sizeof(ExHeader_Header)) {
+        return ResultStatus::ErrorInvalidFormat;
+    }
+
+    exefs_offset = ncch_offset + (u64)ncch_header.exefs_offset * kBlockSize;
+    if (Read(exefs_offset, sizeof(ExeFs_Header), &exefs_header) != sizeof(ExeFs_Header))
+        return ResultStatus::ErrorInvalidFormat;
+
+    LOG_DEBUG(Loader, "NCCH offset:     0x%08llX", (unsigned long long)ncch_offset);
+    LOG_DEBUG(Loader, "ExeFS offset:    0x%08llX", (unsigned long long)exefs_offset);
+    LOG_DEBUG(Loader, "ExeFS size:      0x%08X", ncch_header.exefs_size * kBlockSize);
+
+    is_open = true;
+    return ResultStatus::Success;
+}
+
+u64 NCCHContainer::GetProgramId() const {
+    u64 program_id;
+    memcpy(&program_id, ncch_header.program_id, sizeof(u64));
+    return program_id;
+}
+
+bool NCCHContainer::FindExeFSSection(const char* name, u64& offset, u32& size) const {
+    for (const ExeFs_SectionHeader& section : exefs_header.section) {
+        if (strncmp(section.name, name, sizeof(section.name)) == 0) {
+            offset = exefs_offset + sizeof(ExeFs_Header) + section.offset;
+            size = section.size;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool NCCHContainer::FindRomFS(u64& offset, u64& size) const {
+    if (ncch_header.romfs_offset == 0 || ncch_header.romfs_size == 0)
+        return false;
+
+    // The RomFS data follows a 0x1000 byte header
+    if ((u64)ncch_header.romfs_size * kBlockSize < 0x1000) {
+        LOG_ERROR(Loader, "RomFS is smaller than its header");
+        return false;
+    }
+    offset = ncch_offset + ((u64)ncch_header.romfs_offset * kBlockSize) + 0x1000;
+    size = ((u64)ncch_header.romfs_size * kBlockSize) - 0x1000;
+
+    // Reading past the end of a mapped file would raise SIGBUS rather than fail
+    const u64 file_size = mapping.IsOpen() ? mapping.GetSize() : FileUtil::GetSize(filename);
+    if (offset > file_size || size > file_size - offset) {
+        LOG_ERROR(Loader, "RomFS (offset 0x%llX, size 0x%llX) is past the end of the file",
+                  (unsigned long long)offset, (unsigned long long)size);
+        return false;
+    }
+    return true;
+}
+
+const u8* NCCHContainer::GetData(u64 offset, u64 length) const {
+    if (!mapping.IsOpen() || offset > mapping.GetSize() || length > mapping.GetSize() - offset)
+        return nullptr;
+    return mapping.GetData() + offset;
+}
+
+size_t NCCHContainer::Read(u64 offset, u64 length, void* buffer) const {
+    if (mapping.IsOpen()) {
+        if (offset > mapping.GetSize())
+            return 0;
+        size_t copy_length = (size_t)std::min(length, mapping.GetSize() - offset);
+        memcpy(buffer, mapping.GetData() + offset, copy_length);
+        return copy_length;
+    }
+
+    if (!file.Seek(offset, SEEK_SET)) {
+        file.Clear();
+        return 0;
+    }
+    size_t read = file.ReadBytes(buffer, (size_t)length);
+    file.Clear();
+    return read;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // AppLoader_NCCH class
 
@@ -105,8 +320,6 @@ AppLoader_NCCH::AppLoader_NCCH(const std::string& filename) {
     is_loaded = false;
     is_compressed = false;
     entry_point = 0;
-    ncch_offset = 0;
-    exefs_offset = 0;
 }
 
 /// AppLoader_NCCH destructor
@@ -121,9 +334,32 @@ ResultStatus AppLoader_NCCH::LoadExec() const {
     if (!is_loaded)
         return ResultStatus::ErrorNotLoaded;
 
-    std::vector<u8> code;
-    if (ResultStatus::Success == ReadCode(code)) {
-        Memory::WriteBlock(entry_point, &code[0], code.size());
+    // Read or decompress the code straight into the ExeFS code region
+    u32 code_size = 0;
+    auto get_code_buffer = [this, &code_size](u32 size) -> u8* {
+        if (entry_point < Memory::EXEFS_CODE_VADDR ||
+            (u64)entry_point + size > Memory::EXEFS_CODE_VADDR_END) {
+            LOG_ERROR(Loader, "Code of size 0x%08X at 0x%08X doesn't fit in the code region",
+                      size, entry_point);
+            return nullptr;
+        }
+        code_size = size;
+        u8* code = Memory::GetPointer(entry_point);
+        Memory::PrepareHostWrite(code, size);
+        return code;
+    };
+
+    // Only compressed code is worth caching, uncompressed code is read as fast from the NCCH
+    bool use_code_cache = is_compressed && Settings::values.use_code_cache;
+    ResultStatus result = ResultStatus::Success;
+    if (!use_code_cache || !LoadCachedCode(GetProgramId(), container.GetExeFSHeader(), get_code_buffer)) {
+        result = LoadSectionExeFS(".code", get_code_buffer);
+        if (ResultStatus::Success == result && use_code_cache)
+            StoreCachedCode(GetProgramId(), container.GetExeFSHeader(),
+                            Memory::GetPointer(entry_point), code_size);
+    }
+
+    if (ResultStatus::Success == result) {
         Kernel::LoadExec(entry_point);
         return ResultStatus::Success;
     }
@@ -137,61 +373,71 @@ ResultStatus AppLoader_NCCH::LoadExec() const {
  * @return ResultStatus result of function
  */
 ResultStatus AppLoader_NCCH::LoadSectionExeFS(const char* name, std::vector<u8>& buffer) const {
-    // Iterate through the ExeFs archive until we find the .code file...
-    FileUtil::IOFile file(filename, "rb");
-    if (file.IsOpen()) {
-        LOG_DEBUG(Loader, "%d sections:", kMaxSections);
-        for (int i = 0; i < kMaxSections; i++) {
-            // Load the specified section...
-            if (strcmp((const char*)exefs_header.section[i].name, name) == 0) {
-                LOG_DEBUG(Loader, "%d - offset: 0x%08X, size: 0x%08X, name: %s", i,
-                        exefs_header.section[i].offset, exefs_header.section[i].size,
-                        exefs_header.section[i].name);
-
-                s64 section_offset = (exefs_header.section[i].offset + exefs_offset +
-                    sizeof(ExeFs_Header)+ncch_offset);
-                file.Seek(section_offset, 0);
-
-                // Section is compressed...
-                if (i == 0 && is_compressed) {
-                    // Read compressed .code section...
-                    std::unique_ptr<u8[]> temp_buffer;
-                    try {
-                        temp_buffer.reset(new u8[exefs_header.section[i].size]);
-                    } catch (std::bad_alloc&) {
-                        return ResultStatus::ErrorMemoryAllocationFailed;
-                    }
-                    file.ReadBytes(&temp_buffer[0], exefs_header.section[i].size);
-
-                    // Decompress .code section...
-                    u32 decompressed_size = LZSS_GetDecompressedSize(&temp_buffer[0],
-                        exefs_header.section[i].size);
-                    buffer.resize(decompressed_size);
-                    if (!LZSS_Decompress(&temp_buffer[0], exefs_header.section[i].size, &buffer[0],
-                        decompressed_size)) {
-                        return ResultStatus::ErrorInvalidFormat;
-                    }
-                    // Section is uncompressed...
-                }
-                else {
-                    buffer.resize(exefs_header.section[i].size);
-                    file.ReadBytes(&buffer[0], exefs_header.section[i].size);
-                }
-                return ResultStatus::Success;
+    return LoadSectionExeFS(name, [&buffer](u32 size) -> u8* {
+        buffer.resize(size);
+        return buffer.data();
+    });
+}
+
+/**
+ * Reads an application ExeFS section of an NCCH file, decompressing it if needed
+ * @param name Name of section to read out of NCCH file
+ * @param get_buffer Called with the (decompressed) size of the section, returns the buffer to read
+ *        it into, or nullptr if there is none
+ * @return ResultStatus result of function
+ */
+ResultStatus AppLoader_NCCH::LoadSectionExeFS(const char* name,
+                                              const std::function<u8*(u32)>& get_buffer) const {
+    if (!is_loaded)
+        return ResultStatus::ErrorNotLoaded;
+
+    u64 section_offset;
+    u32 section_size;
+    if (!container.FindExeFSSection(name, section_offset, section_size))
+        return ResultStatus::ErrorNotUsed;
+
+    LOG_DEBUG(Loader, "offset: 0x%08llX, size: 0x%08X, name: %s",
+              (unsigned long long)section_offset, section_size, name);
+
+    // Section is compressed...
+    if (is_compressed && strcmp(name, ".code") == 0) {
+        if (section_size < 8)
+            return ResultStatus::ErrorInvalidFormat;
+
+        // Decompress straight from the mapped file, or read the compressed section first
+        const u8* compressed = container.GetData(section_offset, section_size);
+        std::unique_ptr<u8[]> temp_buffer;
+        if (compressed == nullptr) {
+            try {
+                temp_buffer.reset(new u8[section_size]);
+            } catch (std::bad_alloc&) {
+                return ResultStatus::ErrorMemoryAllocationFailed;
             }
+            if (container.Read(section_offset, section_size, &temp_buffer[0]) != section_size)
+                return ResultStatus::ErrorInvalidFormat;
+            compressed = &temp_buffer[0];
         }
+
+        // Decompress .code section...
+        u32 decompressed_size = LZSS_GetDecompressedSize(compressed, section_size);
+        u8* buffer = get_buffer(decompressed_size);
+        if (buffer == nullptr)
+            return ResultStatus::ErrorMemoryAllocationFailed;
+        if (!LZSS_Decompress(compressed, section_size, buffer, decompressed_size))
+            return ResultStatus::ErrorInvalidFormat;
+    // Section is uncompressed...
     } else {
-        LOG_ERROR(Loader, "Unable to read file %s!", filename.c_str());
-        return ResultStatus::Error;
+        u8* buffer = get_buffer(section_size);
+        if (buffer == nullptr)
+            return ResultStatus::ErrorMemoryAllocationFailed;
+        container.Read(section_offset, section_size, buffer);
     }
-    return ResultStatus::ErrorNotUsed;
+    return ResultStatus::Success;
 }
 
 /**
  * Loads an NCCH file (e.g. from a CCI, or the first NCCH in a CXI)
- * @param error_string Pointer to string to put error message if an error has occurred
- * @todo Move NCSD parsing out of here and create a separate function for loading these
- * @return True on success, otherwise false
+ * @return ResultStatus result of function
  */
 ResultStatus AppLoader_NCCH::Load() {
     LOG_INFO(Loader, "Loading NCCH file %s...", filename.c_str());
@@ -199,53 +445,27 @@ ResultStatus AppLoader_NCCH::Load() {
     if (is_loaded)
         return ResultStatus::ErrorAlreadyLoaded;
 
-    FileUtil::IOFile file(filename, "rb");
-    if (file.IsOpen()) {
-        file.ReadBytes(&ncch_header, sizeof(NCCH_Header));
-
-        // Skip NCSD header and load first NCCH (NCSD is just a container of NCCH files)...
-        if (0 == memcmp(&ncch_header.magic, "NCSD", 4)) {
-            LOG_WARNING(Loader, "Only loading the first (bootable) NCCH within the NCSD file!");
-            ncch_offset = 0x4000;
-            file.Seek(ncch_offset, 0);
-            file.ReadBytes(&ncch_header, sizeof(NCCH_Header));
-        }
-
-        // Verify we are loading the correct file type...
-        if (0 != memcmp(&ncch_header.magic, "NCCH", 4))
-            return ResultStatus::ErrorInvalidFormat;
-
-        // Read ExHeader...
-
-        file.ReadBytes(&exheader_header, sizeof(ExHeader_Header));
-
-        is_compressed = (exheader_header.codeset_info.flags.flag & 1) == 1;
-        entry_point = exheader_header.codeset_info.text.address;
-
-        LOG_INFO(Loader, "Name:            %s", exheader_header.codeset_info.name);
-        LOG_DEBUG(Loader, "Code compressed: %s", is_compressed ? "yes" : "no");
-        LOG_DEBUG(Loader, "Entry point:     0x%08X", entry_point);
-
-        // Read ExeFS...
+    // The first partition of an NCSD is the bootable one
+    ResultStatus result = container.Open(filename, 0);
+    if (result != ResultStatus::Success)
+        return result;
 
-        exefs_offset = ncch_header.exefs_offset * kBlockSize;
-        u32 exefs_size = ncch_header.exefs_size * kBlockSize;
+    if (container.GetNumPartitions() > 1)
+        LOG_INFO(Loader, "Loading the first (bootable) of %u NCCH partitions", container.GetNumPartitions());
 
-        LOG_DEBUG(Loader, "ExeFS offset:    0x%08X", exefs_offset);
-        LOG_DEBUG(Loader, "ExeFS size:      0x%08X", exefs_size);
+    const ExHeader_Header& exheader_header = container.GetExHeader();
+    is_compressed = (exheader_header.codeset_info.flags.flag & 1) == 1;
+    entry_point = exheader_header.codeset_info.text.address;
 
-        file.Seek(exefs_offset + ncch_offset, 0);
-        file.ReadBytes(&exefs_header, sizeof(ExeFs_Header));
+    LOG_INFO(Loader, "Name:            %s", exheader_header.codeset_info.name);
+    LOG_DEBUG(Loader, "Code compressed: %s", is_compressed ? "yes" : "no");
+    LOG_DEBUG(Loader, "Entry point:     0x%08X", entry_point);
 
-        is_loaded = true; // Set state to loaded
+    is_loaded = true; // Set state to loaded
 
-        LoadExec(); // Load the executable into memory for booting
+    LoadExec(); // Load the executable into memory for booting
 
-        return ResultStatus::Success;
-    } else {
-        LOG_ERROR(Loader, "Unable to read file %s!", filename.c_str());
-    }
-    return ResultStatus::Error;
+    return ResultStatus::Success;
 }
 
 /**
@@ -285,38 +505,32 @@ ResultStatus AppLoader_NCCH::ReadLogo(std::vector<u8>& buffer) const {
 }
 
 /**
- * Get the RomFS of the application
- * @param buffer Reference to buffer to store data
+ * Get the location of the RomFS of the application
+ * @param romfs_file Reference to string to store the name of the file containing the RomFS
+ * @param offset Reference to store the offset of the RomFS within the file
+ * @param size Reference to store the size of the RomFS
  * @return ResultStatus result of function
  */
-ResultStatus AppLoader_NCCH::ReadRomFS(std::vector<u8>& buffer) const {
-    FileUtil::IOFile file(filename, "rb");
-    if (file.IsOpen()) {
-        // Check if the NCCH has a RomFS...
-        if (ncch_header.romfs_offset != 0 && ncch_header.romfs_size != 0) {
-            u32 romfs_offset = ncch_offset + (ncch_header.romfs_offset * kBlockSize) + 0x1000;
-            u32 romfs_size = (ncch_header.romfs_size * kBlockSize) - 0x1000;
-
-            LOG_DEBUG(Loader, "RomFS offset:    0x%08X", romfs_offset);
-            LOG_DEBUG(Loader, "RomFS size:      0x%08X", romfs_size);
+ResultStatus AppLoader_NCCH::ReadRomFS(std::string& romfs_file, u64& offset, u64& size) const {
+    if (!is_loaded) {
+        return ResultStatus::ErrorNotLoaded;
+    }
 
-            buffer.resize(romfs_size);
+    // Check if the NCCH has a RomFS...
+    if (container.FindRomFS(offset, size)) {
+        romfs_file = filename;
 
-            file.Seek(romfs_offset, 0);
-            file.ReadBytes(&buffer[0], romfs_size);
+        LOG_DEBUG(Loader, "RomFS offset:    0x%08llX", (unsigned long long)offset);
+        LOG_DEBUG(Loader, "RomFS size:      0x%08llX", (unsigned long long)size);
 
-            return ResultStatus::Success;
-        }
-        LOG_DEBUG(Loader, "NCCH has no RomFS");
-        return ResultStatus::ErrorNotUsed;
-    } else {
-        LOG_ERROR(Loader, "Unable to read file %s!", filename.c_str());
+        return ResultStatus::Success;
     }
-    return ResultStatus::Error;
+    LOG_DEBUG(Loader, "NCCH has no RomFS");
+    return ResultStatus::ErrorNotUsed;
 }
 
 u64 AppLoader_NCCH::GetProgramId() const {
-    return *reinterpret_cast<u64 const*>(&ncch_header.program_id[0]);
+    return container.GetProgramId();
 }
 
 } // namespace Loader
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <functional>
+
 #include "common/common.h"
 #include "common/file_util.h"
 
@@ -139,11 +141,137 @@ struct ExHeader_Header{
     } access_desc;
 };
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// NCSD header, the header of a CCI, which contains up to 8 NCCH partitions
+
+struct NCSD_Partition {
+    u32 offset; ///< Offset of the partition, in media units (0x200 bytes)
+    u32 size;   ///< Size of the partition, in media units
+};
+
+struct NCSD_Header {
+    u8 signature[0x100];
+    char magic[4];
+    u32 media_size;
+    u8 media_id[8];
+    u8 partition_fs_type[8];
+    u8 partition_crypt_type[8];
+    NCSD_Partition partitions[8];
+};
+static_assert(sizeof(NCSD_Header) == 0x160, "NCSD header isn't exactly 0x160 bytes long!");
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Loader namespace
 
 namespace Loader {
 
+/**
+ * Get the decompressed size of an LZSS compressed ExeFS file
+ * @param buffer Buffer of compressed file
+ * @param size Size of compressed buffer, at least 8 bytes
+ * @return Size of decompressed buffer
+ */
+u32 LZSS_GetDecompressedSize(const u8* buffer, u32 size);
+
+/**
+ * Decompress ExeFS file (compressed with LZSS)
+ *
+ * The file is decompressed backwards, from the end of the compressed region (given by the footer)
+ * down to its start. The data below the compressed region is stored uncompressed at the start of
+ * the file, and is copied once decompression is done.
+ *
+ * @param compressed Compressed buffer
+ * @param compressed_size Size of compressed buffer
+ * @param decompressed Decompressed buffer, not overlapping the compressed buffer
+ * @param decompressed_size Size of decompressed buffer
+ * @return True on success, otherwise false
+ */
+bool LZSS_Decompress(const u8* compressed, u32 compressed_size, u8* decompressed,
+                     u32 decompressed_size);
+
+/**
+ * Reader for the headers and sections of an NCCH, either a standalone one (CXI) or one of the
+ * partitions of an NCSD (CCI). The file is opened once and mapped in memory when possible, and the
+ * headers are parsed once, so that sections can be located and read without reopening the file.
+ */
+class NCCHContainer : NonCopyable {
+public:
+    NCCHContainer();
+
+    /**
+     * Opens an NCCH or NCSD file and reads the headers of an NCCH
+     * @param filename Name of the file to open
+     * @param partition Index of the NCCH in an NCSD, ignored for a standalone NCCH
+     * @return ResultStatus result of function
+     */
+    ResultStatus Open(const std::string& filename, u32 partition = 0);
+
+    /// Returns true if an NCCH has been opened
+    bool IsOpen() const { return is_open; }
+
+    /// Returns the number of NCCH partitions in the file, 1 for a standalone NCCH
+    u32 GetNumPartitions() const { return num_partitions; }
+
+    const NCCH_Header& GetNCCHHeader() const { return ncch_header; }
+    const ExHeader_Header& GetExHeader() const { return exheader_header; }
+    const ExeFs_Header& GetExeFSHeader() const { return exefs_header; }
+
+    /// Returns the offset of the NCCH in the file
+    u64 GetNCCHOffset() const { return ncch_offset; }
+
+    /// Returns the program ID from the NCCH header
+    u64 GetProgramId() const;
+
+    /**
+     * Locates a section of the ExeFS
+     * @param name Name of the section (e.g. ".code", "icon")
+     * @param offset Reference to store the offset of the section in the file
+     * @param size Reference to store the size of the section
+     * @return True if the ExeFS has a section with that name
+     */
+    bool FindExeFSSection(const char* name, u64& offset, u32& size) const;
+
+    /**
+     * Locates the RomFS of the NCCH, excluding its IVFC header
+     * @param offset Reference to store the offset of the RomFS in the file
+     * @param size Reference to store the size of the RomFS
+     * @return True if the NCCH has a RomFS, which is entirely within the file
+     */
+    bool FindRomFS(u64& offset, u64& size) const;
+
+    /**
+     * Gets a region of the file without copying it
+     * @param offset Offset of the region in the file
+     * @param length Length in bytes of the region
+     * @return Pointer to the region, or nullptr if the file isn't mapped or the region is outside of it
+     */
+    const u8* GetData(u64 offset, u64 length) const;
+
+    /**
+     * Reads a region of the file
+     * @param offset Offset of the region in the file
+     * @param length Length in bytes of the region
+     * @param buffer Buffer to read the region into
+     * @return Number of bytes read
+     */
+    size_t Read(u64 offset, u64 length, void* buffer) const;
+
+private:
+    std::string filename;
+
+    FileUtil::MappedFile mapping;
+    mutable FileUtil::IOFile file; ///< Used instead of the mapping when the file can't be mapped
+
+    bool is_open;
+    u32 num_partitions;
+    u64 ncch_offset;    ///< Offset of the NCCH header in the file
+    u64 exefs_offset;   ///< Offset of the ExeFS header in the file
+
+    NCCH_Header     ncch_header;
+    ExeFs_Header    exefs_header;
+    ExHeader_Header exheader_header;
+};
+
 /// Loads an NCCH file (e.g. from a CCI, or the first NCCH in a CXI)
 class AppLoader_NCCH final : public AppLoader {
 public:
@@ -185,11 +313,13 @@ public:
     ResultStatus ReadLogo(std::vector<u8>& buffer) const override;
 
     /**
-     * Get the RomFS of the application
-     * @param buffer Reference to buffer to store data
+     * Get the location of the RomFS of the application
+     * @param romfs_file Reference to string to store the name of the file containing the RomFS
+     * @param offset Reference to store the offset of the RomFS within the file
+     * @param size Reference to store the size of the RomFS
      * @return ResultStatus result of function
      */
-    ResultStatus ReadRomFS(std::vector<u8>& buffer) const override;
+    ResultStatus ReadRomFS(std::string& romfs_file, u64& offset, u64& size) const override;
 
     /*
      * Gets the program id from the NCCH header
@@ -207,6 +337,15 @@ private:
      */
     ResultStatus LoadSectionExeFS(const char* name, std::vector<u8>& buffer) const;
 
+    /**
+     * Reads an application ExeFS section of an NCCH file, decompressing it if needed
+     * @param name Name of section to read out of NCCH file
+     * @param get_buffer Called with the (decompressed) size of the section, returns the buffer to
+     *        read it into, or nullptr if there is none
+     * @return ResultStatus result of function
+     */
+    ResultStatus LoadSectionExeFS(const char* name, const std::function<u8*(u32)>& get_buffer) const;
+
     /**
      * Loads .code section into memory for booting
      * @return ResultStatus result of function
@@ -219,12 +358,8 @@ private:
     bool            is_compressed;
 
     u32             entry_point;
-    u32             ncch_offset; // Offset to NCCH header, can be 0 or after NCSD header
-    u32             exefs_offset;
 
-    NCCH_Header     ncch_header;
-    ExeFs_Header    exefs_header;
-    ExHeader_Header exheader_header;
+    NCCHContainer   container;
 };
 
 } // namespace Loader
@@ -0,0 +1,47 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstring>
+
+#include "core/loader/smdh.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Loader namespace
+
+namespace Loader {
+
+bool SMDH::IsValid(const std::vector<u8>& data) {
+    return data.size() >= sizeof(SMDH) && memcmp(data.data(), "SMDH", 4) == 0;
+}
+
+std::u16string SMDH::GetShortTitle(TitleLanguage language) const {
+    const u16* title = titles[static_cast<int>(language)].short_title;
+    size_t length = 0;
+    while (length < ARRAY_SIZE(titles[0].short_title) && title[length] != 0)
+        ++length;
+    return std::u16string(title, title + length);
+}
+
+std::vector<u16> SMDH::GetIcon(bool large) const {
+    const int size = large ? SMDH_LARGE_ICON_SIZE : SMDH_SMALL_ICON_SIZE;
+    const u16* tiled = large ? large_icon : small_icon;
+
+    // Icons are made of 8x8 tiles, left to right then top to bottom. The pixels of a tile are in
+    // Morton order, with the bits of x and y interleaved, x in the lowest bit.
+    std::vector<u16> icon(size * size);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            int tile = (y / 8) * (size / 8) + (x / 8);
+            int pixel = 0;
+            for (int bit = 0; bit < 3; ++bit) {
+                pixel |= ((x >> bit) & 1) << (2 * bit);
+                pixel |= ((y >> bit) & 1) << (2 * bit + 1);
+            }
+            icon[y * size + x] = tiled[tile * 64 + pixel];
+        }
+    }
+    return icon;
+}
+
+} // namespace Loader
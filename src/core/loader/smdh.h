@@ -0,0 +1,79 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "common/common.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Loader namespace
+
+namespace Loader {
+
+/// Size in pixels of the sides of the small and large SMDH icons
+const int SMDH_SMALL_ICON_SIZE = 24;
+const int SMDH_LARGE_ICON_SIZE = 48;
+
+/**
+ * SMDH, the metadata of an application (titles, icons, settings), stored in the "icon" section of
+ * its ExeFS. See http://3dbrew.org/wiki/SMDH
+ */
+struct SMDH {
+    enum class TitleLanguage {
+        Japanese = 0,
+        English,
+        French,
+        German,
+        Italian,
+        Spanish,
+        SimplifiedChinese,
+        Korean,
+        Dutch,
+        Portuguese,
+        Russian,
+        TraditionalChinese,
+    };
+
+    struct Title {
+        u16 short_title[0x40];
+        u16 long_title[0x80];
+        u16 publisher[0x40];
+    };
+
+    char magic[4];
+    u16 version;
+    u16 reserved_0;
+    Title titles[16];
+    u8 settings[0x30];
+    u8 reserved_1[8];
+    u16 small_icon[SMDH_SMALL_ICON_SIZE * SMDH_SMALL_ICON_SIZE]; ///< Tiled RGB565
+    u16 large_icon[SMDH_LARGE_ICON_SIZE * SMDH_LARGE_ICON_SIZE]; ///< Tiled RGB565
+
+    /**
+     * Checks whether a buffer holds an SMDH
+     * @param data Contents of the ExeFS "icon" section
+     * @return True if the buffer is large enough and has the SMDH magic
+     */
+    static bool IsValid(const std::vector<u8>& data);
+
+    /**
+     * Gets the short title of the application in a language
+     * @param language Language of the title
+     * @return UTF-16 title, empty if the SMDH has none in that language
+     */
+    std::u16string GetShortTitle(TitleLanguage language) const;
+
+    /**
+     * Gets an icon of the application as linear rows of RGB565 pixels, from the top
+     * @param large True for the 48x48 icon, false for the 24x24 icon
+     * @return Pixels of the icon
+     */
+    std::vector<u16> GetIcon(bool large) const;
+};
+static_assert(sizeof(SMDH) == 0x36C0, "SMDH isn't exactly 0x36C0 bytes long!");
+
+} // namespace Loader
@@ -3,6 +3,7 @@
 // Refer to the license.txt file included.
 
 #include "common/common.h"
+#include "common/dirty_page_tracker.h"
 #include "common/mem_arena.h"
 
 #include "core/mem_map.h"
@@ -75,6 +76,19 @@ void Init() {
         physical_fcram);
 }
 
+std::vector<HostSpan> GetHostRegions() {
+    std::vector<HostSpan> regions;
+    for (const MemoryView& view : g_views) {
+        HostSpan region = { *view.out_ptr, view.size };
+        regions.push_back(region);
+    }
+    return regions;
+}
+
+void PrepareHostWrite(u8* pointer, size_t size) {
+    Common::DirtyPageTracker::MarkDirty(pointer, size);
+}
+
 void Shutdown() {
     u32 flags = 0;
     MemoryMap_Shutdown(g_views, kNumMemViews, flags, &arena);
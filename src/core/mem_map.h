@@ -4,9 +4,14 @@
 
 #pragma once
 
+#include <array>
+#include <vector>
+
 #include "common/common.h"
 #include "common/common_types.h"
 
+class PointerWrap;
+
 namespace Memory {
 
 // TODO: It would be nice to eventually replace these with strong types that prevent accidental
@@ -96,6 +101,8 @@ struct MemoryBlock {
     const u32 GetVirtualAddress() const{
         return base_address + address;
     }
+
+    void DoState(PointerWrap& p);
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -123,6 +130,9 @@ extern u8* g_exefs_code;    ///< ExeFS:/.code is loaded here
 void Init();
 void Shutdown();
 
+/// Saves or loads the mapped memory blocks. The contents of memory are saved by SaveState.
+void DoState(PointerWrap& p);
+
 template <typename T>
 inline void Read(T &var, VAddr addr);
 
@@ -145,6 +155,132 @@ void WriteBlock(VAddr addr, const u8* data, size_t size);
 
 u8* GetPointer(VAddr virtual_address);
 
+/**
+ * Must be called before host memory backing guest memory is written by the host OS rather than by
+ * the emulator itself, e.g. when reading a file straight into it. Guest memory is write-protected
+ * to track the pages changed between savestates, which makes such writes fail otherwise.
+ * @param pointer Host memory about to be written
+ * @param size Size of the write, in bytes
+ */
+void PrepareHostWrite(u8* pointer, size_t size);
+
+/**
+ * Gets the host memory backing a virtual address, along with how much of it is contiguous
+ * @param virtual_address Virtual address to look up
+ * @param contiguous_size Receives the number of bytes from the address to the end of its region
+ * @return Pointer to the host memory, or nullptr if the address isn't backed by host memory
+ */
+u8* GetHostRange(VAddr virtual_address, u32& contiguous_size);
+
+/// Contiguous range of host memory backing part of a guest buffer
+struct HostSpan {
+    u8* pointer;
+    u32 size;
+};
+
+/// Returns the host memory backing each region of guest memory, always in the same order
+std::vector<HostSpan> GetHostRegions();
+
+/**
+ * View of a guest buffer as the host memory backing it. The buffer is resolved, and its whole
+ * range checked, once on construction; afterwards, accesses go straight to host memory without
+ * any per-word address translation. A buffer that crosses from one memory region into an adjacent
+ * one (e.g. from the heap into shared memory) is backed by several host spans, which the copy
+ * functions scatter to and gather from.
+ */
+class GuestBuffer {
+public:
+    /// Maximum number of host spans a buffer may be made of, more than any chain of adjacent regions
+    static const size_t MAX_SPANS = 4;
+
+    /**
+     * Resolves a guest buffer
+     * @param address Virtual address of the start of the buffer
+     * @param size Size of the buffer in bytes, the buffer is invalid if it extends past 4GB
+     */
+    GuestBuffer(VAddr address, u64 size);
+
+    /// Returns true if the whole buffer is backed by host memory
+    bool IsValid() const { return valid; }
+
+    VAddr GetAddress() const { return address; }
+    u32 GetSize() const { return size; }
+
+    /// Returns true if the buffer is backed by a single span of host memory
+    bool IsContiguous() const { return valid && num_spans <= 1; }
+
+    /// Gets the host memory backing a contiguous buffer, nullptr if it isn't contiguous or empty
+    u8* GetContiguousPointer() const {
+        return (valid && num_spans == 1) ? spans[0].pointer : nullptr;
+    }
+
+    size_t GetNumSpans() const { return num_spans; }
+    const HostSpan& GetSpan(size_t index) const { return spans[index]; }
+
+    /**
+     * Reads part of the buffer into host memory
+     * @param offset Offset of the data in the buffer, in bytes
+     * @param dest Host memory to copy the data to
+     * @param length Number of bytes to read, offset + length must not exceed GetSize()
+     */
+    void Read(u32 offset, void* dest, u32 length) const;
+
+    /**
+     * Writes host memory to part of the buffer
+     * @param offset Offset of the data in the buffer, in bytes
+     * @param src Host memory to copy the data from
+     * @param length Number of bytes to write, offset + length must not exceed GetSize()
+     */
+    void Write(u32 offset, const void* src, u32 length) const;
+
+    /// Copies the contents of the buffer to host memory, which must hold GetSize() bytes
+    void CopyTo(void* dest) const { Read(0, dest, size); }
+
+    /// Copies GetSize() bytes of host memory into the buffer
+    void CopyFrom(const void* src) const { Write(0, src, size); }
+
+    /**
+     * Copies the contents of another guest buffer into this one
+     * @param src Buffer to copy from, must be at least as large as this one
+     */
+    void CopyFrom(const GuestBuffer& src) const;
+
+private:
+    VAddr address;
+    u32 size;
+    bool valid;
+    size_t num_spans;
+    std::array<HostSpan, MAX_SPANS> spans;
+};
+
+/// GuestBuffer holding an array of count elements of type T
+template <typename T>
+class GuestSpan : public GuestBuffer {
+public:
+    GuestSpan(VAddr address, u32 count) : GuestBuffer(address, (u64)count * sizeof(T)), count(count) {
+    }
+
+    u32 GetCount() const { return count; }
+
+    /// Gets the elements of a contiguous buffer, nullptr if it isn't contiguous or empty
+    T* GetPointer() const { return reinterpret_cast<T*>(GetContiguousPointer()); }
+
+    /// Reads an element, which may straddle two spans
+    T Get(u32 index) const {
+        T value;
+        Read(index * sizeof(T), &value, sizeof(T));
+        return value;
+    }
+
+    /// Writes an element, which may straddle two spans
+    void Set(u32 index, const T& value) const {
+        Write(index * sizeof(T), &value, sizeof(T));
+    }
+
+private:
+    u32 count;
+};
+
 /**
  * Maps a block of memory on the heap
  * @param size Size of block in bytes
@@ -2,9 +2,11 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <map>
 
 #include "common/common.h"
+#include "common/chunk_file.h"
 
 #include "core/mem_map.h"
 #include "core/hw/hw.h"
@@ -145,39 +147,134 @@ inline void Write(const VAddr vaddr, const T data) {
     }
 }
 
+u8* GetHostRange(const VAddr vaddr, u32& contiguous_size) {
+    struct Region {
+        VAddr start;
+        VAddr end;
+        u8* base;
+    };
+    const Region regions[] = {
+        { KERNEL_MEMORY_VADDR, KERNEL_MEMORY_VADDR_END, g_kernel_mem },
+        { EXEFS_CODE_VADDR,    EXEFS_CODE_VADDR_END,    g_exefs_code },
+        { HEAP_LINEAR_VADDR,   HEAP_LINEAR_VADDR_END,   g_heap_linear },
+        { HEAP_VADDR,          HEAP_VADDR_END,          g_heap },
+        { SHARED_MEMORY_VADDR, SHARED_MEMORY_VADDR_END, g_shared_mem },
+        { SYSTEM_MEMORY_VADDR, SYSTEM_MEMORY_VADDR_END, g_system_mem },
+        { VRAM_VADDR,          VRAM_VADDR_END,          g_vram },
+    };
+
+    for (const Region& region : regions) {
+        if (vaddr >= region.start && vaddr < region.end) {
+            contiguous_size = region.end - vaddr;
+            return region.base + (vaddr - region.start);
+        }
+    }
+    contiguous_size = 0;
+    return nullptr;
+}
+
 u8 *GetPointer(const VAddr vaddr) {
-    // Kernel memory command buffer
-    if (vaddr >= KERNEL_MEMORY_VADDR && vaddr < KERNEL_MEMORY_VADDR_END) {
-        return g_kernel_mem + (vaddr - KERNEL_MEMORY_VADDR);
+    u32 contiguous_size;
+    u8* pointer = GetHostRange(vaddr, contiguous_size);
+    if (pointer == nullptr)
+        LOG_ERROR(HW_Memory, "unknown GetPointer @ 0x%08x", vaddr);
+    return pointer;
+}
 
-    // ExeFS:/.code is loaded here
-    } else if ((vaddr >= EXEFS_CODE_VADDR)  && (vaddr < EXEFS_CODE_VADDR_END)) {
-        return g_exefs_code + (vaddr - EXEFS_CODE_VADDR);
+GuestBuffer::GuestBuffer(VAddr address, u64 size)
+        : address(address), size((u32)size), valid(false), num_spans(0) {
+    if (address + size > 0x100000000ULL) {
+        LOG_ERROR(HW_Memory, "guest buffer @ 0x%08X (size=0x%llX) extends past the address space",
+                  address, (unsigned long long)size);
+        return;
+    }
 
-    // FCRAM - linear heap
-    } else if ((vaddr >= HEAP_LINEAR_VADDR)  && (vaddr < HEAP_LINEAR_VADDR_END)) {
-        return g_heap_linear + (vaddr - HEAP_LINEAR_VADDR);
+    VAddr vaddr = address;
+    u32 remaining = this->size;
+    while (remaining > 0) {
+        u32 contiguous_size;
+        u8* pointer = GetHostRange(vaddr, contiguous_size);
+        if (pointer == nullptr) {
+            LOG_ERROR(HW_Memory, "guest buffer @ 0x%08X (size=0x%08X) is unmapped @ 0x%08X",
+                      address, this->size, vaddr);
+            return;
+        }
+
+        // Extend the previous span if the regions happen to be adjacent in host memory as well
+        u32 span_size = std::min(contiguous_size, remaining);
+        if (num_spans > 0 && spans[num_spans - 1].pointer + spans[num_spans - 1].size == pointer) {
+            spans[num_spans - 1].size += span_size;
+        } else if (num_spans < MAX_SPANS) {
+            spans[num_spans++] = { pointer, span_size };
+        } else {
+            LOG_ERROR(HW_Memory, "guest buffer @ 0x%08X (size=0x%08X) spans too many regions",
+                      address, this->size);
+            return;
+        }
+
+        vaddr += span_size;
+        remaining -= span_size;
+    }
+    valid = true;
+}
 
-    // FCRAM - application heap
-    } else if ((vaddr >= HEAP_VADDR)  && (vaddr < HEAP_VADDR_END)) {
-        return g_heap + (vaddr - HEAP_VADDR);
+void GuestBuffer::Read(u32 offset, void* dest, u32 length) const {
+    u8* out = static_cast<u8*>(dest);
+    for (size_t i = 0; i < num_spans && length > 0; ++i) {
+        if (offset >= spans[i].size) {
+            offset -= spans[i].size;
+            continue;
+        }
+        u32 chunk = std::min(spans[i].size - offset, length);
+        memcpy(out, spans[i].pointer + offset, chunk);
+        out += chunk;
+        length -= chunk;
+        offset = 0;
+    }
+}
 
-    // Shared memory
-    } else if ((vaddr >= SHARED_MEMORY_VADDR)  && (vaddr < SHARED_MEMORY_VADDR_END)) {
-        return g_shared_mem + (vaddr - SHARED_MEMORY_VADDR);
+void GuestBuffer::Write(u32 offset, const void* src, u32 length) const {
+    const u8* in = static_cast<const u8*>(src);
+    for (size_t i = 0; i < num_spans && length > 0; ++i) {
+        if (offset >= spans[i].size) {
+            offset -= spans[i].size;
+            continue;
+        }
+        u32 chunk = std::min(spans[i].size - offset, length);
+        memcpy(spans[i].pointer + offset, in, chunk);
+        in += chunk;
+        length -= chunk;
+        offset = 0;
+    }
+}
 
-    // System memory
-    } else if ((vaddr >= SYSTEM_MEMORY_VADDR)  && (vaddr < SYSTEM_MEMORY_VADDR_END)) {
-        return g_system_mem + (vaddr - SYSTEM_MEMORY_VADDR);
+void GuestBuffer::CopyFrom(const GuestBuffer& src) const {
+    // Gather each span of the source straight into this buffer
+    u32 offset = 0;
+    for (size_t i = 0; i < src.num_spans && offset < size; ++i) {
+        u32 chunk = std::min(src.spans[i].size, size - offset);
+        Write(offset, src.spans[i].pointer, chunk);
+        offset += chunk;
+    }
+}
 
-    // VRAM
-    } else if ((vaddr >= VRAM_VADDR)  && (vaddr < VRAM_VADDR_END)) {
-        return g_vram + (vaddr - VRAM_VADDR);
+void MemoryBlock::DoState(PointerWrap& p) {
+    p.Do(handle);
+    p.Do(base_address);
+    p.Do(address);
+    p.Do(size);
+    p.Do(operation);
+    p.Do(permissions);
+}
 
-    } else {
-        LOG_ERROR(HW_Memory, "unknown GetPointer @ 0x%08x", vaddr);
-        return 0;
-    }
+void DoState(PointerWrap& p) {
+    auto s = p.Section("Memory", 1);
+    if (!s)
+        return;
+
+    p.Do(heap_map);
+    p.Do(heap_linear_map);
+    p.Do(shared_map);
 }
 
 /**
@@ -0,0 +1,270 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <vector>
+
+#include "common/common.h"
+#include "common/file_util.h"
+#include "common/varint.h"
+
+#include "core/core.h"
+#include "core/movie.h"
+#include "core/settings.h"
+
+namespace Movie {
+
+/// Header of movie files. It is followed by the inputs, each as a varint number of frames and a
+/// varint number of ticks since the previous input (or since the start of the movie), a byte of
+/// INPUT_HAS_* flags telling which parts of the input changed, and the parts which changed: a u32
+/// pad state, then a s16 circle pad X and Y.
+struct FileHeader {
+    u32 magic;
+    u32 version;
+    u32 cpu_core;           ///< Settings::values.cpu_core, both cores don't count ticks the same
+    u32 gpu_refresh_rate;   ///< Settings::values.gpu_refresh_rate, which sets the frame length
+    u64 num_frames;         ///< Length of the movie
+    u64 num_ticks;          ///< Emulated ticks elapsed at the last frame of the movie
+    u32 num_inputs;
+    u32 inputs_size;        ///< Size in bytes of the encoded inputs
+};
+
+static const u32 FILE_MAGIC = 0x564F4D43; ///< "CMOV"
+static const u32 FILE_VERSION = 1;
+
+static const u8 INPUT_HAS_PAD = 1 << 0;
+static const u8 INPUT_HAS_CIRCLE_PAD = 1 << 1;
+
+/// Sanity limit on the size of the inputs read from files
+static const u32 MAX_INPUTS_SIZE = 0x4000000;
+
+/// Input which was given to the emulated system from some frame on
+struct Input {
+    u64 frame;
+    u64 ticks;      ///< Emulated ticks elapsed since the start of the movie at that frame
+    InputState state;
+};
+
+static Mode mode = Mode::None;
+static std::string filename;
+static std::vector<Input> inputs;
+static size_t next_input = 0;       ///< When replaying, index of the next input to give
+static InputState current_state;
+static u64 start_ticks = 0;
+static u64 frame = 0;
+static u64 frame_ticks = 0;         ///< Ticks elapsed at the last frame
+static u64 num_frames = 0;          ///< When replaying, length of the movie
+static u64 num_ticks = 0;           ///< When replaying, ticks elapsed at the last frame of the movie
+static bool desynced = false;
+
+static u64 GetTicks() {
+    return Core::g_app_core->GetTicks() - start_ticks;
+}
+
+static void Reset() {
+    inputs.clear();
+    next_input = 0;
+    current_state = InputState();
+    start_ticks = Core::g_app_core->GetTicks();
+    frame = 0;
+    frame_ticks = 0;
+    num_frames = 0;
+    num_ticks = 0;
+    desynced = false;
+}
+
+static std::vector<u8> EncodeInputs() {
+    std::vector<u8> data;
+    Input previous = {};
+    for (const Input& input : inputs) {
+        Common::WriteVarint(data, input.frame - previous.frame);
+        Common::WriteVarint(data, input.ticks - previous.ticks);
+
+        const u8 flags = (input.state.pad != previous.state.pad ? INPUT_HAS_PAD : 0) |
+            (input.state.circle_pad_x != previous.state.circle_pad_x ||
+             input.state.circle_pad_y != previous.state.circle_pad_y ? INPUT_HAS_CIRCLE_PAD : 0);
+        data.push_back(flags);
+
+        if (flags & INPUT_HAS_PAD) {
+            const u8* pad = reinterpret_cast<const u8*>(&input.state.pad);
+            data.insert(data.end(), pad, pad + sizeof(input.state.pad));
+        }
+        if (flags & INPUT_HAS_CIRCLE_PAD) {
+            const u8* x = reinterpret_cast<const u8*>(&input.state.circle_pad_x);
+            const u8* y = reinterpret_cast<const u8*>(&input.state.circle_pad_y);
+            data.insert(data.end(), x, x + sizeof(input.state.circle_pad_x));
+            data.insert(data.end(), y, y + sizeof(input.state.circle_pad_y));
+        }
+        previous = input;
+    }
+    return data;
+}
+
+static bool DecodeInputs(const std::vector<u8>& data, u32 num_inputs) {
+    const u8* in = data.data();
+    const u8* end = data.data() + data.size();
+    Input input = {};
+    for (u32 i = 0; i < num_inputs; ++i) {
+        u64 frames, ticks;
+        if (!Common::ReadVarint(in, end, frames) || !Common::ReadVarint(in, end, ticks) ||
+            in == end)
+            return false;
+        input.frame += frames;
+        input.ticks += ticks;
+
+        const u8 flags = *in++;
+        if (flags & INPUT_HAS_PAD) {
+            if ((size_t)(end - in) < sizeof(input.state.pad))
+                return false;
+            memcpy(&input.state.pad, in, sizeof(input.state.pad));
+            in += sizeof(input.state.pad);
+        }
+        if (flags & INPUT_HAS_CIRCLE_PAD) {
+            if ((size_t)(end - in) < sizeof(s16) * 2)
+                return false;
+            memcpy(&input.state.circle_pad_x, in, sizeof(s16));
+            memcpy(&input.state.circle_pad_y, in + sizeof(s16), sizeof(s16));
+            in += sizeof(s16) * 2;
+        }
+        inputs.push_back(input);
+    }
+    return in == end;
+}
+
+static bool WriteFile() {
+    std::vector<u8> data = EncodeInputs();
+
+    FileHeader header;
+    header.magic = FILE_MAGIC;
+    header.version = FILE_VERSION;
+    header.cpu_core = Settings::values.cpu_core;
+    header.gpu_refresh_rate = Settings::values.gpu_refresh_rate;
+    header.num_frames = frame;
+    header.num_ticks = frame_ticks;
+    header.num_inputs = (u32)inputs.size();
+    header.inputs_size = (u32)data.size();
+
+    FileUtil::IOFile file(filename, "wb");
+    return file.IsOpen() && file.WriteArray(&header, 1) &&
+        file.WriteBytes(data.data(), data.size()) == data.size();
+}
+
+bool StartRecording(const std::string& movie_filename) {
+    Stop();
+    Reset();
+    filename = movie_filename;
+    mode = Mode::Recording;
+
+    LOG_INFO(Core_Movie, "Recording movie to %s", filename.c_str());
+    return true;
+}
+
+bool StartPlayback(const std::string& movie_filename) {
+    Stop();
+    Reset();
+
+    FileUtil::IOFile file(movie_filename, "rb");
+    FileHeader header;
+    if (!file.IsOpen() || !file.ReadArray(&header, 1)) {
+        LOG_ERROR(Core_Movie, "Failed to read %s", movie_filename.c_str());
+        return false;
+    }
+    if (header.magic != FILE_MAGIC || header.version != FILE_VERSION ||
+        header.num_frames == 0 || header.inputs_size > MAX_INPUTS_SIZE) {
+        LOG_ERROR(Core_Movie, "%s isn't a movie of this version", movie_filename.c_str());
+        return false;
+    }
+    if (header.cpu_core != (u32)Settings::values.cpu_core ||
+        header.gpu_refresh_rate != (u32)Settings::values.gpu_refresh_rate) {
+        LOG_ERROR(Core_Movie, "%s was recorded with cpu_core %u and gpu_refresh_rate %u, it can "
+                  "only be replayed with the same settings", movie_filename.c_str(),
+                  header.cpu_core, header.gpu_refresh_rate);
+        return false;
+    }
+
+    std::vector<u8> data(header.inputs_size);
+    if (file.ReadBytes(data.data(), data.size()) != data.size() ||
+        !DecodeInputs(data, header.num_inputs)) {
+        LOG_ERROR(Core_Movie, "%s is corrupted", movie_filename.c_str());
+        inputs.clear();
+        return false;
+    }
+
+    filename = movie_filename;
+    num_frames = header.num_frames;
+    num_ticks = header.num_ticks;
+    mode = Mode::Playing;
+
+    LOG_INFO(Core_Movie, "Playing movie %s: %llu frames, %u inputs", filename.c_str(),
+             (unsigned long long)num_frames, header.num_inputs);
+    return true;
+}
+
+void Stop() {
+    if (mode == Mode::Recording) {
+        if (WriteFile()) {
+            LOG_INFO(Core_Movie, "Recorded %llu frames (%llu ticks), %u inputs to %s",
+                     (unsigned long long)frame, (unsigned long long)frame_ticks,
+                     (u32)inputs.size(), filename.c_str());
+        } else {
+            LOG_ERROR(Core_Movie, "Failed to write movie to %s", filename.c_str());
+        }
+    } else if (mode == Mode::Playing) {
+        LOG_INFO(Core_Movie, "Stopped playing movie at frame %llu of %llu",
+                 (unsigned long long)frame, (unsigned long long)num_frames);
+    }
+
+    inputs.clear();
+    mode = Mode::None;
+}
+
+void UpdateInput(InputState& input) {
+    if (mode == Mode::None)
+        return;
+
+    frame_ticks = GetTicks();
+    if (mode == Mode::Recording) {
+        if (input != current_state) {
+            current_state = input;
+            inputs.push_back({ frame, frame_ticks, input });
+        }
+    } else {
+        for (; next_input < inputs.size() && inputs[next_input].frame == frame; ++next_input) {
+            const Input& next = inputs[next_input];
+            if (next.ticks != frame_ticks && !desynced) {
+                LOG_WARNING(Core_Movie, "Movie desynced at frame %llu: tick %llu, recorded at %llu",
+                            (unsigned long long)frame, (unsigned long long)frame_ticks,
+                            (unsigned long long)next.ticks);
+                desynced = true;
+            }
+            current_state = next.state;
+        }
+        input = current_state;
+
+        if (frame + 1 == num_frames) {
+            if (frame_ticks == num_ticks && !desynced) {
+                LOG_INFO(Core_Movie, "Finished playing movie, %llu frames in %llu ticks",
+                         (unsigned long long)num_frames, (unsigned long long)num_ticks);
+            } else {
+                LOG_WARNING(Core_Movie, "Finished playing movie, %llu frames in %llu ticks "
+                            "instead of %llu: the emulation diverged from the recording",
+                            (unsigned long long)num_frames, (unsigned long long)frame_ticks,
+                            (unsigned long long)num_ticks);
+            }
+            inputs.clear();
+            mode = Mode::None;
+        }
+    }
+    ++frame;
+}
+
+Mode GetMode() {
+    return mode;
+}
+
+u64 GetFrame() {
+    return frame;
+}
+
+} // namespace
@@ -0,0 +1,83 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <string>
+
+#include "common/common_types.h"
+
+/**
+ * Movies: recordings of the input given to the emulated system, replayed to run exactly the same
+ * emulation again, e.g. to compare the performance of two builds on identical workloads.
+ *
+ * Input is handed to the emulated system once per emulated frame (see HID_User::Update), so it
+ * only depends on emulated time. A movie stores the input of every frame it changed, along with
+ * the emulated tick count at that point, which is checked on replay to detect desyncs. While a
+ * movie is active, anything else which could make the emulation depend on the host (asynchronous
+ * I/O, loading states) is disabled.
+ *
+ * A movie starts from the state the emulated system is in when the recording starts, i.e. right
+ * after the program is loaded, or after a savestate is loaded, and must be replayed from the same.
+ */
+namespace Movie {
+
+enum class Mode {
+    None,
+    Recording,
+    Playing,
+};
+
+/// Input of the emulated system during a frame
+struct InputState {
+    u32 pad;            ///< HID_User::PadState
+    s16 circle_pad_x;
+    s16 circle_pad_y;
+
+    bool operator==(const InputState& other) const {
+        return pad == other.pad && circle_pad_x == other.circle_pad_x &&
+               circle_pad_y == other.circle_pad_y;
+    }
+
+    bool operator!=(const InputState& other) const {
+        return !(*this == other);
+    }
+};
+
+/**
+ * Starts recording the input from the current state of the emulated system
+ * @param filename Path of the movie file, written when the recording is stopped
+ * @return True if the recording started
+ */
+bool StartRecording(const std::string& filename);
+
+/**
+ * Starts replaying a movie from the current state of the emulated system
+ * @param filename Path of the movie file
+ * @return True if the movie was read and is compatible with the current settings
+ */
+bool StartPlayback(const std::string& filename);
+
+/// Stops recording, writing the movie file, or stops replaying
+void Stop();
+
+/**
+ * Called by the HID service once per emulated frame with the input from the frontend. When
+ * recording, records it; when replaying, replaces it with the recorded input.
+ * @param input Input from the frontend, replaced by the input to give to the emulated system
+ */
+void UpdateInput(InputState& input);
+
+/// Gets whether a movie is being recorded, replayed, or neither
+Mode GetMode();
+
+/// Gets whether a movie is being recorded or replayed
+inline bool IsActive() {
+    return GetMode() != Mode::None;
+}
+
+/// Gets the number of frames elapsed since the movie started
+u64 GetFrame();
+
+} // namespace
@@ -0,0 +1,313 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "common/common.h"
+#include "common/dirty_page_tracker.h"
+#include "common/varint.h"
+
+#include "core/rewind.h"
+#include "core/savestate.h"
+#include "core/settings.h"
+
+#include "video_core/video_core.h"
+
+namespace Rewind {
+
+/// A state of the buffer, as the changes leading back from it to the previous, older state
+struct Entry {
+    int frame;                  ///< Renderer frame at which the state was captured
+    /// Changes leading back from this state to the previous one (see EncodeEntry), empty for the
+    /// oldest
+    std::vector<u8> delta;
+};
+
+static bool enabled = false;
+static std::deque<Entry> entries;
+static std::shared_ptr<const SaveState::Snapshot> newest; ///< State of entries.back()
+static int last_capture_frame = 0;
+static size_t deltas_size = 0;  ///< Sum of the sizes of the deltas of the entries
+static std::vector<u8> zero_page;
+static Stats stats;
+
+static inline u64 Read64(const u8* p) {
+    u64 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/**
+ * Appends the XOR of two buffers, run-length encoded: alternating counts of equal bytes and of
+ * differing bytes, the latter followed by the XORed bytes. Since it is a XOR, the delta turns
+ * either buffer into the other one.
+ */
+static void EncodeDelta(const u8* a, const u8* b, size_t size, std::vector<u8>& out) {
+    // Equal runs shorter than this are cheaper to store inside a run of differing bytes
+    const size_t MIN_EQUAL_RUN = 8;
+
+    size_t i = 0;
+    while (i < size) {
+        const size_t equal_start = i;
+        while (i + 8 <= size && Read64(a + i) == Read64(b + i))
+            i += 8;
+        while (i < size && a[i] == b[i])
+            ++i;
+        Common::WriteVarint(out, i - equal_start);
+        if (i == size)
+            break;
+
+        const size_t diff_start = i;
+        while (i < size) {
+            if (a[i] != b[i]) {
+                ++i;
+                continue;
+            }
+            size_t j = i;
+            while (j < size && j - i < MIN_EQUAL_RUN && a[j] == b[j])
+                ++j;
+            if (j == size || j - i == MIN_EQUAL_RUN)
+                break;
+            i = j;
+        }
+        Common::WriteVarint(out, i - diff_start);
+        for (size_t k = diff_start; k < i; ++k)
+            out.push_back(a[k] ^ b[k]);
+    }
+}
+
+/// Applies a delta written by EncodeDelta to a buffer, returns false if the delta is malformed
+static bool ApplyDelta(const u8*& in, const u8* end, u8* data, size_t size) {
+    size_t i = 0;
+    while (i < size) {
+        u64 equal, diff;
+        if (!Common::ReadVarint(in, end, equal) || equal > size - i)
+            return false;
+        i += equal;
+        if (i == size)
+            break;
+
+        if (!Common::ReadVarint(in, end, diff) || diff > size - i || diff > (size_t)(end - in))
+            return false;
+        for (size_t k = 0; k < diff; ++k)
+            data[i + k] ^= in[k];
+        in += diff;
+        i += diff;
+    }
+    return true;
+}
+
+static const u8* PageData(const SaveState::Page& page) {
+    return page ? page->data() : zero_page.data();
+}
+
+static bool IsZeroPage(const std::vector<u8>& data) {
+    return memcmp(data.data(), zero_page.data(), zero_page.size()) == 0;
+}
+
+/**
+ * Encodes the changes leading back from a state to an older one: the number of changed pages,
+ * then for each its page number and delta, then the size of the older state blob and the delta of
+ * the blobs, both padded with zeroes to the larger size.
+ */
+static std::vector<u8> EncodeEntry(const SaveState::Snapshot& older,
+                                   const SaveState::Snapshot& newer) {
+    std::vector<u32> changed_pages;
+    for (u32 i = 0; i < newer.chunks.size(); ++i) {
+        if (older.chunks[i] == newer.chunks[i])
+            continue;
+        for (u32 j = 0; j < SaveState::PAGES_PER_CHUNK; ++j) {
+            if ((*older.chunks[i])[j] != (*newer.chunks[i])[j])
+                changed_pages.push_back(i * SaveState::PAGES_PER_CHUNK + j);
+        }
+    }
+
+    std::vector<u8> delta;
+    Common::WriteVarint(delta, changed_pages.size());
+    for (u32 page : changed_pages) {
+        const u32 chunk = page / SaveState::PAGES_PER_CHUNK;
+        const u32 index = page % SaveState::PAGES_PER_CHUNK;
+        Common::WriteVarint(delta, page);
+        EncodeDelta(PageData((*older.chunks[chunk])[index]), PageData((*newer.chunks[chunk])[index]),
+                    zero_page.size(), delta);
+    }
+
+    const size_t state_size = std::max(older.state.size(), newer.state.size());
+    std::vector<u8> older_state(older.state), newer_state(newer.state);
+    older_state.resize(state_size);
+    newer_state.resize(state_size);
+    Common::WriteVarint(delta, older.state.size());
+    EncodeDelta(older_state.data(), newer_state.data(), state_size, delta);
+
+    delta.shrink_to_fit();
+    return delta;
+}
+
+/// Rebuilds the state preceding a snapshot from the delta of its entry, nullptr if it is malformed
+static std::shared_ptr<const SaveState::Snapshot> DecodeEntry(const SaveState::Snapshot& newer,
+                                                              const std::vector<u8>& delta) {
+    std::shared_ptr<SaveState::Snapshot> older = std::make_shared<SaveState::Snapshot>();
+    older->chunks = newer.chunks;
+
+    const u8* in = delta.data();
+    const u8* end = delta.data() + delta.size();
+    u64 num_pages;
+    if (!Common::ReadVarint(in, end, num_pages))
+        return nullptr;
+
+    // Pages are in increasing order, so each chunk is copied once
+    std::shared_ptr<SaveState::Chunk> chunk;
+    size_t chunk_index = 0;
+    for (u64 i = 0; i < num_pages; ++i) {
+        u64 page;
+        if (!Common::ReadVarint(in, end, page) ||
+            page / SaveState::PAGES_PER_CHUNK >= older->chunks.size())
+            return nullptr;
+
+        if (!chunk || page / SaveState::PAGES_PER_CHUNK != chunk_index) {
+            if (chunk)
+                older->chunks[chunk_index] = chunk;
+            chunk_index = page / SaveState::PAGES_PER_CHUNK;
+            chunk = std::make_shared<SaveState::Chunk>(*older->chunks[chunk_index]);
+        }
+
+        SaveState::Page& entry = (*chunk)[page % SaveState::PAGES_PER_CHUNK];
+        const u8* data = PageData(entry);
+        std::shared_ptr<std::vector<u8>> contents =
+            std::make_shared<std::vector<u8>>(data, data + zero_page.size());
+        if (!ApplyDelta(in, end, contents->data(), contents->size()))
+            return nullptr;
+        entry = IsZeroPage(*contents) ? nullptr : contents;
+    }
+    if (chunk)
+        older->chunks[chunk_index] = chunk;
+
+    u64 state_size;
+    if (!Common::ReadVarint(in, end, state_size))
+        return nullptr;
+    older->state = newer.state;
+    older->state.resize(std::max((size_t)state_size, newer.state.size()));
+    if (!ApplyDelta(in, end, older->state.data(), older->state.size()) || in != end)
+        return nullptr;
+    older->state.resize((size_t)state_size);
+
+    return older;
+}
+
+static void UpdateStats() {
+    stats.num_states = (u32)entries.size();
+    stats.memory_used = deltas_size + (newest ? newest->state.size() : 0);
+    stats.frames_covered = entries.empty() ? 0 : entries.back().frame - entries.front().frame;
+}
+
+static void Capture(int frame) {
+    Common::Profiling::ScopeTimer timer(stats.capture_time);
+
+    std::shared_ptr<const SaveState::Snapshot> snapshot = SaveState::Capture();
+    if (!snapshot)
+        return;
+
+    Entry entry;
+    entry.frame = frame;
+    if (newest)
+        entry.delta = EncodeEntry(*newest, *snapshot);
+    deltas_size += entry.delta.size();
+    entries.push_back(std::move(entry));
+    newest = snapshot;
+
+    // Drop the oldest states until the buffer fits. The delta of the oldest state leads back to a
+    // state which isn't there anymore, so it is dropped as well.
+    while (entries.size() > 1 && deltas_size + newest->state.size() > stats.memory_budget) {
+        deltas_size -= entries.front().delta.size();
+        entries.pop_front();
+    }
+    deltas_size -= entries.front().delta.size();
+    std::vector<u8>().swap(entries.front().delta);
+}
+
+void Init() {
+    stats = Stats();
+    stats.capture_interval = std::max(Settings::values.rewind_interval, 0);
+    stats.memory_budget = (size_t)std::max(Settings::values.rewind_buffer_size, 1) * 1024 * 1024;
+    zero_page.assign(Common::DirtyPageTracker::GetPageSize(), 0);
+
+    enabled = stats.capture_interval != 0 && !zero_page.empty();
+    last_capture_frame = VideoCore::g_renderer->current_frame();
+    if (enabled) {
+        LOG_INFO(Core, "Rewind enabled, capturing every %u frames into %d MB",
+                 stats.capture_interval, Settings::values.rewind_buffer_size);
+    }
+}
+
+void Shutdown() {
+    if (stats.capture_time.num_calls != 0) {
+        const double mean_us = Common::Profiling::TicksToNanoseconds(stats.capture_time.total_ticks) /
+                               1000 / stats.capture_time.num_calls;
+        LOG_INFO(Core, "Rewind: %llu captures (mean %.0f us, max %.0f us, %.0f us per frame), "
+                 "%u states over %u frames in %.1f MB",
+                 (unsigned long long)stats.capture_time.num_calls, mean_us,
+                 Common::Profiling::TicksToNanoseconds(stats.capture_time.max_ticks) / 1000,
+                 mean_us / stats.capture_interval, stats.num_states, stats.frames_covered,
+                 stats.memory_used / (1024.0 * 1024.0));
+    }
+
+    entries.clear();
+    newest = nullptr;
+    deltas_size = 0;
+    enabled = false;
+}
+
+void Update() {
+    if (!enabled)
+        return;
+
+    const int frame = VideoCore::g_renderer->current_frame();
+    if (frame - last_capture_frame < (int)stats.capture_interval)
+        return;
+
+    last_capture_frame = frame;
+    Capture(frame);
+    UpdateStats();
+}
+
+bool StepBack() {
+    if (entries.empty())
+        return false;
+
+    const u64 start = Common::Profiling::GetTicks();
+    std::shared_ptr<const SaveState::Snapshot> target = newest;
+    if (entries.size() > 1) {
+        target = DecodeEntry(*newest, entries.back().delta);
+        if (!target) {
+            LOG_ERROR(Core, "Rewind buffer is corrupted");
+            return false;
+        }
+    }
+    if (!SaveState::Load(*target))
+        return false;
+
+    if (entries.size() > 1) {
+        deltas_size -= entries.back().delta.size();
+        entries.pop_back();
+        newest = target;
+    }
+    last_capture_frame = VideoCore::g_renderer->current_frame();
+    UpdateStats();
+
+    LOG_INFO(Core, "Rewound to frame %d in %.2f ms, %u states left (%.1f MB)",
+             entries.back().frame,
+             Common::Profiling::TicksToNanoseconds(Common::Profiling::GetTicks() - start) / 1000000,
+             stats.num_states, stats.memory_used / (1024.0 * 1024.0));
+    return true;
+}
+
+const Stats& GetStats() {
+    return stats;
+}
+
+} // namespace
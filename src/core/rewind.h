@@ -0,0 +1,51 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+
+#include "common/common_types.h"
+#include "common/profiler.h"
+
+/**
+ * Rewind buffer, to step backwards through the emulation. Every few frames (see
+ * Settings::values.rewind_interval) the state is captured with SaveState::Capture. Only the newest
+ * state is kept whole; each older one is kept as the delta leading back to it from the next one:
+ * the changed pages and the state blob, XORed against their newer contents and run-length encoded.
+ * The oldest states are dropped once the deltas exceed the memory budget.
+ */
+namespace Rewind {
+
+struct Stats {
+    u32 num_states;         ///< Number of states that can be rewound to
+    size_t memory_used;     ///< Bytes used by the deltas and the newest state blob
+    size_t memory_budget;
+    u32 frames_covered;     ///< Number of frames between the oldest and the newest state
+
+    /// Time taken by captures, including SaveState::Capture and the delta encoding
+    Common::Profiling::CallStats capture_time;
+    u32 capture_interval;   ///< Frames between two captures
+};
+
+/// Sets up the buffer from the settings, must be called after SaveState::Init and VideoCore::Init
+void Init();
+
+/// Frees the buffer and logs its statistics
+void Shutdown();
+
+/// Captures the state if enough frames have elapsed since the last capture. Called by the core loop.
+void Update();
+
+/**
+ * Goes back to the state captured before the newest one, which is dropped. When only one state is
+ * left, goes back to it without dropping it.
+ * @return True if a state was restored
+ */
+bool StepBack();
+
+/// Gets the statistics of the buffer
+const Stats& GetStats();
+
+} // namespace
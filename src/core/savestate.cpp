@@ -0,0 +1,420 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "common/common.h"
+#include "common/chunk_file.h"
+#include "common/dirty_page_tracker.h"
+#include "common/file_util.h"
+#include "common/lz4.h"
+
+#include "core/core.h"
+#include "core/core_timing.h"
+#include "core/mem_map.h"
+#include "core/movie.h"
+#include "core/savestate.h"
+#include "core/hle/hle.h"
+#include "core/hle/kernel/kernel.h"
+#include "core/hle/service/fs/async_io.h"
+#include "core/hw/hw.h"
+
+#include "video_core/video_core.h"
+
+namespace SaveState {
+
+/// Header of savestate files. It is followed by the compressed state blob, then by the non-zero
+/// pages of guest memory, each as a u32 page number, a u32 size and the page data. Pages which
+/// don't compress are stored as is, with a size equal to the page size.
+struct FileHeader {
+    u32 magic;
+    u32 version;
+    u32 page_size;
+    u32 num_pages;          ///< Number of pages of guest memory
+    u32 num_stored_pages;   ///< Number of pages stored in the file
+    u32 state_size;
+    u32 compressed_state_size;
+    u32 reserved;
+};
+
+static const u32 FILE_MAGIC = 0x53545343; ///< "CSTS"
+static const u32 FILE_VERSION = 1;
+
+/// Sanity limit on the size of the state blob read from files
+static const u32 MAX_STATE_SIZE = 0x4000000;
+
+static bool initialized = false;
+static u32 page_size = 0;
+static u32 num_pages = 0;
+
+/// Contents of guest memory as of the last capture. Pages not written to since then (i.e. not
+/// dirty) still hold these contents.
+static std::vector<std::shared_ptr<const Chunk>> memory_chunks;
+
+/// Savestate files waiting to be written by the writer thread
+static std::deque<std::pair<std::string, std::shared_ptr<const Snapshot>>> pending_saves;
+static std::mutex pending_mutex;
+static std::condition_variable pending_cv;
+static bool writing = false;
+static bool stop_writer = false;
+static std::thread writer;
+
+/// Saves or loads the state of everything but guest memory
+static void DoState(PointerWrap& p) {
+    auto s = p.Section("SaveState", 1);
+    if (!s)
+        return;
+
+    Core::DoState(p);
+    Memory::DoState(p);
+    HW::DoState(p);
+    Kernel::DoState(p);
+    p.Do(HLE::g_reschedule);
+    CoreTiming::DoState(p);
+    VideoCore::DoState(p);
+}
+
+static std::vector<u8> SerializeState() {
+    u8* ptr = nullptr;
+    PointerWrap measure(&ptr, PointerWrap::MODE_MEASURE);
+    DoState(measure);
+
+    std::vector<u8> state((size_t)ptr);
+    ptr = state.data();
+    PointerWrap p(&ptr, PointerWrap::MODE_WRITE);
+    DoState(p);
+    return state;
+}
+
+static bool DeserializeState(const std::vector<u8>& state) {
+    u8* ptr = const_cast<u8*>(state.data());
+    PointerWrap p(&ptr, PointerWrap::MODE_READ);
+    DoState(p);
+    return p.error != PointerWrap::ERROR_FAILURE && ptr == state.data() + state.size();
+}
+
+static bool IsZeroPage(const u8* data) {
+    // Pages are page aligned, so this is always reading whole words
+    const u64* words = reinterpret_cast<const u64*>(data);
+    for (u32 i = 0; i < page_size / sizeof(u64); ++i) {
+        if (words[i] != 0)
+            return false;
+    }
+    return true;
+}
+
+/// Copies the pages written to since the last capture into memory_chunks
+static void UpdateMemoryChunks() {
+    std::vector<u32> pages;
+    if (Common::DirtyPageTracker::IsEnabled()) {
+        Common::DirtyPageTracker::TakeDirtyPages(pages);
+    } else {
+        // Without tracking, every page has to be compared
+        pages.resize(num_pages);
+        for (u32 i = 0; i < num_pages; ++i)
+            pages[i] = i;
+    }
+
+    // The chunks are shared with older snapshots, so the ones that change are copied first
+    std::shared_ptr<Chunk> chunk;
+    u32 chunk_index = 0;
+    for (u32 page : pages) {
+        if (!chunk || page / PAGES_PER_CHUNK != chunk_index) {
+            if (chunk)
+                memory_chunks[chunk_index] = chunk;
+            chunk_index = page / PAGES_PER_CHUNK;
+            chunk = nullptr;
+        }
+
+        const u8* data = Common::DirtyPageTracker::GetPagePointer(page);
+        const Page& old_page = (*memory_chunks[chunk_index])[page % PAGES_PER_CHUNK];
+        if (old_page && memcmp(old_page->data(), data, page_size) == 0)
+            continue;
+        const bool is_zero = IsZeroPage(data);
+        if (!old_page && is_zero)
+            continue;
+
+        if (!chunk)
+            chunk = std::make_shared<Chunk>(*memory_chunks[chunk_index]);
+        (*chunk)[page % PAGES_PER_CHUNK] =
+            is_zero ? nullptr : std::make_shared<const std::vector<u8>>(data, data + page_size);
+    }
+    if (chunk)
+        memory_chunks[chunk_index] = chunk;
+}
+
+/// Writes the pages of guest memory which differ from a snapshot's
+static void RestoreMemory(const std::vector<std::shared_ptr<const Chunk>>& chunks) {
+    for (u32 i = 0; i < chunks.size(); ++i) {
+        if (chunks[i] == memory_chunks[i])
+            continue;
+
+        for (u32 j = 0; j < PAGES_PER_CHUNK && i * PAGES_PER_CHUNK + j < num_pages; ++j) {
+            const Page& page = (*chunks[i])[j];
+            if (page == (*memory_chunks[i])[j])
+                continue;
+
+            u8* pointer = Common::DirtyPageTracker::GetPagePointer(i * PAGES_PER_CHUNK + j);
+            Common::DirtyPageTracker::MarkDirty(pointer, page_size);
+            if (page)
+                memcpy(pointer, page->data(), page_size);
+            else
+                memset(pointer, 0, page_size);
+        }
+        memory_chunks[i] = chunks[i];
+    }
+
+    // Guest memory matches memory_chunks again, the writes above don't need to be captured
+    std::vector<u32> written_pages;
+    Common::DirtyPageTracker::TakeDirtyPages(written_pages);
+}
+
+static bool WriteFile(const std::string& filename, const Snapshot& snapshot) {
+    FileUtil::CreateFullPath(filename);
+    FileUtil::IOFile file(filename, "wb");
+    if (!file.IsOpen())
+        return false;
+
+    FileHeader header = {};
+    header.magic = FILE_MAGIC;
+    header.version = FILE_VERSION;
+    header.page_size = page_size;
+    header.num_pages = num_pages;
+    header.state_size = (u32)snapshot.state.size();
+
+    std::vector<u8> compressed_state(Common::LZ4::CompressBound(snapshot.state.size()));
+    header.compressed_state_size = (u32)Common::LZ4::Compress(snapshot.state.data(),
+            snapshot.state.size(), compressed_state.data(), compressed_state.size());
+
+    for (const auto& chunk : snapshot.chunks) {
+        for (const Page& page : *chunk) {
+            if (page)
+                header.num_stored_pages++;
+        }
+    }
+
+    if (!file.WriteArray(&header, 1) ||
+        !file.WriteBytes(compressed_state.data(), header.compressed_state_size)) {
+        return false;
+    }
+
+    std::vector<u8> compressed_page(page_size);
+    for (u32 i = 0; i < snapshot.chunks.size(); ++i) {
+        for (u32 j = 0; j < PAGES_PER_CHUNK; ++j) {
+            const Page& page = (*snapshot.chunks[i])[j];
+            if (!page)
+                continue;
+
+            // Compressed pages must be smaller than a page, to tell them apart from stored ones
+            u32 page_header[2] = { i * PAGES_PER_CHUNK + j, 0 };
+            page_header[1] = (u32)Common::LZ4::Compress(page->data(), page_size,
+                                                        compressed_page.data(), page_size - 1);
+            const u8* data = compressed_page.data();
+            if (page_header[1] == 0) {
+                page_header[1] = page_size;
+                data = page->data();
+            }
+
+            if (!file.WriteArray(page_header, 2) || !file.WriteBytes(data, page_header[1]))
+                return false;
+        }
+    }
+    return file.Close();
+}
+
+static void WriterLoop() {
+    while (true) {
+        std::pair<std::string, std::shared_ptr<const Snapshot>> save;
+        {
+            std::unique_lock<std::mutex> lock(pending_mutex);
+            pending_cv.wait(lock, []{ return stop_writer || !pending_saves.empty(); });
+            if (pending_saves.empty())
+                return;
+            save = std::move(pending_saves.front());
+            pending_saves.pop_front();
+            writing = true;
+        }
+
+        if (WriteFile(save.first, *save.second)) {
+            LOG_INFO(Core_SaveState, "Saved state to %s", save.first.c_str());
+        } else {
+            LOG_ERROR(Core_SaveState, "Failed to write state to %s", save.first.c_str());
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex);
+            writing = false;
+        }
+        pending_cv.notify_all();
+    }
+}
+
+void Init() {
+    for (const Memory::HostSpan& region : Memory::GetHostRegions())
+        Common::DirtyPageTracker::AddRegion(region.pointer, region.size);
+    page_size = (u32)Common::DirtyPageTracker::GetPageSize();
+    num_pages = Common::DirtyPageTracker::GetNumPages();
+
+    for (const Memory::HostSpan& region : Memory::GetHostRegions()) {
+        if (region.size % page_size != 0) {
+            LOG_ERROR(Core_SaveState, "Guest memory isn't made of whole host pages, savestates "
+                      "are unavailable");
+            Common::DirtyPageTracker::ClearRegions();
+            return;
+        }
+    }
+
+    // Guest memory is all zeroes at this point, which is what an empty chunk holds
+    const std::shared_ptr<const Chunk> empty_chunk = std::make_shared<Chunk>();
+    memory_chunks.assign((num_pages + PAGES_PER_CHUNK - 1) / PAGES_PER_CHUNK, empty_chunk);
+
+    if (!Common::DirtyPageTracker::Enable()) {
+        LOG_WARNING(Core_SaveState, "Dirty page tracking is unavailable, savestates will compare "
+                    "all of guest memory");
+    }
+
+    stop_writer = false;
+    writer = std::thread(WriterLoop);
+    initialized = true;
+}
+
+void Shutdown() {
+    if (!initialized)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        stop_writer = true;
+    }
+    pending_cv.notify_all();
+    writer.join();
+
+    Common::DirtyPageTracker::ClearRegions();
+    memory_chunks.clear();
+    initialized = false;
+}
+
+std::shared_ptr<const Snapshot> Capture() {
+    if (!initialized)
+        return nullptr;
+
+    // Requests in flight would write to guest memory behind our back
+    Service::FS::FlushAsyncIO();
+    UpdateMemoryChunks();
+
+    std::shared_ptr<Snapshot> snapshot = std::make_shared<Snapshot>();
+    snapshot->chunks = memory_chunks;
+    snapshot->state = SerializeState();
+    return snapshot;
+}
+
+bool Load(const Snapshot& snapshot) {
+    if (!initialized || snapshot.chunks.size() != memory_chunks.size())
+        return false;
+
+    if (Movie::IsActive()) {
+        LOG_ERROR(Core_SaveState, "States can't be loaded while a movie is recorded or played");
+        return false;
+    }
+
+    // Capturing also brings memory_chunks up to date, which RestoreMemory relies on
+    std::shared_ptr<const Snapshot> current = Capture();
+
+    RestoreMemory(snapshot.chunks);
+    if (!DeserializeState(snapshot.state)) {
+        LOG_ERROR(Core_SaveState, "Failed to load the state, restoring the previous one");
+        RestoreMemory(current->chunks);
+        DeserializeState(current->state);
+        return false;
+    }
+    return true;
+}
+
+bool SaveToFile(const std::string& filename) {
+    std::shared_ptr<const Snapshot> snapshot = Capture();
+    if (!snapshot)
+        return false;
+
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        pending_saves.emplace_back(filename, snapshot);
+    }
+    pending_cv.notify_all();
+    return true;
+}
+
+bool LoadFromFile(const std::string& filename) {
+    if (!initialized)
+        return false;
+
+    // The file might still be being written
+    WaitForPendingSaves();
+
+    FileUtil::IOFile file(filename, "rb");
+    FileHeader header;
+    if (!file.IsOpen() || !file.ReadArray(&header, 1)) {
+        LOG_ERROR(Core_SaveState, "Failed to read %s", filename.c_str());
+        return false;
+    }
+    if (header.magic != FILE_MAGIC || header.version != FILE_VERSION ||
+        header.page_size != page_size || header.num_pages != num_pages ||
+        header.num_stored_pages > num_pages || header.state_size > MAX_STATE_SIZE ||
+        header.compressed_state_size > Common::LZ4::CompressBound(header.state_size)) {
+        LOG_ERROR(Core_SaveState, "%s isn't a savestate of this version", filename.c_str());
+        return false;
+    }
+
+    Snapshot snapshot;
+    std::vector<u8> compressed(std::max(header.compressed_state_size, page_size));
+    snapshot.state.resize(header.state_size);
+    if (!file.ReadBytes(compressed.data(), header.compressed_state_size) ||
+        !Common::LZ4::Decompress(compressed.data(), header.compressed_state_size,
+                                 snapshot.state.data(), snapshot.state.size())) {
+        LOG_ERROR(Core_SaveState, "%s is corrupted", filename.c_str());
+        return false;
+    }
+
+    std::vector<std::shared_ptr<Chunk>> chunks(memory_chunks.size());
+    for (auto& chunk : chunks)
+        chunk = std::make_shared<Chunk>();
+
+    for (u32 i = 0; i < header.num_stored_pages; ++i) {
+        u32 page_header[2];
+        if (!file.ReadArray(page_header, 2) || page_header[0] >= num_pages ||
+            page_header[1] > page_size || !file.ReadBytes(compressed.data(), page_header[1])) {
+            LOG_ERROR(Core_SaveState, "%s is corrupted", filename.c_str());
+            return false;
+        }
+
+        std::shared_ptr<std::vector<u8>> page = std::make_shared<std::vector<u8>>(page_size);
+        if (page_header[1] == page_size) {
+            memcpy(page->data(), compressed.data(), page_size);
+        } else if (!Common::LZ4::Decompress(compressed.data(), page_header[1], page->data(),
+                                            page_size)) {
+            LOG_ERROR(Core_SaveState, "%s is corrupted", filename.c_str());
+            return false;
+        }
+        (*chunks[page_header[0] / PAGES_PER_CHUNK])[page_header[0] % PAGES_PER_CHUNK] = page;
+    }
+
+    snapshot.chunks.assign(chunks.begin(), chunks.end());
+    if (!Load(snapshot))
+        return false;
+
+    LOG_INFO(Core_SaveState, "Loaded state from %s", filename.c_str());
+    return true;
+}
+
+void WaitForPendingSaves() {
+    std::unique_lock<std::mutex> lock(pending_mutex);
+    pending_cv.wait(lock, []{ return !writing && pending_saves.empty(); });
+}
+
+} // namespace
@@ -0,0 +1,81 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/common_types.h"
+
+/**
+ * Savestates of the whole emulated system. Guest memory is saved page by page: pages written to
+ * are tracked with Common::DirtyPageTracker, so a capture only copies the pages written since the
+ * previous one, and snapshots share the pages they have in common. Everything else (CPU, kernel,
+ * services, GPU...) is serialized with PointerWrap into a small blob.
+ *
+ * Savestates are only compatible with the same build and the same game, with the same services
+ * open; loading anything else fails and leaves the emulated system as it was.
+ */
+namespace SaveState {
+
+/// Contents of a page of guest memory, or null for a page of zeroes
+typedef std::shared_ptr<const std::vector<u8>> Page;
+
+/// Number of pages grouped in a chunk, chunks are the unit of copy-on-write between snapshots
+const u32 PAGES_PER_CHUNK = 256;
+
+typedef std::array<Page, PAGES_PER_CHUNK> Chunk;
+
+/// Immutable state of the emulated system at some point, see Capture
+struct Snapshot {
+    /// Guest memory, numbered as the pages of Common::DirtyPageTracker
+    std::vector<std::shared_ptr<const Chunk>> chunks;
+
+    /// Serialized state of everything but guest memory
+    std::vector<u8> state;
+};
+
+/// Starts tracking guest memory, must be called after Memory::Init
+void Init();
+
+/// Stops tracking guest memory and finishes writing pending savestate files
+void Shutdown();
+
+/**
+ * Captures the state of the emulated system. Cheap enough to be called every frame: only the pages
+ * written to since the previous capture are copied.
+ * @return The snapshot, or nullptr if savestates aren't available
+ */
+std::shared_ptr<const Snapshot> Capture();
+
+/**
+ * Restores the emulated system to a snapshot. Only the pages differing from the current contents
+ * of guest memory are copied.
+ * @param snapshot Snapshot to restore, from Capture or LoadFromFile
+ * @return True on success, otherwise the emulated system is left as it was
+ */
+bool Load(const Snapshot& snapshot);
+
+/**
+ * Captures the state of the emulated system and writes it to a file. The file is compressed and
+ * written on a background thread, the emulation only waits for the capture.
+ * @param filename Path of the file to write
+ * @return True if the state was captured, the result of the write is logged
+ */
+bool SaveToFile(const std::string& filename);
+
+/**
+ * Reads a savestate file and restores the emulated system to it
+ * @param filename Path of the file to read
+ * @return True on success, otherwise the emulated system is left as it was
+ */
+bool LoadFromFile(const std::string& filename);
+
+/// Waits for the savestate files being written in the background
+void WaitForPendingSaves();
+
+} // namespace
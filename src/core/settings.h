@@ -31,9 +31,13 @@ struct Values {
     // Core
     int cpu_core;
     int gpu_refresh_rate;
+    int rewind_interval;
+    int rewind_buffer_size;
 
     // Data Storage
     bool use_virtual_sd;
+    bool use_async_io;
+    bool use_code_cache;
 
     std::string log_filter;
 } extern values;
@@ -5,6 +5,9 @@
 #include "core/core.h"
 #include "core/core_timing.h"
 #include "core/mem_map.h"
+#include "core/movie.h"
+#include "core/rewind.h"
+#include "core/savestate.h"
 #include "core/system.h"
 #include "core/hw/hw.h"
 #include "core/hle/hle.h"
@@ -22,11 +25,13 @@ void UpdateState(State state) {
 void Init(EmuWindow* emu_window) {
     Core::Init();
     Memory::Init();
+    SaveState::Init();
     HW::Init();
     Kernel::Init();
     HLE::Init();
     CoreTiming::Init();
     VideoCore::Init(emu_window);
+    Rewind::Init();
 }
 
 void RunLoopFor(int cycles) {
@@ -37,11 +42,14 @@ void RunLoopUntil(u64 global_cycles) {
 }
 
 void Shutdown() {
+    Movie::Stop();
+    Rewind::Shutdown();
     VideoCore::Shutdown();
     CoreTiming::Shutdown();
     HLE::Shutdown();
     Kernel::Shutdown();
     HW::Shutdown();
+    SaveState::Shutdown();
     Memory::Shutdown();
     Core::Shutdown();
 }
@@ -0,0 +1,157 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include "common/common.h"
+#include "common/file_util.h"
+
+#include "core/file_sys/disk_archive.h"
+
+#include "microbench/microbench.h"
+
+// Cost of the small writes games make to their saves, through the write-back cache of DiskFile.
+// Each iteration opens an existing 512 KiB save, writes 16 bytes 1000 times, at random offsets or
+// one after the other, and closes it again, the way a game updates its save. On Linux, the runner
+// also reports the write system calls and bytes written by the process, from /proc/self/io. The
+// UncachedReference benchmarks time the way DiskFile::Write wrote before the cache: each write
+// passed to the host file at once, and flushed if the guest asked to.
+
+static const u32 SAVE_SIZE = 512 * 1024;
+static const u32 WRITE_SIZE = 16;
+static const u32 NUM_WRITES = 1000;
+
+static const int FLUSH = 1 << 0;
+static const int ATOMIC = 1 << 1;
+static const int SEQUENTIAL = 1 << 2;
+
+/// Archive over a temporary directory of the host, with or without atomic writes
+class BenchArchive final : public FileSys::DiskArchive {
+public:
+    BenchArchive(const std::string& mount_point, bool atomic_writes)
+        : DiskArchive(mount_point), atomic_writes(atomic_writes) {}
+
+    std::string GetName() const override { return "Bench"; }
+    bool UseAtomicWrites() const override { return atomic_writes; }
+
+private:
+    bool atomic_writes;
+};
+
+/// Creates the save written by the benchmarks, and deletes it at the end of the run
+class ScopedSave {
+public:
+    ScopedSave() : directory(Microbench::GetScratchDirectory()) {
+        FileUtil::WriteStringToFile(false, std::string(SAVE_SIZE, '\0'),
+                                    (directory + "save.bin").c_str());
+    }
+
+    ~ScopedSave() {
+        FileUtil::Delete(directory + "save.bin");
+    }
+
+    const std::string directory;
+};
+
+/// Host write system calls and bytes written by the process so far, from /proc/self/io
+static bool GetHostWrites(u64& syscalls, u64& bytes) {
+#ifdef __linux__
+    std::ifstream io("/proc/self/io");
+    std::string key;
+    u64 value;
+    int num_found = 0;
+    while (io >> key >> value) {
+        if (key == "syscw:") {
+            syscalls = value;
+            ++num_found;
+        } else if (key == "wchar:") {
+            bytes = value;
+            ++num_found;
+        }
+    }
+    return num_found == 2;
+#else
+    return false;
+#endif
+}
+
+/// Offset of the index-th write, random but the same in every run unless the writes are sequential
+static u64 WriteOffset(s64 arg, u32 index) {
+    if (arg & SEQUENTIAL)
+        return (u64)index * WRITE_SIZE;
+    return (u64)((index * 2654435761u) >> 8) % (SAVE_SIZE / WRITE_SIZE) * WRITE_SIZE;
+}
+
+static void SetHostWriteCounters(Microbench::State& state, u64 syscalls_before, u64 bytes_before) {
+    u64 syscalls, bytes;
+    if (GetHostWrites(syscalls, bytes)) {
+        state.SetCounter("write syscalls", syscalls - syscalls_before);
+        state.SetCounter("bytes written", bytes - bytes_before);
+    }
+}
+
+static void DiskFileSmallWrites(Microbench::State& state) {
+    const ScopedSave save;
+    const BenchArchive archive(save.directory, (state.GetArg() & ATOMIC) != 0);
+    const u32 flush = (state.GetArg() & FLUSH) ? 1 : 0;
+
+    FileSys::Mode mode;
+    mode.hex = 0;
+    mode.read_flag = 1;
+    mode.write_flag = 1;
+
+    u8 buffer[WRITE_SIZE];
+    memset(buffer, 0xA5, sizeof(buffer));
+
+    u64 syscalls_before = 0, bytes_before = 0;
+    GetHostWrites(syscalls_before, bytes_before);
+    while (state.KeepRunning()) {
+        auto file = archive.OpenFile(FileSys::Path("/save.bin"), mode);
+        for (u32 i = 0; i < NUM_WRITES; ++i)
+            file->Write(WriteOffset(state.GetArg(), i), WRITE_SIZE, flush, buffer);
+        file->Close();
+    }
+    SetHostWriteCounters(state, syscalls_before, bytes_before);
+    state.SetItemsProcessed(state.GetIterations() * NUM_WRITES);
+    state.SetBytesProcessed(state.GetIterations() * NUM_WRITES * WRITE_SIZE);
+}
+MICROBENCH_ARG(DiskFileSmallWrites, 0);
+MICROBENCH_ARG(DiskFileSmallWrites, 1);   // FLUSH
+MICROBENCH_ARG(DiskFileSmallWrites, 2);   // ATOMIC
+MICROBENCH_ARG(DiskFileSmallWrites, 3);   // ATOMIC | FLUSH
+MICROBENCH_ARG(DiskFileSmallWrites, 4);   // SEQUENTIAL
+MICROBENCH_ARG(DiskFileSmallWrites, 5);   // SEQUENTIAL | FLUSH
+MICROBENCH_ARG(DiskFileSmallWrites, 6);   // SEQUENTIAL | ATOMIC
+MICROBENCH_ARG(DiskFileSmallWrites, 7);   // SEQUENTIAL | ATOMIC | FLUSH
+
+static void DiskFileSmallWritesUncachedReference(Microbench::State& state) {
+    const ScopedSave save;
+    const std::string path = save.directory + "save.bin";
+    const bool flush = (state.GetArg() & FLUSH) != 0;
+
+    u8 buffer[WRITE_SIZE];
+    memset(buffer, 0xA5, sizeof(buffer));
+
+    u64 syscalls_before = 0, bytes_before = 0;
+    GetHostWrites(syscalls_before, bytes_before);
+    while (state.KeepRunning()) {
+        FileUtil::IOFile file(path, "r+b");
+        for (u32 i = 0; i < NUM_WRITES; ++i) {
+            file.Seek(WriteOffset(state.GetArg(), i), SEEK_SET);
+            file.WriteBytes(buffer, WRITE_SIZE);
+            if (flush)
+                file.Flush();
+        }
+        file.Close();
+    }
+    SetHostWriteCounters(state, syscalls_before, bytes_before);
+    state.SetItemsProcessed(state.GetIterations() * NUM_WRITES);
+    state.SetBytesProcessed(state.GetIterations() * NUM_WRITES * WRITE_SIZE);
+}
+MICROBENCH_ARG(DiskFileSmallWritesUncachedReference, 0);
+MICROBENCH_ARG(DiskFileSmallWritesUncachedReference, 1);   // FLUSH
+MICROBENCH_ARG(DiskFileSmallWritesUncachedReference, 4);   // SEQUENTIAL
+MICROBENCH_ARG(DiskFileSmallWritesUncachedReference, 5);   // SEQUENTIAL | FLUSH
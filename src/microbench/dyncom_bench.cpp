@@ -0,0 +1,132 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "common/common.h"
+
+#include "core/mem_map.h"
+#include "core/arm/dyncom/arm_dyncom.h"
+
+#include "microbench/microbench.h"
+
+// Synthetic programs run by the dyncom interpreter, each an endless loop written to its own page
+// of the code region, so that their blocks stay apart in the cache and in profiles. The ARM
+// encodings are spelled out since there is no assembler in the build.
+
+static const VAddr ALU_LOOP_VADDR = Memory::EXEFS_CODE_VADDR;
+static const VAddr LOAD_STORE_STREAM_VADDR = Memory::EXEFS_CODE_VADDR + 0x1000;
+static const VAddr BRANCHES_VADDR = Memory::EXEFS_CODE_VADDR + 0x2000;
+static const VAddr VFP_LOOP_VADDR = Memory::EXEFS_CODE_VADDR + 0x3000;
+static const VAddr DATA_VADDR = Memory::HEAP_VADDR;
+
+/// Instructions run by each iteration of the benchmarks
+static const int INSTRUCTIONS_PER_ITERATION = 10000;
+
+/// Integer arithmetic, logic and shifts
+static const std::vector<u32> ALU_LOOP = {
+    0xE0800001, // add  r0, r0, r1
+    0xE0222000, // eor  r2, r2, r0
+    0xE1833082, // orr  r3, r3, r2, lsl #1
+    0xE0444003, // sub  r4, r4, r3
+    0xE0055004, // and  r5, r5, r4
+    0xE1A061E5, // mov  r6, r5, ror #3
+    0xE2811001, // add  r1, r1, #1
+    0xEAFFFFF7, // b    ALU_LOOP
+};
+
+/// Read-modify-write of each word of a 64 KB buffer at r0
+static const std::vector<u32> LOAD_STORE_STREAM = {
+    0xE7902001, // ldr  r2, [r0, r1]
+    0xE2822001, // add  r2, r2, #1
+    0xE7802001, // str  r2, [r0, r1]
+    0xE2811004, // add  r1, r1, #4
+    0xE3C11801, // bic  r1, r1, #0x10000
+    0xEAFFFFF9, // b    LOAD_STORE_STREAM
+};
+
+/// Alternately taken and not taken conditional branches, and a call
+static const std::vector<u32> BRANCHES = {
+    0xE2800001, // add  r0, r0, #1
+    0xE3100001, // tst  r0, #1
+    0x1A000001, // bne  odd
+    0xEB000002, // bl   function
+    0xEAFFFFFA, // b    BRANCHES
+    0xE2811001, // odd: add r1, r1, #1
+    0xEAFFFFF8, // b    BRANCHES
+    0xE2822001, // function: add r2, r2, #1
+    0xE12FFF1E, // bx   lr
+};
+
+/// Single precision VFP arithmetic, with s1 = 1.0 and s3 = 0.5
+static const std::vector<u32> VFP_LOOP = {
+    0xEE300A20, // vadd.f32 s0, s0, s1
+    0xEE201A21, // vmul.f32 s2, s0, s3
+    0xEE312A60, // vsub.f32 s4, s2, s1
+    0xEE402A21, // vmla.f32 s5, s0, s3
+    0xEAFFFFFA, // b        VFP_LOOP
+};
+
+static u32 FloatBits(float value) {
+    u32 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+/**
+ * Writes a program to the code region and runs it once, so that its blocks are translated before
+ * the timing starts
+ * @param address Address to write the program to
+ * @param program Instructions of the program
+ * @return CPU running the program
+ */
+static std::unique_ptr<ARM_DynCom> SetupProgram(VAddr address, const std::vector<u32>& program) {
+    for (size_t i = 0; i < program.size(); ++i)
+        Memory::Write32(address + (u32)i * 4, program[i]);
+
+    std::unique_ptr<ARM_DynCom> cpu(new ARM_DynCom);
+    ThreadContext context;
+    cpu->SaveContext(context);
+    context.fpu_registers[1] = FloatBits(1.0f);
+    context.fpu_registers[3] = FloatBits(0.5f);
+    cpu->LoadContext(context);
+
+    cpu->SetReg(0, DATA_VADDR);
+    cpu->SetPC(address);
+    cpu->ExecuteInstructions(INSTRUCTIONS_PER_ITERATION);
+    return cpu;
+}
+
+static void RunProgram(Microbench::State& state, VAddr address, const std::vector<u32>& program) {
+    std::unique_ptr<ARM_DynCom> cpu = SetupProgram(address, program);
+
+    // The interpreter may run a few more instructions than asked to finish a block, the ticks
+    // count the ones actually run
+    const u64 start_ticks = cpu->GetTicks();
+    while (state.KeepRunning())
+        cpu->ExecuteInstructions(INSTRUCTIONS_PER_ITERATION);
+    state.SetItemsProcessed(cpu->GetTicks() - start_ticks);
+}
+
+static void DyncomAluLoop(Microbench::State& state) {
+    RunProgram(state, ALU_LOOP_VADDR, ALU_LOOP);
+}
+MICROBENCH(DyncomAluLoop);
+
+static void DyncomLoadStoreStream(Microbench::State& state) {
+    RunProgram(state, LOAD_STORE_STREAM_VADDR, LOAD_STORE_STREAM);
+}
+MICROBENCH(DyncomLoadStoreStream);
+
+static void DyncomBranches(Microbench::State& state) {
+    RunProgram(state, BRANCHES_VADDR, BRANCHES);
+}
+MICROBENCH(DyncomBranches);
+
+static void DyncomVfpLoop(Microbench::State& state) {
+    RunProgram(state, VFP_LOOP_VADDR, VFP_LOOP);
+}
+MICROBENCH(DyncomVfpLoop);
@@ -0,0 +1,172 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "common/common.h"
+#include "common/file_util.h"
+
+#include "core/mem_map.h"
+#include "core/loader/3dsx.h"
+#include "core/loader/elf.h"
+
+#include "microbench/microbench.h"
+
+// Loading of large homebrew executables into guest memory, from synthetic files generated in the
+// scratch directory: a 50 MB ELF with a single loadable segment and a 4 MB BSS, and a 33 MB 3DSX
+// with an absolute relocation every 16 words of its segments. Each file is loaded once before the
+// timing starts, which checks that it is valid and brings it into the host page cache, so that the
+// benchmarks time the loader rather than the disk.
+
+/// Appends a little-endian value to a file image
+template <typename T>
+static void Put(std::vector<u8>& image, T value) {
+    const size_t offset = image.size();
+    image.resize(offset + sizeof(T));
+    memcpy(&image[offset], &value, sizeof(T));
+}
+
+/// Appends pseudo-random words below limit, the same on every run
+static void PutWords(std::vector<u8>& image, u32 size, u32 limit) {
+    const size_t offset = image.size();
+    image.resize(offset + size);
+
+    u32 seed = 0x12345678;
+    for (u32 i = 0; i < size / 4; ++i) {
+        seed = seed * 1103515245 + 12345;
+        const u32 word = seed % limit;
+        memcpy(&image[offset + i * 4], &word, sizeof(word));
+    }
+}
+
+/// Writes a generated file to the scratch directory, and deletes it at the end of the run
+class ScopedImage {
+public:
+    ScopedImage(const std::string& name, const std::vector<u8>& image)
+        : path(Microbench::GetScratchDirectory() + name), size(image.size()) {
+        FileUtil::IOFile file(path, "wb");
+        file.WriteBytes(image.data(), image.size());
+    }
+
+    ~ScopedImage() {
+        FileUtil::Delete(path);
+    }
+
+    const std::string path;
+    const u64 size;
+};
+
+static const u32 ELF_SEGMENT_SIZE = 50 * 1024 * 1024;
+static const u32 ELF_BSS_SIZE = 4 * 1024 * 1024;
+static const u32 ELF_SEGMENT_OFFSET = 0x1000;
+
+/// Generates an ARM executable ELF with one loadable segment at the start of the ExeFS code region
+static std::vector<u8> GenerateELF() {
+    std::vector<u8> image;
+    static const u8 ident[16] = { 0x7F, 'E', 'L', 'F', 1, 1, 1 };
+    image.insert(image.end(), ident, ident + sizeof(ident));
+    Put<u16>(image, 2);                              // e_type: ET_EXEC
+    Put<u16>(image, 40);                             // e_machine: ARM
+    Put<u32>(image, 1);                              // e_version
+    Put<u32>(image, Memory::EXEFS_CODE_VADDR);       // e_entry
+    Put<u32>(image, 52);                             // e_phoff, right after this header
+    Put<u32>(image, 0);                              // e_shoff
+    Put<u32>(image, 0);                              // e_flags
+    Put<u16>(image, 52);                             // e_ehsize
+    Put<u16>(image, 32);                             // e_phentsize
+    Put<u16>(image, 1);                              // e_phnum
+    Put<u16>(image, 40);                             // e_shentsize
+    Put<u16>(image, 0);                              // e_shnum
+    Put<u16>(image, 0);                              // e_shstrndx
+
+    Put<u32>(image, 1);                              // p_type: PT_LOAD
+    Put<u32>(image, ELF_SEGMENT_OFFSET);             // p_offset
+    Put<u32>(image, Memory::EXEFS_CODE_VADDR);       // p_vaddr
+    Put<u32>(image, Memory::EXEFS_CODE_VADDR);       // p_paddr
+    Put<u32>(image, ELF_SEGMENT_SIZE);               // p_filesz
+    Put<u32>(image, ELF_SEGMENT_SIZE + ELF_BSS_SIZE); // p_memsz
+    Put<u32>(image, 7);                              // p_flags: RWX
+    Put<u32>(image, 0x1000);                         // p_align
+
+    image.resize(ELF_SEGMENT_OFFSET);
+    PutWords(image, ELF_SEGMENT_SIZE, 0xFFFFFFFF);
+    return image;
+}
+
+static const u32 THREEDSX_CODE_SIZE = 16 * 1024 * 1024;
+static const u32 THREEDSX_RODATA_SIZE = 8 * 1024 * 1024;
+static const u32 THREEDSX_DATA_SIZE = 9 * 1024 * 1024;
+static const u32 THREEDSX_BSS_SIZE = 1024 * 1024;
+
+/// Number of relocations of a segment of the given size, one every 16 words
+static u32 Num3DSXRelocations(u32 segment_size) {
+    return (segment_size / 4 - 1) / 16;
+}
+
+/// Generates a 3DSX whose segments are made of addresses within the image, with an absolute
+/// relocation every 16 words
+static std::vector<u8> Generate3DSX() {
+    const u32 image_size = THREEDSX_CODE_SIZE + THREEDSX_RODATA_SIZE + THREEDSX_DATA_SIZE;
+    const u32 segment_sizes[3] = {
+        THREEDSX_CODE_SIZE, THREEDSX_RODATA_SIZE, THREEDSX_DATA_SIZE - THREEDSX_BSS_SIZE
+    };
+
+    std::vector<u8> image;
+    Put<u32>(image, 0x58534433);                     // magic: '3DSX'
+    Put<u16>(image, 32);                             // header_size
+    Put<u16>(image, 8);                              // reloc_hdr_size: two tables per segment
+    Put<u32>(image, 0);                              // format_ver
+    Put<u32>(image, 0);                              // flags
+    Put<u32>(image, THREEDSX_CODE_SIZE);
+    Put<u32>(image, THREEDSX_RODATA_SIZE);
+    Put<u32>(image, THREEDSX_DATA_SIZE);
+    Put<u32>(image, THREEDSX_BSS_SIZE);
+
+    // Absolute and relative relocation counts of each segment
+    for (u32 segment_size : segment_sizes) {
+        Put<u32>(image, Num3DSXRelocations(segment_size));
+        Put<u32>(image, 0);
+    }
+
+    for (u32 segment_size : segment_sizes)
+        PutWords(image, segment_size, image_size);
+
+    // Each relocation skips up to the next multiple of 16 words, and patches one word
+    for (u32 segment_size : segment_sizes) {
+        const u32 num_relocations = Num3DSXRelocations(segment_size);
+        for (u32 i = 0; i < num_relocations; ++i) {
+            Put<u16>(image, i == 0 ? 0 : 15);
+            Put<u16>(image, 1);
+        }
+    }
+    return image;
+}
+
+typedef Loader::ResultStatus (*LoadImageFunction)(const std::string& filename, u32& entry_point);
+
+static void TimeLoad(Microbench::State& state, const ScopedImage& file, LoadImageFunction load) {
+    u32 entry_point;
+    if (load(file.path, entry_point) != Loader::ResultStatus::Success)
+        LOG_ERROR(Loader, "Failed to load %s", file.path.c_str());
+
+    while (state.KeepRunning()) {
+        load(file.path, entry_point);
+        Microbench::DoNotOptimize(entry_point);
+    }
+    state.SetBytesProcessed(state.GetIterations() * file.size);
+}
+
+static void LoadELF(Microbench::State& state) {
+    const ScopedImage file("bench.elf", GenerateELF());
+    TimeLoad(state, file, Loader::AppLoader_ELF::LoadImage);
+}
+MICROBENCH(LoadELF);
+
+static void Load3DSX(Microbench::State& state) {
+    const ScopedImage file("bench.3dsx", Generate3DSX());
+    TimeLoad(state, file, Loader::AppLoader_THREEDSX::LoadImage);
+}
+MICROBENCH(Load3DSX);
@@ -0,0 +1,136 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <array>
+#include <cstdarg>
+#include <cstdio>
+#include <mutex>
+
+#include "common/common.h"
+#include "common/string_util.h"
+#include "common/logging/backend.h"
+
+#include "microbench/microbench.h"
+
+// Cost of logging on the emulation thread, for the kind of messages HLE code logs. The messages
+// are captured at Debug level, which the runner's console filter drops, so the logging thread still
+// formats them but nothing is printed. The EagerReference benchmarks time the way messages were
+// logged before formatting was deferred: formatted at the call site whatever the filter, then
+// pushed to a mutex-protected ring buffer.
+
+/// Sets the producer-side level of every log class for the lifetime of the object
+class ScopedLogLevel {
+public:
+    explicit ScopedLogLevel(Log::Level level) {
+        for (size_t i = 0; i < saved_levels.size(); ++i) {
+            saved_levels[i] = Log::g_class_levels[i].load();
+            Log::g_class_levels[i].store(level);
+        }
+    }
+
+    ~ScopedLogLevel() {
+        for (size_t i = 0; i < saved_levels.size(); ++i)
+            Log::g_class_levels[i].store(saved_levels[i]);
+    }
+
+private:
+    std::array<Log::Level, (size_t)Log::Class::Count> saved_levels;
+};
+
+static std::mutex eager_mutex;
+static std::array<Log::Entry, 256> eager_ring;
+static size_t eager_next_entry = 0;
+
+/// Logs a message the way the logging backend did before formatting was deferred
+static void LogEager(Log::Class log_class, Log::Level log_level, const char* filename,
+                     unsigned int line_nr, const char* function, const char* format, ...) {
+    std::array<char, 4 * 1024> formatting_buffer;
+
+    Log::Entry entry;
+    entry.log_class = log_class;
+    entry.log_level = log_level;
+
+    snprintf(formatting_buffer.data(), formatting_buffer.size(), "%s:%s:%u", filename, function,
+             line_nr);
+    entry.location = std::string(formatting_buffer.data());
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(formatting_buffer.data(), formatting_buffer.size(), format, args);
+    va_end(args);
+    entry.message = std::string(formatting_buffer.data());
+
+    std::lock_guard<std::mutex> lock(eager_mutex);
+    eager_ring[eager_next_entry] = std::move(entry);
+    eager_next_entry = (eager_next_entry + 1) % eager_ring.size();
+}
+
+#define LOG_EAGER(log_class, log_level, ...) \
+    LogEager(Log::Class::log_class, Log::Level::log_level, __FILE__, __LINE__, __func__, \
+             __VA_ARGS__)
+
+// Arguments of the WaitSynchronization1 trace of svc.cpp, a typical per-call HLE message
+static const u32 HANDLE = 0x00018005;
+static const std::string TYPE_NAME = "Event";
+static const std::string OBJECT_NAME = "GSP_GPU::interrupt_event";
+static const long long NANOSECONDS = -1;
+
+/// A message which the filter drops at the call site
+static void LogHLECallFiltered(Microbench::State& state) {
+    ScopedLogLevel level(Log::Level::Warning);
+    while (state.KeepRunning()) {
+        LOG_DEBUG(Kernel_SVC, "called handle=0x%08X(%s:%s), nanoseconds=%lld", HANDLE,
+                  TYPE_NAME.c_str(), OBJECT_NAME.c_str(), NANOSECONDS);
+    }
+    state.SetItemsProcessed(state.GetIterations());
+}
+MICROBENCH(LogHLECallFiltered);
+
+/// A message which is captured and handed to the logging thread
+static void LogHLECall(Microbench::State& state) {
+    ScopedLogLevel level(Log::Level::Debug);
+    while (state.KeepRunning()) {
+        LOG_DEBUG(Kernel_SVC, "called handle=0x%08X(%s:%s), nanoseconds=%lld", HANDLE,
+                  TYPE_NAME.c_str(), OBJECT_NAME.c_str(), NANOSECONDS);
+    }
+    state.SetItemsProcessed(state.GetIterations());
+}
+MICROBENCH(LogHLECall);
+
+static void LogHLECallEagerReference(Microbench::State& state) {
+    while (state.KeepRunning()) {
+        LOG_EAGER(Kernel_SVC, Debug, "called handle=0x%08X(%s:%s), nanoseconds=%lld", HANDLE,
+                  TYPE_NAME.c_str(), OBJECT_NAME.c_str(), NANOSECONDS);
+    }
+    state.SetItemsProcessed(state.GetIterations());
+}
+MICROBENCH(LogHLECallEagerReference);
+
+/// Builds the diagnostic Service::Interface::SyncRequest logs for an unknown command with all of
+/// its 63 parameters, which is longer than the inline string storage of a log record
+static std::string BuildUnknownCommandError() {
+    std::string error = "unknown/unimplemented function '0x00FF0FFF': port=gsp::Gpu";
+    for (int i = 1; i <= 63; ++i)
+        error += Common::StringFromFormat(", cmd_buff[%i]=%u", i, 0x10000000u + i);
+    return error;
+}
+
+static void LogUnknownCommand(Microbench::State& state) {
+    const std::string error = BuildUnknownCommandError();
+    ScopedLogLevel level(Log::Level::Debug);
+    while (state.KeepRunning())
+        LOG_DEBUG(Service, "%s", error.c_str());
+    state.SetItemsProcessed(state.GetIterations());
+    state.SetBytesProcessed(state.GetIterations() * error.size());
+}
+MICROBENCH(LogUnknownCommand);
+
+static void LogUnknownCommandEagerReference(Microbench::State& state) {
+    const std::string error = BuildUnknownCommandError();
+    while (state.KeepRunning())
+        LOG_EAGER(Service, Debug, "%s", error.c_str());
+    state.SetItemsProcessed(state.GetIterations());
+    state.SetBytesProcessed(state.GetIterations() * error.size());
+}
+MICROBENCH(LogUnknownCommandEagerReference);
@@ -0,0 +1,352 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "common/common.h"
+#include "common/file_util.h"
+#include "common/logging/backend.h"
+#include "common/logging/filter.h"
+#include "common/logging/text_formatter.h"
+#include "common/scm_rev.h"
+#include "common/scope_exit.h"
+#include "common/string_util.h"
+
+#include "core/mem_map.h"
+#include "core/arm/dyncom/arm_dyncom_profiler.h"
+
+#include "microbench/microbench.h"
+
+namespace Microbench {
+
+struct Benchmark {
+    std::string name;
+    Function function;
+    s64 arg;
+};
+
+static std::vector<Benchmark>& GetBenchmarks() {
+    // Function-local so that it is constructed before the first registration from any file
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+int Register(const std::string& name, Function function, s64 arg) {
+    GetBenchmarks().push_back({ name, function, arg });
+    return 0;
+}
+
+static std::string GetScratchDirectoryPath() {
+    return FileUtil::GetUserPath(D_USER_IDX) + "microbench" DIR_SEP;
+}
+
+std::string GetScratchDirectory() {
+    const std::string directory = GetScratchDirectoryPath();
+    if (!FileUtil::Exists(directory))
+        FileUtil::CreateFullPath(directory);
+    return directory;
+}
+
+} // namespace
+
+using Microbench::Benchmark;
+using Microbench::State;
+
+static const char* USAGE =
+    "Usage: citra-microbench [options]\n"
+    "Times emulator kernels in isolation.\n"
+    "  --filter <text>        Only run the benchmarks whose name contains text\n"
+    "  --min-time <s>         Minimum duration of each timed run (default: 0.1)\n"
+    "  --repetitions <n>      Number of timed runs of each benchmark (default: 9)\n"
+    "  --json <file>          Also write the results as JSON, or only print them as JSON with -\n"
+    "  --baseline <file>      Compare with the JSON results of an earlier run\n"
+    "  --threshold <percent>  Slowdown over the baseline which fails the run (default: 10)\n"
+    "  --dyncom-profile <file> Profile the dyncom benchmarks and write the report, - for stdout\n"
+    "                         (needs a build with ENABLE_PROFILING, and skews their times)\n"
+    "  --list                 List the benchmarks without running them\n";
+
+struct Options {
+    std::string filter;
+    std::string json_filename;
+    std::string baseline_filename;
+    std::string dyncom_profile_filename;
+    double min_time = 0.1;
+    int repetitions = 9;
+    double threshold = 10;
+    bool list = false;
+};
+
+struct Result {
+    std::string name;
+    u64 iterations;
+    double ns_per_iteration;        ///< Median over the timed runs
+    double min_ns_per_iteration;
+    double deviation;               ///< Median absolute deviation of the runs, over the median
+    double items_per_second;
+    double bytes_per_second;
+    std::map<std::string, double> counters;   ///< Per iteration
+};
+
+static double Median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    const size_t middle = values.size() / 2;
+    return (values.size() % 2) ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+}
+
+static State RunOnce(const Benchmark& benchmark, u64 iterations) {
+    State state(iterations, benchmark.arg);
+    benchmark.function(state);
+    return state;
+}
+
+/**
+ * Runs a benchmark: first with growing iteration counts until a run lasts the minimum time, which
+ * also warms up the caches, then the requested number of times with that iteration count.
+ */
+static Result RunBenchmark(const Benchmark& benchmark, const Options& options) {
+    const double min_ns = options.min_time * 1e9;
+
+    u64 iterations = 1;
+    while (true) {
+        const State state = RunOnce(benchmark, iterations);
+        const double ns = Common::Profiling::TicksToNanoseconds(state.GetTotalTicks());
+        if (ns >= min_ns)
+            break;
+
+        // Aim a bit past the minimum time, without growing too fast from a noisy short run
+        const double factor = (ns > 0) ? min_ns * 1.2 / ns : 10;
+        iterations = (u64)(iterations * std::min(std::max(factor, 2.0), 10.0));
+    }
+
+    std::vector<double> ns_per_iteration;
+    u64 items = 0, bytes = 0;
+    std::map<std::string, u64> counters;
+    for (int i = 0; i < options.repetitions; ++i) {
+        const State state = RunOnce(benchmark, iterations);
+        ns_per_iteration.push_back(
+            Common::Profiling::TicksToNanoseconds(state.GetTotalTicks()) / iterations);
+        items = state.GetItemsProcessed();
+        bytes = state.GetBytesProcessed();
+        counters = state.GetCounters();
+    }
+
+    Result result;
+    result.name = benchmark.name;
+    result.iterations = iterations;
+    result.ns_per_iteration = Median(ns_per_iteration);
+    result.min_ns_per_iteration = *std::min_element(ns_per_iteration.begin(),
+                                                    ns_per_iteration.end());
+
+    std::vector<double> deviations;
+    for (double ns : ns_per_iteration)
+        deviations.push_back(std::abs(ns - result.ns_per_iteration));
+    result.deviation = Median(deviations) / result.ns_per_iteration;
+
+    const double seconds_per_iteration = result.ns_per_iteration / 1e9;
+    result.items_per_second = items / (double)iterations / seconds_per_iteration;
+    result.bytes_per_second = bytes / (double)iterations / seconds_per_iteration;
+    for (const auto& counter : counters)
+        result.counters[counter.first] = counter.second / (double)iterations;
+    return result;
+}
+
+/// Formats a rate with a metric prefix, e.g. "12.3 M"
+static std::string FormatRate(double rate) {
+    if (rate >= 1e9)
+        return Common::StringFromFormat("%7.2f G", rate / 1e9);
+    if (rate >= 1e6)
+        return Common::StringFromFormat("%7.2f M", rate / 1e6);
+    if (rate >= 1e3)
+        return Common::StringFromFormat("%7.2f k", rate / 1e3);
+    return Common::StringFromFormat("%7.2f  ", rate);
+}
+
+static std::string FormatText(const Result& result, const double* baseline_ns) {
+    std::string text = Common::StringFromFormat("%-36s %12.1f ns %12.1f ns min  +-%4.1f%%",
+        result.name.c_str(), result.ns_per_iteration, result.min_ns_per_iteration,
+        result.deviation * 100);
+    if (result.items_per_second != 0)
+        text += "  " + FormatRate(result.items_per_second) + "items/s";
+    if (result.bytes_per_second != 0)
+        text += "  " + FormatRate(result.bytes_per_second) + "B/s";
+    for (const auto& counter : result.counters)
+        text += Common::StringFromFormat("  %.1f %s", counter.second, counter.first.c_str());
+    if (baseline_ns) {
+        text += Common::StringFromFormat("  %+6.1f%% vs baseline",
+                                         (result.ns_per_iteration / *baseline_ns - 1) * 100);
+    }
+    return text + "\n";
+}
+
+/// Formats the results as JSON, with each benchmark on its own line so that ReadBaseline can read
+/// them back without a JSON parser
+static std::string FormatJSON(const std::vector<Result>& results) {
+    std::string json = Common::StringFromFormat("{\n"
+        "  \"revision\": \"%s\",\n"
+        "  \"benchmarks\": [\n", Common::g_scm_rev);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& result = results[i];
+        std::string counters;
+        for (const auto& counter : result.counters) {
+            counters += Common::StringFromFormat("%s\"%s\": %.3f", counters.empty() ? "" : ", ",
+                                                 counter.first.c_str(), counter.second);
+        }
+        json += Common::StringFromFormat("    {\"name\": \"%s\", \"iterations\": %llu, "
+            "\"ns_per_iteration\": %.3f, \"min_ns_per_iteration\": %.3f, \"deviation\": %.4f, "
+            "\"items_per_second\": %.0f, \"bytes_per_second\": %.0f, \"counters\": {%s}}%s\n",
+            result.name.c_str(), (unsigned long long)result.iterations, result.ns_per_iteration,
+            result.min_ns_per_iteration, result.deviation, result.items_per_second,
+            result.bytes_per_second, counters.c_str(), (i + 1 < results.size()) ? "," : "");
+    }
+    return json + "  ]\n}\n";
+}
+
+/// Reads the median time per iteration of each benchmark from JSON written by FormatJSON
+static bool ReadBaseline(const std::string& filename, std::map<std::string, double>& baseline) {
+    std::string json;
+    if (FileUtil::ReadFileToString(true, filename.c_str(), json) == 0)
+        return false;
+
+    std::vector<std::string> lines;
+    Common::SplitString(json, '\n', lines);
+    for (const std::string& line : lines) {
+        static const std::string NAME_KEY = "\"name\": \"";
+        static const std::string NS_KEY = "\"ns_per_iteration\": ";
+
+        const size_t name_pos = line.find(NAME_KEY);
+        const size_t ns_pos = line.find(NS_KEY);
+        if (name_pos == std::string::npos || ns_pos == std::string::npos)
+            continue;
+
+        const size_t name_start = name_pos + NAME_KEY.size();
+        const size_t name_end = line.find('"', name_start);
+        if (name_end == std::string::npos)
+            continue;
+        baseline[line.substr(name_start, name_end - name_start)] =
+            std::atof(line.c_str() + ns_pos + NS_KEY.size());
+    }
+    return !baseline.empty();
+}
+
+static bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--list") {
+            options.list = true;
+            continue;
+        }
+        if (i + 1 == argc)
+            return false; // An option is missing its value
+
+        const std::string value = argv[++i];
+        if (arg == "--filter") {
+            options.filter = value;
+        } else if (arg == "--min-time") {
+            options.min_time = std::atof(value.c_str());
+        } else if (arg == "--repetitions") {
+            options.repetitions = std::max(std::atoi(value.c_str()), 1);
+        } else if (arg == "--json") {
+            options.json_filename = value;
+        } else if (arg == "--baseline") {
+            options.baseline_filename = value;
+        } else if (arg == "--threshold") {
+            options.threshold = std::atof(value.c_str());
+        } else if (arg == "--dyncom-profile") {
+            options.dyncom_profile_filename = value;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Application entry point
+int __cdecl main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        fputs(USAGE, stderr);
+        return -1;
+    }
+
+    std::shared_ptr<Log::Logger> logger = Log::InitGlobalLogger();
+    Log::Filter log_filter(Log::Level::Debug);
+    log_filter.ParseFilterString("*:Warning");
+    Log::SetGlobalFilter(log_filter);
+    std::thread logging_thread(Log::TextLoggingLoop, logger, &log_filter);
+
+    // Emulated memory used by the benchmarks, mapped once for all of them
+    Memory::Init();
+    SCOPE_EXIT({
+        if (FileUtil::Exists(Microbench::GetScratchDirectoryPath()))
+            FileUtil::DeleteDirRecursively(Microbench::GetScratchDirectoryPath());
+        Memory::Shutdown();
+        logger->Close();
+        logging_thread.join();
+    });
+
+    std::map<std::string, double> baseline;
+    if (!options.baseline_filename.empty() && !ReadBaseline(options.baseline_filename, baseline)) {
+        LOG_CRITICAL(Frontend, "Failed to read baseline %s", options.baseline_filename.c_str());
+        return -1;
+    }
+
+    DyncomProfiler::SetEnabled(!options.dyncom_profile_filename.empty());
+
+    const bool json_only = (options.json_filename == "-");
+    std::vector<Result> results;
+    std::vector<std::string> regressions;
+    for (const Benchmark& benchmark : Microbench::GetBenchmarks()) {
+        if (benchmark.name.find(options.filter) == std::string::npos)
+            continue;
+        if (options.list) {
+            printf("%s\n", benchmark.name.c_str());
+            continue;
+        }
+
+        const Result result = RunBenchmark(benchmark, options);
+        results.push_back(result);
+
+        auto base = baseline.find(result.name);
+        const double* baseline_ns = (base != baseline.end()) ? &base->second : nullptr;
+        if (baseline_ns && (result.ns_per_iteration / *baseline_ns - 1) * 100 > options.threshold)
+            regressions.push_back(result.name);
+
+        if (!json_only) {
+            fputs(FormatText(result, baseline_ns).c_str(), stdout);
+            fflush(stdout);
+        }
+    }
+
+    if (json_only) {
+        fputs(FormatJSON(results).c_str(), stdout);
+    } else if (!options.json_filename.empty()) {
+        const std::string json = FormatJSON(results);
+        if (FileUtil::WriteStringToFile(true, json, options.json_filename.c_str()) != json.size()) {
+            LOG_ERROR(Frontend, "Failed to write %s", options.json_filename.c_str());
+            return -1;
+        }
+    }
+
+    if (options.dyncom_profile_filename == "-") {
+        fputs(DyncomProfiler::FormatReport().c_str(), stdout);
+    } else if (!options.dyncom_profile_filename.empty() &&
+               !DyncomProfiler::Dump(options.dyncom_profile_filename)) {
+        return -1;
+    }
+
+    if (!regressions.empty()) {
+        fprintf(stderr, "%u benchmarks are more than %.1f%% slower than the baseline:\n",
+                (u32)regressions.size(), options.threshold);
+        for (const std::string& name : regressions)
+            fprintf(stderr, "  %s\n", name.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,123 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <map>
+#include <string>
+
+#include "common/common_types.h"
+#include "common/profiler.h"
+
+/**
+ * A small benchmark framework for timing emulator kernels in isolation.
+ *
+ * Benchmarks are functions registered with MICROBENCH, which repeat the code to measure while
+ * State::KeepRunning returns true:
+ *
+ *     static void Float24Mul(Microbench::State& state) {
+ *         float24 a = ..., b = ...;
+ *         while (state.KeepRunning())
+ *             Microbench::DoNotOptimize(a = a * b);
+ *         state.SetItemsProcessed(state.GetIterations());
+ *     }
+ *     MICROBENCH(Float24Mul);
+ *
+ * The runner picks a number of iterations so that a run lasts at least the minimum time, then
+ * times several runs and reports the median, which is what comparisons against a baseline use.
+ * The emulated memory is mapped by the runner, benchmarks can use it without calling Memory::Init.
+ */
+namespace Microbench {
+
+class State {
+public:
+    State(u64 iterations, s64 arg) : iterations(iterations), remaining(iterations), arg(arg),
+        start_ticks(0), total_ticks(0), items_processed(0), bytes_processed(0) {}
+
+    /// Returns true while iterations remain, the timing covers the calls between the first and last
+    bool KeepRunning() {
+        if (remaining == iterations)
+            start_ticks = Common::Profiling::GetTicks();
+        if (remaining == 0) {
+            total_ticks = Common::Profiling::GetTicks() - start_ticks;
+            return false;
+        }
+        --remaining;
+        return true;
+    }
+
+    /// Argument the benchmark was registered with, e.g. a size
+    s64 GetArg() const { return arg; }
+
+    u64 GetIterations() const { return iterations; }
+    u64 GetTotalTicks() const { return total_ticks; }
+
+    /// Sets the number of items (pixels, vertices, ...) processed by the whole run
+    void SetItemsProcessed(u64 items) { items_processed = items; }
+    u64 GetItemsProcessed() const { return items_processed; }
+
+    /// Sets the number of bytes processed by the whole run
+    void SetBytesProcessed(u64 bytes) { bytes_processed = bytes; }
+    u64 GetBytesProcessed() const { return bytes_processed; }
+
+    /**
+     * Sets a count of something other than time spent by the whole run, e.g. host system calls,
+     * which the runner reports per iteration
+     */
+    void SetCounter(const std::string& name, u64 value) { counters[name] = value; }
+    const std::map<std::string, u64>& GetCounters() const { return counters; }
+
+private:
+    const u64 iterations;
+    u64 remaining;
+    const s64 arg;
+    u64 start_ticks;
+    u64 total_ticks;
+    u64 items_processed;
+    u64 bytes_processed;
+    std::map<std::string, u64> counters;
+};
+
+typedef void (*Function)(State& state);
+
+/**
+ * Adds a benchmark to the list run by the runner
+ * @param name Name of the benchmark, "function/arg" for benchmarks run with several arguments
+ * @param function Benchmark function
+ * @param arg Argument passed to the function through State::GetArg
+ * @return Dummy value, so that registrations can initialize static variables
+ */
+int Register(const std::string& name, Function function, s64 arg = 0);
+
+/**
+ * Returns the directory on the host in which benchmarks can create files, creating it if needed.
+ * The runner deletes it, with everything left in it, before exiting.
+ */
+std::string GetScratchDirectory();
+
+/// Keeps the compiler from optimizing away the computation of a value which isn't used
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+#if defined(__GNUC__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+} // namespace
+
+#define MICROBENCH_CONCAT_HELPER(x, y) x ## y
+#define MICROBENCH_CONCAT(x, y) MICROBENCH_CONCAT_HELPER(x, y)
+
+/// Registers a benchmark function
+#define MICROBENCH(function) \
+    static int MICROBENCH_CONCAT(microbench_, __LINE__) = \
+        ::Microbench::Register(#function, function)
+
+/// Registers a benchmark function with an argument, once per argument it should be run with
+#define MICROBENCH_ARG(function, arg) \
+    static int MICROBENCH_CONCAT(microbench_, __LINE__) = \
+        ::Microbench::Register(#function "/" #arg, function, arg)
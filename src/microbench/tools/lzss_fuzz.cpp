@@ -0,0 +1,201 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "common/common_types.h"
+
+#include "core/loader/ncch.h"
+
+// Differential fuzzer of the ExeFS LZSS decoder: decompresses generated and mutated streams with
+// Loader::LZSS_Decompress and with the decoder it replaced, and checks that both give the same
+// result and the same output. Exits with 1 if they disagree.
+
+/**
+ * Decoder used by the NCCH loader before Loader::LZSS_Decompress, kept as the reference. It clears
+ * the output and copies the whole compressed file to it before decoding, and reads out of bounds on
+ * footers whose top is past the start of the file, which the generator never produces.
+ */
+static bool ReferenceDecompress(const u8* compressed, u32 compressed_size, u8* decompressed,
+                                u32 decompressed_size) {
+    const u8* footer = compressed + compressed_size - 8;
+    u32 buffer_top_and_bottom;
+    memcpy(&buffer_top_and_bottom, footer, sizeof(u32));
+    u32 out = decompressed_size;
+    u32 index = compressed_size - ((buffer_top_and_bottom >> 24) & 0xFF);
+    u32 stop_index = compressed_size - (buffer_top_and_bottom & 0xFFFFFF);
+
+    memset(decompressed, 0, decompressed_size);
+    memcpy(decompressed, compressed, compressed_size);
+
+    while (index > stop_index) {
+        u8 control = compressed[--index];
+
+        for (u32 i = 0; i < 8; i++) {
+            if (index <= stop_index)
+                break;
+            if (index <= 0)
+                break;
+            if (out <= 0)
+                break;
+
+            if (control & 0x80) {
+                // Check if compression is out of bounds
+                if (index < 2)
+                    return false;
+                index -= 2;
+
+                u32 segment_offset = compressed[index] | (compressed[index + 1] << 8);
+                u32 segment_size = ((segment_offset >> 12) & 15) + 3;
+                segment_offset &= 0x0FFF;
+                segment_offset += 2;
+
+                // Check if compression is out of bounds
+                if (out < segment_size)
+                    return false;
+                for (u32 j = 0; j < segment_size; j++) {
+                    // Check if compression is out of bounds
+                    if (out + segment_offset >= decompressed_size)
+                        return false;
+
+                    u8 data = decompressed[out + segment_offset];
+                    decompressed[--out] = data;
+                }
+            } else {
+                // Check if compression is out of bounds
+                if (out < 1)
+                    return false;
+                decompressed[--out] = compressed[--index];
+            }
+            control <<= 1;
+        }
+    }
+    return true;
+}
+
+static std::mt19937 rng;
+
+/// Returns a random number in [0, n)
+static u32 Random(u32 n) {
+    return rng() % n;
+}
+
+static void WriteFooterWord(std::vector<u8>& stream, u32 offset, u32 value) {
+    memcpy(&stream[stream.size() - offset], &value, sizeof(u32));
+}
+
+static u32 ReadFooterWord(const std::vector<u8>& stream, u32 offset) {
+    u32 value;
+    memcpy(&value, &stream[stream.size() - offset], sizeof(u32));
+    return value;
+}
+
+/**
+ * Builds a valid compressed stream
+ * @param decompressed_size Size of the decompressed data
+ * @param prefix_size Size of the uncompressed data at the start of the file
+ * @param literal_percent Probability of a literal rather than a back-reference, in percent
+ * @param max_segment_size Maximum size of a back-reference, between 3 and 18
+ * @return The compressed stream, with its footer
+ */
+static std::vector<u8> Generate(u32 decompressed_size, u32 prefix_size, u32 literal_percent,
+                                u32 max_segment_size) {
+    // Tokens are generated from the end of the output, the way they are decoded
+    std::vector<u8> tokens;
+    u32 out = decompressed_size;
+    while (out > prefix_size) {
+        const size_t control_index = tokens.size();
+        tokens.push_back(0);
+        u8 control = 0;
+        for (int i = 0; i < 8 && out > prefix_size; ++i) {
+            // Back-references read from above the byte they write, within the output
+            const u32 max_offset = decompressed_size - out >= 1 ? decompressed_size - out - 1 : 0;
+            const u32 room = out - prefix_size;
+            if (Random(100) >= literal_percent && max_offset >= 2 && room >= 3) {
+                const u32 size = 3 + Random(std::min(room - 3, max_segment_size - 3) + 1);
+                const u32 offset = 2 + Random(std::min<u32>(max_offset, 4097) - 1);
+                const u32 token = ((size - 3) << 12) | (offset - 2);
+                tokens.push_back(token >> 8);
+                tokens.push_back(token & 0xFF);
+                control |= 0x80 >> i;
+                out -= size;
+            } else {
+                tokens.push_back(Random(256));
+                out -= 1;
+            }
+        }
+        tokens[control_index] = control;
+    }
+
+    std::vector<u8> stream(prefix_size);
+    for (u8& byte : stream)
+        byte = Random(256);
+    stream.insert(stream.end(), tokens.rbegin(), tokens.rend());
+
+    const u32 size = (u32)stream.size() + 8;
+    stream.resize(size);
+    WriteFooterWord(stream, 8, (8u << 24) | (size - prefix_size));
+    WriteFooterWord(stream, 4, decompressed_size - size);
+    return stream;
+}
+
+/// Corrupts a few bytes of a stream, and sometimes the top or bottom of its footer
+static void Mutate(std::vector<u8>& stream) {
+    const u32 size = (u32)stream.size();
+    for (u32 num_mutations = Random(4); num_mutations > 0; --num_mutations)
+        stream[Random(size - 8)] = Random(256);
+
+    const u32 top_and_bottom = ReadFooterWord(stream, 8);
+    if (Random(8) == 0)
+        WriteFooterWord(stream, 8, (top_and_bottom & 0xFF000000) | Random(size + 16));
+    // The top stays within the file, where the reference decoder reads in bounds
+    if (Random(8) == 0)
+        WriteFooterWord(stream, 8, (top_and_bottom & 0xFFFFFF) |
+                                   (Random(std::min<u32>(size, 255) + 1) << 24));
+}
+
+int main(int argc, char** argv) {
+    const u32 num_iterations = argc > 1 ? (u32)std::strtoul(argv[1], nullptr, 10) : 200000;
+    rng.seed(argc > 2 ? (u32)std::strtoul(argv[2], nullptr, 10) : 1234);
+
+    u32 num_runs = 0;
+    u32 num_valid = 0;
+    u32 num_mismatches = 0;
+    for (u32 i = 0; i < num_iterations; ++i) {
+        const u32 decompressed_size = 16 + Random(4096);
+        std::vector<u8> stream = Generate(decompressed_size, Random(decompressed_size / 4),
+                                          Random(100), 3 + Random(16));
+        if (stream.size() > decompressed_size)
+            continue;
+        Mutate(stream);
+
+        const u32 size = (u32)stream.size();
+        const u32 output_size = Loader::LZSS_GetDecompressedSize(stream.data(), size);
+        if (output_size < size || output_size > 1 << 20)
+            continue;
+
+        std::vector<u8> expected(output_size);
+        std::vector<u8> output(output_size, 0xCC);
+        const bool expected_result = ReferenceDecompress(stream.data(), size, expected.data(),
+                                                         output_size);
+        const bool result = Loader::LZSS_Decompress(stream.data(), size, output.data(),
+                                                    output_size);
+        ++num_runs;
+        if (result != expected_result || (result && output != expected)) {
+            if (num_mismatches++ < 10) {
+                printf("mismatch at iteration %u: result %d, expected %d, size %u -> %u\n", i,
+                       result, expected_result, size, output_size);
+            }
+        }
+        num_valid += expected_result;
+    }
+
+    printf("%u streams, %u decompressed, %u mismatches\n", num_runs, num_valid, num_mismatches);
+    return num_mismatches == 0 ? 0 : 1;
+}
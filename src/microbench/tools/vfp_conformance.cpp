@@ -0,0 +1,302 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+#include "common/common.h"
+
+#include "core/arm/skyeye_common/armdefs.h"
+#include "core/arm/skyeye_common/vfp/vfp.h"
+#include "core/arm/skyeye_common/vfp/vfp_host.h"
+
+// Conformance test of the host FPU fast path of the VFP (see vfp_host.h) against the soft float
+// code: runs each data processing instruction on random and special operands with both, and checks
+// that they write the same registers and return the same exceptions. The soft float code is forced
+// with a trap-enable bit, which it ignores, but which keeps the host path from being used. Short
+// vector instructions, with strides of 1 and 2 and with register sequences wrapping around their
+// bank, are also checked against a reference which runs each element as a scalar instruction with
+// the soft float code. Exits with 1 if any of them disagree.
+
+/// An instruction, given by the opcode bits of its encoding
+struct Operation {
+    const char* name;
+    u32 opcode;
+    bool vector;    ///< Whether the instruction iterates over short vectors
+};
+
+static const u32 EXTENSION = 0x00B00040;
+
+static const Operation operations[] = {
+    { "fmac",   0x00000000,             true  },    // VMLA
+    { "fnmac",  0x00000040,             true  },    // VMLS
+    { "fmsc",   0x00100000,             true  },    // VNMLS
+    { "fnmsc",  0x00100040,             true  },    // VNMLA
+    { "fmul",   0x00200000,             true  },
+    { "fnmul",  0x00200040,             true  },
+    { "fadd",   0x00300000,             true  },
+    { "fsub",   0x00300040,             true  },
+    { "fdiv",   0x00800000,             true  },
+    { "fsqrt",  EXTENSION | 0x00010080, true  },
+    { "fcvt",   EXTENSION | 0x00070080, false },
+    { "fuito",  EXTENSION | 0x00080000, false },
+    { "fsito",  EXTENSION | 0x00080080, false },
+    { "ftoui",  EXTENSION | 0x000C0000, false },
+    { "ftouiz", EXTENSION | 0x000C0080, false },
+    { "ftosi",  EXTENSION | 0x000D0000, false },
+    { "ftosiz", EXTENSION | 0x000D0080, false },
+};
+
+static std::mt19937_64 rng;
+
+static const u32 special_singles[] = {
+    0x00000000, 0x80000000, 0x7F800000, 0xFF800000, 0x7F7FFFFF, 0xFF7FFFFF, 0x00800000, 0x80800000,
+    0x00000001, 0x807FFFFF, 0x7FC00000, 0x7F800001, 0x3F800000, 0xBF800000, 0x4F800000, 0x4F000000,
+    0xCF000000, 0x3F000000, 0xBF000000,
+};
+
+static const u64 special_doubles[] = {
+    0x0000000000000000ULL, 0x8000000000000000ULL, 0x7FF0000000000000ULL, 0xFFF0000000000000ULL,
+    0x7FEFFFFFFFFFFFFFULL, 0x0010000000000000ULL, 0x0000000000000001ULL, 0x7FF8000000000000ULL,
+    0x3FF0000000000000ULL, 0xBFF0000000000000ULL, 0x41F0000000000000ULL, 0x41E0000000000000ULL,
+    0xC1E0000000000000ULL, 0x47EFFFFFE0000000ULL, 0x3690000000000000ULL,
+};
+
+/// Returns a random fraction, with a denominator up to 1000
+static double RandomFraction() {
+    return ((double)(rng() % 2000001) - 1000000.0) / (double)(1 + rng() % 1000);
+}
+
+/// Returns a special value, random bits, an integer or a fraction
+static u32 RandomSingle() {
+    float value;
+    switch (rng() % 8) {
+    case 0:
+        return special_singles[rng() % ARRAY_SIZE(special_singles)];
+    case 1:
+    case 2:
+        return (u32)rng();
+    case 3:
+        value = (float)((s64)(rng() % 2001) - 1000);
+        break;
+    default:
+        value = (float)RandomFraction();
+        break;
+    }
+
+    u32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+/// Double version of RandomSingle
+static u64 RandomDouble() {
+    double value;
+    switch (rng() % 8) {
+    case 0:
+        return special_doubles[rng() % ARRAY_SIZE(special_doubles)];
+    case 1:
+    case 2:
+        return rng();
+    case 3:
+        value = (double)((s64)(rng() % 2001) - 1000);
+        break;
+    default:
+        value = RandomFraction();
+        break;
+    }
+
+    u64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+/**
+ * Encodes a data processing instruction
+ * @param is_double Whether the instruction operates on doubles
+ * @param opcode Opcode bits of the instruction
+ * @param d Destination register, s0-s31 or d0-d15
+ * @param n First operand register, ignored by the extension instructions which use its field
+ * @param m Second operand register
+ */
+static u32 Encode(bool is_double, u32 opcode, u32 d, u32 n, u32 m) {
+    if ((opcode & EXTENSION) == EXTENSION)
+        n = 0;
+    if (is_double) {
+        return 0x0E000B00 | opcode | ((d & 15) << 12) | ((d >> 4) << 22) | ((n & 15) << 16) |
+               ((n >> 4) << 7) | (m & 15) | ((m >> 4) << 5);
+    }
+    return 0x0E000A00 | opcode | ((d >> 1) << 12) | ((d & 1) << 22) | ((n >> 1) << 16) |
+           ((n & 1) << 7) | (m >> 1) | ((m & 1) << 5);
+}
+
+static u32 Execute(bool is_double, ARMul_State* state, u32 instruction, u32 fpscr) {
+    return is_double ? vfp_double_cpdo(state, instruction, fpscr)
+                     : vfp_single_cpdo(state, instruction, fpscr);
+}
+
+/// Returns the index-th register of a short vector starting at reg, wrapping around its bank
+static u32 VectorRegister(bool is_double, u32 reg, u32 index, u32 stride) {
+    const u32 bank_size = is_double ? 4 : 8;
+    const u32 bank = reg & ~(bank_size - 1);
+    return bank + (reg - bank + index * stride) % bank_size;
+}
+
+/**
+ * Runs a short vector instruction element by element, as scalar instructions on the registers the
+ * architecture gives each element, with the soft float code
+ * @return The exceptions raised by the elements
+ */
+static u32 ExecuteReference(const Operation& operation, bool is_double, ARMul_State* state,
+                            u32 d, u32 n, u32 m, u32 vector_length, u32 stride) {
+    const u32 bank_size = is_double ? 4 : 8;
+    // Instructions with a destination in the first bank are scalar whatever the vector length
+    const u32 length = d < bank_size ? 1 : vector_length;
+
+    u32 exceptions = 0;
+    for (u32 i = 0; i < length; ++i) {
+        // The second operand is a scalar used by every element if it is in the first bank
+        const u32 element_m = m < bank_size ? m : VectorRegister(is_double, m, i, stride);
+        const u32 instruction = Encode(is_double, operation.opcode,
+                                       VectorRegister(is_double, d, i, stride),
+                                       VectorRegister(is_double, n, i, stride), element_m);
+        exceptions |= Execute(is_double, state, instruction, FPSCR_IXE);
+    }
+    return exceptions;
+}
+
+/// Prints the registers which differ between two states
+static void PrintRegisterDifferences(const char* name, const ARMul_State& state,
+                                     const char* expected_name, const ARMul_State& expected) {
+    for (u32 r = 0; r < ARRAY_SIZE(state.ExtReg); ++r) {
+        if (state.ExtReg[r] != expected.ExtReg[r]) {
+            printf("    s%u: %s %08X, %s %08X\n", r, name, state.ExtReg[r], expected_name,
+                   expected.ExtReg[r]);
+        }
+    }
+}
+
+static bool SameResults(const ARMul_State& state, u32 exceptions, const ARMul_State& expected,
+                        u32 expected_exceptions) {
+    return memcmp(state.ExtReg, expected.ExtReg, sizeof(state.ExtReg)) == 0 &&
+           exceptions == expected_exceptions;
+}
+
+static ARMul_State host_state;
+static ARMul_State soft_state;
+static ARMul_State reference_state;
+
+/**
+ * Runs an instruction on random registers with the host FPU, with the soft float code, and for
+ * short vectors element by element
+ * @param vector_length Length of the short vectors, 1 for scalar instructions
+ * @param stride Distance between the registers of consecutive elements, 1 or 2
+ * @return The number of runs where the registers or exceptions differ
+ */
+static u32 Test(const Operation& operation, bool is_double, u32 vector_length, u32 stride,
+                u32 num_iterations) {
+    const u32 num_registers = is_double ? 16 : 32;
+    // Short vectors need a destination outside of the first bank
+    const u32 bank_size = is_double ? 4 : 8;
+    const u32 fpscr = ((vector_length - 1) << FPSCR_LENGTH_BIT) |
+                      (stride == 2 ? FPSCR_STRIDE_MASK : 0);
+
+    u32 num_mismatches = 0;
+    for (u32 i = 0; i < num_iterations; ++i) {
+        memset(host_state.ExtReg, 0, sizeof(host_state.ExtReg));
+        for (u32 r = 0; r < num_registers; ++r) {
+            if (is_double) {
+                const u64 value = RandomDouble();
+                host_state.ExtReg[r * 2] = (u32)value;
+                host_state.ExtReg[r * 2 + 1] = (u32)(value >> 32);
+            } else {
+                host_state.ExtReg[r] = RandomSingle();
+            }
+        }
+        memcpy(soft_state.ExtReg, host_state.ExtReg, sizeof(host_state.ExtReg));
+        memcpy(reference_state.ExtReg, host_state.ExtReg, sizeof(host_state.ExtReg));
+
+        u32 d = rng() % num_registers;
+        if (vector_length > 1) {
+            const u32 span = (vector_length - 1) * stride;
+            // Half of the vectors start close enough to the end of their bank to wrap around it
+            const u32 index = (rng() % 2) ? bank_size - 1 - rng() % span : rng() % bank_size;
+            d = bank_size * (1 + rng() % (num_registers / bank_size - 1)) + index;
+        }
+        const u32 n = rng() % num_registers;
+        const u32 m = rng() % num_registers;
+        const u32 instruction = Encode(is_double, operation.opcode, d, n, m);
+
+        const u32 host_exceptions = Execute(is_double, &host_state, instruction, fpscr);
+        const u32 soft_exceptions = Execute(is_double, &soft_state, instruction,
+                                            fpscr | FPSCR_IXE);
+
+        // Scalar instructions are only compared between the host and the soft float code
+        u32 reference_exceptions = soft_exceptions;
+        if (vector_length > 1) {
+            reference_exceptions = ExecuteReference(operation, is_double, &reference_state, d, n,
+                                                    m, vector_length, stride);
+        } else {
+            memcpy(reference_state.ExtReg, soft_state.ExtReg, sizeof(soft_state.ExtReg));
+        }
+
+        const bool host_matches = SameResults(host_state, host_exceptions, reference_state,
+                                              reference_exceptions);
+        const bool soft_matches = SameResults(soft_state, soft_exceptions, reference_state,
+                                              reference_exceptions);
+        if (host_matches && soft_matches)
+            continue;
+
+        if (num_mismatches++ < 3) {
+            printf("  %s.%s mismatch, instruction %08X, length %u, stride %u: exceptions host %X, "
+                   "soft %X, reference %X\n", operation.name, is_double ? "f64" : "f32",
+                   instruction, vector_length, stride, host_exceptions, soft_exceptions,
+                   reference_exceptions);
+            PrintRegisterDifferences("host", host_state, "reference", reference_state);
+            PrintRegisterDifferences("soft", soft_state, "reference", reference_state);
+        }
+    }
+    return num_mismatches;
+}
+
+int main(int argc, char** argv) {
+    const u32 num_iterations = argc > 1 ? (u32)std::strtoul(argv[1], nullptr, 10) : 100000;
+    rng.seed(argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1234);
+
+#ifndef VFP_HOST_FPU
+    printf("The host FPU path isn't compiled in, the soft float code is compared with itself\n");
+#endif
+
+    // Vector lengths and strides, as (length, stride). A vector fits in a bank, which holds 8
+    // singles or 4 doubles.
+    static const u32 vector_shapes[][2] = {
+        { 1, 1 }, { 3, 1 }, { 4, 1 }, { 8, 1 }, { 2, 2 }, { 3, 2 }, { 4, 2 },
+    };
+
+    u32 total_mismatches = 0;
+    for (int is_double = 0; is_double < 2; ++is_double) {
+        const u32 bank_size = is_double ? 4 : 8;
+        for (const Operation& operation : operations) {
+            for (const auto& shape : vector_shapes) {
+                const u32 vector_length = shape[0];
+                const u32 stride = shape[1];
+                if (vector_length > 1 && !operation.vector)
+                    continue;
+                if (vector_length * stride > bank_size)
+                    continue;
+
+                const u32 num_mismatches = Test(operation, is_double != 0, vector_length, stride,
+                                                num_iterations);
+                printf("%-7s %s length %u stride %u: %u mismatches\n", operation.name,
+                       is_double ? "f64" : "f32", vector_length, stride, num_mismatches);
+                total_mismatches += num_mismatches;
+            }
+        }
+    }
+
+    printf("%u mismatches\n", total_mismatches);
+    return total_mismatches == 0 ? 0 : 1;
+}
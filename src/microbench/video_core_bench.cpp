@@ -0,0 +1,457 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "common/common.h"
+
+#include "core/mem_map.h"
+#include "core/hw/gpu.h"
+
+#include "video_core/clipper.h"
+#include "video_core/math.h"
+#include "video_core/pica.h"
+#include "video_core/rasterizer.h"
+#include "video_core/vertex_shader.h"
+#include "video_core/debug_utils/debug_utils.h"
+
+#include "microbench/microbench.h"
+
+using Pica::float24;
+using Pica::Regs;
+using Pica::VertexShader::InputVertex;
+using Pica::VertexShader::OutputVertex;
+
+// Layout of the emulated VRAM used by the benchmarks
+static const u32 FRAMEBUFFER_SIZE = 512;
+static const u32 COLOR_BUFFER_PADDR = Memory::VRAM_PADDR;
+static const u32 DEPTH_BUFFER_PADDR = Memory::VRAM_PADDR + 0x100000;
+static const u32 TEXTURE_PADDR = Memory::VRAM_PADDR + 0x200000;
+static const u32 TRANSFER_INPUT_PADDR = Memory::VRAM_PADDR + 0x300000;
+static const u32 TRANSFER_OUTPUT_PADDR = Memory::VRAM_PADDR + 0x400000;
+
+static const u32 TEXTURE_SIZE = 64;
+
+static float24 F24(float value) {
+    return float24::FromFloat32(value);
+}
+
+/// Encodes a float in the 24-bit format of the Pica registers, inverse of FromRawFloat24
+static u32 ToRawFloat24(float value) {
+    if (value == 0)
+        return 0;
+
+    int exponent;
+    const float mantissa = std::frexp(std::abs(value), &exponent); // value = mantissa * 2^exponent
+    return ((value < 0) ? 0x800000 : 0) | ((u32)(exponent - 1 + 63) << 16) |
+           (u32)((mantissa * 2 - 1) * 65536);
+}
+
+/// Fills a buffer with the same pseudo-random bytes on every run
+static void FillPattern(u8* data, size_t size) {
+    u32 seed = 0x12345678;
+    for (size_t i = 0; i < size; ++i) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = (u8)(seed >> 16);
+    }
+}
+
+/// Resets the Pica registers to render into a plain framebuffer
+static void SetupPica() {
+    memset(&Pica::registers, 0, sizeof(Pica::registers));
+    auto& framebuffer = Pica::registers.framebuffer;
+    framebuffer.color_buffer_address = COLOR_BUFFER_PADDR / 8;
+    framebuffer.depth_buffer_address = DEPTH_BUFFER_PADDR / 8;
+    framebuffer.width = FRAMEBUFFER_SIZE;
+    framebuffer.height = FRAMEBUFFER_SIZE - 1;
+
+    // With zeroed registers, all texture combiner stages output the primary color
+}
+
+/// Enables an RGBA8 texture, modulated with the primary color by the first combiner stage
+static void SetupTexture() {
+    auto& regs = Pica::registers;
+    regs.texture0_enable = 1;
+    regs.texture0.address = TEXTURE_PADDR / 8;
+    regs.texture0.width = TEXTURE_SIZE;
+    regs.texture0.height = TEXTURE_SIZE;
+    regs.texture0.wrap_s = Regs::TextureConfig::Repeat;
+    regs.texture0.wrap_t = Regs::TextureConfig::Repeat;
+    regs.texture0_format = Regs::TextureFormat::RGBA8;
+    FillPattern(Memory::GetPointer(Pica::PAddrToVAddr(TEXTURE_PADDR)),
+                TEXTURE_SIZE * TEXTURE_SIZE * 4);
+
+    using Source = Regs::TevStageConfig::Source;
+    using Operation = Regs::TevStageConfig::Operation;
+    regs.tev_stage0.color_source1 = Source::Texture0;
+    regs.tev_stage0.color_source2 = Source::PrimaryColor;
+    regs.tev_stage0.alpha_source1 = Source::Texture0;
+    regs.tev_stage0.alpha_source2 = Source::PrimaryColor;
+    regs.tev_stage0.color_op = Operation::Modulate;
+    regs.tev_stage0.alpha_op = Operation::Modulate;
+    for (auto* stage : { &regs.tev_stage1, &regs.tev_stage2, &regs.tev_stage3,
+                         &regs.tev_stage4, &regs.tev_stage5 }) {
+        stage->color_source1 = Source::Previous;
+        stage->alpha_source1 = Source::Previous;
+    }
+}
+
+/// Makes a vertex at the given screen position, as output by the clipper
+static OutputVertex MakeScreenVertex(float x, float y, float u, float v) {
+    OutputVertex vertex;
+    memset(&vertex, 0, sizeof(vertex));
+    vertex.pos = Math::MakeVec(F24(0), F24(0), F24(0.5f), F24(1));
+    vertex.color = Math::MakeVec(F24(1), F24(0.5f), F24(0.25f), F24(1));
+    vertex.tc0 = Math::MakeVec(F24(u), F24(v));
+    vertex.screenpos = Math::MakeVec(F24(x), F24(y), F24(0.5f));
+    return vertex;
+}
+
+/// Makes a vertex at the given clip space position, as output by the vertex shader
+static OutputVertex MakeClipVertex(float x, float y) {
+    OutputVertex vertex = MakeScreenVertex(0, 0, (x + 1) / 2, (y + 1) / 2);
+    vertex.pos = Math::MakeVec(F24(x), F24(y), F24(0.5f), F24(1));
+    return vertex;
+}
+
+/// Rasterizes a right triangle whose legs are GetArg() pixels long
+static void RasterizeTriangle(Microbench::State& state, bool textured) {
+    SetupPica();
+    if (textured)
+        SetupTexture();
+
+    const float size = (float)state.GetArg();
+    const OutputVertex v0 = MakeScreenVertex(8, 8, 0, 0);
+    const OutputVertex v1 = MakeScreenVertex(8 + size, 8, 1, 0);
+    const OutputVertex v2 = MakeScreenVertex(8, 8 + size, 0, 1);
+
+    while (state.KeepRunning())
+        Pica::Rasterizer::ProcessTriangle(v0, v1, v2);
+    state.SetItemsProcessed(state.GetIterations() * state.GetArg() * state.GetArg() / 2);
+}
+
+static void RasterizerFlat(Microbench::State& state) {
+    RasterizeTriangle(state, false);
+}
+MICROBENCH_ARG(RasterizerFlat, 4);
+MICROBENCH_ARG(RasterizerFlat, 16);
+MICROBENCH_ARG(RasterizerFlat, 64);
+MICROBENCH_ARG(RasterizerFlat, 256);
+
+static void RasterizerTextured(Microbench::State& state) {
+    RasterizeTriangle(state, true);
+}
+MICROBENCH_ARG(RasterizerTextured, 4);
+MICROBENCH_ARG(RasterizerTextured, 16);
+MICROBENCH_ARG(RasterizerTextured, 64);
+MICROBENCH_ARG(RasterizerTextured, 256);
+
+/// Clips and rasterizes a small triangle, which is fully inside the view volume with GetArg() 0
+/// and crosses its right edge otherwise
+static void Clipper(Microbench::State& state) {
+    SetupPica();
+    auto& regs = Pica::registers;
+    regs.viewport_size_x = ToRawFloat24(FRAMEBUFFER_SIZE / 4);
+    regs.viewport_size_y = ToRawFloat24(FRAMEBUFFER_SIZE / 4);
+    regs.viewport_depth_range = ToRawFloat24(1);
+    regs.viewport_depth_far_plane = ToRawFloat24(1);
+
+    const float x = state.GetArg() ? 0.98f : 0.5f;
+    const OutputVertex v0 = MakeClipVertex(x, 0);
+    const OutputVertex v1 = MakeClipVertex(x + 0.04f, 0);
+    const OutputVertex v2 = MakeClipVertex(x, 0.04f);
+
+    while (state.KeepRunning()) {
+        // The clipper overwrites the screen positions of its input
+        OutputVertex vertices[3] = { v0, v1, v2 };
+        Pica::Clipper::ProcessTriangle(vertices[0], vertices[1], vertices[2]);
+    }
+    state.SetItemsProcessed(state.GetIterations());
+}
+MICROBENCH_ARG(Clipper, 0);
+MICROBENCH_ARG(Clipper, 1);
+
+// Shader instruction encoding (see nihstro/shader_bytecode.h)
+namespace Shader {
+
+enum OpCode : u32 {
+    ADD = 0x00,
+    DP3 = 0x01,
+    DP4 = 0x02,
+    MUL = 0x08,
+    MAX = 0x0C,
+    RSQ = 0x0F,
+    MOV = 0x13,
+    END = 0x22,
+};
+
+// Register indices as source operands; destinations use the output and temporary ranges
+static u32 Input(u32 index) { return index; }
+static u32 Temp(u32 index) { return 0x10 + index; }
+static u32 Uniform(u32 index) { return 0x20 + index; }
+static u32 Output(u32 index) { return index; }
+
+/// Swizzle patterns referenced by the operand descriptor index of the instructions
+enum OperandDesc : u32 {
+    XYZW,   ///< Writes all components
+    X,
+    Y,
+    Z,
+    W,
+    XYZ,
+    XYZW_SRC1_XXXX, ///< Writes all components, reading the x component of src1 into each of them
+};
+
+static u32 MakeSwizzle(u32 dest_mask, u32 src1_selector) {
+    const u32 IDENTITY = 0x1B; // xyzw, two bits per component starting with x in the high bits
+    return dest_mask | (src1_selector << 5) | (IDENTITY << 14);
+}
+
+static const u32 SWIZZLE_PATTERNS[] = {
+    MakeSwizzle(0xF, 0x1B),
+    MakeSwizzle(0x8, 0x1B),
+    MakeSwizzle(0x4, 0x1B),
+    MakeSwizzle(0x2, 0x1B),
+    MakeSwizzle(0x1, 0x1B),
+    MakeSwizzle(0xE, 0x1B),
+    MakeSwizzle(0xF, 0x00),
+};
+
+static u32 Arithmetic(OpCode opcode, OperandDesc desc, u32 dest, u32 src1, u32 src2 = 0) {
+    return (opcode << 26) | (dest << 21) | (src1 << 12) | (src2 << 7) | desc;
+}
+
+static u32 End() {
+    return END << 26;
+}
+
+/// Passes position, color and texture coordinates through
+static const std::vector<u32> PASSTHROUGH = {
+    Arithmetic(MOV, XYZW, Output(0), Input(0)),
+    Arithmetic(MOV, XYZW, Output(1), Input(1)),
+    Arithmetic(MOV, XYZW, Output(2), Input(2)),
+    End(),
+};
+
+/// Transforms the position by the matrix in c0-c3
+static const std::vector<u32> TRANSFORM = {
+    Arithmetic(DP4, X, Output(0), Uniform(0), Input(0)),
+    Arithmetic(DP4, Y, Output(0), Uniform(1), Input(0)),
+    Arithmetic(DP4, Z, Output(0), Uniform(2), Input(0)),
+    Arithmetic(DP4, W, Output(0), Uniform(3), Input(0)),
+    Arithmetic(MOV, XYZW, Output(1), Input(1)),
+    Arithmetic(MOV, XYZW, Output(2), Input(2)),
+    End(),
+};
+
+/// Transforms the position, and computes the diffuse lighting of the normal in v1 by the light
+/// of direction c4 and color c6, clamped at c5 (zero)
+static const std::vector<u32> LIGHTING = {
+    Arithmetic(DP4, X, Output(0), Uniform(0), Input(0)),
+    Arithmetic(DP4, Y, Output(0), Uniform(1), Input(0)),
+    Arithmetic(DP4, Z, Output(0), Uniform(2), Input(0)),
+    Arithmetic(DP4, W, Output(0), Uniform(3), Input(0)),
+    Arithmetic(DP3, X, Temp(0), Input(1), Input(1)),
+    Arithmetic(RSQ, X, Temp(0), Temp(0)),
+    Arithmetic(MUL, XYZW_SRC1_XXXX, Temp(1), Temp(0), Input(1)),
+    Arithmetic(DP3, XYZ, Temp(2), Uniform(4), Temp(1)),
+    Arithmetic(MAX, XYZ, Temp(2), Uniform(5), Temp(2)),
+    Arithmetic(MUL, XYZ, Output(1), Uniform(6), Temp(2)),
+    Arithmetic(MOV, W, Output(1), Uniform(6)),
+    Arithmetic(MOV, XYZW, Output(2), Input(2)),
+    End(),
+};
+
+} // namespace
+
+/// Loads a shader writing the position to o0, the color to o1 and the texture coordinates to o2
+static void SetupShader(const std::vector<u32>& program) {
+    SetupPica();
+    auto& regs = Pica::registers;
+
+    for (u32 i = 0; i < program.size(); ++i)
+        Pica::VertexShader::SubmitShaderMemoryChange(i, program[i]);
+    for (u32 i = 0; i < ARRAY_SIZE(Shader::SWIZZLE_PATTERNS); ++i)
+        Pica::VertexShader::SubmitSwizzleDataChange(i, Shader::SWIZZLE_PATTERNS[i]);
+    regs.vs_main_offset = 0;
+
+    regs.vs_input_register_map.attribute0_register = 0;
+    regs.vs_input_register_map.attribute1_register = 1;
+    regs.vs_input_register_map.attribute2_register = 2;
+
+    using Semantic = Regs::VSOutputAttributes::Semantic;
+    auto SetOutput = [&](int index, Semantic x, Semantic y, Semantic z, Semantic w) {
+        regs.vs_output_attributes[index].map_x = x;
+        regs.vs_output_attributes[index].map_y = y;
+        regs.vs_output_attributes[index].map_z = z;
+        regs.vs_output_attributes[index].map_w = w;
+    };
+    for (int i = 0; i < 7; ++i)
+        SetOutput(i, Semantic::INVALID, Semantic::INVALID, Semantic::INVALID, Semantic::INVALID);
+    SetOutput(0, Semantic::POSITION_X, Semantic::POSITION_Y, Semantic::POSITION_Z,
+              Semantic::POSITION_W);
+    SetOutput(1, Semantic::COLOR_R, Semantic::COLOR_G, Semantic::COLOR_B, Semantic::COLOR_A);
+    SetOutput(2, Semantic::TEXCOORD0_U, Semantic::TEXCOORD0_V, Semantic::INVALID,
+              Semantic::INVALID);
+
+    // A scaling matrix, a light direction, zero and a light color
+    for (u32 i = 0; i < 4; ++i) {
+        Pica::VertexShader::GetFloatUniform(i) = Math::MakeVec(
+            F24(i == 0 ? 0.5f : 0), F24(i == 1 ? 0.5f : 0), F24(i == 2 ? 0.5f : 0),
+            F24(i == 3 ? 1.0f : 0));
+    }
+    Pica::VertexShader::GetFloatUniform(4) = Math::MakeVec(F24(0.6f), F24(0.8f), F24(0), F24(0));
+    Pica::VertexShader::GetFloatUniform(5) = Math::MakeVec(F24(0), F24(0), F24(0), F24(0));
+    Pica::VertexShader::GetFloatUniform(6) = Math::MakeVec(F24(1), F24(0.9f), F24(0.8f), F24(1));
+}
+
+static void RunShader(Microbench::State& state, const std::vector<u32>& program) {
+    SetupShader(program);
+
+    const size_t NUM_VERTICES = 64;
+    std::vector<InputVertex> vertices(NUM_VERTICES);
+    for (size_t i = 0; i < NUM_VERTICES; ++i) {
+        const float t = (float)i / NUM_VERTICES;
+        memset(&vertices[i], 0, sizeof(vertices[i]));
+        vertices[i].attr[0] = Math::MakeVec(F24(t), F24(1 - t), F24(0.5f), F24(1));
+        vertices[i].attr[1] = Math::MakeVec(F24(t), F24(0.5f), F24(1 - t), F24(0));
+        vertices[i].attr[2] = Math::MakeVec(F24(t), F24(t), F24(0), F24(0));
+    }
+
+    size_t index = 0;
+    while (state.KeepRunning()) {
+        OutputVertex output = Pica::VertexShader::RunShader(vertices[index], 3);
+        Microbench::DoNotOptimize(output);
+        index = (index + 1) % NUM_VERTICES;
+    }
+    state.SetItemsProcessed(state.GetIterations());
+}
+
+static void VertexShaderPassthrough(Microbench::State& state) {
+    RunShader(state, Shader::PASSTHROUGH);
+}
+MICROBENCH(VertexShaderPassthrough);
+
+static void VertexShaderTransform(Microbench::State& state) {
+    RunShader(state, Shader::TRANSFORM);
+}
+MICROBENCH(VertexShaderTransform);
+
+static void VertexShaderLighting(Microbench::State& state) {
+    RunShader(state, Shader::LIGHTING);
+}
+MICROBENCH(VertexShaderLighting);
+
+/// Reads every texel of a texture of format GetArg()
+static void LookupTexture(Microbench::State& state) {
+    Pica::DebugUtils::TextureInfo info;
+    info.physical_address = TEXTURE_PADDR;
+    info.width = TEXTURE_SIZE;
+    info.height = TEXTURE_SIZE;
+    info.format = (Regs::TextureFormat)state.GetArg();
+    info.stride = Regs::NibblesPerPixel(info.format) * info.width / 2;
+
+    std::vector<u8> texture(TEXTURE_SIZE * TEXTURE_SIZE * 4);
+    FillPattern(texture.data(), texture.size());
+
+    while (state.KeepRunning()) {
+        for (int t = 0; t < info.height; ++t) {
+            for (int s = 0; s < info.width; ++s) {
+                Microbench::DoNotOptimize(
+                    Pica::DebugUtils::LookupTexture(texture.data(), s, t, info));
+            }
+        }
+    }
+    state.SetItemsProcessed(state.GetIterations() * info.width * info.height);
+}
+
+static int RegisterLookupTexture() {
+    static const struct {
+        Regs::TextureFormat format;
+        const char* name;
+    } formats[] = {
+        { Regs::TextureFormat::RGBA8, "RGBA8" },
+        { Regs::TextureFormat::RGB8, "RGB8" },
+        { Regs::TextureFormat::RGBA5551, "RGBA5551" },
+        { Regs::TextureFormat::RGB565, "RGB565" },
+        { Regs::TextureFormat::RGBA4, "RGBA4" },
+        { Regs::TextureFormat::IA8, "IA8" },
+        { Regs::TextureFormat::I8, "I8" },
+        { Regs::TextureFormat::A8, "A8" },
+        { Regs::TextureFormat::IA4, "IA4" },
+        { Regs::TextureFormat::A4, "A4" },
+    };
+    for (const auto& format : formats) {
+        Microbench::Register(std::string("LookupTexture/") + format.name, LookupTexture,
+                             (s64)format.format);
+    }
+    return 0;
+}
+static int lookup_texture_registration = RegisterLookupTexture();
+
+/// Converts a top screen sized RGBA8 framebuffer to RGB8, the only conversion implemented so far
+static void DisplayTransfer(Microbench::State& state) {
+    SetupPica();
+    const u32 WIDTH = 400, HEIGHT = 240;
+    FillPattern(Memory::GetPointer(Pica::PAddrToVAddr(TRANSFER_INPUT_PADDR)), WIDTH * HEIGHT * 4);
+
+    auto& config = GPU::g_regs.display_transfer_config;
+    config.input_address = TRANSFER_INPUT_PADDR / 8;
+    config.output_address = TRANSFER_OUTPUT_PADDR / 8;
+    config.input_width = WIDTH;
+    config.input_height = HEIGHT;
+    config.output_width = WIDTH;
+    config.output_height = HEIGHT;
+    config.input_format = GPU::Regs::PixelFormat::RGBA8;
+    config.output_format = GPU::Regs::PixelFormat::RGB8;
+
+    const u32 trigger_address = 0x1EF00000 + 4 * GPU_REG_INDEX(display_transfer_config.trigger);
+    while (state.KeepRunning())
+        GPU::Write<u32>(trigger_address, 1);
+    state.SetItemsProcessed(state.GetIterations() * WIDTH * HEIGHT);
+    state.SetBytesProcessed(state.GetIterations() * WIDTH * HEIGHT * 4);
+}
+MICROBENCH(DisplayTransfer);
+
+/// A dependent chain of float24 multiply-adds, as done by the clipper and the rasterizer
+static void Float24MulAdd(Microbench::State& state) {
+    float24 value = F24(1);
+    const float24 factor = F24(0.999f), offset = F24(0.001f);
+    while (state.KeepRunning()) {
+        for (int i = 0; i < 64; ++i)
+            value = value * factor + offset;
+    }
+    Microbench::DoNotOptimize(value);
+    state.SetItemsProcessed(state.GetIterations() * 64);
+}
+MICROBENCH(Float24MulAdd);
+
+/// Four-component float24 dot products, as done by the vertex shader
+static void Float24Dot4(Microbench::State& state) {
+    Math::Vec4<float24> a = Math::MakeVec(F24(0.5f), F24(0.25f), F24(0.125f), F24(1));
+    const Math::Vec4<float24> b = Math::MakeVec(F24(0.9f), F24(0.8f), F24(0.7f), F24(0.1f));
+    while (state.KeepRunning()) {
+        for (int i = 0; i < 64; ++i)
+            a.x = Math::Dot(a, b);
+    }
+    Microbench::DoNotOptimize(a);
+    state.SetItemsProcessed(state.GetIterations() * 64);
+}
+MICROBENCH(Float24Dot4);
+
+/// Decoding of float24 register values, as done for the viewport of every clipped vertex
+static void Float24FromRaw(Microbench::State& state) {
+    u32 raw[64];
+    for (u32 i = 0; i < 64; ++i)
+        raw[i] = ToRawFloat24(1.0f + i * 3.5f);
+
+    while (state.KeepRunning()) {
+        for (u32 i = 0; i < 64; ++i)
+            Microbench::DoNotOptimize(float24::FromRawFloat24(raw[i]));
+    }
+    state.SetItemsProcessed(state.GetIterations() * 64);
+}
+MICROBENCH(Float24FromRaw);
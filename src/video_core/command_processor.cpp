@@ -2,6 +2,10 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include "common/chunk_file.h"
+#include "common/profiler.h"
+#include "common/trace.h"
+
 #include "clipper.h"
 #include "command_processor.h"
 #include "math.h"
@@ -50,6 +54,8 @@ static inline void WritePicaReg(u32 id, u32 value, u32 mask) {
         case PICA_REG_INDEX(trigger_draw):
         case PICA_REG_INDEX(trigger_draw_indexed):
         {
+            TRACE_SCOPE(GPU, "Draw");
+
             DebugUtils::DumpTevStageConfig(registers.GetTevStages());
 
             if (g_debug_context)
@@ -294,6 +300,9 @@ static std::ptrdiff_t ExecuteCommandBlock(const u32* first_command_word) {
 }
 
 void ProcessCommandList(const u32* list, u32 size) {
+    PROFILE_SUBSYSTEM(CommandProcessor);
+    TRACE_SCOPE(GPU, "CommandList");
+
     u32* read_pointer = (u32*)list;
     u32 list_length = size / sizeof(u32);
 
@@ -302,6 +311,19 @@ void ProcessCommandList(const u32* list, u32 size) {
     }
 }
 
+void DoState(PointerWrap& p) {
+    auto s = p.Section("CommandProcessor", 1);
+    if (!s)
+        return;
+
+    // The register set is plain data, but its BitFields keep it from being recognized as POD
+    p.DoVoid(&registers, sizeof(registers));
+    p.Do(float_regs_counter);
+    p.DoArray(uniform_write_buffer, 4);
+    p.Do(vs_binary_write_offset);
+    p.Do(vs_swizzle_write_offset);
+}
+
 } // namespace
 
 } // namespace
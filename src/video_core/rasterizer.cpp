@@ -5,6 +5,7 @@
 #include <algorithm>
 
 #include "common/common_types.h"
+#include "common/profiler.h"
 
 #include "math.h"
 #include "pica.h"
@@ -43,6 +44,8 @@ void ProcessTriangle(const VertexShader::OutputVertex& v0,
                      const VertexShader::OutputVertex& v1,
                      const VertexShader::OutputVertex& v2)
 {
+    PROFILE_SUBSYSTEM_FINE(Rasterizer);
+
     // NOTE: Assuming that rasterizer coordinates are 12.4 fixed-point values
     struct Fix12P4 {
         Fix12P4() {}
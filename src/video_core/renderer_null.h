@@ -0,0 +1,24 @@
+// Copyright 2014 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "video_core/renderer_base.h"
+
+/// Renderer which displays nothing, used when running without a window (e.g. for benchmarks)
+class RendererNull : public RendererBase {
+public:
+    void SwapBuffers() override {
+        m_current_frame++;
+    }
+
+    void SetWindow(EmuWindow* window) override {
+    }
+
+    void Init() override {
+    }
+
+    void ShutDown() override {
+    }
+};
@@ -2,6 +2,7 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include "core/frame_pacing.h"
 #include "core/hw/gpu.h"
 #include "core/mem_map.h"
 #include "common/emu_window.h"
@@ -80,6 +81,8 @@ void RendererOpenGL::SwapBuffers() {
     // Swap buffers
     render_window->PollEvents();
     render_window->SwapBuffers();
+
+    UpdateFramerate();
 }
 
 /**
@@ -219,6 +222,7 @@ void RendererOpenGL::DrawScreens() {
 
 /// Updates the framerate
 void RendererOpenGL::UpdateFramerate() {
+    m_current_fps = (f32)FramePacing::GetStats().fps;
 }
 
 /**
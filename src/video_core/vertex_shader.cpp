@@ -6,7 +6,9 @@
 
 #include <boost/range/algorithm.hpp>
 
+#include <common/chunk_file.h>
 #include <common/file_util.h>
+#include <common/profiler.h>
 
 #include <core/mem_map.h>
 
@@ -439,6 +441,8 @@ static void ProcessShaderCode(VertexShaderState& state) {
 
 OutputVertex RunShader(const InputVertex& input, int num_attributes)
 {
+    PROFILE_SUBSYSTEM_FINE(VertexShader);
+
     VertexShaderState state;
 
     const u32* main = &shader_memory[registers.vs_main_offset];
@@ -498,6 +502,18 @@ OutputVertex RunShader(const InputVertex& input, int num_attributes)
 }
 
 
+void DoState(PointerWrap& p)
+{
+    auto s = p.Section("VertexShader", 1);
+    if (!s)
+        return;
+
+    // float24 isn't POD, but the uniforms are plain data
+    p.DoVoid(&shader_uniforms, sizeof(shader_uniforms));
+    p.DoArray(shader_memory.data(), (int)shader_memory.size());
+    p.DoArray(swizzle_data.data(), (int)swizzle_data.size());
+}
+
 } // namespace
 
 } // namespace
@@ -11,6 +11,8 @@
 #include "math.h"
 #include "pica.h"
 
+class PointerWrap;
+
 namespace Pica {
 
 namespace VertexShader {
@@ -77,6 +79,9 @@ bool& GetBoolUniform(u32 index);
 const std::array<u32, 1024>& GetShaderBinary();
 const std::array<u32, 1024>& GetSwizzlePatterns();
 
+/// Saves or loads the uniforms, the shader binary and the swizzle patterns
+void DoState(PointerWrap& p);
+
 } // namespace
 
 } // namespace
@@ -3,13 +3,17 @@
 // Refer to the license.txt file included.
 
 #include "common/common.h"
+#include "common/chunk_file.h"
 #include "common/emu_window.h"
 #include "common/log.h"
 
 #include "core/core.h"
 
+#include "video_core/command_processor.h"
 #include "video_core/video_core.h"
 #include "video_core/renderer_base.h"
+#include "video_core/renderer_null.h"
+#include "video_core/vertex_shader.h"
 #include "video_core/renderer_opengl/renderer_opengl.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -24,7 +28,11 @@ int             g_current_frame = 0;
 /// Initialize the video core
 void Init(EmuWindow* emu_window) {
     g_emu_window = emu_window;
-    g_renderer = new RendererOpenGL();
+    if (emu_window != nullptr) {
+        g_renderer = new RendererOpenGL();
+    } else {
+        g_renderer = new RendererNull();
+    }
     g_renderer->SetWindow(g_emu_window);
     g_renderer->Init();
 
@@ -39,4 +47,14 @@ void Shutdown() {
     LOG_DEBUG(Render, "shutdown OK");
 }
 
+void DoState(PointerWrap& p) {
+    auto s = p.Section("VideoCore", 1);
+    if (!s)
+        return;
+
+    Pica::CommandProcessor::DoState(p);
+    Pica::VertexShader::DoState(p);
+    p.Do(g_current_frame);
+}
+
 } // namespace
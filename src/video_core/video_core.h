@@ -9,6 +9,8 @@
 
 #include "renderer_base.h"
 
+class PointerWrap;
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Video Core namespace
 
@@ -36,10 +38,16 @@ extern EmuWindow*      g_emu_window;            ///< Emu window
 /// Start the video core
 void Start();
 
-/// Initialize the video core
+/**
+ * Initialize the video core
+ * @param emu_window Window to render to, or nullptr to run without displaying anything
+ */
 void Init(EmuWindow* emu_window);
 
 /// Shutdown the video core
 void Shutdown();
 
+/// Saves or loads the state of the emulated GPU. Nothing of the renderer is saved.
+void DoState(PointerWrap& p);
+
 } // namespace